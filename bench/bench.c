@@ -0,0 +1,72 @@
+#include "bench.h"
+
+#include <stdatomic.h> // atomic_uint_least64_t
+#include <stddef.h>    // size_t
+#include <time.h>      // clock_gettime
+
+static atomic_uint_least64_t allocations = 0;
+
+#ifdef BENCH_COUNT_ALLOCATIONS
+void *__real_malloc(size_t size);
+
+void *__wrap_malloc(size_t size) {
+  atomic_fetch_add_explicit(&allocations, 1, memory_order_relaxed);
+  return __real_malloc(size);
+}
+#endif
+
+uint64_t bench_allocations(void) {
+  return atomic_load_explicit(&allocations, memory_order_relaxed);
+}
+
+bool bench_counts_allocations(void) {
+#ifdef BENCH_COUNT_ALLOCATIONS
+  return true;
+#else
+  return false;
+#endif
+}
+
+static volatile uint64_t sink = 0;
+
+void bench_consume(uint64_t value) { sink += value; }
+
+uint64_t bench_now_ns(void) {
+  struct timespec ts = {0};
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void bench_report_begin(bench_report *report, FILE *file) {
+  report->file = file;
+  report->first_result = true;
+  fprintf(file, "{\n  \"benchmarks\": [");
+}
+
+void bench_report_end(bench_report *report) {
+  fprintf(report->file, "\n  ]\n}\n");
+  fflush(report->file);
+}
+
+void bench_result_begin(bench_report *report, const char *name) {
+  fprintf(report->file, "%s\n    {\"name\": \"%s\"",
+          report->first_result ? "" : ",", name);
+  report->first_result = false;
+
+  // Progress goes to stderr so stdout stays valid JSON.
+  fprintf(stderr, "%s\n", name);
+}
+
+void bench_metric(bench_report *report, const char *name, double value) {
+  // Print counts as integers rather than in exponent notation.
+  if (value > -1e15 && value < 1e15 && value == (double)(int64_t)value) {
+    fprintf(report->file, ", \"%s\": %lld", name, (long long)value);
+  } else {
+    fprintf(report->file, ", \"%s\": %.6g", name, value);
+  }
+}
+
+void bench_result_end(bench_report *report) {
+  fprintf(report->file, "}");
+  fflush(report->file);
+}
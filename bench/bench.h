@@ -0,0 +1,100 @@
+#pragma once
+
+#include <stdbool.h> // bool
+#include <stdint.h>  // uint64_t
+#include <stdio.h>   // FILE
+
+/**
+ * Writes benchmark results as JSON:
+ *
+ *     {"benchmarks": [{"name": "...", "<metric>": <value>, ...}, ...]}
+ *
+ * Metric names carry their unit, e.g. ns_per_op, so results can be compared
+ * between releases without knowing how each benchmark works.
+ */
+typedef struct bench_report bench_report;
+struct bench_report {
+  FILE *file;
+  bool first_result;
+};
+
+/**
+ * @brief Start a report.
+ *
+ * @param[out] report The report to start.
+ * @param[in] file The file to write the JSON to.
+ */
+void bench_report_begin(bench_report *report, FILE *file);
+
+/**
+ * @brief Finish a report.
+ *
+ * @param[in,out] report The report to finish.
+ */
+void bench_report_end(bench_report *report);
+
+/**
+ * @brief Start a benchmark result.
+ *
+ * @param[in,out] report The report.
+ * @param[in] name The name of the benchmark, as group/case.
+ */
+void bench_result_begin(bench_report *report, const char *name);
+
+/**
+ * @brief Add a metric to the current benchmark result.
+ *
+ * @param[in,out] report The report.
+ * @param[in] name The name of the metric, including its unit.
+ * @param[in] value The value of the metric.
+ */
+void bench_metric(bench_report *report, const char *name, double value);
+
+/**
+ * @brief Finish the current benchmark result.
+ *
+ * @param[in,out] report The report.
+ */
+void bench_result_end(bench_report *report);
+
+/**
+ * @brief Get the current CLOCK_MONOTONIC time in nanoseconds.
+ */
+uint64_t bench_now_ns(void);
+
+/**
+ * @brief Get the number of calls to malloc() so far.
+ *
+ * @return The number of allocations, or 0 if allocations aren't counted.
+ */
+uint64_t bench_allocations(void);
+
+/**
+ * @brief Whether malloc() calls are counted.
+ *
+ * Allocations are counted when the benchmark is linked with
+ * -Wl,--wrap=malloc and built with BENCH_COUNT_ALLOCATIONS.
+ */
+bool bench_counts_allocations(void);
+
+/**
+ * @brief Keep a value alive so the work that produced it isn't optimized
+ * away.
+ */
+void bench_consume(uint64_t value);
+
+/**
+ * Benchmark groups. Each returns 0 on success, -1 on failure.
+ */
+int bench_hue_stream_message(bench_report *report);
+int bench_frame_slot(bench_report *report);
+int bench_cue_sheet(bench_report *report);
+int bench_animation(bench_report *report);
+int bench_easing(bench_report *report);
+int bench_hue_dtls(bench_report *report, const char *bridge_ip);
+int bench_stream_metrics(bench_report *report);
+int bench_color(bench_report *report);
+int bench_gamut(bench_report *report);
+int bench_ambilight(bench_report *report);
+int bench_audio(bench_report *report);
+int bench_prng(bench_report *report);
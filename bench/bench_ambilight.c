@@ -0,0 +1,115 @@
+/**
+ * Benchmark for the ambilight zone averaging.
+ *
+ * Renders the channels of a full entertainment area from a 4K 4:2:0 frame,
+ * with every kernel the CPU supports. Each kernel's largest difference from
+ * the scalar kernel is reported alongside its time per frame, which must stay
+ * well within the 16.7 ms of a 60 fps frame.
+ */
+
+#include "ambilight.h"
+#include "bench.h"
+#include <stdio.h>  // fprintf, snprintf
+#include <stdlib.h> // abs, free, malloc
+
+#define WIDTH 3840
+#define HEIGHT 2160
+#define CHANNEL_COUNT HUE_STREAM_MESSAGE_MAX_CHANNELS
+#define ITERATIONS 100
+
+static hue_stream_message_data reference[CHANNEL_COUNT];
+static hue_stream_message_data data[CHANNEL_COUNT];
+
+static int max_error(void) {
+  int error = 0;
+  for (int i = 0; i < CHANNEL_COUNT; i++) {
+    for (int j = 0; j < HUE_STREAM_MESSAGE_COLOR_VALUE_ELEMENTS; j++) {
+      const int difference =
+          abs(data[i].color_value[j] - reference[i].color_value[j]);
+      error = difference > error ? difference : error;
+    }
+  }
+  return error;
+}
+
+static int bench_kernel(bench_report *report, const y4m_frame *frame,
+                        const hue_entertainment_channel *channels,
+                        color_kernel kernel) {
+  ambilight light = {0};
+  if (ambilight_init(&light, frame, channels, CHANNEL_COUNT, kernel)) {
+    fprintf(stderr, "ambilight_init() failed\n");
+    return -1;
+  }
+
+  const uint64_t start = bench_now_ns();
+  for (int i = 0; i < ITERATIONS; i++) {
+    if (ambilight_render(&light, frame, data)) {
+      fprintf(stderr, "ambilight_render() failed\n");
+      return -1;
+    }
+  }
+  const uint64_t elapsed_ns = bench_now_ns() - start;
+
+  char name[64] = {0};
+  snprintf(name, sizeof(name), "ambilight/4k_%s", color_kernel_name(kernel));
+  bench_result_begin(report, name);
+  bench_metric(report, "channels", CHANNEL_COUNT);
+  bench_metric(report, "ns_per_frame", (double)elapsed_ns / ITERATIONS);
+  bench_metric(report, "max_error_lsb", max_error());
+  bench_result_end(report);
+
+  bench_consume(data[CHANNEL_COUNT - 1].color_value[0]);
+  return 0;
+}
+
+int bench_ambilight(bench_report *report) {
+  const size_t luma_size = (size_t)WIDTH * HEIGHT;
+  const size_t chroma_size = luma_size / 4;
+  uint8_t *buffer = malloc(luma_size + 2 * chroma_size);
+  if (!buffer) {
+    perror("malloc");
+    return -1;
+  }
+
+  // A fixed pseudo-random frame, so runs are comparable.
+  uint32_t state = 1;
+  for (size_t i = 0; i < luma_size + 2 * chroma_size; i++) {
+    state = state * 1664525 + 1013904223;
+    buffer[i] = state >> 24;
+  }
+
+  const y4m_frame frame = {
+      .width = WIDTH,
+      .height = HEIGHT,
+      .chroma_shift_x = 1,
+      .chroma_shift_y = 1,
+      .has_chroma = true,
+      .planes = {buffer, buffer + luma_size, buffer + luma_size + chroma_size},
+      .strides = {WIDTH, WIDTH / 2, WIDTH / 2},
+  };
+
+  // Lights around the screen, from bottom left to top right.
+  hue_entertainment_channel channels[CHANNEL_COUNT] = {0};
+  for (int i = 0; i < CHANNEL_COUNT; i++) {
+    channels[i].channel_id = i;
+    channels[i].x = -1.0 + 2.0 * i / (CHANNEL_COUNT - 1);
+    channels[i].z = -1.0 + (i % 3);
+  }
+
+  int ret = 0;
+  ambilight light = {0};
+  if (ambilight_init(&light, &frame, channels, CHANNEL_COUNT,
+                     COLOR_KERNEL_SCALAR) ||
+      ambilight_render(&light, &frame, reference)) {
+    ret = -1;
+  }
+
+  const color_kernel best = color_kernel_best();
+  for (color_kernel kernel = COLOR_KERNEL_SCALAR; !ret && kernel <= best;
+       kernel++) {
+    ret = bench_kernel(report, &frame, channels, kernel);
+  }
+
+  free(buffer);
+  return ret;
+}
@@ -0,0 +1,92 @@
+/**
+ * Benchmark for rendering the built-in animations.
+ *
+ * Each animation is played from start to end on a manual clock that advances
+ * one 60 fps frame per call, so the cost per frame covers the cue lookup and
+ * the effect, with no sleeping.
+ */
+
+#include "animation.h"
+#include "bench.h"
+
+#define CHANNEL_COUNT 10
+#define FRAMES_PER_SECOND 60
+#define PASSES 20
+#define NANOSECONDS_PER_SECOND 1000000000L
+
+typedef animation_status (*animation_function)(hue_stream_message_data *frame,
+                                               int channel_count,
+                                               animation_context *context);
+
+typedef struct animation_bench animation_bench;
+struct animation_bench {
+  const char *name;
+  animation_function function;
+};
+
+static const animation_bench animations[] = {
+    {"animation/thx_deep_note", animation_thx_deep_note},
+    {"animation/spider_man_into_the_spider_verse",
+     animation_spider_man_into_the_spider_verse},
+    {"animation/spider_man_across_the_spider_verse",
+     animation_spider_man_across_the_spider_verse},
+};
+
+// Play an animation to the end. Returns the number of frames rendered, or -1
+// on failure.
+static int play(animation_function function, hue_stream_message_data *frame) {
+  const struct timespec start_time = {0};
+  animation_clock clock = {0};
+  animation_clock_init_manual(&clock, &start_time);
+
+  animation_context context = {0};
+  if (animation_context_init(&context, &clock)) {
+    fprintf(stderr, "animation_context_init() failed\n");
+    return -1;
+  }
+
+  int frames = 0;
+  while (true) {
+    const animation_status status = function(frame, CHANNEL_COUNT, &context);
+    if (status == ANIMATION_STATUS_ERROR) {
+      fprintf(stderr, "animation failed\n");
+      return -1;
+    }
+
+    if (status == ANIMATION_STATUS_END) {
+      return frames;
+    }
+
+    bench_consume(frame[frames % CHANNEL_COUNT].color_value[2]);
+    frames++;
+    animation_clock_advance(&clock,
+                            NANOSECONDS_PER_SECOND / FRAMES_PER_SECOND);
+  }
+}
+
+int bench_animation(bench_report *report) {
+  hue_stream_message_data frame[CHANNEL_COUNT] = {0};
+  for (int i = 0; i < CHANNEL_COUNT; i++) {
+    frame[i].channel_id = i;
+  }
+
+  for (size_t i = 0; i < sizeof(animations) / sizeof(animations[0]); i++) {
+    uint64_t frames = 0;
+    const uint64_t start = bench_now_ns();
+    for (int pass = 0; pass < PASSES; pass++) {
+      const int pass_frames = play(animations[i].function, frame);
+      if (pass_frames < 0) {
+        return -1;
+      }
+      frames += pass_frames;
+    }
+    const uint64_t elapsed_ns = bench_now_ns() - start;
+
+    bench_result_begin(report, animations[i].name);
+    bench_metric(report, "frames", frames);
+    bench_metric(report, "ns_per_frame", (double)elapsed_ns / frames);
+    bench_result_end(report);
+  }
+
+  return 0;
+}
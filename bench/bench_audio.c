@@ -0,0 +1,96 @@
+/**
+ * Benchmark for the audio analyzer.
+ *
+ * Analyzes a window per 60 Hz frame of a fixed noisy tone at 48 kHz, with
+ * every kernel the CPU supports, then renders a full entertainment area from
+ * it. The time per window must stay a small part of a frame for the lights to
+ * follow the audio within one frame. Each kernel's largest band difference
+ * from the scalar kernel is reported alongside, and the allocations per window
+ * when they are counted, which should be none.
+ */
+
+#include "audio_analyzer.h"
+#include "bench.h"
+#include <math.h>  // fabsf, sinf
+#include <stdio.h> // fprintf, snprintf
+
+#define SAMPLE_RATE 48000
+#define HOP_SIZE (SAMPLE_RATE / 60)
+#define CHANNEL_COUNT HUE_STREAM_MESSAGE_MAX_CHANNELS
+#define ITERATIONS 20000
+// The signal repeats after this many hops.
+#define HOP_COUNT 64
+
+static float signal[HOP_COUNT * HOP_SIZE];
+static audio_analyzer reference;
+static audio_analyzer analyzer;
+
+static int analyze(audio_analyzer *a, color_kernel kernel, int iterations,
+                   hue_stream_message_data *frame) {
+  if (audio_analyzer_init(a, SAMPLE_RATE, kernel)) {
+    fprintf(stderr, "audio_analyzer_init() failed\n");
+    return -1;
+  }
+
+  float flash = 0.0f;
+  for (int i = 0; i < iterations; i++) {
+    const float *hop = signal + (i % HOP_COUNT) * HOP_SIZE;
+    if (audio_analyzer_process(a, hop, HOP_SIZE) ||
+        audio_analyzer_render(a, frame, CHANNEL_COUNT, &flash)) {
+      fprintf(stderr, "audio_analyzer_process() failed\n");
+      return -1;
+    }
+  }
+  return 0;
+}
+
+static float max_error(void) {
+  float error = 0.0f;
+  for (int i = 0; i < AUDIO_ANALYZER_BAND_COUNT; i++) {
+    const float difference = fabsf(analyzer.bands[i] - reference.bands[i]);
+    error = difference > error ? difference : error;
+  }
+  return error;
+}
+
+int bench_audio(bench_report *report) {
+  // A tone with a burst of noise twice a second, so onsets are found.
+  uint32_t state = 1;
+  for (int i = 0; i < HOP_COUNT * HOP_SIZE; i++) {
+    state = state * 1664525 + 1013904223;
+    const float noise = (float)(state >> 8) / (1 << 24) * 2.0f - 1.0f;
+    signal[i] = 0.5f * sinf(2.0f * 3.14159265f * 440.0f * i / SAMPLE_RATE) +
+                (i % (SAMPLE_RATE / 2) < 480 ? 0.5f * noise : 0.0f);
+  }
+
+  hue_stream_message_data frame[CHANNEL_COUNT] = {0};
+  if (analyze(&reference, COLOR_KERNEL_SCALAR, ITERATIONS, frame)) {
+    return -1;
+  }
+
+  const color_kernel best = color_kernel_best();
+  for (color_kernel kernel = COLOR_KERNEL_SCALAR; kernel <= best; kernel++) {
+    uint64_t allocations = bench_allocations();
+    const uint64_t start = bench_now_ns();
+    if (analyze(&analyzer, kernel, ITERATIONS, frame)) {
+      return -1;
+    }
+    const uint64_t elapsed_ns = bench_now_ns() - start;
+    allocations = bench_allocations() - allocations;
+
+    char name[64] = {0};
+    snprintf(name, sizeof(name), "audio/window_%s", color_kernel_name(kernel));
+    bench_result_begin(report, name);
+    bench_metric(report, "window_size", AUDIO_ANALYZER_WINDOW_SIZE);
+    bench_metric(report, "ns_per_window", (double)elapsed_ns / ITERATIONS);
+    bench_metric(report, "max_band_error", max_error());
+    if (bench_counts_allocations()) {
+      bench_metric(report, "allocations_per_window",
+                   (double)allocations / ITERATIONS);
+    }
+    bench_result_end(report);
+
+    bench_consume(frame[CHANNEL_COUNT - 1].color_value[0]);
+  }
+  return 0;
+}
@@ -0,0 +1,89 @@
+/**
+ * Benchmark for converting RGB frames to xy + brightness.
+ *
+ * Converts a frame as large as a video-driven effect would feed, with every
+ * kernel the CPU supports, from linear floats and from 8-bit sRGB. Each
+ * kernel's largest difference from the scalar kernel is reported alongside its
+ * speed, in units of the 16-bit output.
+ */
+
+#include "bench.h"
+#include "color.h"
+#include <stdio.h>  // fprintf, snprintf
+#include <stdlib.h> // abs
+
+#define CHANNEL_COUNT 4096
+#define ITERATIONS 2000
+
+static float linear[3 * CHANNEL_COUNT];
+static uint8_t srgb8[3 * CHANNEL_COUNT];
+static hue_stream_message_data reference[CHANNEL_COUNT];
+static hue_stream_message_data data[CHANNEL_COUNT];
+
+static int max_error(void) {
+  int error = 0;
+  for (int i = 0; i < CHANNEL_COUNT; i++) {
+    for (int j = 0; j < HUE_STREAM_MESSAGE_COLOR_VALUE_ELEMENTS; j++) {
+      const int difference =
+          abs(data[i].color_value[j] - reference[i].color_value[j]);
+      error = difference > error ? difference : error;
+    }
+  }
+  return error;
+}
+
+static int bench_kernel(bench_report *report, color_kernel kernel,
+                        bool srgb) {
+  if (srgb ? color_srgb8_to_xy_brightness(COLOR_KERNEL_SCALAR, srgb8,
+                                          CHANNEL_COUNT, reference)
+           : color_linear_to_xy_brightness(COLOR_KERNEL_SCALAR, linear,
+                                           CHANNEL_COUNT, reference)) {
+    return -1;
+  }
+
+  const uint64_t start = bench_now_ns();
+  for (int i = 0; i < ITERATIONS; i++) {
+    const int ret = srgb ? color_srgb8_to_xy_brightness(kernel, srgb8,
+                                                        CHANNEL_COUNT, data)
+                         : color_linear_to_xy_brightness(kernel, linear,
+                                                         CHANNEL_COUNT, data);
+    if (ret) {
+      fprintf(stderr, "color_%s_to_xy_brightness() failed\n",
+              srgb ? "srgb8" : "linear");
+      return -1;
+    }
+  }
+  const uint64_t elapsed_ns = bench_now_ns() - start;
+
+  char name[64] = {0};
+  snprintf(name, sizeof(name), "color/%s_%s", srgb ? "srgb8" : "linear",
+           color_kernel_name(kernel));
+  bench_result_begin(report, name);
+  bench_metric(report, "channels", CHANNEL_COUNT);
+  bench_metric(report, "ns_per_channel",
+               (double)elapsed_ns / ITERATIONS / CHANNEL_COUNT);
+  bench_metric(report, "max_error_lsb", max_error());
+  bench_result_end(report);
+
+  bench_consume(data[CHANNEL_COUNT - 1].color_value[0]);
+  return 0;
+}
+
+int bench_color(bench_report *report) {
+  // A fixed pseudo-random frame, so runs are comparable.
+  uint32_t state = 1;
+  for (int i = 0; i < 3 * CHANNEL_COUNT; i++) {
+    state = state * 1664525 + 1013904223;
+    srgb8[i] = state >> 24;
+    linear[i] = color_srgb_to_linear(srgb8[i] / 255.0f);
+  }
+
+  const color_kernel best = color_kernel_best();
+  for (color_kernel kernel = COLOR_KERNEL_SCALAR; kernel <= best; kernel++) {
+    if (bench_kernel(report, kernel, false) ||
+        bench_kernel(report, kernel, true)) {
+      return -1;
+    }
+  }
+  return 0;
+}
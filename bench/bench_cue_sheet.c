@@ -0,0 +1,96 @@
+/**
+ * Benchmark for finding the active cue on every frame.
+ *
+ * Plays a synthetic 100k-cue timeline forward at 60 fps and reports the cost
+ * per frame in each tenth of the timeline, for the linear scan animate() used
+ * to do and for cue_sheet_find(). The cursor keeps the cost flat no matter
+ * how far into the timeline playback is. Random seeks exercise the binary
+ * search fallback.
+ */
+
+#include "bench.h"
+#include "cue_sheet.h"
+#include <stdlib.h> // malloc, free, rand
+
+#define CUE_COUNT 100000
+#define CUE_DURATION_SECONDS 0.1
+#define FRAMES_PER_SECOND 60
+#define SEGMENTS 10
+#define LINEAR_FRAMES_PER_SEGMENT 200
+#define SEEKS 1000000
+
+// The lookup animate() did before cue_sheet_find().
+static int linear_find(const cue_sheet *sheet, double time) {
+  for (int i = 0; i < sheet->cue_count; i++) {
+    const double start_time = sheet->cues[i].start_time;
+    const double end_time =
+        i < sheet->cue_count - 1 ? sheet->cues[i + 1].start_time : 0;
+    if (time >= start_time && time < end_time) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+int bench_cue_sheet(bench_report *report) {
+  cue *cues = malloc(CUE_COUNT * sizeof(cue));
+  if (!cues) {
+    perror("malloc");
+    return -1;
+  }
+
+  const animation_effect *hold = animation_effect_find("hold");
+  for (int i = 0; i < CUE_COUNT; i++) {
+    cues[i] =
+        (cue){i * CUE_DURATION_SECONDS, hold, 0, {0}, EASING_QUADRATIC};
+  }
+
+  const cue_sheet sheet = {"synthetic", CUE_COUNT, cues};
+  const double duration = (CUE_COUNT - 1) * CUE_DURATION_SECONDS;
+  const int frames = duration * FRAMES_PER_SECOND;
+  const int frames_per_segment = frames / SEGMENTS;
+
+  uint64_t checksum = 0;
+
+  int cursor = 0;
+  for (int segment = 0; segment < SEGMENTS; segment++) {
+    const int first = segment * frames_per_segment;
+
+    uint64_t start = bench_now_ns();
+    for (int frame = first; frame < first + LINEAR_FRAMES_PER_SEGMENT;
+         frame++) {
+      checksum += linear_find(&sheet, (double)frame / FRAMES_PER_SECOND);
+    }
+    const double linear_ns =
+        (double)(bench_now_ns() - start) / LINEAR_FRAMES_PER_SEGMENT;
+
+    start = bench_now_ns();
+    for (int frame = first; frame < first + frames_per_segment; frame++) {
+      checksum +=
+          cue_sheet_find(&sheet, (double)frame / FRAMES_PER_SECOND, &cursor);
+    }
+    const double cursor_ns =
+        (double)(bench_now_ns() - start) / frames_per_segment;
+
+    char name[64] = {0};
+    snprintf(name, sizeof(name), "cue_sheet/find_segment_%d", segment);
+    bench_result_begin(report, name);
+    bench_metric(report, "cues", CUE_COUNT);
+    bench_metric(report, "linear_ns_per_frame", linear_ns);
+    bench_metric(report, "cursor_ns_per_frame", cursor_ns);
+    bench_result_end(report);
+  }
+
+  const uint64_t start = bench_now_ns();
+  for (int i = 0; i < SEEKS; i++) {
+    checksum += cue_sheet_find(&sheet, rand() % (int)duration, &cursor);
+  }
+  bench_result_begin(report, "cue_sheet/random_seek");
+  bench_metric(report, "iterations", SEEKS);
+  bench_metric(report, "ns_per_op", (double)(bench_now_ns() - start) / SEEKS);
+  bench_result_end(report);
+
+  bench_consume(checksum);
+  free(cues);
+  return 0;
+}
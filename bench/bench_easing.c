@@ -0,0 +1,109 @@
+/**
+ * Benchmark for the easing curves fades are rendered with.
+ *
+ * Interpolates the 16-bit color components of a few fades over a phase with
+ * each curve, in double precision, the way fades were rendered before, and
+ * in fixed point, eased once per frame. The fixed-point results are checked
+ * against the double ones, and the benchmark fails if any is more than
+ * MAX_ERROR off.
+ */
+
+#include "bench.h"
+#include "easing.h"
+
+#define STEPS 1000000
+// The most a fixed-point result may differ from the double one, in the smallest
+// step of a 16-bit value.
+#define MAX_ERROR 1
+
+typedef struct fade fade;
+struct fade {
+  int start;
+  int end;
+};
+
+// Fades the built-in animations use, up, down and across the whole range.
+static const fade fades[] = {
+    {0x0000, 0xffff},
+    {0xffff, 0x00ff},
+    {0x2b00, 0x50d2},
+    {0x00ff, 0xffff},
+};
+
+#define FADE_COUNT (int)(sizeof(fades) / sizeof(fades[0]))
+
+static void report_values(bench_report *report, easing_curve curve,
+                          const char *path, uint64_t elapsed_ns) {
+  char name[64];
+  snprintf(name, sizeof(name), "easing/%s/%s", easing_name(curve), path);
+  bench_result_begin(report, name);
+  bench_metric(report, "values", (double)STEPS * FADE_COUNT);
+  bench_metric(report, "ns_per_value",
+               (double)elapsed_ns / ((double)STEPS * FADE_COUNT));
+  bench_result_end(report);
+}
+
+static int bench_curve(bench_report *report, easing_curve curve) {
+  uint64_t sum = 0;
+  uint64_t start = bench_now_ns();
+  for (int step = 0; step < STEPS; step++) {
+    const double progress = (double)step / STEPS;
+    for (int i = 0; i < FADE_COUNT; i++) {
+      sum += (int)(fades[i].start + (fades[i].end - fades[i].start) *
+                                        easing_reference(curve, progress));
+    }
+  }
+  report_values(report, curve, "double", bench_now_ns() - start);
+
+  // Like animate(), ease once per frame and interpolate every value from it.
+  start = bench_now_ns();
+  for (int step = 0; step < STEPS; step++) {
+    const uint32_t eased =
+        easing_apply(curve, easing_progress((double)step / STEPS));
+    for (int i = 0; i < FADE_COUNT; i++) {
+      sum += easing_interpolate(fades[i].start, fades[i].end, eased);
+    }
+  }
+  report_values(report, curve, "fixed", bench_now_ns() - start);
+
+  int max_error = 0;
+  for (int i = 0; i < FADE_COUNT; i++) {
+    for (int step = 0; step <= STEPS; step++) {
+      const double progress = (double)step / STEPS;
+      const int expected =
+          fades[i].start + (fades[i].end - fades[i].start) *
+                               easing_reference(curve, progress);
+      const int actual = easing_interpolate(
+          fades[i].start, fades[i].end,
+          easing_apply(curve, easing_progress(progress)));
+      const int error = actual > expected ? actual - expected
+                                          : expected - actual;
+      if (error > max_error) {
+        max_error = error;
+      }
+    }
+  }
+
+  char name[64];
+  snprintf(name, sizeof(name), "easing/%s/error", easing_name(curve));
+  bench_result_begin(report, name);
+  bench_metric(report, "max_error_lsb", max_error);
+  bench_result_end(report);
+
+  bench_consume(sum);
+  if (max_error > MAX_ERROR) {
+    fprintf(stderr, "%s easing is off by %d\n", easing_name(curve),
+            max_error);
+    return -1;
+  }
+  return 0;
+}
+
+int bench_easing(bench_report *report) {
+  for (int curve = 0; curve < EASING_CURVE_COUNT; curve++) {
+    if (bench_curve(report, curve)) {
+      return -1;
+    }
+  }
+  return 0;
+}
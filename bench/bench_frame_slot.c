@@ -0,0 +1,145 @@
+/**
+ * Contention benchmark for the render-to-stream frame handoff.
+ *
+ * A producer and a consumer thread hand frames to each other as fast as they
+ * can, first through a mutex-protected frame (the old current_frame path) and
+ * then through a frame_slot. The latency of every publish and read is timed
+ * so that the cost of waiting on the other thread shows up in the maximum.
+ */
+
+#include "bench.h"
+#include "frame_slot.h"
+#include <pthread.h>
+#include <stdatomic.h> // atomic_bool
+#include <stdio.h>     // snprintf
+#include <string.h>    // memcpy
+
+#define CHANNEL_COUNT 10
+#define OPERATIONS 2000000
+
+typedef struct latency latency;
+struct latency {
+  uint64_t count;
+  uint64_t total_ns;
+  uint64_t max_ns;
+};
+
+static void latency_add(latency *l, uint64_t ns) {
+  l->count++;
+  l->total_ns += ns;
+  if (ns > l->max_ns) {
+    l->max_ns = ns;
+  }
+}
+
+static void latency_report(bench_report *report, const char *name,
+                           const latency *l) {
+  char metric[64] = {0};
+  snprintf(metric, sizeof(metric), "%s_ops", name);
+  bench_metric(report, metric, l->count);
+  snprintf(metric, sizeof(metric), "%s_mean_ns", name);
+  bench_metric(report, metric,
+               l->count ? (double)l->total_ns / l->count : 0.0);
+  snprintf(metric, sizeof(metric), "%s_max_ns", name);
+  bench_metric(report, metric, l->max_ns);
+}
+
+static atomic_bool producing = false;
+
+// Mutex path.
+
+static pthread_mutex_t mutex_frame_mutex = PTHREAD_MUTEX_INITIALIZER;
+static hue_stream_message_data mutex_frame[CHANNEL_COUNT] = {0};
+
+static void *mutex_producer(void *arg) {
+  latency *l = arg;
+  hue_stream_message_data frame[CHANNEL_COUNT] = {0};
+  for (int i = 0; i < OPERATIONS; i++) {
+    frame[0].color_value[0] = i;
+    const uint64_t start = bench_now_ns();
+    pthread_mutex_lock(&mutex_frame_mutex);
+    memcpy(mutex_frame, frame, sizeof(frame));
+    pthread_mutex_unlock(&mutex_frame_mutex);
+    latency_add(l, bench_now_ns() - start);
+  }
+  atomic_store(&producing, false);
+  return NULL;
+}
+
+static void mutex_consumer(latency *l) {
+  hue_stream_message_data frame[CHANNEL_COUNT] = {0};
+  while (atomic_load(&producing)) {
+    const uint64_t start = bench_now_ns();
+    pthread_mutex_lock(&mutex_frame_mutex);
+    memcpy(frame, mutex_frame, sizeof(frame));
+    pthread_mutex_unlock(&mutex_frame_mutex);
+    latency_add(l, bench_now_ns() - start);
+  }
+}
+
+// Frame slot path.
+
+static frame_slot slot = {0};
+
+static void *slot_producer(void *arg) {
+  latency *l = arg;
+  hue_stream_message_data frame[CHANNEL_COUNT] = {0};
+  for (int i = 0; i < OPERATIONS; i++) {
+    frame[0].color_value[0] = i;
+    const uint64_t start = bench_now_ns();
+    frame_slot_publish(&slot, frame, start);
+    latency_add(l, bench_now_ns() - start);
+  }
+  atomic_store(&producing, false);
+  return NULL;
+}
+
+static void slot_consumer(latency *l) {
+  hue_stream_message_data frame[CHANNEL_COUNT] = {0};
+  while (atomic_load(&producing)) {
+    const uint64_t start = bench_now_ns();
+    memcpy(frame, frame_slot_acquire(&slot, NULL), sizeof(frame));
+    latency_add(l, bench_now_ns() - start);
+  }
+}
+
+static int run(bench_report *report, const char *name,
+               void *(*producer)(void *), void (*consumer)(latency *)) {
+  latency publish = {0};
+  latency read = {0};
+
+  atomic_store(&producing, true);
+  pthread_t thread = 0;
+  if (pthread_create(&thread, NULL, producer, &publish)) {
+    fprintf(stderr, "pthread_create() failed\n");
+    return -1;
+  }
+
+  const uint64_t start = bench_now_ns();
+  consumer(&read);
+  pthread_join(thread, NULL);
+  const double elapsed = (bench_now_ns() - start) / 1e9;
+
+  bench_result_begin(report, name);
+  bench_metric(report, "elapsed_s", elapsed);
+  latency_report(report, "publish", &publish);
+  latency_report(report, "read", &read);
+  bench_result_end(report);
+  return 0;
+}
+
+int bench_frame_slot(bench_report *report) {
+  hue_stream_message_data frame[CHANNEL_COUNT] = {0};
+  if (frame_slot_init(&slot, frame, CHANNEL_COUNT)) {
+    fprintf(stderr, "frame_slot_init() failed\n");
+    return -1;
+  }
+
+  if (run(report, "frame_slot/mutex_handoff", mutex_producer,
+          mutex_consumer) ||
+      run(report, "frame_slot/handoff", slot_producer, slot_consumer)) {
+    return -1;
+  }
+
+  return 0;
+}
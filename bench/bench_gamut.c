@@ -0,0 +1,89 @@
+/**
+ * Benchmark for moving frames into the lights' gamuts.
+ *
+ * Maps a frame of colors spread over the whole xy plane, most of them outside
+ * every gamut, into each gamut through the lookup tables and through the exact
+ * geometric clamp. The tables' largest difference from the clamp is reported
+ * alongside their speed, in units of the 16-bit coordinates.
+ */
+
+#include "bench.h"
+#include "gamut.h"
+#include <stdio.h>  // snprintf
+#include <stdlib.h> // abs
+
+#define CHANNEL_COUNT 4096
+#define ITERATIONS 2000
+
+static hue_stream_message_data frame[CHANNEL_COUNT];
+static hue_stream_message_data reference[CHANNEL_COUNT];
+static hue_stream_message_data mapped[CHANNEL_COUNT];
+static gamut_type gamuts[CHANNEL_COUNT];
+
+static int max_error(void) {
+  int error = 0;
+  for (int i = 0; i < CHANNEL_COUNT; i++) {
+    for (int j = 0; j < 2; j++) {
+      const int difference =
+          abs(mapped[i].color_value[j] - reference[i].color_value[j]);
+      error = difference > error ? difference : error;
+    }
+  }
+  return error;
+}
+
+static void report_result(bench_report *report, gamut_type type,
+                          const char *method, uint64_t elapsed_ns,
+                          bool with_error) {
+  char name[64] = {0};
+  snprintf(name, sizeof(name), "gamut/%s_%s", gamut_name(type), method);
+  bench_result_begin(report, name);
+  bench_metric(report, "channels", CHANNEL_COUNT);
+  bench_metric(report, "ns_per_channel",
+               (double)elapsed_ns / ITERATIONS / CHANNEL_COUNT);
+  if (with_error) {
+    bench_metric(report, "max_error_lsb", max_error());
+  }
+  bench_result_end(report);
+}
+
+static void bench_type(bench_report *report, gamut_type type) {
+  for (int i = 0; i < CHANNEL_COUNT; i++) {
+    gamuts[i] = type;
+  }
+
+  uint64_t start = bench_now_ns();
+  for (int i = 0; i < ITERATIONS; i++) {
+    for (int j = 0; j < CHANNEL_COUNT; j++) {
+      reference[j] = frame[j];
+      gamut_clamp(type, &reference[j].color_value[0],
+                  &reference[j].color_value[1]);
+    }
+  }
+  report_result(report, type, "exact", bench_now_ns() - start, false);
+
+  start = bench_now_ns();
+  for (int i = 0; i < ITERATIONS; i++) {
+    gamut_map_frame(gamuts, frame, mapped, CHANNEL_COUNT);
+  }
+  report_result(report, type, "table", bench_now_ns() - start, true);
+
+  bench_consume(mapped[CHANNEL_COUNT - 1].color_value[0]);
+}
+
+int bench_gamut(bench_report *report) {
+  // A fixed pseudo-random frame, so runs are comparable.
+  uint32_t state = 1;
+  for (int i = 0; i < CHANNEL_COUNT; i++) {
+    frame[i].channel_id = i % HUE_STREAM_MESSAGE_MAX_CHANNELS;
+    for (int j = 0; j < HUE_STREAM_MESSAGE_COLOR_VALUE_ELEMENTS; j++) {
+      state = state * 1664525 + 1013904223;
+      frame[i].color_value[j] = state >> 16;
+    }
+  }
+
+  for (gamut_type type = GAMUT_A; type < GAMUT_TYPE_COUNT; type++) {
+    bench_type(report, type);
+  }
+  return 0;
+}
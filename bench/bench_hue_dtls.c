@@ -0,0 +1,167 @@
+/**
+ * Benchmark for sending Hue stream messages over DTLS.
+ *
+ * Connects to a bridge, normally hue_bridge_emulator on loopback, and times
+ * hue_dtls_send_message() and hue_dtls_send_buffer() back to back. Restarting
+ * the entertainment area over the REST client's kept-alive connection is timed
+ * against the first, cold start. Without a bridge the benchmark is reported as
+ * skipped.
+ */
+
+#include "bench.h"
+#include "hue_dtls_client.h"
+#include "hue_rest_client.h"
+#include <stdlib.h> // free
+
+#define CHANNEL_COUNT 10
+#define ENTERTAINMENT_CONFIG_ID "2d4cb563-4244-4bfc-9bb2-f5a08068df84"
+#define ITERATIONS 10000
+#define RESTART_ITERATIONS 20
+
+static void report_result(bench_report *report, const char *name,
+                          uint64_t elapsed_ns, uint64_t allocations) {
+  bench_result_begin(report, name);
+  bench_metric(report, "iterations", ITERATIONS);
+  bench_metric(report, "ns_per_op", (double)elapsed_ns / ITERATIONS);
+  if (bench_counts_allocations()) {
+    bench_metric(report, "allocations_per_op",
+                 (double)allocations / ITERATIONS);
+  }
+  bench_result_end(report);
+}
+
+static int send_messages(bench_report *report, hue_dtls_context *context,
+                         hue_stream_message_data *frame) {
+  hue_stream_message *message =
+      hue_stream_message_create(frame, CHANNEL_COUNT, ENTERTAINMENT_CONFIG_ID);
+  if (!message) {
+    fprintf(stderr, "hue_stream_message_create() failed\n");
+    return -1;
+  }
+
+  int ret = 0;
+  uint64_t allocations = bench_allocations();
+  uint64_t start = bench_now_ns();
+  for (int i = 0; !ret && i < ITERATIONS; i++) {
+    message->sequence_id = i;
+    message->data[i % CHANNEL_COUNT].color_value[0] = i;
+    ret = hue_dtls_send_message(context, message, CHANNEL_COUNT);
+  }
+  free(message);
+
+  if (ret) {
+    fprintf(stderr, "hue_dtls_send_message() failed\n");
+    return -1;
+  }
+
+  report_result(report, "hue_dtls/send_message", bench_now_ns() - start,
+                bench_allocations() - allocations);
+
+  hue_stream_message_buffer buffer = {0};
+  if (hue_stream_message_buffer_init(
+          &buffer, ENTERTAINMENT_CONFIG_ID,
+          HUE_STREAM_MESSAGE_COLOR_SPACE_XY_BRIGHTNESS)) {
+    fprintf(stderr, "hue_stream_message_buffer_init() failed\n");
+    return -1;
+  }
+
+  allocations = bench_allocations();
+  start = bench_now_ns();
+  for (int i = 0; !ret && i < ITERATIONS; i++) {
+    frame[i % CHANNEL_COUNT].color_value[0] = i;
+    hue_stream_message_buffer_write(&buffer, i, frame, CHANNEL_COUNT);
+    ret = hue_dtls_send_buffer(context, &buffer);
+  }
+
+  if (ret) {
+    fprintf(stderr, "hue_dtls_send_buffer() failed\n");
+    return -1;
+  }
+
+  report_result(report, "hue_dtls/send_buffer", bench_now_ns() - start,
+                bench_allocations() - allocations);
+  return 0;
+}
+
+// Start the area, then stop and start it again as between two titles.
+static int restart_area(bench_report *report, hue_rest_client *client,
+                        const hue_rest_area *area) {
+  uint64_t start = bench_now_ns();
+  if (hue_rest_client_start(client, area, 1)) {
+    fprintf(stderr, "hue_rest_client_start() failed\n");
+    return -1;
+  }
+
+  bench_result_begin(report, "hue_rest/cold_start");
+  bench_metric(report, "ns_per_op", bench_now_ns() - start);
+  bench_result_end(report);
+
+  start = bench_now_ns();
+  for (int i = 0; i < RESTART_ITERATIONS; i++) {
+    if (hue_rest_client_stop(client, area, 1) ||
+        hue_rest_client_start(client, area, 1)) {
+      fprintf(stderr, "hue_rest_client_stop() or _start() failed\n");
+      return -1;
+    }
+  }
+
+  bench_result_begin(report, "hue_rest/restart");
+  bench_metric(report, "iterations", RESTART_ITERATIONS);
+  bench_metric(report, "ns_per_op",
+               (double)(bench_now_ns() - start) / RESTART_ITERATIONS);
+  bench_result_end(report);
+  return 0;
+}
+
+int bench_hue_dtls(bench_report *report, const char *bridge_ip) {
+  if (!bridge_ip) {
+    bench_result_begin(report, "hue_dtls/send_message");
+    bench_metric(report, "skipped", 1);
+    bench_result_end(report);
+    return 0;
+  }
+
+  hue_rest_client *client = hue_rest_client_create();
+  if (!client) {
+    fprintf(stderr, "hue_rest_client_create() failed\n");
+    return -1;
+  }
+
+  const hue_rest_area area = {bridge_ip, ENTERTAINMENT_CONFIG_ID};
+  if (restart_area(report, client, &area)) {
+    hue_rest_client_free(client);
+    return -1;
+  }
+
+  hue_dtls_context *context = hue_dtls_context_create();
+  if (!context) {
+    fprintf(stderr, "hue_dtls_context_create() failed\n");
+    hue_rest_client_stop(client, &area, 1);
+    hue_rest_client_free(client);
+    return -1;
+  }
+
+  const uint64_t start = bench_now_ns();
+  if (hue_dtls_connect(context, bridge_ip)) {
+    fprintf(stderr, "hue_dtls_connect() failed\n");
+    hue_dtls_context_free(context);
+    hue_rest_client_stop(client, &area, 1);
+    hue_rest_client_free(client);
+    return -1;
+  }
+
+  bench_result_begin(report, "hue_dtls/connect");
+  bench_metric(report, "ns_per_op", bench_now_ns() - start);
+  bench_result_end(report);
+
+  hue_stream_message_data frame[CHANNEL_COUNT] = {0};
+  for (int i = 0; i < CHANNEL_COUNT; i++) {
+    frame[i].channel_id = i;
+  }
+
+  const int ret = send_messages(report, context, frame);
+  hue_dtls_context_free(context);
+  hue_rest_client_stop(client, &area, 1);
+  hue_rest_client_free(client);
+  return ret;
+}
@@ -0,0 +1,104 @@
+/**
+ * Microbenchmark for building a Hue stream message per frame.
+ *
+ * Compares the allocating path (hue_stream_message_create() followed by
+ * hue_stream_message_serialize()) with a reusable hue_stream_message_buffer.
+ * When allocations are counted, the allocations made by each path are
+ * reported too.
+ */
+
+#include "bench.h"
+#include "hue_stream_message.h"
+#include <stdlib.h> // free
+#include <string.h> // memcmp
+
+#define CHANNEL_COUNT 10
+#define ENTERTAINMENT_CONFIG_ID "2d4cb563-4244-4bfc-9bb2-f5a08068df84"
+#define ITERATIONS 1000000
+
+static void report_result(bench_report *report, const char *name,
+                          uint64_t elapsed_ns, uint64_t allocations) {
+  bench_result_begin(report, name);
+  bench_metric(report, "iterations", ITERATIONS);
+  bench_metric(report, "ns_per_op", (double)elapsed_ns / ITERATIONS);
+  if (bench_counts_allocations()) {
+    bench_metric(report, "allocations_per_op",
+                 (double)allocations / ITERATIONS);
+  }
+  bench_result_end(report);
+}
+
+int bench_hue_stream_message(bench_report *report) {
+  hue_stream_message_data frame[CHANNEL_COUNT] = {0};
+  for (int i = 0; i < CHANNEL_COUNT; i++) {
+    frame[i].channel_id = i;
+  }
+
+  // Allocating path, split into its two calls.
+  uint64_t create_ns = 0;
+  uint64_t serialize_ns = 0;
+  uint64_t allocations = bench_allocations();
+  for (int i = 0; i < ITERATIONS; i++) {
+    frame[i % CHANNEL_COUNT].color_value[0] = i;
+
+    const uint64_t start = bench_now_ns();
+    hue_stream_message *message = hue_stream_message_create(
+        frame, CHANNEL_COUNT, ENTERTAINMENT_CONFIG_ID);
+    const uint64_t created = bench_now_ns();
+    uint8_t *buffer = NULL;
+    size_t buffer_size = 0;
+    hue_stream_message_serialize(message, CHANNEL_COUNT, &buffer,
+                                 &buffer_size);
+    serialize_ns += bench_now_ns() - created;
+    create_ns += created - start;
+
+    bench_consume(buffer[buffer_size - 1]);
+    free(buffer);
+    free(message);
+  }
+  allocations = bench_allocations() - allocations;
+
+  // Each path allocates once per frame.
+  report_result(report, "hue_stream_message/create", create_ns,
+                allocations / 2);
+  report_result(report, "hue_stream_message/serialize", serialize_ns,
+                allocations / 2);
+
+  // Reusable buffer path.
+  hue_stream_message_buffer buffer = {0};
+  if (hue_stream_message_buffer_init(
+          &buffer, ENTERTAINMENT_CONFIG_ID,
+          HUE_STREAM_MESSAGE_COLOR_SPACE_XY_BRIGHTNESS)) {
+    fprintf(stderr, "hue_stream_message_buffer_init() failed\n");
+    return -1;
+  }
+
+  allocations = bench_allocations();
+  const uint64_t start = bench_now_ns();
+  for (int i = 0; i < ITERATIONS; i++) {
+    frame[i % CHANNEL_COUNT].color_value[0] = i;
+    hue_stream_message_buffer_write(&buffer, 0, frame, CHANNEL_COUNT);
+    bench_consume(buffer.data[buffer.size - 1]);
+  }
+  report_result(report, "hue_stream_message/buffer_write",
+                bench_now_ns() - start, bench_allocations() - allocations);
+
+  // Both paths must produce the same bytes.
+  hue_stream_message *message =
+      hue_stream_message_create(frame, CHANNEL_COUNT, ENTERTAINMENT_CONFIG_ID);
+  uint8_t *serialized = NULL;
+  size_t serialized_size = 0;
+  hue_stream_message_serialize(message, CHANNEL_COUNT, &serialized,
+                               &serialized_size);
+  const int mismatch = serialized_size != buffer.size ||
+                       memcmp(serialized, buffer.data, buffer.size);
+  free(serialized);
+  free(message);
+
+  if (mismatch) {
+    fprintf(stderr, "serialized messages differ\n");
+    return -1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,43 @@
+/**
+ * Benchmark for the random numbers animations draw.
+ *
+ * Draws the 16-bit color components random effects use, from the C library's
+ * rand(), which animations used to share, and from an animation's own
+ * xoshiro256** generator.
+ */
+
+#include "bench.h"
+#include "prng.h"
+#include <stdlib.h> // rand, srand
+
+#define ITERATIONS 10000000
+#define BOUND 0xffff
+
+static void report_numbers(bench_report *report, const char *name,
+                           uint64_t elapsed_ns) {
+  bench_result_begin(report, name);
+  bench_metric(report, "numbers", ITERATIONS);
+  bench_metric(report, "ns_per_number", (double)elapsed_ns / ITERATIONS);
+  bench_result_end(report);
+}
+
+int bench_prng(bench_report *report) {
+  srand(1);
+  uint64_t sum = 0;
+  uint64_t start = bench_now_ns();
+  for (int i = 0; i < ITERATIONS; i++) {
+    sum += rand() % BOUND;
+  }
+  report_numbers(report, "prng/rand", bench_now_ns() - start);
+
+  prng generator = {0};
+  prng_seed(&generator, 1);
+  start = bench_now_ns();
+  for (int i = 0; i < ITERATIONS; i++) {
+    sum += prng_below(&generator, BOUND);
+  }
+  report_numbers(report, "prng/xoshiro256", bench_now_ns() - start);
+
+  bench_consume(sum);
+  return 0;
+}
@@ -0,0 +1,32 @@
+/**
+ * Benchmark for the cost of timing a hot path stage.
+ *
+ * Times stream_metrics_record() including the clock read that starts the
+ * stage, which is the overhead each instrumented stage adds per frame.
+ */
+
+#include "bench.h"
+#include "stream_metrics.h"
+
+#define ITERATIONS 10000000
+
+int bench_stream_metrics(bench_report *report) {
+  static stream_metrics metrics = {0};
+  stream_metrics_init(&metrics);
+
+  const uint64_t start = bench_now_ns();
+  for (int i = 0; i < ITERATIONS; i++) {
+    const uint64_t start_ns = latency_histogram_now_ns();
+    stream_metrics_record(&metrics, STREAM_STAGE_SEND, start_ns);
+  }
+  const uint64_t elapsed_ns = bench_now_ns() - start;
+
+  bench_result_begin(report, "stream_metrics/record");
+  bench_metric(report, "iterations", ITERATIONS);
+  bench_metric(report, "ns_per_op", (double)elapsed_ns / ITERATIONS);
+  bench_result_end(report);
+
+  bench_consume(latency_histogram_percentile(
+      &metrics.stages[STREAM_STAGE_SEND], 99));
+  return 0;
+}
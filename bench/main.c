@@ -0,0 +1,62 @@
+/**
+ * Runs every microbenchmark and writes the results to stdout as JSON, so
+ * regressions can be tracked between releases.
+ */
+
+#include "bench.h"
+#include "hue_rest_client.h"
+#include <getopt.h> // getopt_long
+
+static void usage(const char *program) {
+  fprintf(stderr, "Usage: %s [--bridge <Hue bridge IP address>]\n", program);
+}
+
+int main(int argc, char *argv[]) {
+  static const struct option options[] = {
+      {"bridge", required_argument, NULL, 'b'},
+      {"help", no_argument, NULL, 'h'},
+      {NULL, 0, NULL, 0}};
+
+  const char *bridge_ip = NULL;
+
+  int option = 0;
+  while ((option = getopt_long(argc, argv, "b:h", options, NULL)) != -1) {
+    switch (option) {
+    case 'b':
+      bridge_ip = optarg;
+      break;
+    case 'h':
+      usage(argv[0]);
+      return 0;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (optind != argc) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  if (hue_rest_global_init()) {
+    fprintf(stderr, "hue_rest_global_init() failed\n");
+    return 1;
+  }
+
+  bench_report report = {0};
+  bench_report_begin(&report, stdout);
+
+  const int ret = bench_hue_stream_message(&report) ||
+                  bench_frame_slot(&report) || bench_cue_sheet(&report) ||
+                  bench_animation(&report) || bench_easing(&report) ||
+                  bench_prng(&report) ||
+                  bench_stream_metrics(&report) ||
+                  bench_color(&report) || bench_gamut(&report) ||
+                  bench_ambilight(&report) || bench_audio(&report) ||
+                  bench_hue_dtls(&report, bridge_ip);
+
+  bench_report_end(&report);
+  hue_rest_global_cleanup();
+  return ret ? 1 : 0;
+}
@@ -0,0 +1,35 @@
+# Embed text cue sheets in a C header, so the built-in animations are compiled
+# from the same files that ship in movies/.
+#
+# Usage:
+#   cmake -DINPUTS=<cue sheet>,<cue sheet>... -DOUTPUT=<header>
+#         -P EmbedCueSheets.cmake
+#
+# The header defines builtin_cue_sheet_texts, with the bytes and size of each
+# cue sheet in the order given.
+
+string(REPLACE "," ";" inputs "${INPUTS}")
+
+set(content "// Generated by EmbedCueSheets.cmake. Do not edit.\n")
+string(APPEND content "#pragma once\n\n#include <stddef.h> // size_t\n\n")
+string(APPEND content "typedef struct builtin_cue_sheet_text builtin_cue_sheet_text;\n")
+string(APPEND content "struct builtin_cue_sheet_text {\n")
+string(APPEND content "  const unsigned char *text;\n  size_t size;\n};\n\n")
+
+set(entries "")
+set(index 0)
+foreach(input IN LISTS inputs)
+  file(READ "${input}" hex HEX)
+  string(REGEX REPLACE "([0-9a-f][0-9a-f])" "0x\\1," bytes "${hex}")
+  string(APPEND content "// ${input}\n")
+  string(APPEND content
+         "static const unsigned char builtin_cue_sheet_${index}[] = {${bytes}};\n\n")
+  string(APPEND entries
+         "    {builtin_cue_sheet_${index}, sizeof(builtin_cue_sheet_${index})},\n")
+  math(EXPR index "${index} + 1")
+endforeach()
+
+string(APPEND content "static const builtin_cue_sheet_text builtin_cue_sheet_texts[] = {\n")
+string(APPEND content "${entries}};\n")
+
+file(WRITE "${OUTPUT}" "${content}")
@@ -0,0 +1,67 @@
+# Find Mbed TLS.
+#
+# Defines the imported targets MbedTLS::mbedtls, MbedTLS::mbedx509 and
+# MbedTLS::mbedcrypto, the same names Mbed TLS's own CMake package exports.
+# Homebrew's prefixes are searched too. Set MbedTLS_ROOT to use another
+# installation.
+
+set(_mbedtls_hints
+    /opt/homebrew/opt/mbedtls
+    /usr/local/opt/mbedtls
+)
+
+find_path(MbedTLS_INCLUDE_DIR mbedtls/ssl.h
+    HINTS ${_mbedtls_hints}
+    PATH_SUFFIXES include
+)
+find_library(MbedTLS_LIBRARY mbedtls HINTS ${_mbedtls_hints} PATH_SUFFIXES lib)
+find_library(MbedTLS_X509_LIBRARY mbedx509 HINTS ${_mbedtls_hints} PATH_SUFFIXES lib)
+find_library(MbedTLS_CRYPTO_LIBRARY mbedcrypto HINTS ${_mbedtls_hints} PATH_SUFFIXES lib)
+
+# Mbed TLS 3 defines its version in build_info.h, Mbed TLS 2 in version.h.
+foreach(_mbedtls_header build_info.h version.h)
+  set(_mbedtls_header_path "${MbedTLS_INCLUDE_DIR}/mbedtls/${_mbedtls_header}")
+  if(MbedTLS_INCLUDE_DIR AND NOT MbedTLS_VERSION AND EXISTS "${_mbedtls_header_path}")
+    file(STRINGS "${_mbedtls_header_path}" _mbedtls_version_line
+        REGEX "^#define[ \t]+MBEDTLS_VERSION_STRING[ \t]+\"[0-9.]+\"")
+    string(REGEX REPLACE ".*\"([0-9.]+)\".*" "\\1" MbedTLS_VERSION
+        "${_mbedtls_version_line}")
+  endif()
+endforeach()
+
+include(FindPackageHandleStandardArgs)
+find_package_handle_standard_args(MbedTLS
+    REQUIRED_VARS
+        MbedTLS_LIBRARY
+        MbedTLS_X509_LIBRARY
+        MbedTLS_CRYPTO_LIBRARY
+        MbedTLS_INCLUDE_DIR
+    VERSION_VAR MbedTLS_VERSION
+)
+
+if(MbedTLS_FOUND AND NOT TARGET MbedTLS::mbedtls)
+  add_library(MbedTLS::mbedcrypto UNKNOWN IMPORTED)
+  set_target_properties(MbedTLS::mbedcrypto PROPERTIES
+      IMPORTED_LOCATION "${MbedTLS_CRYPTO_LIBRARY}"
+      INTERFACE_INCLUDE_DIRECTORIES "${MbedTLS_INCLUDE_DIR}"
+  )
+
+  add_library(MbedTLS::mbedx509 UNKNOWN IMPORTED)
+  set_target_properties(MbedTLS::mbedx509 PROPERTIES
+      IMPORTED_LOCATION "${MbedTLS_X509_LIBRARY}"
+      INTERFACE_LINK_LIBRARIES MbedTLS::mbedcrypto
+  )
+
+  add_library(MbedTLS::mbedtls UNKNOWN IMPORTED)
+  set_target_properties(MbedTLS::mbedtls PROPERTIES
+      IMPORTED_LOCATION "${MbedTLS_LIBRARY}"
+      INTERFACE_LINK_LIBRARIES MbedTLS::mbedx509
+  )
+endif()
+
+mark_as_advanced(
+    MbedTLS_INCLUDE_DIR
+    MbedTLS_LIBRARY
+    MbedTLS_X509_LIBRARY
+    MbedTLS_CRYPTO_LIBRARY
+)
@@ -0,0 +1,1013 @@
+/**
+ * A local stand-in for a Hue bridge, for testing and benchmarking the stream
+ * path without real hardware.
+ *
+ * It serves the REST calls that list entertainment areas and the lights
+ * behind them, start and stop streaming to one and report its status over
+ * HTTPS, keeping connections alive between requests like the bridge does. It
+ * accepts the DTLS handshake on port 2100 with the bridge's PSK cipher suite,
+ * and decodes every HueStream packet it receives. The arrival time of each
+ * packet is recorded, so packet rate, jitter and end-to-end latency can be
+ * measured on a plain Linux box.
+ * With --calibrate, it times the flashes of `resonate --calibrate` against
+ * the start of each second, which is the lookahead the stream path needs.
+ *
+ * The DTLS server is based on the Mbed TLS DTLS server example
+ * (dtls_server.c), adapted to use a PSK instead of a certificate.
+ */
+
+#include "hue_dtls_client.h"
+#include "hue_stream_message.h"
+#include <getopt.h> // getopt_long
+#include <math.h>   // sqrt
+#include <mbedtls/pk.h>
+#include <mbedtls/ssl_cookie.h>
+#include <mbedtls/x509_crt.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdbool.h>
+#include <stdint.h>  // int64_t, uint64_t
+#include <stdio.h>   // fprintf, printf, fopen
+#include <stdlib.h>  // atoi, getenv, strtoul
+#include <string.h>  // memcmp, memcpy, strcmp, strcspn, strlen, strncmp, strstr
+#include <strings.h> // strncasecmp
+#include <time.h>    // clock_gettime
+
+#define HTTPS_PORT "443"
+
+#define ENTERTAINMENT_CONFIGURATION_PATH                                       \
+  "/clip/v2/resource/entertainment_configuration/"
+#define ENTERTAINMENT_PATH "/clip/v2/resource/entertainment"
+#define LIGHT_PATH "/clip/v2/resource/light"
+
+// The entertainment area the emulator lists.
+#define ENTERTAINMENT_CONFIG_ID "2d4cb563-4244-4bfc-9bb2-f5a08068df84"
+#define DEFAULT_CHANNEL_COUNT 10
+
+// Each channel has one light, with an entertainment service that renders it.
+// The IDs end in the channel ID.
+#define ENTERTAINMENT_ID_FORMAT "5b7a1e0c-3c2d-4f6e-8a1b-%012d"
+#define LIGHT_ID_FORMAT "9e3f2a4d-6b1c-4d8e-9f7a-%012d"
+#define LIGHT_GAMUT_TYPE "C"
+
+#define MAX_REQUEST_SIZE 4096
+#define MAX_RESPONSE_SIZE 16384
+
+#define UNAUTHORIZED_RESPONSE                                                  \
+  "{\"errors\":[{\"description\":\"unauthorized user\"}]}"
+
+// How often blocked reads wake up to check whether the emulator is stopping.
+#define READ_TIMEOUT_MS 1000
+
+// How long a kept-alive HTTPS connection may sit idle. Connections are served
+// one at a time, so an idle one holds up the next client until then.
+#define KEEP_ALIVE_TIMEOUT_MS 10000
+
+// The bridge ends the entertainment session after 10 seconds without a
+// message.
+#define SESSION_TIMEOUT_MS 10000
+
+#define NANOSECONDS_PER_SECOND 1000000000L
+
+static volatile sig_atomic_t running = true;
+
+static void handle_signal(int signal) {
+  if (signal == SIGINT) {
+    running = false;
+  }
+}
+
+/**
+ * The entertainment area streaming state, set by the REST endpoint and
+ * checked against every HueStream packet.
+ */
+typedef struct bridge_state bridge_state;
+struct bridge_state {
+  pthread_mutex_t mutex;
+  bool streaming;
+  char entertainment_config_id
+      [HUE_STREAM_MESSAGE_ENTERTAINMENT_CONFIG_ID_SIZE + 1];
+};
+
+static bridge_state state = {.mutex = PTHREAD_MUTEX_INITIALIZER};
+
+// The number of channels in the listed entertainment area.
+static int channel_count = DEFAULT_CHANNEL_COUNT;
+
+// Whether to time calibration flashes.
+static bool calibrating = false;
+
+// A channel at least this bright is lit by a calibration flash.
+#define FLASH_MIN_BRIGHTNESS 0x8000
+
+static int64_t now_ns(void) {
+  struct timespec now = {0};
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t)now.tv_sec * NANOSECONDS_PER_SECOND + now.tv_nsec;
+}
+
+static int64_t realtime_ns(void) {
+  struct timespec now = {0};
+  clock_gettime(CLOCK_REALTIME, &now);
+  return (int64_t)now.tv_sec * NANOSECONDS_PER_SECOND + now.tv_nsec;
+}
+
+static int handshake(mbedtls_ssl_context *ssl) {
+  int ret = 0;
+  do {
+    ret = mbedtls_ssl_handshake(ssl);
+  } while (ret == MBEDTLS_ERR_SSL_WANT_READ ||
+           ret == MBEDTLS_ERR_SSL_WANT_WRITE);
+  return ret;
+}
+
+static void close_notify(mbedtls_ssl_context *ssl) {
+  // Errors are ok since the client might already be gone.
+  int ret = 0;
+  do {
+    ret = mbedtls_ssl_close_notify(ssl);
+  } while (ret == MBEDTLS_ERR_SSL_WANT_WRITE);
+}
+
+typedef struct https_server https_server;
+struct https_server {
+  mbedtls_net_context listen_fd;
+  mbedtls_net_context client_fd;
+  mbedtls_ssl_context ssl;
+  mbedtls_ssl_config conf;
+  mbedtls_x509_crt cert;
+  mbedtls_pk_context key;
+  mbedtls_ctr_drbg_context ctr_drbg;
+  mbedtls_entropy_context entropy;
+};
+
+static void https_server_free(https_server *server) {
+  mbedtls_net_free(&server->client_fd);
+  mbedtls_net_free(&server->listen_fd);
+  mbedtls_ssl_free(&server->ssl);
+  mbedtls_ssl_config_free(&server->conf);
+  mbedtls_x509_crt_free(&server->cert);
+  mbedtls_pk_free(&server->key);
+  mbedtls_ctr_drbg_free(&server->ctr_drbg);
+  mbedtls_entropy_free(&server->entropy);
+}
+
+static int https_server_init(https_server *server, const char *bind_ip,
+                             const char *port, const char *cert_path,
+                             const char *key_path) {
+  mbedtls_net_init(&server->listen_fd);
+  mbedtls_net_init(&server->client_fd);
+  mbedtls_ssl_init(&server->ssl);
+  mbedtls_ssl_config_init(&server->conf);
+  mbedtls_x509_crt_init(&server->cert);
+  mbedtls_pk_init(&server->key);
+  mbedtls_ctr_drbg_init(&server->ctr_drbg);
+  mbedtls_entropy_init(&server->entropy);
+
+  const char *pers = "hue_bridge_emulator_https";
+  if (mbedtls_ctr_drbg_seed(&server->ctr_drbg, mbedtls_entropy_func,
+                            &server->entropy, (const unsigned char *)pers,
+                            strlen(pers))) {
+    fprintf(stderr, "mbedtls_ctr_drbg_seed() failed\n");
+    goto exit;
+  }
+
+  // Clients don't verify the certificate, so a self-signed one will do.
+  if (mbedtls_x509_crt_parse_file(&server->cert, cert_path)) {
+    fprintf(stderr, "mbedtls_x509_crt_parse_file() failed\n");
+    goto exit;
+  }
+
+  if (mbedtls_pk_parse_keyfile(&server->key, key_path, NULL,
+                               mbedtls_ctr_drbg_random, &server->ctr_drbg)) {
+    fprintf(stderr, "mbedtls_pk_parse_keyfile() failed\n");
+    goto exit;
+  }
+
+  if (mbedtls_ssl_config_defaults(&server->conf, MBEDTLS_SSL_IS_SERVER,
+                                  MBEDTLS_SSL_TRANSPORT_STREAM,
+                                  MBEDTLS_SSL_PRESET_DEFAULT)) {
+    fprintf(stderr, "mbedtls_ssl_config_defaults() failed\n");
+    goto exit;
+  }
+
+  mbedtls_ssl_conf_rng(&server->conf, mbedtls_ctr_drbg_random,
+                       &server->ctr_drbg);
+  mbedtls_ssl_conf_read_timeout(&server->conf, READ_TIMEOUT_MS);
+
+  if (mbedtls_ssl_conf_own_cert(&server->conf, &server->cert, &server->key)) {
+    fprintf(stderr, "mbedtls_ssl_conf_own_cert() failed\n");
+    goto exit;
+  }
+
+  if (mbedtls_ssl_setup(&server->ssl, &server->conf)) {
+    fprintf(stderr, "mbedtls_ssl_setup() failed\n");
+    goto exit;
+  }
+
+  if (mbedtls_net_bind(&server->listen_fd, bind_ip, port,
+                       MBEDTLS_NET_PROTO_TCP)) {
+    fprintf(stderr, "mbedtls_net_bind() failed on port %s\n", port);
+    goto exit;
+  }
+
+  return 0;
+
+exit:
+  https_server_free(server);
+  return -1;
+}
+
+// Read an HTTP request, including its body, into a null-terminated buffer.
+// Returns 1 if the client closes the connection, or leaves it idle for too
+// long, before sending a request.
+static int read_request(mbedtls_ssl_context *ssl, char *request, size_t size) {
+  size_t length = 0;
+  int idle_ms = 0;
+  while (length < size - 1) {
+    const int ret = mbedtls_ssl_read(ssl, (unsigned char *)request + length,
+                                     size - 1 - length);
+    if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+      continue;
+    }
+
+    if (length == 0 && ret == MBEDTLS_ERR_SSL_TIMEOUT && running &&
+        (idle_ms += READ_TIMEOUT_MS) < KEEP_ALIVE_TIMEOUT_MS) {
+      continue;
+    }
+
+    if (length == 0 && (ret == 0 || ret == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY ||
+                        ret == MBEDTLS_ERR_SSL_TIMEOUT)) {
+      return 1;
+    }
+
+    if (ret <= 0) {
+      fprintf(stderr, "mbedtls_ssl_read() failed: -0x%x\n",
+              (unsigned int)-ret);
+      return -1;
+    }
+
+    length += ret;
+    request[length] = '\0';
+
+    const char *end = strstr(request, "\r\n\r\n");
+    if (!end) {
+      continue;
+    }
+
+    size_t content_length = 0;
+    for (const char *line = strstr(request, "\r\n"); line && line < end;
+         line = strstr(line + 2, "\r\n")) {
+      if (strncasecmp(line + 2, "Content-Length:", 15) == 0) {
+        content_length = strtoul(line + 17, NULL, 10);
+      }
+    }
+
+    if (length >= (size_t)(end + 4 - request) + content_length) {
+      return 0;
+    }
+  }
+
+  fprintf(stderr, "request is too large\n");
+  return -1;
+}
+
+// Find the value of a request header. Returns the length of the value, or -1
+// if the header is missing.
+static int find_header(const char *request, const char *name,
+                       const char **value) {
+  const size_t name_length = strlen(name);
+  for (const char *line = strstr(request, "\r\n"); line;
+       line = strstr(line + 2, "\r\n")) {
+    if (strncasecmp(line + 2, name, name_length) == 0 &&
+        line[2 + name_length] == ':') {
+      *value = line + 3 + name_length;
+      while (**value == ' ') {
+        (*value)++;
+      }
+      return strcspn(*value, "\r\n");
+    }
+  }
+  return -1;
+}
+
+static void write_response(mbedtls_ssl_context *ssl, int status,
+                           const char *reason, const char *body) {
+  char response[MAX_RESPONSE_SIZE] = {0};
+  const int length = snprintf(response, sizeof(response),
+                              "HTTP/1.1 %d %s\r\n"
+                              "Content-Type: application/json\r\n"
+                              "Content-Length: %zu\r\n"
+                              "\r\n"
+                              "%s",
+                              status, reason, strlen(body), body);
+
+  int written = 0;
+  while (written < length) {
+    const int ret = mbedtls_ssl_write(
+        ssl, (const unsigned char *)response + written, length - written);
+    if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+      continue;
+    }
+
+    if (ret < 0) {
+      fprintf(stderr, "mbedtls_ssl_write() failed: -0x%x\n",
+              (unsigned int)-ret);
+      return;
+    }
+
+    written += ret;
+  }
+}
+
+// Check the application key if the emulator was given one.
+static bool authorized(const char *request, const char *method,
+                       const char *path) {
+  const char *hue_username = getenv("HUE_USERNAME");
+  const char *key = NULL;
+  const int key_length = find_header(request, "hue-application-key", &key);
+  if (key_length < 0 ||
+      (hue_username && ((size_t)key_length != strlen(hue_username) ||
+                        strncmp(key, hue_username, key_length)))) {
+    printf("REST: %s %s unauthorized\n", method, path);
+    return false;
+  }
+  return true;
+}
+
+// List the emulated entertainment area, with its channels spread from left to
+// right.
+static void write_configurations(mbedtls_ssl_context *ssl) {
+  char body[MAX_RESPONSE_SIZE / 2] = {0};
+  int length = snprintf(body, sizeof(body),
+                        "{\"errors\":[],\"data\":[{\"id\":\"%s\","
+                        "\"type\":\"entertainment_configuration\","
+                        "\"metadata\":{\"name\":\"Emulator\"},"
+                        "\"name\":\"Emulator\",\"channels\":[",
+                        ENTERTAINMENT_CONFIG_ID);
+  for (int i = 0; i < channel_count; i++) {
+    const double x =
+        channel_count > 1 ? -1.0 + 2.0 * i / (channel_count - 1) : 0.0;
+    length += snprintf(body + length, sizeof(body) - length,
+                       "%s{\"channel_id\":%d,\"position\":{\"x\":%.3f,"
+                       "\"y\":0.8,\"z\":0.0},\"members\":[{\"service\":"
+                       "{\"rid\":\"" ENTERTAINMENT_ID_FORMAT "\","
+                       "\"rtype\":\"entertainment\"},\"index\":0}]}",
+                       i ? "," : "", i, x, i);
+  }
+  snprintf(body + length, sizeof(body) - length, "]}]}");
+
+  printf("REST: listed entertainment configurations\n");
+  write_response(ssl, 200, "OK", body);
+}
+
+// List the entertainment services of the channels' lights.
+static void write_entertainment_services(mbedtls_ssl_context *ssl) {
+  char body[MAX_RESPONSE_SIZE / 2] = {0};
+  int length = snprintf(body, sizeof(body), "{\"errors\":[],\"data\":[");
+  for (int i = 0; i < channel_count; i++) {
+    length += snprintf(body + length, sizeof(body) - length,
+                       "%s{\"id\":\"" ENTERTAINMENT_ID_FORMAT "\","
+                       "\"type\":\"entertainment\",\"renderer\":true,"
+                       "\"renderer_reference\":{\"rid\":\"" LIGHT_ID_FORMAT
+                       "\",\"rtype\":\"light\"}}",
+                       i ? "," : "", i, i);
+  }
+  snprintf(body + length, sizeof(body) - length, "]}");
+
+  printf("REST: listed entertainment services\n");
+  write_response(ssl, 200, "OK", body);
+}
+
+// List the channels' lights, which all have the same gamut.
+static void write_lights(mbedtls_ssl_context *ssl) {
+  char body[MAX_RESPONSE_SIZE / 2] = {0};
+  int length = snprintf(body, sizeof(body), "{\"errors\":[],\"data\":[");
+  for (int i = 0; i < channel_count; i++) {
+    length += snprintf(body + length, sizeof(body) - length,
+                       "%s{\"id\":\"" LIGHT_ID_FORMAT "\","
+                       "\"type\":\"light\",\"color\":{\"gamut_type\":"
+                       "\"" LIGHT_GAMUT_TYPE "\"}}",
+                       i ? "," : "", i);
+  }
+  snprintf(body + length, sizeof(body) - length, "]}");
+
+  printf("REST: listed lights\n");
+  write_response(ssl, 200, "OK", body);
+}
+
+// Report whether the emulated entertainment area is streaming.
+static void write_status(mbedtls_ssl_context *ssl, const char *id) {
+  if (strcmp(id, ENTERTAINMENT_CONFIG_ID)) {
+    printf("REST: entertainment configuration %s not found\n", id);
+    write_response(ssl, 404, "Not Found", "{}");
+    return;
+  }
+
+  pthread_mutex_lock(&state.mutex);
+  const bool active =
+      state.streaming && !strcmp(state.entertainment_config_id, id);
+  pthread_mutex_unlock(&state.mutex);
+
+  char body[512] = {0};
+  snprintf(body, sizeof(body),
+           "{\"errors\":[],\"data\":[{\"id\":\"%s\","
+           "\"type\":\"entertainment_configuration\","
+           "\"name\":\"Emulator\",\"status\":\"%s\"}]}",
+           id, active ? "active" : "inactive");
+
+  printf("REST: reported entertainment configuration status\n");
+  write_response(ssl, 200, "OK", body);
+}
+
+// Handle GET /clip/v2/resource/entertainment_configuration,
+// GET /clip/v2/resource/entertainment_configuration/{id},
+// GET /clip/v2/resource/entertainment, GET /clip/v2/resource/light, and
+// PUT /clip/v2/resource/entertainment_configuration/{id} with an
+// {"action":"start"} or {"action":"stop"} body, like the bridge does.
+static void handle_request(mbedtls_ssl_context *ssl, const char *request) {
+  char method[8] = {0};
+  char path[256] = {0};
+  if (sscanf(request, "%7s %255s", method, path) != 2) {
+    write_response(ssl, 400, "Bad Request", "{}");
+    return;
+  }
+
+  const size_t prefix_length = strlen(ENTERTAINMENT_CONFIGURATION_PATH);
+  const bool configurations =
+      !strncmp(path, ENTERTAINMENT_CONFIGURATION_PATH, prefix_length - 1) &&
+      path[prefix_length - 1] == '\0';
+  const bool services = !strcmp(path, ENTERTAINMENT_PATH);
+  const bool lights = !strcmp(path, LIGHT_PATH);
+  if (configurations || services || lights) {
+    if (strcmp(method, "GET")) {
+      printf("REST: %s %s not allowed\n", method, path);
+      write_response(ssl, 405, "Method Not Allowed", "{}");
+    } else if (!authorized(request, method, path)) {
+      write_response(ssl, 403, "Forbidden", UNAUTHORIZED_RESPONSE);
+    } else if (configurations) {
+      write_configurations(ssl);
+    } else if (services) {
+      write_entertainment_services(ssl);
+    } else {
+      write_lights(ssl);
+    }
+    return;
+  }
+
+  const char *id = path + prefix_length;
+  if (strncmp(path, ENTERTAINMENT_CONFIGURATION_PATH, prefix_length) ||
+      strlen(id) != HUE_STREAM_MESSAGE_ENTERTAINMENT_CONFIG_ID_SIZE) {
+    printf("REST: %s %s not found\n", method, path);
+    write_response(ssl, 404, "Not Found", "{}");
+    return;
+  }
+
+  if (!strcmp(method, "GET")) {
+    if (authorized(request, method, path)) {
+      write_status(ssl, id);
+    } else {
+      write_response(ssl, 403, "Forbidden", UNAUTHORIZED_RESPONSE);
+    }
+    return;
+  }
+
+  if (strcmp(method, "PUT")) {
+    printf("REST: %s %s not allowed\n", method, path);
+    write_response(ssl, 405, "Method Not Allowed", "{}");
+    return;
+  }
+
+  if (!authorized(request, method, path)) {
+    write_response(ssl, 403, "Forbidden", UNAUTHORIZED_RESPONSE);
+    return;
+  }
+
+  const char *body = strstr(request, "\r\n\r\n") + 4;
+  const bool start = strstr(body, "\"start\"");
+  const bool stop = strstr(body, "\"stop\"");
+  if (start == stop) {
+    printf("REST: PUT %s has an invalid action\n", path);
+    write_response(ssl, 400, "Bad Request", "{}");
+    return;
+  }
+
+  pthread_mutex_lock(&state.mutex);
+  state.streaming = start;
+  memcpy(state.entertainment_config_id, id,
+         HUE_STREAM_MESSAGE_ENTERTAINMENT_CONFIG_ID_SIZE);
+  pthread_mutex_unlock(&state.mutex);
+
+  printf("REST: %s streaming to entertainment configuration %s\n",
+         start ? "start" : "stop", id);
+
+  char response[256] = {0};
+  snprintf(response, sizeof(response),
+           "{\"data\":[{\"rid\":\"%s\",\"rtype\":"
+           "\"entertainment_configuration\"}],\"errors\":[]}",
+           id);
+  write_response(ssl, 200, "OK", response);
+}
+
+static void *https_serve(void *arg) {
+  https_server *server = arg;
+
+  while (running) {
+    mbedtls_net_free(&server->client_fd);
+    mbedtls_ssl_session_reset(&server->ssl);
+
+    if (mbedtls_net_accept(&server->listen_fd, &server->client_fd, NULL, 0,
+                           NULL)) {
+      fprintf(stderr, "mbedtls_net_accept() failed\n");
+      continue;
+    }
+
+    mbedtls_ssl_set_bio(&server->ssl, &server->client_fd, mbedtls_net_send,
+                        mbedtls_net_recv, mbedtls_net_recv_timeout);
+
+    const int ret = handshake(&server->ssl);
+    if (ret) {
+      fprintf(stderr, "HTTPS handshake failed: -0x%x\n", (unsigned int)-ret);
+      continue;
+    }
+
+    // Serve requests until the client closes the connection or leaves it
+    // idle.
+    char request[MAX_REQUEST_SIZE] = {0};
+    while (running && !read_request(&server->ssl, request, sizeof(request))) {
+      handle_request(&server->ssl, request);
+    }
+
+    close_notify(&server->ssl);
+  }
+
+  return NULL;
+}
+
+typedef struct dtls_server dtls_server;
+struct dtls_server {
+  mbedtls_net_context listen_fd;
+  mbedtls_net_context client_fd;
+  mbedtls_ssl_context ssl;
+  mbedtls_ssl_config conf;
+  mbedtls_ssl_cookie_ctx cookie;
+  mbedtls_ctr_drbg_context ctr_drbg;
+  mbedtls_entropy_context entropy;
+  mbedtls_timing_delay_context timer;
+  int ciphersuites[2];
+};
+
+static void dtls_server_free(dtls_server *server) {
+  mbedtls_net_free(&server->client_fd);
+  mbedtls_net_free(&server->listen_fd);
+  mbedtls_ssl_free(&server->ssl);
+  mbedtls_ssl_config_free(&server->conf);
+  mbedtls_ssl_cookie_free(&server->cookie);
+  mbedtls_ctr_drbg_free(&server->ctr_drbg);
+  mbedtls_entropy_free(&server->entropy);
+}
+
+static int dtls_server_init(dtls_server *server, const char *bind_ip) {
+  mbedtls_net_init(&server->listen_fd);
+  mbedtls_net_init(&server->client_fd);
+  mbedtls_ssl_init(&server->ssl);
+  mbedtls_ssl_config_init(&server->conf);
+  mbedtls_ssl_cookie_init(&server->cookie);
+  mbedtls_ctr_drbg_init(&server->ctr_drbg);
+  mbedtls_entropy_init(&server->entropy);
+
+  const char *pers = "hue_bridge_emulator_dtls";
+  if (mbedtls_ctr_drbg_seed(&server->ctr_drbg, mbedtls_entropy_func,
+                            &server->entropy, (const unsigned char *)pers,
+                            strlen(pers))) {
+    fprintf(stderr, "mbedtls_ctr_drbg_seed() failed\n");
+    goto exit;
+  }
+
+  if (mbedtls_ssl_config_defaults(&server->conf, MBEDTLS_SSL_IS_SERVER,
+                                  MBEDTLS_SSL_TRANSPORT_DATAGRAM,
+                                  MBEDTLS_SSL_PRESET_DEFAULT)) {
+    fprintf(stderr, "mbedtls_ssl_config_defaults() failed\n");
+    goto exit;
+  }
+
+  mbedtls_ssl_conf_rng(&server->conf, mbedtls_ctr_drbg_random,
+                       &server->ctr_drbg);
+  mbedtls_ssl_conf_read_timeout(&server->conf, READ_TIMEOUT_MS);
+
+  // Accept only the ciphersuite the Hue bridge uses.
+  server->ciphersuites[0] = HUE_BRIDGE_DTLS_CIPHER;
+  server->ciphersuites[1] = 0;
+  mbedtls_ssl_conf_ciphersuites(&server->conf, server->ciphersuites);
+
+  // Use the same PSK as the client.
+  if (hue_dtls_conf_psk(&server->conf)) {
+    fprintf(stderr, "hue_dtls_conf_psk() failed\n");
+    goto exit;
+  }
+
+  // HelloVerifyRequest cookies. Required for DTLS servers.
+  if (mbedtls_ssl_cookie_setup(&server->cookie, mbedtls_ctr_drbg_random,
+                               &server->ctr_drbg)) {
+    fprintf(stderr, "mbedtls_ssl_cookie_setup() failed\n");
+    goto exit;
+  }
+
+  mbedtls_ssl_conf_dtls_cookies(&server->conf, mbedtls_ssl_cookie_write,
+                                mbedtls_ssl_cookie_check, &server->cookie);
+
+  if (mbedtls_ssl_setup(&server->ssl, &server->conf)) {
+    fprintf(stderr, "mbedtls_ssl_setup() failed\n");
+    goto exit;
+  }
+
+  mbedtls_ssl_set_timer_cb(&server->ssl, &server->timer,
+                           mbedtls_timing_set_delay, mbedtls_timing_get_delay);
+
+  if (mbedtls_net_bind(&server->listen_fd, bind_ip, HUE_BRIDGE_DTLS_PORT,
+                       MBEDTLS_NET_PROTO_UDP)) {
+    fprintf(stderr, "mbedtls_net_bind() failed on port %s\n",
+            HUE_BRIDGE_DTLS_PORT);
+    goto exit;
+  }
+
+  return 0;
+
+exit:
+  dtls_server_free(server);
+  return -1;
+}
+
+typedef struct session_stats session_stats;
+struct session_stats {
+  uint64_t packets;
+  uint64_t invalid_packets;
+  uint64_t bytes;
+  uint64_t channels;
+  uint64_t sequence_gaps;
+  int64_t first_arrival_ns;
+  int64_t last_arrival_ns;
+  int64_t max_interval_ns;
+  double interval_sum_ns;
+  double interval_sum_squares_ns;
+  uint8_t last_sequence_id;
+  // Calibration flashes, timed from the start of the nearest second.
+  bool lit;
+  uint64_t flashes;
+  double flash_offset_sum_ns;
+};
+
+// Time a flash by when its first lit packet arrived.
+static void record_flash(session_stats *stats,
+                         const hue_stream_message *message, int64_t arrival_ns,
+                         int session) {
+  const bool lit = message->data[0].color_value[2] >= FLASH_MIN_BRIGHTNESS;
+  if (lit && !stats->lit) {
+    const int64_t arrival_realtime_ns = realtime_ns() - (now_ns() - arrival_ns);
+    int64_t offset_ns = arrival_realtime_ns % NANOSECONDS_PER_SECOND;
+    if (offset_ns > NANOSECONDS_PER_SECOND / 2) {
+      offset_ns -= NANOSECONDS_PER_SECOND;
+    }
+
+    stats->flashes++;
+    stats->flash_offset_sum_ns += offset_ns;
+    printf("session %d: flash %llu arrived %.3f ms after the second\n",
+           session, (unsigned long long)stats->flashes, offset_ns / 1e6);
+  }
+  stats->lit = lit;
+}
+
+// Validate a packet against the protocol and the streaming state.
+static bool check_packet(const uint8_t *buffer, size_t size,
+                         hue_stream_message *message, int *channel_count) {
+  if (hue_stream_message_parse(buffer, size, message, channel_count)) {
+    return false;
+  }
+
+  pthread_mutex_lock(&state.mutex);
+  const bool streaming = state.streaming;
+  const bool config_id_matches =
+      memcmp(message->entertainment_config_id, state.entertainment_config_id,
+             HUE_STREAM_MESSAGE_ENTERTAINMENT_CONFIG_ID_SIZE) == 0;
+  pthread_mutex_unlock(&state.mutex);
+
+  if (!streaming) {
+    fprintf(stderr, "packet received while streaming is stopped\n");
+    return false;
+  }
+
+  if (!config_id_matches) {
+    fprintf(stderr, "packet entertainment_config_id doesn't match\n");
+    return false;
+  }
+
+  return true;
+}
+
+static void record_packet(session_stats *stats, const uint8_t *buffer,
+                          size_t size, int64_t arrival_ns, FILE *csv,
+                          int session) {
+  hue_stream_message message = {0};
+  int channel_count = 0;
+  const bool valid = check_packet(buffer, size, &message, &channel_count);
+
+  if (stats->packets > 0) {
+    const int64_t interval_ns = arrival_ns - stats->last_arrival_ns;
+    stats->interval_sum_ns += interval_ns;
+    stats->interval_sum_squares_ns += (double)interval_ns * interval_ns;
+    if (interval_ns > stats->max_interval_ns) {
+      stats->max_interval_ns = interval_ns;
+    }
+  } else {
+    stats->first_arrival_ns = arrival_ns;
+  }
+
+  if (valid) {
+    if (stats->packets - stats->invalid_packets > 0 &&
+        message.sequence_id != (uint8_t)(stats->last_sequence_id + 1)) {
+      stats->sequence_gaps++;
+    }
+    stats->last_sequence_id = message.sequence_id;
+    stats->channels += channel_count;
+    if (calibrating && channel_count > 0) {
+      record_flash(stats, &message, arrival_ns, session);
+    }
+  } else {
+    stats->invalid_packets++;
+  }
+
+  stats->packets++;
+  stats->bytes += size;
+  stats->last_arrival_ns = arrival_ns;
+
+  if (csv) {
+    fprintf(csv, "%d,%llu,%lld,%d,%zu,%d,%d\n", session,
+            (unsigned long long)stats->packets, (long long)arrival_ns,
+            valid ? message.sequence_id : -1, size,
+            valid ? channel_count : -1, valid);
+  }
+}
+
+static void print_session_stats(const session_stats *stats, int session) {
+  printf("session %d: %llu packets, %llu invalid, %llu channels, "
+         "%llu bytes, %llu sequence gaps\n",
+         session, (unsigned long long)stats->packets,
+         (unsigned long long)stats->invalid_packets,
+         (unsigned long long)stats->channels,
+         (unsigned long long)stats->bytes,
+         (unsigned long long)stats->sequence_gaps);
+
+  if (stats->packets < 2) {
+    return;
+  }
+
+  const double intervals = stats->packets - 1;
+  const double mean_ns = stats->interval_sum_ns / intervals;
+  const double variance_ns =
+      stats->interval_sum_squares_ns / intervals - mean_ns * mean_ns;
+  const double jitter_ns = variance_ns > 0 ? sqrt(variance_ns) : 0;
+  const double elapsed_seconds =
+      (double)(stats->last_arrival_ns - stats->first_arrival_ns) /
+      NANOSECONDS_PER_SECOND;
+
+  printf("session %d: %.2f packets/s, interval mean %.3f ms, "
+         "jitter %.3f ms, max %.3f ms\n",
+         session, intervals / elapsed_seconds, mean_ns / 1e6, jitter_ns / 1e6,
+         stats->max_interval_ns / 1e6);
+
+  if (stats->flashes) {
+    printf("session %d: %llu flashes, mean %.3f ms after the second\n",
+           session, (unsigned long long)stats->flashes,
+           stats->flash_offset_sum_ns / stats->flashes / 1e6);
+  }
+}
+
+// Receive packets until the client closes the session, goes quiet for
+// SESSION_TIMEOUT_MS, or the emulator stops.
+static void receive(dtls_server *server, FILE *csv, int session) {
+  session_stats stats = {0};
+  uint8_t buffer[HUE_STREAM_MESSAGE_MAX_SIZE + 1] = {0};
+  int idle_ms = 0;
+
+  while (running) {
+    const int ret = mbedtls_ssl_read(&server->ssl, buffer, sizeof(buffer));
+    const int64_t arrival_ns = now_ns();
+
+    if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+      continue;
+    }
+
+    if (ret == MBEDTLS_ERR_SSL_TIMEOUT) {
+      idle_ms += READ_TIMEOUT_MS;
+      if (idle_ms >= SESSION_TIMEOUT_MS) {
+        printf("session %d: timed out\n", session);
+        break;
+      }
+      continue;
+    }
+
+    if (ret == MBEDTLS_ERR_SSL_PEER_CLOSE_NOTIFY || ret == 0) {
+      printf("session %d: closed by client\n", session);
+      break;
+    }
+
+    if (ret < 0) {
+      fprintf(stderr, "mbedtls_ssl_read() failed: -0x%x\n",
+              (unsigned int)-ret);
+      break;
+    }
+
+    idle_ms = 0;
+    record_packet(&stats, buffer, ret, arrival_ns, csv, session);
+  }
+
+  close_notify(&server->ssl);
+  print_session_stats(&stats, session);
+  if (csv) {
+    fflush(csv);
+  }
+}
+
+static void dtls_serve(dtls_server *server, FILE *csv) {
+  int session = 0;
+
+  while (running) {
+    mbedtls_net_free(&server->client_fd);
+    mbedtls_ssl_session_reset(&server->ssl);
+
+    unsigned char client_ip[16] = {0};
+    size_t client_ip_len = 0;
+    if (mbedtls_net_accept(&server->listen_fd, &server->client_fd, client_ip,
+                           sizeof(client_ip), &client_ip_len)) {
+      if (running) {
+        fprintf(stderr, "mbedtls_net_accept() failed\n");
+      }
+      continue;
+    }
+
+    // The client's address is bound into the HelloVerifyRequest cookie.
+    if (mbedtls_ssl_set_client_transport_id(&server->ssl, client_ip,
+                                            client_ip_len)) {
+      fprintf(stderr, "mbedtls_ssl_set_client_transport_id() failed\n");
+      continue;
+    }
+
+    mbedtls_ssl_set_bio(&server->ssl, &server->client_fd, mbedtls_net_send,
+                        mbedtls_net_recv, mbedtls_net_recv_timeout);
+
+    const int ret = handshake(&server->ssl);
+    if (ret == MBEDTLS_ERR_SSL_HELLO_VERIFY_REQUIRED) {
+      // The client retries the handshake with the cookie.
+      continue;
+    }
+
+    if (ret) {
+      fprintf(stderr, "DTLS handshake failed: -0x%x\n", (unsigned int)-ret);
+      continue;
+    }
+
+    session++;
+    printf("session %d: started\n", session);
+    receive(server, csv, session);
+  }
+}
+
+static void usage(const char *program) {
+  fprintf(stderr,
+          "Usage: %s --cert <file> --key <file> [--bind <address>] "
+          "[--https-port <port>] [--channels <count>] [--output <file>] "
+          "[--calibrate]\n",
+          program);
+}
+
+int main(int argc, char *argv[]) {
+  static const struct option options[] = {
+      {"cert", required_argument, NULL, 'c'},
+      {"key", required_argument, NULL, 'k'},
+      {"bind", required_argument, NULL, 'b'},
+      {"https-port", required_argument, NULL, 'p'},
+      {"channels", required_argument, NULL, 'n'},
+      {"output", required_argument, NULL, 'o'},
+      {"calibrate", no_argument, NULL, 'C'},
+      {"help", no_argument, NULL, 'h'},
+      {NULL, 0, NULL, 0}};
+
+  const char *cert_path = NULL;
+  const char *key_path = NULL;
+  const char *bind_ip = NULL;
+  const char *https_port = HTTPS_PORT;
+  const char *output = NULL;
+
+  int option = 0;
+  while ((option = getopt_long(argc, argv, "c:k:b:p:n:o:Ch", options, NULL)) !=
+         -1) {
+    switch (option) {
+    case 'c':
+      cert_path = optarg;
+      break;
+    case 'k':
+      key_path = optarg;
+      break;
+    case 'b':
+      bind_ip = optarg;
+      break;
+    case 'p':
+      https_port = optarg;
+      break;
+    case 'n':
+      channel_count = atoi(optarg);
+      if (!hue_stream_message_valid_channel_count(channel_count)) {
+        fprintf(stderr, "--channels must be between 1 and %d\n",
+                HUE_STREAM_MESSAGE_MAX_CHANNELS);
+        return 1;
+      }
+      break;
+    case 'o':
+      output = optarg;
+      break;
+    case 'C':
+      calibrating = true;
+      break;
+    case 'h':
+      usage(argv[0]);
+      return 0;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  if (!cert_path || !key_path || optind != argc) {
+    usage(argv[0]);
+    return 1;
+  }
+
+  // Record arrival times on CLOCK_MONOTONIC so they can be compared with
+  // timestamps taken by a client on the same machine.
+  FILE *csv = NULL;
+  if (output) {
+    csv = fopen(output, "w");
+    if (!csv) {
+      perror("fopen");
+      return 1;
+    }
+    fprintf(csv, "session,packet,arrival_ns,sequence_id,size,channels,valid\n");
+  }
+
+  int ret = 1;
+
+  // Static because the detached HTTPS thread uses it until the process exits.
+  static https_server https = {0};
+  if (https_server_init(&https, bind_ip, https_port, cert_path, key_path)) {
+    fprintf(stderr, "https_server_init() failed\n");
+    goto exit;
+  }
+
+  dtls_server dtls = {0};
+  if (dtls_server_init(&dtls, bind_ip)) {
+    fprintf(stderr, "dtls_server_init() failed\n");
+    https_server_free(&https);
+    goto exit;
+  }
+
+  // Stop on Ctrl+C. Without SA_RESTART, blocked accepts return so the loops
+  // notice. The HTTPS thread leaves SIGINT to the main thread.
+  struct sigaction action = {0};
+  action.sa_handler = handle_signal;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGINT, &action, NULL);
+
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGINT);
+  pthread_sigmask(SIG_BLOCK, &signals, NULL);
+
+  pthread_t https_thread = 0;
+  const int thread_ret =
+      pthread_create(&https_thread, NULL, https_serve, &https);
+  pthread_sigmask(SIG_UNBLOCK, &signals, NULL);
+  if (thread_ret) {
+    fprintf(stderr, "pthread_create() failed\n");
+    dtls_server_free(&dtls);
+    https_server_free(&https);
+    goto exit;
+  }
+
+  // The HTTPS thread stays blocked in accept(). Exiting the process closes
+  // its socket.
+  pthread_detach(https_thread);
+
+  printf("Listening for REST on port %s and DTLS on port %s\n", https_port,
+         HUE_BRIDGE_DTLS_PORT);
+  dtls_serve(&dtls, csv);
+
+  dtls_server_free(&dtls);
+  ret = 0;
+
+exit:
+  if (csv && fclose(csv)) {
+    perror("fclose");
+    ret = 1;
+  }
+  return ret;
+}
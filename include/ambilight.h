@@ -0,0 +1,82 @@
+#pragma once
+
+#include "color.h"
+#include "frame_slot.h"
+#include "hue_rest_client.h"
+#include "hue_stream_message.h"
+#include "y4m_reader.h"
+
+// Each zone is this fraction of the frame's width and height.
+#define AMBILIGHT_ZONE_DIVISOR 4
+
+/**
+ * The region of the screen a channel takes its color from, in luma samples.
+ */
+typedef struct ambilight_zone ambilight_zone;
+struct ambilight_zone {
+  int x;
+  int y;
+  int width;
+  int height;
+};
+
+/**
+ * Turns video frames into channel colors.
+ *
+ * Each channel gets the zone of the screen in front of it: its x position
+ * goes from the left edge of the screen to the right, and its z position from
+ * the bottom to the top. The zones are summed with the fastest vector kernel
+ * the CPU supports, so a 4K frame takes a fraction of a 60 fps frame period on
+ * one core.
+ */
+typedef struct ambilight ambilight;
+struct ambilight {
+  color_kernel kernel;
+  // Whether the video uses the BT.709 matrix rather than BT.601. HD and larger
+  // video does.
+  bool bt709;
+  int zone_count;
+  ambilight_zone zones[FRAME_SLOT_MAX_CHANNELS];
+};
+
+/**
+ * @brief Lay out the zones of the channels on a video's frames.
+ *
+ * @param[out] light The ambilight to initialize.
+ * @param[in] format A frame of the video. Only its size and format are used.
+ * @param[in] channels The channels, in the order of the frames they render.
+ * @param[in] channel_count The number of channels.
+ * @param[in] kernel The kernel to sum zones with, or COLOR_KERNEL_AUTO for
+ * the fastest one.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int ambilight_init(ambilight *light, const y4m_frame *format,
+                   const hue_entertainment_channel *channels,
+                   int channel_count, color_kernel kernel);
+
+/**
+ * @brief Get the zone of a position, for a frame size.
+ *
+ * @param[in] format A frame of the video.
+ * @param[in] x The channel's x position, between -1 and 1.
+ * @param[in] z The channel's z position, between -1 and 1.
+ * @param[out] zone The zone.
+ */
+void ambilight_zone_at(const y4m_frame *format, double x, double z,
+                       ambilight_zone *zone);
+
+/**
+ * @brief Set each channel to the average color of its zone.
+ *
+ * The channel IDs of the data are left as they are.
+ *
+ * @param[in] light The ambilight.
+ * @param[in] frame The video frame, in the format given to
+ * @ref ambilight_init().
+ * @param[out] data The channel data, one channel per zone.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int ambilight_render(const ambilight *light, const y4m_frame *frame,
+                     hue_stream_message_data *data);
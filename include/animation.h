@@ -1,13 +1,19 @@
 #pragma once
 
+#include "animation_clock.h"
+#include "easing.h"
 #include "hue_stream_message.h"
+#include "prng.h"
 #include <time.h>
 
+#define ANIMATION_EFFECT_MAX_PARAMS 6
+
 typedef enum animation animation;
 enum animation {
   ANIMATION_THX_DEEP_NOTE,
   ANIMATION_SPIDER_MAN_INTO_THE_SPIDER_VERSE,
-  ANIMATION_SPIDER_MAN_ACROSS_THE_SPIDER_VERSE
+  ANIMATION_SPIDER_MAN_ACROSS_THE_SPIDER_VERSE,
+  ANIMATION_COUNT
 };
 
 typedef enum animation_status animation_status;
@@ -17,18 +23,113 @@ enum animation_status {
   ANIMATION_STATUS_RUNNING = 1
 };
 
+/**
+ * An effect that a cue runs. progress goes from 0 to EASING_ONE over the cue,
+ * already shaped by the cue's easing curve, params holds
+ * ANIMATION_EFFECT_MAX_PARAMS values, and random is the animation's
+ * generator, the only source of randomness an effect may use.
+ */
+typedef struct animation_effect animation_effect;
+struct animation_effect {
+  const char *name;
+  void (*animate)(hue_stream_message_data *frame, int channel_count,
+                  uint32_t progress, const double *params, prng *random);
+  int param_count;
+  double default_params[ANIMATION_EFFECT_MAX_PARAMS];
+  // The range every parameter must be in.
+  double param_min;
+  double param_max;
+};
+
+typedef struct cue_sheet cue_sheet;
+
+/**
+ * The playback state of an animation.
+ */
+typedef struct animation_context animation_context;
+struct animation_context {
+  // The clock that drives the animation.
+  animation_clock *clock;
+  // The time on the clock when the animation started.
+  struct timespec start_time;
+  // How far ahead of the clock frames are rendered, to make up for the time
+  // they take to reach the lights.
+  long lookahead_ns;
+  // The index of the cue that was active on the previous frame.
+  int cursor;
+  // The random numbers of the animation, so it replays exactly from a seed.
+  prng random;
+};
+
+/**
+ * @brief Initialize an animation context. The animation starts at the current
+ * time of the clock, with its generator seeded with 0 until
+ * @ref animation_context_seed() is called.
+ *
+ * @param context The context to initialize.
+ * @param clock The clock that drives the animation.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int animation_context_init(animation_context *context, animation_clock *clock);
+
+/**
+ * @brief Seed the random numbers of an animation.
+ *
+ * @param context The context.
+ * @param seed The seed.
+ */
+void animation_context_seed(animation_context *context, uint64_t seed);
+
+/**
+ * @brief Find an effect by name.
+ *
+ * @param name The name of the effect.
+ *
+ * @return The effect, or NULL if there is no effect with that name.
+ */
+const animation_effect *animation_effect_find(const char *name);
+
+/**
+ * @brief Get the cue sheet of a built-in animation.
+ *
+ * The built-in animations are the cue sheets in movies/, embedded at build
+ * time and parsed on first use.
+ *
+ * @param animation The built-in animation.
+ *
+ * @return The cue sheet, or NULL if the animation is invalid or its cue sheet
+ * doesn't parse.
+ */
+const cue_sheet *animation_builtin_cue_sheet(animation animation);
+
+/**
+ * @brief Animate the lights to a cue sheet.
+ *
+ * @param frame The frame to render.
+ * @param channel_count The number of channels in the frame.
+ * @param context The playback state of the animation.
+ * @param sheet The cue sheet to play.
+ *
+ * @return The status of the animation.
+ */
+animation_status animation_cue_sheet(hue_stream_message_data *frame,
+                                     int channel_count,
+                                     animation_context *context,
+                                     const cue_sheet *sheet);
+
 /**
  * @brief Animate the lights to the THX Deep Note.
  *
  * @param frame The frame to render.
  * @param channel_count The number of channels in the frame.
- * @param start_time The time when the animation started.
+ * @param context The playback state of the animation.
  *
  * @return The status of the animation.
  */
 animation_status animation_thx_deep_note(hue_stream_message_data *frame,
                                          int channel_count,
-                                         const struct timespec *start_time);
+                                         animation_context *context);
 
 /**
  * @brief Animate the lights to the opening logos of Spider-Man: Into the
@@ -36,14 +137,14 @@ animation_status animation_thx_deep_note(hue_stream_message_data *frame,
  *
  * @param frame The frame to render.
  * @param channel_count The number of channels in the frame.
- * @param start_time The time when the animation started.
+ * @param context The playback state of the animation.
  *
  * @return The status of the animation.
  */
 animation_status
 animation_spider_man_into_the_spider_verse(hue_stream_message_data *frame,
                                            int channel_count,
-                                           const struct timespec *start_time);
+                                           animation_context *context);
 
 /**
  * @brief Animate the lights to the opening logos of Spider-Man: Across the
@@ -51,11 +152,11 @@ animation_spider_man_into_the_spider_verse(hue_stream_message_data *frame,
  *
  * @param frame The frame to render.
  * @param channel_count The number of channels in the frame.
- * @param start_time The time when the animation started.
+ * @param context The playback state of the animation.
  *
  * @return The status of the animation.
  */
 animation_status
 animation_spider_man_across_the_spider_verse(hue_stream_message_data *frame,
                                              int channel_count,
-                                             const struct timespec *start_time);
+                                             animation_context *context);
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <time.h> // struct timespec
+
+/**
+ * The clock that drives an animation.
+ *
+ * Animations read the time through a clock instead of calling
+ * clock_gettime() directly, so they can run in real time or at a fixed
+ * timestep as fast as the CPU allows.
+ */
+typedef struct animation_clock animation_clock;
+struct animation_clock {
+  // Get the current time. Returns 0 on success, -1 on failure.
+  int (*now)(animation_clock *clock, struct timespec *time);
+  // The current time of a manual clock.
+  struct timespec time;
+};
+
+/**
+ * @brief Initialize a clock that reads CLOCK_MONOTONIC.
+ *
+ * @param[out] clock The clock to initialize.
+ */
+void animation_clock_init_monotonic(animation_clock *clock);
+
+/**
+ * @brief Initialize a clock that only moves when it is advanced.
+ *
+ * @param[out] clock The clock to initialize.
+ * @param[in] time The initial time of the clock.
+ */
+void animation_clock_init_manual(animation_clock *clock,
+                                 const struct timespec *time);
+
+/**
+ * @brief Get the current time of a clock.
+ *
+ * @param[in] clock The clock.
+ * @param[out] time The current time.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int animation_clock_now(animation_clock *clock, struct timespec *time);
+
+/**
+ * @brief Set the time of a manual clock.
+ *
+ * @param[in,out] clock The manual clock.
+ * @param[in] time The new time of the clock.
+ */
+void animation_clock_set(animation_clock *clock, const struct timespec *time);
+
+/**
+ * @brief Advance a manual clock.
+ *
+ * @param[in,out] clock The manual clock.
+ * @param[in] nanoseconds The time to advance the clock by.
+ */
+void animation_clock_advance(animation_clock *clock, long nanoseconds);
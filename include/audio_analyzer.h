@@ -0,0 +1,103 @@
+#pragma once
+
+#include "color.h"
+#include "hue_stream_message.h"
+#include <stdbool.h> // bool
+
+// The number of samples each analysis window covers. At 48 kHz this is 21 ms.
+#define AUDIO_ANALYZER_WINDOW_SIZE 1024
+#define AUDIO_ANALYZER_BIN_COUNT (AUDIO_ANALYZER_WINDOW_SIZE / 2)
+#define AUDIO_ANALYZER_BAND_COUNT 16
+
+// The range of the bands, spaced evenly on a log scale between them.
+#define AUDIO_ANALYZER_MIN_FREQUENCY 30.0f
+#define AUDIO_ANALYZER_MAX_FREQUENCY 16000.0f
+
+/**
+ * A streaming FFT band analyzer.
+ *
+ * Each window is the newest AUDIO_ANALYZER_WINDOW_SIZE samples, so windows
+ * overlap when they are analyzed more often than that, like once per frame.
+ * Every window is Hann-windowed and transformed, then summed into
+ * logarithmic bands, each with its own automatic gain. An onset is a jump in
+ * spectral flux, the total rise of the spectrum since the previous window.
+ *
+ * The analyzer holds everything it needs, so analyzing never allocates. The
+ * FFT and the spectrum run on the fastest vector kernel the CPU supports.
+ */
+typedef struct audio_analyzer audio_analyzer;
+struct audio_analyzer {
+  color_kernel kernel;
+  int sample_rate;
+
+  // The newest samples, oldest first.
+  float samples[AUDIO_ANALYZER_WINDOW_SIZE];
+  float window[AUDIO_ANALYZER_WINDOW_SIZE];
+  int bit_reversed[AUDIO_ANALYZER_WINDOW_SIZE];
+  // The twiddle factors of every stage, the stage of half size h at [h, 2h).
+  float twiddles_real[AUDIO_ANALYZER_WINDOW_SIZE];
+  float twiddles_imaginary[AUDIO_ANALYZER_WINDOW_SIZE];
+  float real[AUDIO_ANALYZER_WINDOW_SIZE];
+  float imaginary[AUDIO_ANALYZER_WINDOW_SIZE];
+
+  float magnitudes[AUDIO_ANALYZER_BIN_COUNT];
+  float previous_magnitudes[AUDIO_ANALYZER_BIN_COUNT];
+  // The first bin of each band, and the end of the last one.
+  int band_bins[AUDIO_ANALYZER_BAND_COUNT + 1];
+  // The loudest each band has been lately, in dB, decaying over time.
+  float band_peaks[AUDIO_ANALYZER_BAND_COUNT];
+  float average_flux;
+  int windows_since_onset;
+
+  // The results of the last window.
+
+  // The level of each band, between 0 and 1.
+  float bands[AUDIO_ANALYZER_BAND_COUNT];
+  float flux;
+  bool onset;
+};
+
+/**
+ * @brief Initialize an analyzer.
+ *
+ * @param[out] analyzer The analyzer to initialize.
+ * @param[in] sample_rate The sample rate of the audio.
+ * @param[in] kernel The kernel to run the FFT with, or COLOR_KERNEL_AUTO for
+ * the fastest one.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int audio_analyzer_init(audio_analyzer *analyzer, int sample_rate,
+                        color_kernel kernel);
+
+/**
+ * @brief Add samples and analyze the newest window.
+ *
+ * @param[in,out] analyzer The analyzer.
+ * @param[in] samples The new mono samples, between -1 and 1.
+ * @param[in] count The number of new samples, at most
+ * AUDIO_ANALYZER_WINDOW_SIZE.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int audio_analyzer_process(audio_analyzer *analyzer, const float *samples,
+                           int count);
+
+/**
+ * @brief Light the channels from the last analyzed window.
+ *
+ * The bands are spread over the channels from bass to treble, each with its
+ * level as the brightness and a hue from red to blue. An onset flashes every
+ * channel toward white.
+ *
+ * @param[in] analyzer The analyzer.
+ * @param[in,out] frame The frame. The channel IDs are left as they are.
+ * @param[in] channel_count The number of channels in the frame.
+ * @param[in,out] flash The strength of the onset flash, between 0 and 1. It
+ * decays from frame to frame.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int audio_analyzer_render(const audio_analyzer *analyzer,
+                          hue_stream_message_data *frame, int channel_count,
+                          float *flash);
@@ -0,0 +1,87 @@
+#pragma once
+
+#include "hue_stream_message.h"
+#include <stdint.h> // uint8_t
+
+// The xy of the sRGB white point, D65, which black converts to since it has
+// no chromaticity of its own.
+#define COLOR_WHITE_POINT_X 0.3127f
+#define COLOR_WHITE_POINT_Y 0.3290f
+
+/**
+ * The implementation of the conversion kernels.
+ *
+ * Every kernel produces the same result to within one unit of the 16-bit
+ * output. AVX2 is used when the CPU supports it, SSE2 on any other x86-64
+ * CPU, and the scalar kernel everywhere else.
+ */
+typedef enum color_kernel color_kernel;
+enum color_kernel {
+  COLOR_KERNEL_AUTO,
+  COLOR_KERNEL_SCALAR,
+  COLOR_KERNEL_SSE2,
+  COLOR_KERNEL_AVX2,
+};
+
+/**
+ * @brief Get the fastest kernel this CPU supports.
+ *
+ * @return The kernel, never COLOR_KERNEL_AUTO.
+ */
+color_kernel color_kernel_best(void);
+
+/**
+ * @brief Get the name of a kernel, for reports.
+ *
+ * @param[in] kernel The kernel.
+ *
+ * @return The name.
+ */
+const char *color_kernel_name(color_kernel kernel);
+
+/**
+ * @brief Convert an sRGB-encoded component to linear light.
+ *
+ * @param[in] value The component, between 0 and 1.
+ *
+ * @return The linear component, between 0 and 1.
+ */
+float color_srgb_to_linear(float value);
+
+/**
+ * @brief Convert linear RGB colors to xy + brightness channel data.
+ *
+ * Each color is converted to CIE XYZ with the sRGB primaries. x and y are its
+ * chromaticity, and the brightness is its luminance Y. Black has the
+ * chromaticity of the white point. Components outside 0 to 1 are clamped.
+ *
+ * The channel IDs of the data are left as they are.
+ *
+ * @param[in] kernel The kernel to convert with, or COLOR_KERNEL_AUTO for the
+ * fastest one.
+ * @param[in] rgb The colors, as interleaved red, green and blue components.
+ * @param[in] count The number of colors.
+ * @param[out] data The channel data, one channel per color.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int color_linear_to_xy_brightness(color_kernel kernel, const float *rgb,
+                                  int count, hue_stream_message_data *data);
+
+/**
+ * @brief Convert 8-bit sRGB colors, such as video pixels, to xy + brightness
+ * channel data.
+ *
+ * Like @ref color_linear_to_xy_brightness(), after decoding the sRGB transfer
+ * function with a lookup table.
+ *
+ * @param[in] kernel The kernel to convert with, or COLOR_KERNEL_AUTO for the
+ * fastest one.
+ * @param[in] rgb The colors, as interleaved red, green and blue components.
+ * @param[in] count The number of colors.
+ * @param[out] data The channel data, one channel per color.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int color_srgb8_to_xy_brightness(color_kernel kernel, const uint8_t *rgb,
+                                 int count, hue_stream_message_data *data);
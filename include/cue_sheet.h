@@ -0,0 +1,101 @@
+#pragma once
+
+#include "animation.h"
+#include <stddef.h> // size_t
+
+#define CUE_SHEET_TITLE_SIZE 64
+
+/**
+ * A single cue: the effect that runs from start_time until the next cue.
+ *
+ * Parameters the cue doesn't set (index >= param_count) take the effect's
+ * default values. The easing curve shapes the effect's progress, and is
+ * quadratic unless the cue picks another.
+ */
+typedef struct cue cue;
+struct cue {
+  double start_time;
+  const animation_effect *effect;
+  int param_count;
+  double params[ANIMATION_EFFECT_MAX_PARAMS];
+  easing_curve easing;
+};
+
+/**
+ * A timeline of cues sorted by start time. The last cue marks the end of the
+ * timeline.
+ */
+struct cue_sheet {
+  char title[CUE_SHEET_TITLE_SIZE];
+  int cue_count;
+  const cue *cues;
+};
+
+/**
+ * @brief Find the cue that is active at a time.
+ *
+ * The search starts at *cursor and checks the cue after it, so playing
+ * forward costs O(1) per frame. After a jump or seek it falls back to a
+ * binary search. *cursor is updated to the cue that was found.
+ *
+ * @param[in] sheet The cue sheet.
+ * @param[in] time The time from the start of the animation.
+ * @param[in,out] cursor The index of the previously active cue.
+ *
+ * @return The index of the active cue, or -1 if the time is before the first
+ * cue or at or after the last cue.
+ */
+int cue_sheet_find(const cue_sheet *sheet, double time, int *cursor);
+
+/**
+ * @brief Load a cue sheet from a file.
+ *
+ * Binary cue sheets (see @ref cue_sheet_save_binary()) are memory-mapped and
+ * recognized by their magic number. Anything else is parsed as a text cue
+ * sheet, which has one directive per line:
+ *
+ *     # Comments start with '#'.
+ *     title <title>
+ *     <time> <effect>[:<easing>] [<param>...]
+ *
+ * Times are in seconds, or [hh:]mm:ss.sss, from the start of the animation.
+ * The easing is a curve name that @ref easing_parse() reads.
+ *
+ * The user is responsible for freeing the cue sheet with
+ * @ref cue_sheet_free().
+ *
+ * @param[in] path The path of the cue sheet file.
+ *
+ * @return A new cue sheet, or NULL on failure.
+ */
+cue_sheet *cue_sheet_load(const char *path);
+
+/**
+ * @brief Parse a text cue sheet.
+ *
+ * The user is responsible for freeing the cue sheet with
+ * @ref cue_sheet_free().
+ *
+ * @param[in] text The text to parse. It doesn't need to be null-terminated.
+ * @param[in] size The size of the text.
+ *
+ * @return A new cue sheet, or NULL on failure.
+ */
+cue_sheet *cue_sheet_parse(const char *text, size_t size);
+
+/**
+ * @brief Save a cue sheet in the compact binary format.
+ *
+ * @param[in] sheet The cue sheet to save.
+ * @param[in] path The path of the file to write.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int cue_sheet_save_binary(const cue_sheet *sheet, const char *path);
+
+/**
+ * @brief Free a cue sheet.
+ *
+ * @param[in] sheet The cue sheet to free.
+ */
+void cue_sheet_free(cue_sheet *sheet);
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <stdint.h> // uint32_t
+
+// Progress in fixed point, with 30 fractional bits. EASING_ONE is the end of a
+// phase.
+#define EASING_FRACTION_BITS 30
+#define EASING_ONE (1U << EASING_FRACTION_BITS)
+
+/**
+ * The shape of a fade over a phase. Each curve eases in and out, except the
+ * step, which holds the start until halfway and then cuts to the end.
+ */
+typedef enum easing_curve easing_curve;
+enum easing_curve {
+  EASING_QUADRATIC,
+  EASING_CUBIC,
+  EASING_SINE,
+  EASING_EXPONENTIAL,
+  EASING_STEP,
+  EASING_CURVE_COUNT,
+};
+
+/**
+ * @brief Parse a curve name, "quadratic", "cubic", "sine", "exponential" or
+ * "step".
+ *
+ * @param[in] name The name.
+ * @param[out] curve The curve.
+ *
+ * @return 0 on success, -1 if the name is unknown.
+ */
+int easing_parse(const char *name, easing_curve *curve);
+
+/**
+ * @brief Get the name of a curve, as @ref easing_parse() reads it.
+ *
+ * @param[in] curve The curve.
+ *
+ * @return The name.
+ */
+const char *easing_name(easing_curve curve);
+
+/**
+ * @brief Evaluate a curve in double precision. This is the reference
+ * @ref easing_apply() matches.
+ *
+ * @param[in] curve The curve.
+ * @param[in] progress The progress, from 0 to 1.
+ *
+ * @return The eased progress, from 0 to 1.
+ */
+double easing_reference(easing_curve curve, double progress);
+
+/**
+ * @brief Convert progress to fixed point.
+ *
+ * @param[in] progress The progress, from 0 to 1. It is clamped to that range.
+ *
+ * @return The progress, from 0 to EASING_ONE.
+ */
+uint32_t easing_progress(double progress);
+
+/**
+ * @brief Evaluate a curve in integer arithmetic.
+ *
+ * The quadratic and cubic curves are computed directly in fixed point. The
+ * sine and exponential are sampled once, on first use, into a table that is
+ * interpolated linearly. Either way, easing takes a few integer operations.
+ *
+ * @param[in] curve The curve.
+ * @param[in] progress The progress, from 0 to EASING_ONE.
+ *
+ * @return The eased progress, from 0 to EASING_ONE.
+ */
+uint32_t easing_apply(easing_curve curve, uint32_t progress);
+
+/**
+ * @brief Interpolate between two values in integer arithmetic.
+ *
+ * The result is start + (end - start) * eased, rounded down, like the
+ * double-precision interpolation it replaces.
+ *
+ * @param[in] start The value at the start.
+ * @param[in] end The value at the end.
+ * @param[in] eased The eased progress, from 0 to EASING_ONE.
+ *
+ * @return The interpolated value.
+ */
+static inline int easing_interpolate(int start, int end, uint32_t eased) {
+  // Inline, since effects call it for every component of every channel, and
+  // a call would cost more than the arithmetic.
+  return start +
+         (int)(((int64_t)(end - start) * eased) >> EASING_FRACTION_BITS);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "hue_rest_client.h"
+#include <stdbool.h> // bool
+#include <stddef.h>  // size_t
+
+// Cached entertainment areas older than this are fetched from the bridge again.
+#define ENTERTAINMENT_CACHE_MAX_AGE_SECONDS (24 * 60 * 60)
+
+/**
+ * @brief Get the path of a bridge's cache file.
+ *
+ * The cache lives in $XDG_CACHE_HOME/resonate, or in ~/.cache/resonate if
+ * XDG_CACHE_HOME isn't set, with one file per bridge.
+ *
+ * @param[in] bridge_ip The IP address of the Hue bridge.
+ * @param[out] path The path.
+ * @param[in] size The size of path.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int entertainment_cache_path(const char *bridge_ip, char *path, size_t size);
+
+/**
+ * @brief Load the cached entertainment areas of a bridge.
+ *
+ * @param[in] bridge_ip The IP address of the Hue bridge.
+ * @param[in] max_age_seconds How old the cache may be.
+ * @param[out] configs The entertainment areas.
+ * @param[in] max_configs The number of areas that fit in configs.
+ *
+ * @return The number of areas, 0 if the cache is missing, stale or unreadable,
+ * or -1 on failure.
+ */
+int entertainment_cache_load(const char *bridge_ip, int max_age_seconds,
+                             hue_entertainment_config *configs,
+                             int max_configs);
+
+/**
+ * @brief Save the entertainment areas of a bridge to the cache.
+ *
+ * The cache file is replaced atomically, so a concurrent reader sees either the
+ * old or the new areas.
+ *
+ * @param[in] bridge_ip The IP address of the Hue bridge.
+ * @param[in] configs The entertainment areas.
+ * @param[in] config_count The number of areas.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int entertainment_cache_save(const char *bridge_ip,
+                             const hue_entertainment_config *configs,
+                             int config_count);
+
+/**
+ * @brief Get the entertainment areas of a bridge, from the cache if it is
+ * fresh, or from the bridge otherwise.
+ *
+ * Areas fetched from the bridge are written back to the cache.
+ *
+ * @param[in] client The REST client to ask the bridge with.
+ * @param[in] bridge_ip The IP address of the Hue bridge.
+ * @param[in] refresh Whether to skip the cache and ask the bridge.
+ * @param[out] configs The entertainment areas.
+ * @param[in] max_configs The number of areas that fit in configs.
+ *
+ * @return The number of areas, or -1 on failure.
+ */
+int entertainment_cache_discover(hue_rest_client *client,
+                                 const char *bridge_ip, bool refresh,
+                                 hue_entertainment_config *configs,
+                                 int max_configs);
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <signal.h>  // sigset_t
+#include <stdbool.h> // bool
+#include <stdint.h>  // uint64_t
+
+typedef enum event_loop_event event_loop_event;
+enum event_loop_event {
+  EVENT_LOOP_ERROR = -1,
+  // A frame is due.
+  EVENT_LOOP_FRAME,
+  // The input can be read without blocking, or has been closed.
+  EVENT_LOOP_INPUT,
+  // One of the loop's signals arrived.
+  EVENT_LOOP_SIGNAL,
+};
+
+/**
+ * A single-threaded event loop that wakes up for frames, input and signals.
+ *
+ * Frames are timed by a timerfd on CLOCK_MONOTONIC, signals are read from a
+ * signalfd, and all of them are waited on together with epoll, so whatever is
+ * done for a frame runs right when the frame is due. Frames that come due
+ * while the loop is busy count as deadline misses and are skipped, like
+ * FRAME_SCHEDULER_OVERRUN_SKIP.
+ *
+ * It needs Linux. Elsewhere @ref event_loop_supported() is false and
+ * @ref event_loop_init() fails.
+ */
+typedef struct event_loop event_loop;
+struct event_loop {
+  int epoll;
+  int timer;
+  int signals;
+  int input;
+  // The signal mask before the loop's signals were blocked.
+  sigset_t previous_mask;
+  long period_ns;
+  uint64_t start_ns;
+  // When the frame last reported was due, on CLOCK_MONOTONIC.
+  uint64_t deadline_ns;
+  // How many periods have passed, counting the frames skipped.
+  uint64_t expirations;
+  uint64_t frames;
+  uint64_t deadline_misses;
+  uint64_t frames_skipped;
+};
+
+/**
+ * @brief Check whether the event loop is supported on this platform.
+ *
+ * @return Whether the event loop is supported.
+ */
+bool event_loop_supported(void);
+
+/**
+ * @brief Initialize an event loop. The first frame is due one period after
+ * this function is called.
+ *
+ * The signals are blocked in the calling thread until the loop is closed, so
+ * they are only seen by the loop. Threads started before are not affected.
+ *
+ * @param[out] loop The loop to initialize.
+ * @param[in] frames_per_second The frame rate.
+ * @param[in] input A file descriptor to watch for input, or -1.
+ * @param[in] signals The signals to handle.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int event_loop_init(event_loop *loop, int frames_per_second, int input,
+                    const sigset_t *signals);
+
+/**
+ * @brief Wait for the next event. A due frame comes before input and signals
+ * that are ready at the same time.
+ *
+ * @param[in,out] loop The loop.
+ * @param[out] signal The signal, when the event is EVENT_LOOP_SIGNAL.
+ *
+ * @return The event.
+ */
+event_loop_event event_loop_wait(event_loop *loop, int *signal);
+
+/**
+ * @brief Print the frame statistics of a loop, like
+ * @ref frame_scheduler_print_stats().
+ *
+ * @param[in] loop The loop.
+ * @param[in] name The name to print the statistics under.
+ */
+void event_loop_print_stats(const event_loop *loop, const char *name);
+
+/**
+ * @brief Close a loop and unblock its signals.
+ *
+ * @param[in] loop The loop.
+ */
+void event_loop_close(event_loop *loop);
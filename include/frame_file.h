@@ -0,0 +1,73 @@
+#pragma once
+
+#include "cue_sheet.h"
+#include <stddef.h> // size_t
+#include <stdint.h> // int64_t, uint8_t
+
+#define FRAME_FILE_TITLE_SIZE 64
+
+/**
+ * A pre-rendered animation, memory-mapped from a frame file.
+ *
+ * Every frame is stored as serialized channels (see
+ * @ref hue_stream_message_serialize_channels()), so playing a frame back is a
+ * pointer lookup followed by a copy into the message buffer.
+ */
+typedef struct frame_file frame_file;
+struct frame_file {
+  char title[FRAME_FILE_TITLE_SIZE];
+  int frames_per_second;
+  int channel_count;
+  int frame_count;
+  // The size of one serialized frame.
+  size_t frame_size;
+  const uint8_t *frames;
+  void *map;
+  size_t map_size;
+};
+
+/**
+ * @brief Render a cue sheet into a frame file.
+ *
+ * The cue sheet is rendered with the offline renderer, so this doesn't wait on
+ * real time.
+ *
+ * @param[in] sheet The cue sheet to render.
+ * @param[in] channel_count The number of channels in each frame.
+ * @param[in] frames_per_second The frame rate to render at.
+ * @param[in] path The path of the frame file to write.
+ *
+ * @return The number of frames rendered, or -1 on failure.
+ */
+int frame_file_render(const cue_sheet *sheet, int channel_count,
+                      int frames_per_second, const char *path);
+
+/**
+ * @brief Memory-map a frame file.
+ *
+ * The user is responsible for closing the frame file with
+ * @ref frame_file_close().
+ *
+ * @param[in] path The path of the frame file.
+ *
+ * @return The frame file, or NULL on failure.
+ */
+frame_file *frame_file_open(const char *path);
+
+/**
+ * @brief Get the frame to show at a time.
+ *
+ * @param[in] file The frame file.
+ * @param[in] elapsed_ns The time since the start of playback in nanoseconds.
+ *
+ * @return The serialized channels of the frame, or NULL if the time is after
+ * the end of the animation. Times before the start get the first frame.
+ */
+const uint8_t *frame_file_frame_at(const frame_file *file, int64_t elapsed_ns);
+
+/**
+ * @brief Unmap and free a frame file.
+ *
+ * @param[in] file The frame file to close.
+ */
+void frame_file_close(frame_file *file);
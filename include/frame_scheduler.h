@@ -0,0 +1,90 @@
+#pragma once
+
+#include <stdint.h> // uint64_t
+#include <time.h>   // struct timespec
+
+typedef enum frame_scheduler_overrun_policy frame_scheduler_overrun_policy;
+enum frame_scheduler_overrun_policy {
+  // Drop the missed frames and realign to the next frame boundary.
+  FRAME_SCHEDULER_OVERRUN_SKIP,
+  // Run the missed frames back to back until the schedule is caught up.
+  FRAME_SCHEDULER_OVERRUN_CATCH_UP
+};
+
+typedef struct frame_scheduler_stats frame_scheduler_stats;
+struct frame_scheduler_stats {
+  uint64_t frames;
+  uint64_t deadline_misses;
+  uint64_t frames_skipped;
+  double elapsed_seconds;
+  double achieved_rate;
+};
+
+typedef struct frame_scheduler frame_scheduler;
+struct frame_scheduler {
+  long period_ns;
+  frame_scheduler_overrun_policy overrun_policy;
+  struct timespec start_time;
+  struct timespec deadline;
+  uint64_t frames;
+  uint64_t deadline_misses;
+  uint64_t frames_skipped;
+};
+
+/**
+ * @brief Initialize a frame scheduler.
+ *
+ * Deadlines are absolute times on CLOCK_MONOTONIC measured from the moment
+ * this function is called, so the time spent working on a frame never delays
+ * the frames that follow it.
+ *
+ * @param[out] scheduler The scheduler to initialize.
+ * @param[in] frames_per_second The target frame rate.
+ * @param[in] overrun_policy What to do when a deadline is missed.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int frame_scheduler_init(frame_scheduler *scheduler, int frames_per_second,
+                         frame_scheduler_overrun_policy overrun_policy);
+
+/**
+ * @brief Initialize a frame scheduler with a frame period, for frame rates
+ * that aren't a whole number, like the 30000/1001 of NTSC video.
+ *
+ * @param[out] scheduler The scheduler to initialize.
+ * @param[in] period_ns The time between frames in nanoseconds.
+ * @param[in] overrun_policy What to do when a deadline is missed.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int frame_scheduler_init_period(frame_scheduler *scheduler, long period_ns,
+                                frame_scheduler_overrun_policy overrun_policy);
+
+/**
+ * @brief Sleep until the next frame deadline.
+ *
+ * Call this once per frame after the frame's work is done.
+ *
+ * @param[in,out] scheduler The frame scheduler.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int frame_scheduler_wait(frame_scheduler *scheduler);
+
+/**
+ * @brief Get the statistics of a frame scheduler.
+ *
+ * @param[in] scheduler The frame scheduler.
+ * @param[out] stats The statistics since the scheduler was initialized.
+ */
+void frame_scheduler_get_stats(const frame_scheduler *scheduler,
+                               frame_scheduler_stats *stats);
+
+/**
+ * @brief Print the statistics of a frame scheduler.
+ *
+ * @param[in] scheduler The frame scheduler.
+ * @param[in] name The name to print the statistics under.
+ */
+void frame_scheduler_print_stats(const frame_scheduler *scheduler,
+                                 const char *name);
@@ -0,0 +1,85 @@
+#pragma once
+
+#include "hue_stream_message.h"
+#include <stdalign.h>   // alignas
+#include <stdatomic.h>  // atomic_uint
+#include <stdbool.h>    // bool
+#include <stdint.h>     // uint64_t
+
+#define FRAME_SLOT_BUFFER_COUNT 3
+#define FRAME_SLOT_CACHE_LINE_SIZE 64
+// A frame may span several entertainment areas, eight full ones at most.
+#define FRAME_SLOT_MAX_CHANNELS (8 * HUE_STREAM_MESSAGE_MAX_CHANNELS)
+
+/**
+ * A lock-free single-producer, single-consumer triple buffer.
+ *
+ * The producer owns one buffer, the consumer owns another, and the third is
+ * the shared buffer they exchange through a single atomic. Neither side ever
+ * waits for the other, and the consumer always gets the newest complete frame.
+ */
+typedef struct frame_slot frame_slot;
+struct frame_slot {
+  hue_stream_message_data buffers[FRAME_SLOT_BUFFER_COUNT]
+                                 [FRAME_SLOT_MAX_CHANNELS];
+  // When the frame in each buffer was published, as the producer timed it.
+  uint64_t published_ns[FRAME_SLOT_BUFFER_COUNT];
+  int channel_count;
+
+  // Index of the shared buffer, plus a flag set when it holds a new frame.
+  alignas(FRAME_SLOT_CACHE_LINE_SIZE) atomic_uint shared;
+
+  // Index of the buffer owned by the producer.
+  alignas(FRAME_SLOT_CACHE_LINE_SIZE) unsigned int back;
+
+  // Index of the buffer owned by the consumer.
+  alignas(FRAME_SLOT_CACHE_LINE_SIZE) unsigned int front;
+};
+
+/**
+ * @brief Initialize a frame slot.
+ *
+ * @param[out] slot The slot to initialize.
+ * @param[in] frame The initial frame the consumer reads.
+ * @param[in] channel_count The number of channels in every frame.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int frame_slot_init(frame_slot *slot, const hue_stream_message_data *frame,
+                    int channel_count);
+
+/**
+ * @brief Publish a new frame. Only the producer thread may call this.
+ *
+ * @param[in,out] slot The frame slot.
+ * @param[in] frame The frame to publish. channel_count channels are copied.
+ * @param[in] published_ns When the frame was finished, on CLOCK_MONOTONIC in
+ * nanoseconds, or 0 if it isn't timed. The slot doesn't read the clock
+ * itself, since the producer usually just has.
+ */
+void frame_slot_publish(frame_slot *slot, const hue_stream_message_data *frame,
+                        uint64_t published_ns);
+
+/**
+ * @brief Get the newest published frame. Only the consumer thread may call
+ * this.
+ *
+ * @param[in,out] slot The frame slot.
+ * @param[out] updated Optional. Set to true if the frame was published since
+ * the previous call.
+ *
+ * @return The newest frame. It stays valid until the next call.
+ */
+const hue_stream_message_data *frame_slot_acquire(frame_slot *slot,
+                                                  bool *updated);
+
+/**
+ * @brief Get when the frame last returned by @ref frame_slot_acquire() was
+ * published. Only the consumer thread may call this.
+ *
+ * @param[in] slot The frame slot.
+ *
+ * @return The time passed to @ref frame_slot_publish(), or 0 for the
+ * initial frame.
+ */
+uint64_t frame_slot_published_ns(const frame_slot *slot);
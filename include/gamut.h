@@ -0,0 +1,74 @@
+#pragma once
+
+#include "hue_stream_message.h"
+#include <stdint.h> // uint16_t
+
+/**
+ * The color gamut of a light, as the bridge reports it in gamut_type.
+ *
+ * Each gamut is a triangle in CIE xy that the light can show. Colors outside
+ * it are moved to its closest point. Lights of the other gamut type are left
+ * alone.
+ */
+typedef enum gamut_type gamut_type;
+enum gamut_type {
+  GAMUT_OTHER,
+  GAMUT_A,
+  GAMUT_B,
+  GAMUT_C,
+  GAMUT_TYPE_COUNT,
+};
+
+// The gamut of most current color lights, used when a light's is unknown.
+#define GAMUT_DEFAULT GAMUT_C
+
+/**
+ * @brief Parse a gamut type name, "A", "B", "C" or "other".
+ *
+ * @param[in] name The name.
+ * @param[out] type The gamut type.
+ *
+ * @return 0 on success, -1 if the name is unknown.
+ */
+int gamut_parse(const char *name, gamut_type *type);
+
+/**
+ * @brief Get the name of a gamut type, as @ref gamut_parse() reads it.
+ *
+ * @param[in] type The gamut type.
+ *
+ * @return The name.
+ */
+const char *gamut_name(gamut_type type);
+
+/**
+ * @brief Move a color into a gamut by exact geometry.
+ *
+ * A color inside the gamut is left as it is. Any other color moves to the
+ * closest point on the triangle's edges. This is the reference
+ * @ref gamut_map_frame() matches.
+ *
+ * @param[in] type The gamut type.
+ * @param[in,out] x The x coordinate, scaled to 0 to 0xffff.
+ * @param[in,out] y The y coordinate, scaled to 0 to 0xffff.
+ */
+void gamut_clamp(gamut_type type, uint16_t *x, uint16_t *y);
+
+/**
+ * @brief Move every channel of an xy + brightness frame into its light's
+ * gamut.
+ *
+ * Each gamut has a precomputed grid over the xy plane that tells, for each
+ * cell, whether its colors are inside the gamut or which edge or corner they
+ * move to. Most channels then cost a table lookup, and the rest a projection
+ * onto one edge. Only cells that straddle a boundary fall back to the exact
+ * clamp.
+ *
+ * @param[in] gamuts The gamut of each channel.
+ * @param[in] frame The frame.
+ * @param[out] mapped The mapped frame. It may be the same as frame.
+ * @param[in] channel_count The number of channels.
+ */
+void gamut_map_frame(const gamut_type *gamuts,
+                     const hue_stream_message_data *frame,
+                     hue_stream_message_data *mapped, int channel_count);
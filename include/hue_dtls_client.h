@@ -7,6 +7,9 @@
 #include <mbedtls/ssl.h>
 #include <mbedtls/timing.h>
 
+#define HUE_BRIDGE_DTLS_CIPHER MBEDTLS_TLS_PSK_WITH_AES_128_GCM_SHA256
+#define HUE_BRIDGE_DTLS_PORT "2100"
+
 typedef struct hue_dtls_context hue_dtls_context;
 struct hue_dtls_context {
   mbedtls_net_context server_fd;
@@ -18,6 +21,19 @@ struct hue_dtls_context {
   int ciphersuites[2];
 };
 
+/**
+ * @brief Configure the pre-shared key (PSK) used by the Hue bridge.
+ *
+ * This function requires these environment variables to be set:
+ * - HUE_APPLICATION_ID (the PSK identity)
+ * - HUE_CLIENTKEY (the PSK as 32 hex digits)
+ *
+ * @param conf The SSL configuration.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int hue_dtls_conf_psk(mbedtls_ssl_config *conf);
+
 /**
  * @brief Create a new DTLS context.
  *
@@ -61,3 +77,16 @@ int hue_dtls_connect(hue_dtls_context *context, const char *bridge_ip);
  */
 int hue_dtls_send_message(hue_dtls_context *context,
                           const hue_stream_message *message, int channel_count);
+
+/**
+ * @brief Send a serialized Hue stream message to the Hue bridge over DTLS.
+ *
+ * Unlike @ref hue_dtls_send_message(), this function doesn't allocate.
+ *
+ * @param context The DTLS context.
+ * @param buffer The serialized message to send.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int hue_dtls_send_buffer(hue_dtls_context *context,
+                         const hue_stream_message_buffer *buffer);
@@ -1,15 +1,188 @@
 #pragma once
 
+#include "gamut.h"
+#include "hue_stream_message.h"
+#include <stdbool.h> // bool
+#include <stddef.h>  // size_t
+#include <stdint.h>  // uint8_t
+
+#define HUE_REST_MAX_ENTERTAINMENT_CONFIGS 16
+#define HUE_REST_ENTERTAINMENT_CONFIG_NAME_SIZE 64
+
+// The most requests @ref hue_rest_client_start() and
+// @ref hue_rest_client_stop() run at once.
+#define HUE_REST_CLIENT_MAX_REQUESTS 16
+
+/**
+ * A channel of an entertainment area, where it is in the room and the gamut of
+ * the light behind it. Each coordinate is between -1 and 1.
+ */
+typedef struct hue_entertainment_channel hue_entertainment_channel;
+struct hue_entertainment_channel {
+  uint8_t channel_id;
+  double x;
+  double y;
+  double z;
+  gamut_type gamut;
+};
+
+/**
+ * An entertainment area (entertainment_configuration) on a bridge.
+ */
+typedef struct hue_entertainment_config hue_entertainment_config;
+struct hue_entertainment_config {
+  char id[HUE_STREAM_MESSAGE_ENTERTAINMENT_CONFIG_ID_SIZE + 1];
+  char name[HUE_REST_ENTERTAINMENT_CONFIG_NAME_SIZE];
+  int channel_count;
+  hue_entertainment_channel channels[HUE_STREAM_MESSAGE_MAX_CHANNELS];
+};
+
+/**
+ * An entertainment area to start or stop, on a given bridge.
+ */
+typedef struct hue_rest_area hue_rest_area;
+struct hue_rest_area {
+  const char *bridge_ip;
+  const char *entertainment_config_id;
+};
+
+/**
+ * A long-lived client for the bridges' REST API.
+ *
+ * The client keeps one TLS connection to each bridge alive between calls, so
+ * only the first call to a bridge pays for the TCP and TLS handshakes. Calls
+ * that take several areas run their requests at the same time, one connection
+ * per bridge.
+ *
+ * A client may only be used by one thread at a time.
+ */
+typedef struct hue_rest_client hue_rest_client;
+
 /**
- * @brief Start the entertainment area streaming.
+ * @brief Initialize libcurl.
+ *
+ * Must be called once before any other hue_rest_ function, and before starting
+ * any thread, since the global initialization of libcurl isn't thread-safe.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int hue_rest_global_init(void);
+
+/**
+ * @brief Clean up what @ref hue_rest_global_init() set up.
+ */
+void hue_rest_global_cleanup(void);
+
+/**
+ * @brief Create a REST client.
  *
  * This function requires these environment variables to be set:
  * - HUE_USERNAME
  *
- * @param bridge_ip The IP address of the Hue bridge.
- * @param entertainment_config_id The entertainment configuration ID.
+ * HUE_REST_PORT may be set to use an HTTPS port other than 443.
+ *
+ * @return The client, or NULL on failure. Free it with
+ * @ref hue_rest_client_free().
+ */
+hue_rest_client *hue_rest_client_create(void);
+
+/**
+ * @brief Close the client's connections and free it.
+ *
+ * @param[in] client The client, or NULL.
+ */
+void hue_rest_client_free(hue_rest_client *client);
+
+/**
+ * @brief Start streaming to entertainment areas.
+ *
+ * Sends {"action":"start"} to every area at once.
+ *
+ * @param[in] client The client.
+ * @param[in] areas The areas.
+ * @param[in] area_count The number of areas, at most
+ * HUE_REST_CLIENT_MAX_REQUESTS.
+ *
+ * @return 0 if every area started, -1 otherwise.
+ */
+int hue_rest_client_start(hue_rest_client *client, const hue_rest_area *areas,
+                          int area_count);
+
+/**
+ * @brief Stop streaming to entertainment areas.
+ *
+ * Sends {"action":"stop"} to every area at once, which ends the areas'
+ * entertainment sessions on the bridges.
+ *
+ * @param[in] client The client.
+ * @param[in] areas The areas.
+ * @param[in] area_count The number of areas, at most
+ * HUE_REST_CLIENT_MAX_REQUESTS.
+ *
+ * @return 0 if every area stopped, -1 otherwise.
+ */
+int hue_rest_client_stop(hue_rest_client *client, const hue_rest_area *areas,
+                         int area_count);
+
+/**
+ * @brief Get whether an entertainment area is streaming.
+ *
+ * Queries GET /clip/v2/resource/entertainment_configuration/{id}.
+ *
+ * @param[in] client The client.
+ * @param[in] area The area.
+ * @param[out] active Whether the area is streaming.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int hue_rest_client_status(hue_rest_client *client, const hue_rest_area *area,
+                           bool *active);
+
+/**
+ * @brief Get the entertainment areas of a bridge, with their channels.
+ *
+ * Queries GET /clip/v2/resource/entertainment_configuration. The gamut of
+ * each channel's light is looked up at the same time, through
+ * GET /clip/v2/resource/entertainment and GET /clip/v2/resource/light. If
+ * that fails, the channels get GAMUT_DEFAULT.
+ *
+ * @param[in] client The client.
+ * @param[in] bridge_ip The IP address of the Hue bridge.
+ * @param[out] configs The entertainment areas.
+ * @param[in] max_configs The number of areas that fit in configs.
+ *
+ * @return The number of areas, or -1 on failure.
+ */
+int hue_rest_client_get_entertainment_configurations(
+    hue_rest_client *client, const char *bridge_ip,
+    hue_entertainment_config *configs, int max_configs);
+
+/**
+ * @brief Parse a GET /clip/v2/resource/entertainment_configuration response.
+ *
+ * The response doesn't tell the channels' gamuts, so they get GAMUT_DEFAULT.
+ *
+ * @param[in] json The response body.
+ * @param[in] length The length of the response body.
+ * @param[out] configs The entertainment areas.
+ * @param[in] max_configs The number of areas that fit in configs. Areas past
+ * it are ignored.
+ *
+ * @return The number of areas, or -1 on failure.
+ */
+int hue_rest_parse_entertainment_configurations(
+    const char *json, size_t length, hue_entertainment_config *configs,
+    int max_configs);
+
+/**
+ * @brief Parse a GET /clip/v2/resource/entertainment_configuration/{id}
+ * response into the area's status.
+ *
+ * @param[in] json The response body.
+ * @param[in] length The length of the response body.
+ * @param[out] active Whether the area is streaming.
  *
  * @return 0 on success, -1 on failure.
  */
-int hue_rest_start_entertainment_area_streaming(
-    const char *bridge_ip, const char *entertainment_config_id);
+int hue_rest_parse_entertainment_status(const char *json, size_t length,
+                                        bool *active);
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "hue_stream_message.h"
+#include <stdbool.h> // bool
+#include <stdint.h>  // uint8_t, uint64_t
+
+typedef struct hue_stream_encoder_stats hue_stream_encoder_stats;
+struct hue_stream_encoder_stats {
+  uint64_t frames;
+  uint64_t packets_sent;
+  uint64_t packets_suppressed;
+  uint64_t channels_sent;
+  uint64_t channels_suppressed;
+  uint64_t bytes_sent;
+  uint64_t bytes_saved;
+};
+
+/**
+ * A change-aware Hue stream message encoder.
+ *
+ * Frames identical to the last one sent are suppressed, and otherwise only the
+ * channels that changed are encoded. Every keepalive_frames frames the whole
+ * frame is sent regardless, which keeps the entertainment session alive and
+ * repairs any channel whose update was lost on the way to the bridge.
+ */
+typedef struct hue_stream_encoder hue_stream_encoder;
+struct hue_stream_encoder {
+  hue_stream_message_buffer buffer;
+  // The serialized channels of the last frame sent.
+  uint8_t last_sent[HUE_STREAM_MESSAGE_MAX_CHANNELS *
+                    HUE_STREAM_MESSAGE_CHANNEL_SIZE];
+  bool has_last_sent;
+  uint8_t sequence_id;
+  int keepalive_frames;
+  int frames_since_full;
+  hue_stream_encoder_stats stats;
+};
+
+/**
+ * @brief Initialize a Hue stream encoder.
+ *
+ * @param[out] encoder The encoder to initialize.
+ * @param[in] entertainment_config_id The entertainment configuration ID.
+ * @param[in] color_space The color space of the channel data.
+ * @param[in] keepalive_frames The maximum number of frames between two full
+ * frames.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int hue_stream_encoder_init(hue_stream_encoder *encoder,
+                            const char *entertainment_config_id,
+                            uint8_t color_space, int keepalive_frames);
+
+/**
+ * @brief Encode a frame.
+ *
+ * If the frame needs to be sent, the message is written to encoder->buffer.
+ *
+ * @param[in,out] encoder The encoder.
+ * @param[in] frame The frame to encode.
+ * @param[in] channel_count The number of channels in the frame.
+ *
+ * @return 1 if encoder->buffer should be sent, 0 if the frame was suppressed,
+ * or -1 on failure.
+ */
+int hue_stream_encoder_encode(hue_stream_encoder *encoder,
+                              const hue_stream_message_data *frame,
+                              int channel_count);
+
+/**
+ * @brief Encode a frame of serialized channels.
+ *
+ * Like @ref hue_stream_encoder_encode(), but the frame is already serialized
+ * (see @ref hue_stream_message_serialize_channels()), as it is in a
+ * pre-rendered frame file.
+ *
+ * @param[in,out] encoder The encoder.
+ * @param[in] channels The serialized channels of the frame.
+ * @param[in] channel_count The number of channels in the frame.
+ *
+ * @return 1 if encoder->buffer should be sent, 0 if the frame was suppressed,
+ * or -1 on failure.
+ */
+int hue_stream_encoder_encode_serialized(hue_stream_encoder *encoder,
+                                         const uint8_t *channels,
+                                         int channel_count);
+
+/**
+ * @brief Print the statistics of a Hue stream encoder.
+ *
+ * @param[in] encoder The encoder.
+ */
+void hue_stream_encoder_print_stats(const hue_stream_encoder *encoder);
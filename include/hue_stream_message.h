@@ -14,6 +14,14 @@
 #define HUE_STREAM_MESSAGE_COLOR_SPACE_RGB 0x00
 #define HUE_STREAM_MESSAGE_COLOR_SPACE_XY_BRIGHTNESS 0x01
 
+// Serialized sizes.
+#define HUE_STREAM_MESSAGE_HEADER_SIZE 52
+#define HUE_STREAM_MESSAGE_SEQUENCE_ID_OFFSET 11
+#define HUE_STREAM_MESSAGE_CHANNEL_SIZE 7
+#define HUE_STREAM_MESSAGE_MAX_SIZE                                            \
+  (HUE_STREAM_MESSAGE_HEADER_SIZE +                                            \
+   HUE_STREAM_MESSAGE_MAX_CHANNELS * HUE_STREAM_MESSAGE_CHANNEL_SIZE)
+
 typedef struct hue_stream_message_data hue_stream_message_data;
 struct hue_stream_message_data {
   uint8_t channel_id;
@@ -33,6 +41,19 @@ struct hue_stream_message {
   hue_stream_message_data data[HUE_STREAM_MESSAGE_MAX_CHANNELS];
 };
 
+/**
+ * A reusable, caller-owned buffer holding a serialized Hue stream message.
+ *
+ * The header is written once by @ref hue_stream_message_buffer_init(). Each
+ * frame then only rewrites the sequence ID and the channel data, so the
+ * steady-state send path never allocates.
+ */
+typedef struct hue_stream_message_buffer hue_stream_message_buffer;
+struct hue_stream_message_buffer {
+  uint8_t data[HUE_STREAM_MESSAGE_MAX_SIZE];
+  size_t size;
+};
+
 /**
  * @brief Create a new Hue stream message.
  *
@@ -64,6 +85,41 @@ void hue_stream_message_serialize(const hue_stream_message *message,
                                   int channel_count, uint8_t **buffer,
                                   size_t *buffer_size);
 
+/**
+ * @brief Parse and validate a serialized Hue stream message.
+ *
+ * This is the inverse of @ref hue_stream_message_serialize(). The message is
+ * rejected, with the reason printed to stderr, if it is truncated, has the
+ * wrong protocol name or version, an unknown color space, a malformed
+ * entertainment configuration ID, or too many or duplicate channels.
+ *
+ * @param[in] buffer The serialized message.
+ * @param[in] buffer_size The size of the serialized message.
+ * @param[out] message The parsed message.
+ * @param[out] channel_count The number of channels in the message.
+ *
+ * @return 0 if the message is valid, -1 otherwise.
+ */
+int hue_stream_message_parse(const uint8_t *buffer, size_t buffer_size,
+                             hue_stream_message *message, int *channel_count);
+
+/**
+ * @brief Serialize channel data without a message header.
+ *
+ * Each channel takes HUE_STREAM_MESSAGE_CHANNEL_SIZE bytes, laid out exactly
+ * as it is in a serialized message.
+ *
+ * @param[in] data The channel data array.
+ * @param[in] channel_count The length of the data array.
+ * @param[out] channels The buffer to serialize into. It must hold at least
+ * channel_count * HUE_STREAM_MESSAGE_CHANNEL_SIZE bytes.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int hue_stream_message_serialize_channels(const hue_stream_message_data *data,
+                                          int channel_count,
+                                          uint8_t *channels);
+
 /**
  * @brief Determine if a channel count is valid.
  *
@@ -72,3 +128,55 @@ void hue_stream_message_serialize(const hue_stream_message *message,
  * @return true if the channel count is valid, false otherwise.
  */
 bool hue_stream_message_valid_channel_count(int channel_count);
+
+/**
+ * @brief Initialize a Hue stream message buffer.
+ *
+ * Writes the fixed message header: the protocol name, version, color space
+ * and entertainment configuration ID.
+ *
+ * @param[out] buffer The buffer to initialize.
+ * @param[in] entertainment_config_id The entertainment configuration ID.
+ * @param[in] color_space The color space of the channel data.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int hue_stream_message_buffer_init(hue_stream_message_buffer *buffer,
+                                   const char *entertainment_config_id,
+                                   uint8_t color_space);
+
+/**
+ * @brief Write a frame into a Hue stream message buffer.
+ *
+ * Only the sequence ID and the channel data are written. The header written by
+ * @ref hue_stream_message_buffer_init() is left untouched.
+ *
+ * @param[in,out] buffer The initialized buffer to write into.
+ * @param[in] sequence_id The sequence ID of the message.
+ * @param[in] data The channel data array.
+ * @param[in] channel_count The length of the data array.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int hue_stream_message_buffer_write(hue_stream_message_buffer *buffer,
+                                    uint8_t sequence_id,
+                                    const hue_stream_message_data *data,
+                                    int channel_count);
+
+/**
+ * @brief Write a frame of serialized channels into a Hue stream message buffer.
+ *
+ * Like @ref hue_stream_message_buffer_write(), but the channels are already
+ * serialized (see @ref hue_stream_message_serialize_channels()) and are copied
+ * as is.
+ *
+ * @param[in,out] buffer The initialized buffer to write into.
+ * @param[in] sequence_id The sequence ID of the message.
+ * @param[in] channels The serialized channels.
+ * @param[in] channel_count The number of serialized channels.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int hue_stream_message_buffer_write_serialized(
+    hue_stream_message_buffer *buffer, uint8_t sequence_id,
+    const uint8_t *channels, int channel_count);
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <stdbool.h> // bool
+#include <stddef.h>  // size_t
+
+typedef enum json_type json_type;
+enum json_type {
+  JSON_OBJECT,
+  JSON_ARRAY,
+  JSON_STRING,
+  // A number, true, false or null.
+  JSON_PRIMITIVE
+};
+
+/**
+ * A JSON value in the source text.
+ *
+ * Tokens are stored in document order, so a value's children follow it, and
+ * next is the index just past them: the value's next sibling, if it has one.
+ * An object's children alternate between keys and values.
+ */
+typedef struct json_token json_token;
+struct json_token {
+  json_type type;
+  // The value's span in the source. For a string, the quotes are excluded.
+  size_t start;
+  size_t end;
+  int next;
+};
+
+/**
+ * @brief Tokenize a JSON document.
+ *
+ * Strings are not unescaped and numbers are not converted until they are
+ * read with @ref json_string_copy() or @ref json_number().
+ *
+ * @param[in] json The document.
+ * @param[in] length The length of the document.
+ * @param[out] tokens The tokens, or NULL to only count them.
+ * @param[in] max_tokens The number of tokens that fit in tokens.
+ *
+ * @return The number of tokens, or -1 if the document is invalid or doesn't
+ * fit in tokens.
+ */
+int json_parse(const char *json, size_t length, json_token *tokens,
+               int max_tokens);
+
+/**
+ * @brief Find a member of an object.
+ *
+ * @param[in] json The document.
+ * @param[in] tokens The tokens of the document.
+ * @param[in] object The index of the object.
+ * @param[in] key The key of the member.
+ *
+ * @return The index of the member's value, or -1 if the object has no such
+ * member or isn't an object.
+ */
+int json_object_get(const char *json, const json_token *tokens, int object,
+                    const char *key);
+
+/**
+ * @brief Compare a string to a C string, without unescaping it.
+ *
+ * @param[in] json The document.
+ * @param[in] token The token.
+ * @param[in] string The string to compare to.
+ *
+ * @return Whether the token is a string equal to string.
+ */
+bool json_string_equals(const char *json, const json_token *token,
+                        const char *string);
+
+/**
+ * @brief Copy and unescape a string.
+ *
+ * Escaped characters outside ASCII are replaced with '?'.
+ *
+ * @param[in] json The document.
+ * @param[in] token The token.
+ * @param[out] string The buffer to copy to.
+ * @param[in] size The size of the buffer.
+ *
+ * @return 0 on success, or -1 if the token isn't a string or doesn't fit.
+ */
+int json_string_copy(const char *json, const json_token *token, char *string,
+                     size_t size);
+
+/**
+ * @brief Read a number.
+ *
+ * @param[in] json The document.
+ * @param[in] token The token.
+ * @param[out] number The number.
+ *
+ * @return 0 on success, or -1 if the token isn't a number.
+ */
+int json_number(const char *json, const json_token *token, double *number);
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <stdatomic.h> // atomic_uint_least64_t
+#include <stdint.h>    // uint64_t
+
+// Each power of two is split into 2^LATENCY_HISTOGRAM_SUB_BUCKET_BITS
+// buckets, so a bucket is at most 25% wide.
+#define LATENCY_HISTOGRAM_SUB_BUCKET_BITS 2
+#define LATENCY_HISTOGRAM_BUCKETS                                              \
+  ((64 - LATENCY_HISTOGRAM_SUB_BUCKET_BITS + 1)                                \
+   << LATENCY_HISTOGRAM_SUB_BUCKET_BITS)
+
+/**
+ * A log-linear histogram of latencies in nanoseconds.
+ *
+ * Recording is a bucket lookup and a few relaxed atomic stores, cheap enough
+ * to leave on in production. A histogram has a single writer, but any thread
+ * can read it while it is being written, so it can be printed without
+ * pausing the thread that records into it.
+ */
+typedef struct latency_histogram latency_histogram;
+struct latency_histogram {
+  atomic_uint_least64_t buckets[LATENCY_HISTOGRAM_BUCKETS];
+  atomic_uint_least64_t count;
+  atomic_uint_least64_t total_ns;
+  atomic_uint_least64_t max_ns;
+};
+
+/**
+ * @brief Initialize a latency histogram.
+ *
+ * @param[out] histogram The histogram to initialize.
+ */
+void latency_histogram_init(latency_histogram *histogram);
+
+/**
+ * @brief Record a latency. Only one thread may record into a histogram.
+ *
+ * @param[in,out] histogram The histogram.
+ * @param[in] ns The latency in nanoseconds.
+ */
+void latency_histogram_record(latency_histogram *histogram, uint64_t ns);
+
+/**
+ * @brief Add to a counter that, like a histogram, has a single writer and any
+ * number of readers.
+ *
+ * @param[in,out] counter The counter.
+ * @param[in] value The value to add.
+ */
+void latency_histogram_add(atomic_uint_least64_t *counter, uint64_t value);
+
+/**
+ * @brief Get a percentile of the recorded latencies.
+ *
+ * The result is the upper bound of the bucket the percentile falls in.
+ *
+ * @param[in] histogram The histogram.
+ * @param[in] percentile The percentile, from 0 to 100.
+ *
+ * @return The latency in nanoseconds, or 0 if nothing was recorded.
+ */
+uint64_t latency_histogram_percentile(const latency_histogram *histogram,
+                                      double percentile);
+
+/**
+ * @brief Get the current CLOCK_MONOTONIC time in nanoseconds, for timing the
+ * latencies to record.
+ */
+uint64_t latency_histogram_now_ns(void);
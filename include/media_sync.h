@@ -0,0 +1,88 @@
+#pragma once
+
+#include "animation_clock.h"
+#include <pthread.h> // pthread_mutex_t, pthread_t
+#include <stdbool.h> // bool
+#include <stdint.h>  // int64_t, uint64_t
+
+// A position further than this from the clock is a seek, so the clock jumps
+// to it instead of slewing.
+#define MEDIA_SYNC_STEP_THRESHOLD_NS 100000000LL
+// Smaller errors are slewed away over about this long.
+#define MEDIA_SYNC_SLEW_TIME_NS 1000000000.0
+// The most the clock runs fast or slow while slewing.
+#define MEDIA_SYNC_MAX_SLEW 0.05
+
+/**
+ * Follows the playback position of a media player over its IPC socket, like
+ * the one mpv opens with --input-ipc-server.
+ *
+ * The position, pause state and speed are observed from a thread of their
+ * own. Between updates the clock runs on CLOCK_MONOTONIC at the playback
+ * speed, and each update slews it faster or slower until it has caught up
+ * with the player, so the time never jumps or runs backwards because of
+ * jitter. Seeks and pauses take effect at once.
+ */
+typedef struct media_sync media_sync;
+struct media_sync {
+  // The clock reads the playback position. It is first, so that the clock
+  // can find the sync it belongs to.
+  animation_clock clock;
+  int socket;
+  pthread_t thread;
+
+  // Guards everything below.
+  pthread_mutex_t mutex;
+  bool connected;
+  bool has_position;
+  bool paused;
+  double speed;
+  // The position at a moment on CLOCK_MONOTONIC, and how fast it advances
+  // from there.
+  int64_t anchor_ns;
+  int64_t position_ns;
+  double rate;
+
+  uint64_t updates;
+  uint64_t steps;
+  // The errors of the updates that were slewed.
+  uint64_t slewed_updates;
+  double error_sum_ns;
+  int64_t max_error_ns;
+};
+
+/**
+ * @brief Connect to a media player and start following it.
+ *
+ * The clock stands still at 0 until the player reports a position. The user
+ * is responsible for closing the sync with @ref media_sync_close().
+ *
+ * @param[in] path The path of the player's Unix socket.
+ *
+ * @return The sync, or NULL on failure.
+ */
+media_sync *media_sync_connect(const char *path);
+
+/**
+ * @brief Check whether the player is still connected.
+ *
+ * @param[in] sync The sync.
+ *
+ * @return Whether the player is connected.
+ */
+bool media_sync_connected(media_sync *sync);
+
+/**
+ * @brief Print how many updates were slewed or stepped, and how far the clock
+ * was from the player when it was slewed.
+ *
+ * @param[in] sync The sync.
+ */
+void media_sync_print_stats(media_sync *sync);
+
+/**
+ * @brief Disconnect from the player and free the sync.
+ *
+ * @param[in] sync The sync, or NULL.
+ */
+void media_sync_close(media_sync *sync);
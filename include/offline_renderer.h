@@ -0,0 +1,51 @@
+#pragma once
+
+#include "animation.h"
+
+/**
+ * @brief Called with every frame an offline render produces.
+ *
+ * @param frame_index The index of the frame.
+ * @param frame The rendered frame.
+ * @param channel_count The number of channels in the frame.
+ * @param user_data The user data passed to @ref offline_renderer_run().
+ *
+ * @return 0 to continue rendering, -1 to stop with an error.
+ */
+typedef int (*offline_renderer_callback)(int frame_index,
+                                         const hue_stream_message_data *frame,
+                                         int channel_count, void *user_data);
+
+/**
+ * @brief Render a cue sheet at a fixed timestep, as fast as the CPU allows.
+ *
+ * The animation is driven by a manual clock that advances by exactly one frame
+ * period per frame, so no bridge is needed and nothing waits on real time.
+ *
+ * @param sheet The cue sheet to render.
+ * @param channel_count The number of channels in each frame.
+ * @param frames_per_second The frame rate to render at.
+ * @param callback Called with every rendered frame.
+ * @param user_data Passed to the callback.
+ *
+ * @return The number of frames rendered, or -1 on failure.
+ */
+int offline_renderer_run(const cue_sheet *sheet, int channel_count,
+                         int frames_per_second,
+                         offline_renderer_callback callback, void *user_data);
+
+/**
+ * @brief Render a cue sheet and write every frame to a CSV file.
+ *
+ * Each row holds the frame index, the time in seconds, the channel ID and the
+ * channel's x, y and brightness values.
+ *
+ * @param sheet The cue sheet to render.
+ * @param channel_count The number of channels in each frame.
+ * @param frames_per_second The frame rate to render at.
+ * @param path The path of the CSV file to write.
+ *
+ * @return The number of frames rendered, or -1 on failure.
+ */
+int offline_renderer_render_csv(const cue_sheet *sheet, int channel_count,
+                                int frames_per_second, const char *path);
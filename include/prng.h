@@ -0,0 +1,45 @@
+#pragma once
+
+#include <stdint.h> // uint32_t, uint64_t
+
+/**
+ * A xoshiro256** pseudorandom number generator.
+ *
+ * Each animation owns its generator, so animations can render on any thread
+ * and a show replays exactly from its seed. It is fast and has a period of
+ * 2^256 - 1, but it is not cryptographically secure.
+ */
+typedef struct prng prng;
+struct prng {
+  uint64_t state[4];
+};
+
+/**
+ * @brief Seed a generator.
+ *
+ * The seed is expanded with SplitMix64, so any seed, including 0, gives a
+ * well-mixed state.
+ *
+ * @param[out] generator The generator to seed.
+ * @param[in] seed The seed.
+ */
+void prng_seed(prng *generator, uint64_t seed);
+
+/**
+ * @brief Get the next 64 random bits.
+ *
+ * @param[in,out] generator The generator.
+ *
+ * @return The random bits.
+ */
+uint64_t prng_next(prng *generator);
+
+/**
+ * @brief Get a random number below a bound, without the bias of a modulo.
+ *
+ * @param[in,out] generator The generator.
+ * @param[in] bound The bound. A bound of 0 returns 0.
+ *
+ * @return A number from 0 up to but not including the bound.
+ */
+uint32_t prng_below(prng *generator, uint32_t bound);
@@ -0,0 +1,49 @@
+#pragma once
+
+// How much of a thread's stack is touched up front, so the hot path doesn't
+// take page faults as its stack grows.
+#define REALTIME_PREFAULT_STACK_SIZE (256 * 1024)
+
+// One more than the highest CPU a thread can be pinned to, CPU_SETSIZE on
+// glibc.
+#define REALTIME_MAX_CPUS 1024
+
+/**
+ * How a hot path thread is scheduled.
+ */
+typedef struct realtime_thread realtime_thread;
+struct realtime_thread {
+  // The SCHED_FIFO priority, or 0 to keep the default scheduling.
+  int priority;
+  // The CPU to pin the thread to, or -1 to let it run on any.
+  int cpu;
+};
+
+/**
+ * @brief Lock every page of the process into memory, now and from now on, so
+ * the hot path is never paged out. Threads started afterwards have their
+ * stacks prefaulted by @ref realtime_thread_apply().
+ *
+ * @return 0 on success, or -1 if memory can't be locked, which is reported.
+ */
+int realtime_lock_memory(void);
+
+/**
+ * @brief Touch REALTIME_PREFAULT_STACK_SIZE bytes of the calling thread's
+ * stack.
+ */
+void realtime_prefault_stack(void);
+
+/**
+ * @brief Give the calling thread its priority and CPU.
+ *
+ * Each setting that the process isn't permitted to make, or that the
+ * platform doesn't support, is reported and skipped, and the thread keeps
+ * running as it was. The stack is prefaulted if memory is locked.
+ *
+ * @param[in] thread The settings.
+ * @param[in] name The name of the thread, for the report.
+ *
+ * @return 0 if every setting was made, or -1 if any was skipped.
+ */
+int realtime_thread_apply(const realtime_thread *thread, const char *name);
@@ -0,0 +1,99 @@
+#pragma once
+
+#include "cue_sheet.h"
+#include "hue_stream_message.h"
+#include "stream_session.h"
+#include <stdint.h> // uint64_t
+#include <stdio.h>  // FILE
+#include <time.h>   // struct timespec
+
+/**
+ * A show log is a text file that records a header, then the time on the
+ * animation clock and a hash of every rendered frame, one per line:
+ *
+ *     # Show logged by resonate.
+ *     sheet 2 Spider-Man: Into the Spider-Verse
+ *     seed 1760798123
+ *     channels 10
+ *     start 5021 118046332
+ *     lookahead 80000000
+ *     channel_lookahead 3 25000000
+ *     frames
+ *     5021 118046332 8c1b5e2f0d9a4c37
+ *
+ * Channel lookaheads of 0 are left out.
+ */
+
+/**
+ * What a show needs to be replayed exactly: the animation, the seed of its
+ * random numbers, the channel map and the lookaheads it was rendered with,
+ * and the time on its clock when it started.
+ */
+typedef struct show_log_header show_log_header;
+struct show_log_header {
+  // The menu number of the animation, and its title to check it by.
+  int sheet;
+  char title[CUE_SHEET_TITLE_SIZE];
+  uint64_t seed;
+  int channel_count;
+  struct timespec start_time;
+  long lookahead_ns;
+  long channel_lookahead_ns[STREAM_SESSION_MAX_CHANNELS];
+};
+
+/**
+ * @brief Write the header of a show log.
+ *
+ * @param[in] file The file to write to.
+ * @param[in] header The header.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int show_log_write_header(FILE *file, const show_log_header *header);
+
+/**
+ * @brief Write a frame to a show log.
+ *
+ * @param[in] file The file to write to.
+ * @param[in] time The time on the animation clock the frame was rendered at.
+ * @param[in] hash The hash of the frame, from @ref show_log_hash().
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int show_log_write_frame(FILE *file, const struct timespec *time,
+                         uint64_t hash);
+
+/**
+ * @brief Read the header of a show log.
+ *
+ * @param[in] file The file to read from.
+ * @param[out] header The header.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int show_log_read_header(FILE *file, show_log_header *header);
+
+/**
+ * @brief Read the next frame of a show log.
+ *
+ * @param[in] file The file to read from, after the header.
+ * @param[out] time The time on the animation clock the frame was rendered at.
+ * @param[out] hash The hash of the frame.
+ *
+ * @return 1 if a frame was read, 0 at the end of the log, or -1 on failure.
+ */
+int show_log_read_frame(FILE *file, struct timespec *time, uint64_t *hash);
+
+/**
+ * @brief Hash the colors of a frame with 64-bit FNV-1a.
+ *
+ * The channel IDs are left out, so a show hashes the same whichever lights it
+ * was rendered for.
+ *
+ * @param[in] frame The frame.
+ * @param[in] channel_count The number of channels in the frame.
+ *
+ * @return The hash.
+ */
+uint64_t show_log_hash(const hue_stream_message_data *frame,
+                       int channel_count);
@@ -0,0 +1,86 @@
+#pragma once
+
+#include "latency_histogram.h"
+#include <stdio.h> // FILE
+
+/**
+ * The stages of the hot path, from rendering a frame to handing it to the
+ * network.
+ */
+typedef enum stream_stage stream_stage;
+enum stream_stage {
+  // Rendering a frame (animation_cue_sheet()) and mapping it into the gamuts.
+  STREAM_STAGE_RENDER,
+  // Handing a frame to the stream thread (frame_slot_publish()).
+  STREAM_STAGE_PUBLISH,
+  // The time a frame waited in the frame slot, from being published to being
+  // acquired. Not recorded by the event loop, which sends what it renders.
+  STREAM_STAGE_WAIT,
+  // Taking the latest frame in the stream thread (frame_slot_acquire()).
+  STREAM_STAGE_ACQUIRE,
+  // Building the message to send (hue_stream_encoder_encode()).
+  STREAM_STAGE_ENCODE,
+  // Sending the message (mbedtls_ssl_write() in hue_dtls_send_buffer()).
+  STREAM_STAGE_SEND,
+  // The time between the first and the last entertainment area receiving the
+  // same frame. Only recorded when a frame is sent to more than one area.
+  STREAM_STAGE_SKEW,
+  // How long after a frame's deadline the render thread woke up for it.
+  STREAM_STAGE_RENDER_JITTER,
+  // How long after a frame's deadline the stream thread, or the event loop,
+  // woke up for it.
+  STREAM_STAGE_STREAM_JITTER,
+  STREAM_STAGE_COUNT
+};
+
+/**
+ * Per-stage latency histograms and counters for the hot path.
+ *
+ * Each stage and counter is written by one thread only. All of them can be
+ * printed from any thread at any time without pausing the stream.
+ */
+typedef struct stream_metrics stream_metrics;
+struct stream_metrics {
+  latency_histogram stages[STREAM_STAGE_COUNT];
+  atomic_uint_least64_t frames_sent;
+  atomic_uint_least64_t send_failures;
+  atomic_uint_least64_t render_deadline_misses;
+  atomic_uint_least64_t stream_deadline_misses;
+};
+
+/**
+ * @brief Initialize stream metrics.
+ *
+ * @param[out] metrics The metrics to initialize.
+ */
+void stream_metrics_init(stream_metrics *metrics);
+
+/**
+ * @brief Record the latency of a stage that started at start_ns.
+ *
+ * @param[in,out] metrics The metrics.
+ * @param[in] stage The stage.
+ * @param[in] start_ns When the stage started, from
+ * @ref latency_histogram_now_ns().
+ *
+ * @return The current time, which can be used as the start of the next stage.
+ */
+uint64_t stream_metrics_record(stream_metrics *metrics, stream_stage stage,
+                               uint64_t start_ns);
+
+/**
+ * @brief Add to a counter with @ref latency_histogram_add(). Only one thread
+ * may add to a counter.
+ *
+ * @param[in,out] counter The counter.
+ * @param[in] value The value to add.
+ */
+void stream_metrics_count(atomic_uint_least64_t *counter, uint64_t value);
+
+/**
+ * @brief Print the latency percentiles of every stage and the counters.
+ *
+ * @param[in] metrics The metrics.
+ * @param[in] file The file to print to.
+ */
+void stream_metrics_print(const stream_metrics *metrics, FILE *file);
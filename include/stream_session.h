@@ -0,0 +1,160 @@
+#pragma once
+
+#include "hue_dtls_client.h"
+#include "hue_rest_client.h"
+#include "hue_stream_message.h"
+#include <stdbool.h> // bool
+#include <stdint.h>  // uint64_t
+
+#define STREAM_SESSION_MAX_SESSIONS 8
+#define STREAM_SESSION_MAX_CHANNELS                                            \
+  (STREAM_SESSION_MAX_SESSIONS * HUE_STREAM_MESSAGE_MAX_CHANNELS)
+#define STREAM_SESSION_BRIDGE_IP_SIZE 64
+
+/**
+ * One entertainment area on one bridge, fed from a slice of the global channel
+ * map.
+ *
+ * The render loop animates the global channel map as a single frame, and each
+ * session streams its own slice of that frame. Sessions on the same bridge
+ * share one DTLS connection.
+ */
+typedef struct stream_session stream_session;
+struct stream_session {
+  char bridge_ip[STREAM_SESSION_BRIDGE_IP_SIZE];
+  char entertainment_config_id[HUE_STREAM_MESSAGE_ENTERTAINMENT_CONFIG_ID_SIZE +
+                               1];
+  // The first channel of the global channel map in this session's slice.
+  int first_channel;
+  int channel_count;
+  // The area's channels, in the order they appear in the slice.
+  hue_entertainment_channel channels[HUE_STREAM_MESSAGE_MAX_CHANNELS];
+  hue_dtls_context *context;
+  // Whether this session opened the connection, and has to free it.
+  bool owns_context;
+  // Whether the area was started over REST, and has to be stopped.
+  bool started;
+  // How long each startup step took. The areas are started together, so they
+  // share one REST start time. Only the session that owns the connection sets
+  // up DTLS and performs the handshake.
+  uint64_t discover_ns;
+  uint64_t rest_start_ns;
+  uint64_t dtls_setup_ns;
+  uint64_t handshake_ns;
+};
+
+/**
+ * @brief Initialize a session.
+ *
+ * Without a channel count, the area's channels are left for
+ * @ref stream_session_connect() to discover, and without an entertainment
+ * configuration ID, so is the area itself.
+ *
+ * @param[out] session The session to initialize.
+ * @param[in] bridge_ip The IP address of the Hue bridge.
+ * @param[in] entertainment_config_id The entertainment configuration ID, or
+ * NULL to use the bridge's first area.
+ * @param[in] channel_count The number of channels in the entertainment area,
+ * numbered from 0, or 0 to discover them.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int stream_session_init(stream_session *session, const char *bridge_ip,
+                        const char *entertainment_config_id,
+                        int channel_count);
+
+/**
+ * @brief Initialize a session from a command line specification.
+ *
+ * The specification is `<bridge IP>[,<entertainment config ID>[,<channel
+ * count>]]`. Omitted parts are discovered, as with
+ * @ref stream_session_init().
+ *
+ * @param[out] session The session to initialize.
+ * @param[in] spec The specification.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int stream_session_parse(stream_session *session, const char *spec);
+
+/**
+ * @brief Lay the sessions out on the global channel map.
+ *
+ * Each session takes the next slice of the map, in order.
+ *
+ * @param[in,out] sessions The sessions.
+ * @param[in] session_count The number of sessions.
+ *
+ * @return The number of channels in the global channel map, or -1 if it
+ * exceeds STREAM_SESSION_MAX_CHANNELS.
+ */
+int stream_session_map(stream_session *sessions, int session_count);
+
+/**
+ * @brief Initialize a global frame with every light off.
+ *
+ * Each channel carries its session's channel ID, so a slice can be encoded as
+ * it is.
+ *
+ * @param[in] sessions The mapped sessions.
+ * @param[in] session_count The number of sessions.
+ * @param[out] frame The frame, with room for the whole channel map.
+ */
+void stream_session_initialize_frame(const stream_session *sessions,
+                                     int session_count,
+                                     hue_stream_message_data *frame);
+
+/**
+ * @brief Get each channel of the global channel map, with its position.
+ *
+ * @param[in] sessions The mapped sessions.
+ * @param[in] session_count The number of sessions.
+ * @param[out] channels The channels, with room for the whole channel map.
+ */
+void stream_session_channels(const stream_session *sessions,
+                             int session_count,
+                             hue_entertainment_channel *channels);
+
+/**
+ * @brief Get the gamut of each channel of the global channel map, for
+ * @ref gamut_map_frame().
+ *
+ * @param[in] sessions The mapped sessions.
+ * @param[in] session_count The number of sessions.
+ * @param[out] gamuts The gamuts, with room for the whole channel map.
+ */
+void stream_session_gamuts(const stream_session *sessions, int session_count,
+                           gamut_type *gamuts);
+
+/**
+ * @brief Start streaming to every session's entertainment area.
+ *
+ * Areas and channels the sessions left out are discovered first, from the
+ * on-disk cache when it is fresh and has the area (see
+ * @ref entertainment_cache_discover()). The areas are then all started over
+ * REST at once, and each bridge gets one DTLS handshake.
+ *
+ * DTLS is set up for every bridge in parallel while the areas are discovered
+ * and started, and the handshakes run in parallel too. On failure, every
+ * session is disconnected.
+ *
+ * @param[in] client The REST client.
+ * @param[in,out] sessions The sessions.
+ * @param[in] session_count The number of sessions.
+ * @param[in] refresh Whether to skip the cache and ask the bridges.
+ *
+ * @return 0 on success, -1 on failure.
+ */
+int stream_session_connect(hue_rest_client *client, stream_session *sessions,
+                           int session_count, bool refresh);
+
+/**
+ * @brief Close the connections of the sessions, and stop streaming to their
+ * entertainment areas.
+ *
+ * @param[in] client The REST client.
+ * @param[in,out] sessions The sessions.
+ * @param[in] session_count The number of sessions.
+ */
+void stream_session_disconnect(hue_rest_client *client,
+                               stream_session *sessions, int session_count);
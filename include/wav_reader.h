@@ -0,0 +1,76 @@
+#pragma once
+
+#include <stdbool.h> // bool
+#include <stdint.h>  // uint8_t, uint64_t
+#include <stdio.h>   // FILE
+
+/**
+ * Reads PCM audio from a WAV file or stream, such as the output of
+ * `ffmpeg -i <audio> -f wav -` or `arecord -f S16_LE -t wav`.
+ *
+ * 16, 24 and 32-bit integer and 32-bit float samples are supported. Every
+ * channel is mixed down to mono. The data chunk is read until the end of the
+ * stream, so streams that don't know their length work too.
+ *
+ * Anything but a regular file is live: its samples arrive as they are played,
+ * and it is read unbuffered so @ref wav_reader_available() sees every sample
+ * that has arrived.
+ */
+typedef struct wav_reader wav_reader;
+struct wav_reader {
+  FILE *file;
+  int sample_rate;
+  int channel_count;
+  int bits_per_sample;
+  bool floating_point;
+  // The size of one sample frame, one sample of every channel.
+  int block_size;
+  // Holds the sample frames of one read, so reads don't allocate.
+  uint8_t *buffer;
+  uint64_t frame_count;
+  bool live;
+};
+
+/**
+ * @brief Open a WAV stream and read its header.
+ *
+ * The user is responsible for closing the reader with
+ * @ref wav_reader_close().
+ *
+ * @param[in] path The path of the stream, or "-" for standard input.
+ *
+ * @return The reader, or NULL on failure.
+ */
+wav_reader *wav_reader_open(const char *path);
+
+/**
+ * @brief Read mono samples, between -1 and 1.
+ *
+ * Blocks until count samples are read or the stream ends.
+ *
+ * @param[in,out] reader The reader.
+ * @param[out] samples The samples.
+ * @param[in] count The number of samples to read.
+ *
+ * @return The number of samples read, 0 at the end of the stream, or -1 on
+ * failure.
+ */
+int wav_reader_read(wav_reader *reader, float *samples, int count);
+
+/**
+ * @brief Count the samples of a live stream that have arrived but haven't
+ * been read, so a reader that fell behind can skip to the newest.
+ *
+ * @param[in] reader The reader.
+ *
+ * @return The number of samples that can be read without blocking, or 0 if
+ * the stream isn't live or can't tell.
+ */
+int wav_reader_available(const wav_reader *reader);
+
+/**
+ * @brief Close the stream and free the reader.
+ *
+ * @param[in] reader The reader, or NULL.
+ */
+void wav_reader_close(wav_reader *reader);
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <stdbool.h> // bool
+#include <stddef.h>  // size_t
+#include <stdint.h>  // uint8_t, uint64_t
+#include <stdio.h>   // FILE
+
+/**
+ * One decoded 8-bit Y'CbCr video frame, as planes.
+ *
+ * The chroma planes are subsampled by 1 << chroma_shift_x horizontally and
+ * 1 << chroma_shift_y vertically. A monochrome frame only has the luma plane.
+ */
+typedef struct y4m_frame y4m_frame;
+struct y4m_frame {
+  int width;
+  int height;
+  int chroma_shift_x;
+  int chroma_shift_y;
+  bool has_chroma;
+  // Whether the samples use the full 0 to 255 range instead of the video
+  // range, 16 to 235 for luma and 16 to 240 for chroma.
+  bool full_range;
+  const uint8_t *planes[3];
+  int strides[3];
+};
+
+/**
+ * Reads frames from a YUV4MPEG2 (Y4M) stream, such as the output of
+ * `ffmpeg -i <video> -f yuv4mpegpipe -`.
+ *
+ * 8-bit 4:2:0, 4:2:2, 4:4:4 and monochrome streams are supported. Frames are
+ * read one after another into a single buffer, so a pipe works as well as a
+ * file.
+ */
+typedef struct y4m_reader y4m_reader;
+struct y4m_reader {
+  FILE *file;
+  int frame_rate_numerator;
+  int frame_rate_denominator;
+  // The frame read last. Its planes point into buffer.
+  y4m_frame frame;
+  size_t frame_size;
+  uint8_t *buffer;
+  uint64_t frame_count;
+};
+
+/**
+ * @brief Open a Y4M stream and read its header.
+ *
+ * The user is responsible for closing the reader with
+ * @ref y4m_reader_close().
+ *
+ * @param[in] path The path of the stream, or "-" for standard input.
+ *
+ * @return The reader, or NULL on failure.
+ */
+y4m_reader *y4m_reader_open(const char *path);
+
+/**
+ * @brief Read the next frame into reader->frame.
+ *
+ * @param[in,out] reader The reader.
+ *
+ * @return 1 if a frame was read, 0 at the end of the stream, or -1 on failure.
+ */
+int y4m_reader_read(y4m_reader *reader);
+
+/**
+ * @brief Get the duration of one frame.
+ *
+ * @param[in] reader The reader.
+ *
+ * @return The frame period in nanoseconds.
+ */
+long y4m_reader_frame_period_ns(const y4m_reader *reader);
+
+/**
+ * @brief Close the stream and free the reader.
+ *
+ * @param[in] reader The reader, or NULL.
+ */
+void y4m_reader_close(y4m_reader *reader);
@@ -0,0 +1,240 @@
+#include "ambilight.h"
+
+#include <stdio.h>  // fprintf
+#include <string.h> // memset
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define AMBILIGHT_X86 1
+#include <immintrin.h>
+#else
+#define AMBILIGHT_X86 0
+#endif
+
+// The luma and chroma coefficients of each matrix, as in
+// R = Y + CR_R * Cr, G = Y + CB_G * Cb + CR_G * Cr and B = Y + CB_B * Cb.
+#define BT709_CR_R 1.5748f
+#define BT709_CB_G -0.187324f
+#define BT709_CR_G -0.468124f
+#define BT709_CB_B 1.8556f
+#define BT601_CR_R 1.402f
+#define BT601_CB_G -0.344136f
+#define BT601_CR_G -0.714136f
+#define BT601_CB_B 1.772f
+
+// Video taller than this is HD and uses BT.709.
+#define BT709_MIN_HEIGHT 720
+
+typedef uint64_t (*sum_function)(const uint8_t *row, int stride, int width,
+                                 int height);
+
+static uint64_t sum_scalar(const uint8_t *row, int stride, int width,
+                           int height) {
+  uint64_t sum = 0;
+  for (int i = 0; i < height; i++, row += stride) {
+    uint32_t row_sum = 0;
+    for (int j = 0; j < width; j++) {
+      row_sum += row[j];
+    }
+    sum += row_sum;
+  }
+  return sum;
+}
+
+#if AMBILIGHT_X86
+
+// psadbw against zero adds each group of 8 bytes into a 64-bit lane.
+static uint64_t sum_sse2(const uint8_t *row, int stride, int width,
+                         int height) {
+  const __m128i zero = _mm_setzero_si128();
+  __m128i sums = zero;
+  uint64_t tail = 0;
+  const int vector_width = width & ~15;
+  for (int i = 0; i < height; i++, row += stride) {
+    for (int j = 0; j < vector_width; j += 16) {
+      const __m128i bytes = _mm_loadu_si128((const __m128i *)(row + j));
+      sums = _mm_add_epi64(sums, _mm_sad_epu8(bytes, zero));
+    }
+    for (int j = vector_width; j < width; j++) {
+      tail += row[j];
+    }
+  }
+
+  uint64_t lanes[2];
+  _mm_storeu_si128((__m128i *)lanes, sums);
+  return lanes[0] + lanes[1] + tail;
+}
+
+__attribute__((target("avx2"))) static uint64_t
+sum_avx2(const uint8_t *row, int stride, int width, int height) {
+  const __m256i zero = _mm256_setzero_si256();
+  __m256i sums = zero;
+  uint64_t tail = 0;
+  const int vector_width = width & ~31;
+  for (int i = 0; i < height; i++, row += stride) {
+    for (int j = 0; j < vector_width; j += 32) {
+      const __m256i bytes = _mm256_loadu_si256((const __m256i *)(row + j));
+      sums = _mm256_add_epi64(sums, _mm256_sad_epu8(bytes, zero));
+    }
+    for (int j = vector_width; j < width; j++) {
+      tail += row[j];
+    }
+  }
+
+  uint64_t lanes[4];
+  _mm256_storeu_si256((__m256i *)lanes, sums);
+  return lanes[0] + lanes[1] + lanes[2] + lanes[3] + tail;
+}
+
+#endif
+
+static sum_function find_kernel(color_kernel kernel) {
+  switch (kernel) {
+  case COLOR_KERNEL_SCALAR:
+    return sum_scalar;
+#if AMBILIGHT_X86
+  case COLOR_KERNEL_SSE2:
+    return sum_sse2;
+  case COLOR_KERNEL_AVX2:
+    if (__builtin_cpu_supports("avx2")) {
+      return sum_avx2;
+    }
+    break;
+#endif
+  default:
+    break;
+  }
+
+  fprintf(stderr, "The %s kernel isn't supported on this CPU\n",
+          color_kernel_name(kernel));
+  return NULL;
+}
+
+static int clamp(int value, int low, int high) {
+  return value < low ? low : (value > high ? high : value);
+}
+
+void ambilight_zone_at(const y4m_frame *format, double x, double z,
+                       ambilight_zone *zone) {
+  if (!format || !zone) {
+    fprintf(stderr, "format or zone is null\n");
+    return;
+  }
+
+  // Zones start and end on chroma samples, so both planes cover the same
+  // part of the screen.
+  const int align_x = 1 << format->chroma_shift_x;
+  const int align_y = 1 << format->chroma_shift_y;
+  const int width = format->width / AMBILIGHT_ZONE_DIVISOR / align_x * align_x;
+  const int height =
+      format->height / AMBILIGHT_ZONE_DIVISOR / align_y * align_y;
+  zone->width = width > align_x ? width : align_x;
+  zone->height = height > align_y ? height : align_y;
+
+  const int center_x = (int)((x + 1.0) / 2.0 * format->width);
+  const int center_y = (int)((1.0 - z) / 2.0 * format->height);
+  zone->x = clamp(center_x - zone->width / 2, 0,
+                  format->width - zone->width) /
+            align_x * align_x;
+  zone->y = clamp(center_y - zone->height / 2, 0,
+                  format->height - zone->height) /
+            align_y * align_y;
+}
+
+int ambilight_init(ambilight *light, const y4m_frame *format,
+                   const hue_entertainment_channel *channels,
+                   int channel_count, color_kernel kernel) {
+  if (!light || !format || !channels) {
+    fprintf(stderr, "light, format or channels is null\n");
+    return -1;
+  }
+
+  if (channel_count < 0 || channel_count > FRAME_SLOT_MAX_CHANNELS) {
+    fprintf(stderr, "Invalid channel count %d\n", channel_count);
+    return -1;
+  }
+
+  const int align_x = 1 << format->chroma_shift_x;
+  const int align_y = 1 << format->chroma_shift_y;
+  if (format->width < align_x || format->height < align_y) {
+    fprintf(stderr, "Frame size %dx%d is too small\n", format->width,
+            format->height);
+    return -1;
+  }
+
+  memset(light, 0, sizeof(ambilight));
+  light->kernel = kernel == COLOR_KERNEL_AUTO ? color_kernel_best() : kernel;
+  if (!find_kernel(light->kernel)) {
+    return -1;
+  }
+
+  light->bt709 = format->height >= BT709_MIN_HEIGHT;
+  light->zone_count = channel_count;
+  for (int i = 0; i < channel_count; i++) {
+    ambilight_zone_at(format, channels[i].x, channels[i].z, &light->zones[i]);
+  }
+  return 0;
+}
+
+// Average a zone of a plane, normalized to 0 to 1 for luma or -0.5 to 0.5 for
+// chroma.
+static float average(sum_function sum, const y4m_frame *frame, int plane,
+                     const ambilight_zone *zone, bool full_range) {
+  const int shift_x = plane ? frame->chroma_shift_x : 0;
+  const int shift_y = plane ? frame->chroma_shift_y : 0;
+  const int width = zone->width >> shift_x;
+  const int height = zone->height >> shift_y;
+  const uint8_t *row = frame->planes[plane] +
+                       (size_t)(zone->y >> shift_y) * frame->strides[plane] +
+                       (zone->x >> shift_x);
+
+  const float mean =
+      (float)sum(row, frame->strides[plane], width, height) / (width * height);
+  if (plane == 0) {
+    return full_range ? mean / 255.0f : (mean - 16.0f) / 219.0f;
+  }
+  return full_range ? (mean - 128.0f) / 255.0f : (mean - 128.0f) / 224.0f;
+}
+
+static float clamp_unit(float value) {
+  return value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+}
+
+int ambilight_render(const ambilight *light, const y4m_frame *frame,
+                     hue_stream_message_data *data) {
+  if (!light || !frame || !data) {
+    fprintf(stderr, "light, frame or data is null\n");
+    return -1;
+  }
+
+  const sum_function sum = find_kernel(light->kernel);
+  if (!sum) {
+    return -1;
+  }
+
+  const float cr_r = light->bt709 ? BT709_CR_R : BT601_CR_R;
+  const float cb_g = light->bt709 ? BT709_CB_G : BT601_CB_G;
+  const float cr_g = light->bt709 ? BT709_CR_G : BT601_CR_G;
+  const float cb_b = light->bt709 ? BT709_CB_B : BT601_CB_B;
+
+  // The averages are gamma-encoded like the video, which is what the eye
+  // expects of a screen edge.
+  float rgb[3 * FRAME_SLOT_MAX_CHANNELS];
+  for (int i = 0; i < light->zone_count; i++) {
+    const ambilight_zone *zone = &light->zones[i];
+    const float y = average(sum, frame, 0, zone, frame->full_range);
+    float cb = 0.0f;
+    float cr = 0.0f;
+    if (frame->has_chroma) {
+      cb = average(sum, frame, 1, zone, frame->full_range);
+      cr = average(sum, frame, 2, zone, frame->full_range);
+    }
+
+    rgb[3 * i] = color_srgb_to_linear(clamp_unit(y + cr_r * cr));
+    rgb[3 * i + 1] =
+        color_srgb_to_linear(clamp_unit(y + cb_g * cb + cr_g * cr));
+    rgb[3 * i + 2] = color_srgb_to_linear(clamp_unit(y + cb_b * cb));
+  }
+
+  return color_linear_to_xy_brightness(light->kernel, rgb, light->zone_count,
+                                       data);
+}
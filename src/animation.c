@@ -1,27 +1,11 @@
 #include "animation.h"
+#include "builtin_cue_sheets.h"
+#include "cue_sheet.h"
 
+#include <pthread.h> // pthread_once
 #include <stdbool.h>
 #include <stdio.h>
-#include <stdlib.h>
-
-typedef struct animation_phase animation_phase;
-struct animation_phase {
-  double start_time;
-  void (*animate)(hue_stream_message_data *frame, int channel_count,
-                  double progress);
-};
-
-static double ease_in_out_quadratic(double progress) {
-  if (progress < 0.5) {
-    return 2 * progress * progress;
-  } else {
-    return -1 + 2 * progress * (2 - progress);
-  }
-}
-
-static int interpolate(int start, int end, double progress) {
-  return start + (end - start) * ease_in_out_quadratic(progress);
-}
+#include <string.h> // strcmp
 
 static void set_all_same(hue_stream_message_data *frame, int channel_count,
                          int x, int y, int brightness) {
@@ -51,82 +35,109 @@ static void set_all_same_brightness(hue_stream_message_data *frame,
 #define COLOR_WHITE_Y 0x54a9
 
 static animation_status animate(hue_stream_message_data *frame,
-                                int channel_count,
-                                const struct timespec *start_time,
-                                const animation_phase *phases, int num_phases) {
+                                int channel_count, animation_context *context,
+                                const cue_sheet *sheet) {
   struct timespec current_time = {0};
-  if (clock_gettime(CLOCK_MONOTONIC, &current_time)) {
-    fprintf(stderr, "clock_gettime() failed\n");
+  if (animation_clock_now(context->clock, &current_time)) {
+    fprintf(stderr, "animation_clock_now() failed\n");
     return ANIMATION_STATUS_ERROR;
   }
 
   const double elapsed_time =
-      current_time.tv_sec - start_time->tv_sec +
-      (current_time.tv_nsec - start_time->tv_nsec) / 1e9;
-
-  for (int i = 0; i < num_phases; i++) {
-    const double phase_start_time = phases[i].start_time;
-    const double phase_end_time =
-        i < num_phases - 1 ? phases[i + 1].start_time : 0;
-    if (elapsed_time >= phase_start_time && elapsed_time < phase_end_time) {
-      const double phase_duration = phase_end_time - phase_start_time;
-      const double phase_progress =
-          (elapsed_time - phase_start_time) / phase_duration;
-      phases[i].animate(frame, channel_count, phase_progress);
-      return ANIMATION_STATUS_RUNNING;
-    }
+      current_time.tv_sec - context->start_time.tv_sec +
+      (current_time.tv_nsec - context->start_time.tv_nsec +
+       context->lookahead_ns) /
+          1e9;
+
+  // A negative lookahead, or a first cue after 0, puts the start of the
+  // animation in the future. Until then the frame holds.
+  if (sheet->cue_count > 0 && elapsed_time < sheet->cues[0].start_time) {
+    return ANIMATION_STATUS_RUNNING;
   }
 
-  return ANIMATION_STATUS_END;
+  const int i = cue_sheet_find(sheet, elapsed_time, &context->cursor);
+  if (i < 0) {
+    return ANIMATION_STATUS_END;
+  }
+
+  const cue *c = &sheet->cues[i];
+  const double phase_duration = c[1].start_time - c->start_time;
+  const double phase_progress = (elapsed_time - c->start_time) / phase_duration;
+
+  // Parameters the cue doesn't set take the effect's defaults.
+  double params[ANIMATION_EFFECT_MAX_PARAMS] = {0};
+  for (int j = 0; j < ANIMATION_EFFECT_MAX_PARAMS; j++) {
+    params[j] =
+        j < c->param_count ? c->params[j] : c->effect->default_params[j];
+  }
+
+  // Ease once per frame, so the effect only does integer arithmetic.
+  const uint32_t eased =
+      easing_apply(c->easing, easing_progress(phase_progress));
+  c->effect->animate(frame, channel_count, eased, params, &context->random);
+  return ANIMATION_STATUS_RUNNING;
 }
 
 static void animate_hold(hue_stream_message_data *frame, int channel_count,
-                         double progress) {
+                         uint32_t progress, const double *params,
+                         prng *random) {
   (void)frame;
   (void)channel_count;
   (void)progress;
+  (void)params;
+  (void)random;
 }
 
 static void animate_fade_to_blue(hue_stream_message_data *frame,
-                                 int channel_count, double progress) {
+                                 int channel_count, uint32_t progress,
+                                 const double *params, prng *random) {
+  (void)params;
+  (void)random;
   set_all_same(frame, channel_count, COLOR_BLUE_X, COLOR_BLUE_Y,
-               interpolate(BRIGHTNESS_ZERO, BRIGHTNESS_MAX, progress));
+               easing_interpolate(BRIGHTNESS_ZERO, BRIGHTNESS_MAX, progress));
 }
 
 static void animate_fade_to_dim(hue_stream_message_data *frame,
-                                int channel_count, double progress) {
+                                int channel_count, uint32_t progress,
+                                const double *params, prng *random) {
+  (void)params;
+  (void)random;
   set_all_same_brightness(
       frame, channel_count,
-      interpolate(BRIGHTNESS_MAX, BRIGHTNESS_LOW, progress));
+      easing_interpolate(BRIGHTNESS_MAX, BRIGHTNESS_LOW, progress));
 }
 
 static void animate_fade_to_white(hue_stream_message_data *frame,
-                                  int channel_count, double progress) {
+                                  int channel_count, uint32_t progress,
+                                  const double *params, prng *random) {
+  (void)params;
+  (void)random;
   set_all_same(frame, channel_count,
-               interpolate(COLOR_BLUE_X, COLOR_WHITE_X, progress),
-               interpolate(COLOR_BLUE_Y, COLOR_WHITE_Y, progress),
-               interpolate(BRIGHTNESS_LOW, BRIGHTNESS_MAX, progress));
+               easing_interpolate(COLOR_BLUE_X, COLOR_WHITE_X, progress),
+               easing_interpolate(COLOR_BLUE_Y, COLOR_WHITE_Y, progress),
+               easing_interpolate(BRIGHTNESS_LOW, BRIGHTNESS_MAX, progress));
 }
 
 static void animate_fade_to_off(hue_stream_message_data *frame,
-                                int channel_count, double progress) {
+                                int channel_count, uint32_t progress,
+                                const double *params, prng *random) {
+  (void)params;
+  (void)random;
   set_all_same_brightness(
       frame, channel_count,
-      interpolate(BRIGHTNESS_MAX, BRIGHTNESS_ZERO, progress));
+      easing_interpolate(BRIGHTNESS_MAX, BRIGHTNESS_ZERO, progress));
 }
 
-animation_status animation_thx_deep_note(hue_stream_message_data *frame,
-                                         int channel_count,
-                                         const struct timespec *start_time) {
-  const animation_phase phases[] = {
-      {0.0, animate_hold},           {3.3, animate_fade_to_blue},
-      {6.3, animate_hold},           {16.5, animate_fade_to_dim},
-      {19.0, animate_fade_to_white}, {21.8, animate_hold},
-      {28.0, animate_fade_to_off},   {30.5, animate_hold},
-  };
-
-  const int num_phases = sizeof(phases) / sizeof(phases[0]);
-  return animate(frame, channel_count, start_time, phases, num_phases);
+// Fade all lights from (params[0], params[1], params[2]) to
+// (params[3], params[4], params[5]) in xy + brightness color space.
+static void animate_fade(hue_stream_message_data *frame, int channel_count,
+                         uint32_t progress, const double *params,
+                         prng *random) {
+  (void)random;
+  set_all_same(frame, channel_count,
+               easing_interpolate(params[0], params[3], progress),
+               easing_interpolate(params[1], params[4], progress),
+               easing_interpolate(params[2], params[5], progress));
 }
 
 static bool light_is_on(hue_stream_message_data *frame, int channel_count,
@@ -154,37 +165,11 @@ static bool light_turn_off(hue_stream_message_data *frame, int channel_count,
 #define LIGHT_TURN_ON_INTERVAL_SECONDS 4
 #define LIGHT_TURN_OFF_OR_CHANGE_INTERVAL_SECONDS 0.5
 
-static void animate_random_across(hue_stream_message_data *frame,
-                                  int channel_count, double progress);
-static void animate_black(hue_stream_message_data *frame, int channel_count,
-                          double progress);
-
-animation_status
-animation_spider_man_into_the_spider_verse(hue_stream_message_data *frame,
-                                           int channel_count,
-                                           const struct timespec *start_time) {
-  const animation_phase phases[] = {
-      {0.000, animate_hold},   {6.048, animate_random_across},
-      {7.049, animate_black},  {7.716, animate_random_across},
-      {8.926, animate_black},  {9.509, animate_random_across},
-      {10.260, animate_black}, {10.469, animate_random_across},
-      {11.470, animate_black}, {11.721, animate_random_across},
-      {13.764, animate_black}, {14.390, animate_random_across},
-      {27.486, animate_black}, {28.112, animate_random_across},
-      {29.197, animate_black}, {29.405, animate_random_across},
-      {31.532, animate_black}, {32.200, animate_random_across},
-      {36.536, animate_black}, {36.620, animate_random_across},
-      {36.828, animate_black}, {36.954, animate_random_across},
-      {44.337, animate_hold}};
-
-  const int num_phases = sizeof(phases) / sizeof(phases[0]);
-  return animate(frame, channel_count, start_time, phases, num_phases);
-}
-
 static bool lights_to_random_color(hue_stream_message_data *frame,
-                                   int channel_count, int light) {
-  const uint16_t x = rand() % 0xffff;
-  const uint16_t y = rand() % 0xffff;
+                                   int channel_count, int light,
+                                   prng *random) {
+  const uint16_t x = prng_below(random, 0xffff);
+  const uint16_t y = prng_below(random, 0xffff);
   const uint16_t brightness = 0xffff;
 
   for (int i = light; i < channel_count; i++) {
@@ -197,82 +182,206 @@ static bool lights_to_random_color(hue_stream_message_data *frame,
 }
 
 static bool lights_to_random_colors(hue_stream_message_data *frame,
-                                    int channel_count, int start) {
+                                    int channel_count, int start,
+                                    prng *random) {
   for (int i = start; i < channel_count; i++) {
-    frame[i].color_value[0] = rand() % 0xffff;
-    frame[i].color_value[1] = rand() % 0xffff;
+    frame[i].color_value[0] = prng_below(random, 0xffff);
+    frame[i].color_value[1] = prng_below(random, 0xffff);
     frame[i].color_value[2] = 0xffff;
   }
   return true;
 }
 
 #define ACROSS_LIGHTS_CHANGE_INTERVAL_SECONDS 0.25
+// Longer intervals are as good as never changing, and would overflow the
+// interval in frames.
+#define ACROSS_LIGHTS_MAX_INTERVAL_SECONDS 3600
 
+// params[0] is the average number of seconds between color changes.
 static void animate_random_across(hue_stream_message_data *frame,
-                                  int channel_count, double progress) {
+                                  int channel_count, uint32_t progress,
+                                  const double *params, prng *random) {
   (void)progress;
 
   if (channel_count == 0) {
     return;
   }
 
+  const int change_interval_frames =
+      params[0] * FRAME_RATE >= 1 ? (int)(params[0] * FRAME_RATE) : 1;
+
   const bool lights_on = light_is_on(frame, channel_count, 0);
 
   if (lights_on) {
-    if (rand() % (int)(ACROSS_LIGHTS_CHANGE_INTERVAL_SECONDS * FRAME_RATE) ==
-        0) {
-      if (rand() % 2 == 0) {
-        lights_to_random_color(frame, channel_count, 0);
+    if (prng_below(random, change_interval_frames) == 0) {
+      if (prng_below(random, 2) == 0) {
+        lights_to_random_color(frame, channel_count, 0, random);
       } else {
-        lights_to_random_colors(frame, channel_count, 0);
+        lights_to_random_colors(frame, channel_count, 0, random);
       }
     }
   } else {
-    if (rand() % 2 == 0) {
-      lights_to_random_color(frame, channel_count, 0);
+    if (prng_below(random, 2) == 0) {
+      lights_to_random_color(frame, channel_count, 0, random);
     } else {
-      lights_to_random_colors(frame, channel_count, 0);
+      lights_to_random_colors(frame, channel_count, 0, random);
     }
   }
 }
 
 static void animate_black(hue_stream_message_data *frame, int channel_count,
-                          double progress) {
+                          uint32_t progress, const double *params,
+                          prng *random) {
   (void)progress;
+  (void)params;
+  (void)random;
   for (int i = 0; i < channel_count; i++) {
     light_turn_off(frame, channel_count, i);
   }
 }
 
+static const animation_effect effect_hold = {
+    "hold", animate_hold, 0, {0}, 0, 0};
+static const animation_effect effect_fade_to_blue = {
+    "fade_to_blue", animate_fade_to_blue, 0, {0}, 0, 0};
+static const animation_effect effect_fade_to_dim = {
+    "fade_to_dim", animate_fade_to_dim, 0, {0}, 0, 0};
+static const animation_effect effect_fade_to_white = {
+    "fade_to_white", animate_fade_to_white, 0, {0}, 0, 0};
+static const animation_effect effect_fade_to_off = {
+    "fade_to_off", animate_fade_to_off, 0, {0}, 0, 0};
+// Fades between 16-bit xy + brightness values.
+static const animation_effect effect_fade = {
+    "fade", animate_fade, 6, {0}, 0, 0xffff};
+static const animation_effect effect_random_across = {
+    "random_across", animate_random_across, 1,
+    {ACROSS_LIGHTS_CHANGE_INTERVAL_SECONDS}, 0,
+    ACROSS_LIGHTS_MAX_INTERVAL_SECONDS};
+static const animation_effect effect_black = {
+    "black", animate_black, 0, {0}, 0, 0};
+
+static const animation_effect *const effects[] = {
+    &effect_hold,          &effect_fade_to_blue, &effect_fade_to_dim,
+    &effect_fade_to_white, &effect_fade_to_off,  &effect_fade,
+    &effect_random_across, &effect_black,
+};
+
+const animation_effect *animation_effect_find(const char *name) {
+  if (!name) {
+    fprintf(stderr, "name is null\n");
+    return NULL;
+  }
+
+  for (size_t i = 0; i < sizeof(effects) / sizeof(effects[0]); i++) {
+    if (strcmp(effects[i]->name, name) == 0) {
+      return effects[i];
+    }
+  }
+
+  return NULL;
+}
+
+// The built-in animations, parsed once from the cue sheets in movies/ that
+// are embedded at build time.
+static const cue_sheet *builtin_sheets[ANIMATION_COUNT];
+static pthread_once_t builtin_sheets_once = PTHREAD_ONCE_INIT;
+
+_Static_assert(sizeof(builtin_cue_sheet_texts) /
+                       sizeof(builtin_cue_sheet_texts[0]) ==
+                   ANIMATION_COUNT,
+               "every built-in animation needs a cue sheet");
+
+static void parse_builtin_sheets(void) {
+  for (int i = 0; i < ANIMATION_COUNT; i++) {
+    const builtin_cue_sheet_text *text = &builtin_cue_sheet_texts[i];
+    builtin_sheets[i] =
+        cue_sheet_parse((const char *)text->text, text->size);
+    if (!builtin_sheets[i]) {
+      fprintf(stderr, "built-in cue sheet %d is invalid\n", i);
+    }
+  }
+}
+
+const cue_sheet *animation_builtin_cue_sheet(animation animation) {
+  if (animation < 0 || animation >= ANIMATION_COUNT) {
+    return NULL;
+  }
+
+  pthread_once(&builtin_sheets_once, parse_builtin_sheets);
+  return builtin_sheets[animation];
+}
+
+// Animate a built-in animation, which is an error if its cue sheet didn't
+// parse.
+static animation_status animate_builtin(hue_stream_message_data *frame,
+                                        int channel_count,
+                                        animation_context *context,
+                                        animation animation) {
+  const cue_sheet *sheet = animation_builtin_cue_sheet(animation);
+  if (!sheet) {
+    return ANIMATION_STATUS_ERROR;
+  }
+  return animate(frame, channel_count, context, sheet);
+}
+
+int animation_context_init(animation_context *context,
+                           animation_clock *clock) {
+  if (!context || !clock) {
+    fprintf(stderr, "context or clock is null\n");
+    return -1;
+  }
+
+  context->clock = clock;
+  context->cursor = 0;
+  context->lookahead_ns = 0;
+  prng_seed(&context->random, 0);
+  if (animation_clock_now(clock, &context->start_time)) {
+    fprintf(stderr, "animation_clock_now() failed\n");
+    return -1;
+  }
+
+  return 0;
+}
+
+void animation_context_seed(animation_context *context, uint64_t seed) {
+  if (!context) {
+    fprintf(stderr, "context is null\n");
+    return;
+  }
+
+  prng_seed(&context->random, seed);
+}
+
+animation_status animation_cue_sheet(hue_stream_message_data *frame,
+                                     int channel_count,
+                                     animation_context *context,
+                                     const cue_sheet *sheet) {
+  if (!frame || !context || !sheet) {
+    fprintf(stderr, "frame, context, or sheet is null\n");
+    return ANIMATION_STATUS_ERROR;
+  }
+
+  return animate(frame, channel_count, context, sheet);
+}
+
+animation_status animation_thx_deep_note(hue_stream_message_data *frame,
+                                         int channel_count,
+                                         animation_context *context) {
+  return animate_builtin(frame, channel_count, context,
+                         ANIMATION_THX_DEEP_NOTE);
+}
+
+animation_status
+animation_spider_man_into_the_spider_verse(hue_stream_message_data *frame,
+                                           int channel_count,
+                                           animation_context *context) {
+  return animate_builtin(frame, channel_count, context,
+                         ANIMATION_SPIDER_MAN_INTO_THE_SPIDER_VERSE);
+}
+
 animation_status animation_spider_man_across_the_spider_verse(
     hue_stream_message_data *frame, int channel_count,
-    const struct timespec *start_time) {
-  const animation_phase phases[] = {
-      {0.000, animate_hold},   {8.718, animate_random_across},
-      {9.260, animate_black},  {9.510, animate_random_across},
-      {9.885, animate_black},  {11.053, animate_random_across},
-      {13.264, animate_black}, {13.472, animate_random_across},
-      {17.017, animate_black}, {17.852, animate_random_across},
-      {17.935, animate_black}, {18.436, animate_random_across},
-      {18.686, animate_black}, {19.145, animate_random_across},
-      {19.478, animate_black}, {20.229, animate_random_across},
-      {20.813, animate_black}, {21.272, animate_random_across},
-      {22.398, animate_black}, {22.481, animate_random_across},
-      {22.898, animate_black}, {24.483, animate_random_across},
-      {25.651, animate_black}, {26.986, animate_random_across},
-      {35.995, animate_black}, {37.788, animate_random_across},
-      {38.706, animate_black}, {38.748, animate_random_across},
-      {43.169, animate_black}, {43.461, animate_random_across},
-      {43.502, animate_black}, {44.837, animate_random_across},
-      {46.505, animate_black}, {47.173, animate_random_across},
-      {53.763, animate_black}, {54.096, animate_random_across},
-      {54.638, animate_black}, {54.889, animate_random_across},
-      {56.140, animate_black}, {56.265, animate_random_across},
-      {56.599, animate_black}, {56.807, animate_random_across},
-      {57.641, animate_black}, {58.642, animate_random_across},
-      {58.893, animate_black}, {59.185, animate_random_across},
-      {61.228, animate_hold}};
-
-  const int num_phases = sizeof(phases) / sizeof(phases[0]);
-  return animate(frame, channel_count, start_time, phases, num_phases);
+    animation_context *context) {
+  return animate_builtin(frame, channel_count, context,
+                         ANIMATION_SPIDER_MAN_ACROSS_THE_SPIDER_VERSE);
 }
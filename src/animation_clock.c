@@ -0,0 +1,74 @@
+#include "animation_clock.h"
+
+#include <stdio.h>  // fprintf
+#include <string.h> // memset
+
+#define NANOSECONDS_PER_SECOND 1000000000L
+
+static int monotonic_now(animation_clock *clock, struct timespec *time) {
+  (void)clock;
+  if (clock_gettime(CLOCK_MONOTONIC, time)) {
+    fprintf(stderr, "clock_gettime() failed\n");
+    return -1;
+  }
+  return 0;
+}
+
+static int manual_now(animation_clock *clock, struct timespec *time) {
+  *time = clock->time;
+  return 0;
+}
+
+void animation_clock_init_monotonic(animation_clock *clock) {
+  if (!clock) {
+    fprintf(stderr, "clock is null\n");
+    return;
+  }
+
+  memset(clock, 0, sizeof(animation_clock));
+  clock->now = monotonic_now;
+}
+
+void animation_clock_init_manual(animation_clock *clock,
+                                 const struct timespec *time) {
+  if (!clock || !time) {
+    fprintf(stderr, "clock or time is null\n");
+    return;
+  }
+
+  memset(clock, 0, sizeof(animation_clock));
+  clock->now = manual_now;
+  clock->time = *time;
+}
+
+int animation_clock_now(animation_clock *clock, struct timespec *time) {
+  if (!clock || !time) {
+    fprintf(stderr, "clock or time is null\n");
+    return -1;
+  }
+
+  return clock->now(clock, time);
+}
+
+void animation_clock_set(animation_clock *clock, const struct timespec *time) {
+  if (!clock || !time) {
+    fprintf(stderr, "clock or time is null\n");
+    return;
+  }
+
+  clock->time = *time;
+}
+
+void animation_clock_advance(animation_clock *clock, long nanoseconds) {
+  if (!clock) {
+    fprintf(stderr, "clock is null\n");
+    return;
+  }
+
+  clock->time.tv_sec += nanoseconds / NANOSECONDS_PER_SECOND;
+  clock->time.tv_nsec += nanoseconds % NANOSECONDS_PER_SECOND;
+  if (clock->time.tv_nsec >= NANOSECONDS_PER_SECOND) {
+    clock->time.tv_sec++;
+    clock->time.tv_nsec -= NANOSECONDS_PER_SECOND;
+  }
+}
@@ -0,0 +1,436 @@
+#include "audio_analyzer.h"
+
+#include "frame_slot.h"
+#include <math.h>   // cosf, fmaxf, fminf, fmodf, log10f, powf, sinf, sqrtf
+#include <stdio.h>  // fprintf
+#include <string.h> // memcpy, memmove, memset
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define AUDIO_X86 1
+#include <immintrin.h>
+#else
+#define AUDIO_X86 0
+#endif
+
+#define PI 3.14159265358979f
+
+// Band levels in dB are relative to a full-scale sine. A band's level spans
+// RANGE_DB below its recent peak, and the peak falls by PEAK_DECAY_DB every
+// window so the gain recovers after a loud passage.
+#define RANGE_DB 30.0f
+#define PEAK_DECAY_DB 0.05f
+#define SILENCE_DB -70.0f
+// How much of a band's level is left a window later when it drops.
+#define BAND_RELEASE 0.85f
+
+// An onset is spectral flux this many times its running average, at least
+// ONSET_MIN_WINDOWS after the previous one.
+#define ONSET_RATIO 1.8f
+#define ONSET_MIN_FLUX 0.01f
+#define ONSET_MIN_WINDOWS 6
+#define FLUX_AVERAGE_RATE 0.05f
+#define FLASH_DECAY 0.8f
+
+// The hue of the lowest and highest band, in degrees: red to blue.
+#define BASS_HUE 0.0f
+#define TREBLE_HUE 240.0f
+
+typedef void (*stage_function)(float *real, float *imaginary,
+                               const float *twiddles_real,
+                               const float *twiddles_imaginary, int half);
+typedef float (*spectrum_function)(const float *real, const float *imaginary,
+                                   float scale, float *magnitudes,
+                                   const float *previous_magnitudes);
+
+// One radix-2 stage: every pair half apart is combined with the twiddle
+// factor of its position in the group.
+static void stage_scalar(float *real, float *imaginary,
+                         const float *twiddles_real,
+                         const float *twiddles_imaginary, int half) {
+  for (int group = 0; group < AUDIO_ANALYZER_WINDOW_SIZE; group += 2 * half) {
+    float *a_real = real + group;
+    float *a_imaginary = imaginary + group;
+    float *b_real = a_real + half;
+    float *b_imaginary = a_imaginary + half;
+    for (int j = 0; j < half; j++) {
+      const float t_real = b_real[j] * twiddles_real[half + j] -
+                           b_imaginary[j] * twiddles_imaginary[half + j];
+      const float t_imaginary = b_real[j] * twiddles_imaginary[half + j] +
+                                b_imaginary[j] * twiddles_real[half + j];
+      b_real[j] = a_real[j] - t_real;
+      b_imaginary[j] = a_imaginary[j] - t_imaginary;
+      a_real[j] += t_real;
+      a_imaginary[j] += t_imaginary;
+    }
+  }
+}
+
+// The magnitude of each bin, and the spectral flux, how much the magnitudes
+// rose since the previous window.
+static float spectrum_scalar(const float *real, const float *imaginary,
+                             float scale, float *magnitudes,
+                             const float *previous_magnitudes) {
+  float flux = 0.0f;
+  for (int i = 0; i < AUDIO_ANALYZER_BIN_COUNT; i++) {
+    magnitudes[i] =
+        sqrtf(real[i] * real[i] + imaginary[i] * imaginary[i]) * scale;
+    const float rise = magnitudes[i] - previous_magnitudes[i];
+    flux += rise > 0.0f ? rise : 0.0f;
+  }
+  return flux;
+}
+
+#if AUDIO_X86
+
+static void stage_sse2(float *real, float *imaginary,
+                       const float *twiddles_real,
+                       const float *twiddles_imaginary, int half) {
+  if (half < 4) {
+    stage_scalar(real, imaginary, twiddles_real, twiddles_imaginary, half);
+    return;
+  }
+
+  for (int group = 0; group < AUDIO_ANALYZER_WINDOW_SIZE; group += 2 * half) {
+    float *a_real = real + group;
+    float *a_imaginary = imaginary + group;
+    float *b_real = a_real + half;
+    float *b_imaginary = a_imaginary + half;
+    for (int j = 0; j < half; j += 4) {
+      const __m128 w_real = _mm_loadu_ps(twiddles_real + half + j);
+      const __m128 w_imaginary = _mm_loadu_ps(twiddles_imaginary + half + j);
+      const __m128 br = _mm_loadu_ps(b_real + j);
+      const __m128 bi = _mm_loadu_ps(b_imaginary + j);
+      const __m128 ar = _mm_loadu_ps(a_real + j);
+      const __m128 ai = _mm_loadu_ps(a_imaginary + j);
+      const __m128 t_real =
+          _mm_sub_ps(_mm_mul_ps(br, w_real), _mm_mul_ps(bi, w_imaginary));
+      const __m128 t_imaginary =
+          _mm_add_ps(_mm_mul_ps(br, w_imaginary), _mm_mul_ps(bi, w_real));
+      _mm_storeu_ps(b_real + j, _mm_sub_ps(ar, t_real));
+      _mm_storeu_ps(b_imaginary + j, _mm_sub_ps(ai, t_imaginary));
+      _mm_storeu_ps(a_real + j, _mm_add_ps(ar, t_real));
+      _mm_storeu_ps(a_imaginary + j, _mm_add_ps(ai, t_imaginary));
+    }
+  }
+}
+
+static float sum_sse2(__m128 value) {
+  float lanes[4];
+  _mm_storeu_ps(lanes, value);
+  return (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+}
+
+static float spectrum_sse2(const float *real, const float *imaginary,
+                           float scale, float *magnitudes,
+                           const float *previous_magnitudes) {
+  const __m128 scales = _mm_set1_ps(scale);
+  const __m128 zero = _mm_setzero_ps();
+  __m128 flux = zero;
+  for (int i = 0; i < AUDIO_ANALYZER_BIN_COUNT; i += 4) {
+    const __m128 r = _mm_loadu_ps(real + i);
+    const __m128 m = _mm_loadu_ps(imaginary + i);
+    const __m128 magnitude = _mm_mul_ps(
+        _mm_sqrt_ps(_mm_add_ps(_mm_mul_ps(r, r), _mm_mul_ps(m, m))), scales);
+    _mm_storeu_ps(magnitudes + i, magnitude);
+    const __m128 rise =
+        _mm_sub_ps(magnitude, _mm_loadu_ps(previous_magnitudes + i));
+    flux = _mm_add_ps(flux, _mm_max_ps(rise, zero));
+  }
+  return sum_sse2(flux);
+}
+
+__attribute__((target("avx2"))) static void
+stage_avx2(float *real, float *imaginary, const float *twiddles_real,
+           const float *twiddles_imaginary, int half) {
+  if (half < 8) {
+    stage_sse2(real, imaginary, twiddles_real, twiddles_imaginary, half);
+    return;
+  }
+
+  for (int group = 0; group < AUDIO_ANALYZER_WINDOW_SIZE; group += 2 * half) {
+    float *a_real = real + group;
+    float *a_imaginary = imaginary + group;
+    float *b_real = a_real + half;
+    float *b_imaginary = a_imaginary + half;
+    for (int j = 0; j < half; j += 8) {
+      const __m256 w_real = _mm256_loadu_ps(twiddles_real + half + j);
+      const __m256 w_imaginary =
+          _mm256_loadu_ps(twiddles_imaginary + half + j);
+      const __m256 br = _mm256_loadu_ps(b_real + j);
+      const __m256 bi = _mm256_loadu_ps(b_imaginary + j);
+      const __m256 ar = _mm256_loadu_ps(a_real + j);
+      const __m256 ai = _mm256_loadu_ps(a_imaginary + j);
+      const __m256 t_real = _mm256_sub_ps(_mm256_mul_ps(br, w_real),
+                                          _mm256_mul_ps(bi, w_imaginary));
+      const __m256 t_imaginary = _mm256_add_ps(_mm256_mul_ps(br, w_imaginary),
+                                               _mm256_mul_ps(bi, w_real));
+      _mm256_storeu_ps(b_real + j, _mm256_sub_ps(ar, t_real));
+      _mm256_storeu_ps(b_imaginary + j, _mm256_sub_ps(ai, t_imaginary));
+      _mm256_storeu_ps(a_real + j, _mm256_add_ps(ar, t_real));
+      _mm256_storeu_ps(a_imaginary + j, _mm256_add_ps(ai, t_imaginary));
+    }
+  }
+}
+
+__attribute__((target("avx2"))) static float
+spectrum_avx2(const float *real, const float *imaginary, float scale,
+              float *magnitudes, const float *previous_magnitudes) {
+  const __m256 scales = _mm256_set1_ps(scale);
+  const __m256 zero = _mm256_setzero_ps();
+  __m256 flux = zero;
+  for (int i = 0; i < AUDIO_ANALYZER_BIN_COUNT; i += 8) {
+    const __m256 r = _mm256_loadu_ps(real + i);
+    const __m256 m = _mm256_loadu_ps(imaginary + i);
+    const __m256 magnitude = _mm256_mul_ps(
+        _mm256_sqrt_ps(_mm256_add_ps(_mm256_mul_ps(r, r), _mm256_mul_ps(m, m))),
+        scales);
+    _mm256_storeu_ps(magnitudes + i, magnitude);
+    const __m256 rise =
+        _mm256_sub_ps(magnitude, _mm256_loadu_ps(previous_magnitudes + i));
+    flux = _mm256_add_ps(flux, _mm256_max_ps(rise, zero));
+  }
+  return sum_sse2(_mm_add_ps(_mm256_castps256_ps128(flux),
+                             _mm256_extractf128_ps(flux, 1)));
+}
+
+#endif
+
+static int find_kernel(color_kernel kernel, stage_function *stage,
+                       spectrum_function *spectrum) {
+  switch (kernel) {
+  case COLOR_KERNEL_SCALAR:
+    *stage = stage_scalar;
+    *spectrum = spectrum_scalar;
+    return 0;
+#if AUDIO_X86
+  case COLOR_KERNEL_SSE2:
+    *stage = stage_sse2;
+    *spectrum = spectrum_sse2;
+    return 0;
+  case COLOR_KERNEL_AVX2:
+    if (__builtin_cpu_supports("avx2")) {
+      *stage = stage_avx2;
+      *spectrum = spectrum_avx2;
+      return 0;
+    }
+    break;
+#endif
+  default:
+    break;
+  }
+
+  fprintf(stderr, "The %s kernel isn't supported on this CPU\n",
+          color_kernel_name(kernel));
+  return -1;
+}
+
+// Spread the bands evenly on a log scale, each at least one bin wide.
+static void init_bands(audio_analyzer *analyzer) {
+  int *bins = analyzer->band_bins;
+  for (int i = 0; i <= AUDIO_ANALYZER_BAND_COUNT; i++) {
+    const float frequency =
+        AUDIO_ANALYZER_MIN_FREQUENCY *
+        powf(AUDIO_ANALYZER_MAX_FREQUENCY / AUDIO_ANALYZER_MIN_FREQUENCY,
+             (float)i / AUDIO_ANALYZER_BAND_COUNT);
+    const int bin = (int)(frequency * AUDIO_ANALYZER_WINDOW_SIZE /
+                              analyzer->sample_rate +
+                          0.5f);
+    bins[i] = bin < 1 ? 1 : (bin > AUDIO_ANALYZER_BIN_COUNT
+                                 ? AUDIO_ANALYZER_BIN_COUNT
+                                 : bin);
+  }
+
+  for (int i = 1; i <= AUDIO_ANALYZER_BAND_COUNT; i++) {
+    if (bins[i] <= bins[i - 1]) {
+      bins[i] = bins[i - 1] + 1;
+    }
+  }
+  for (int i = AUDIO_ANALYZER_BAND_COUNT; i > 0; i--) {
+    if (bins[i] > AUDIO_ANALYZER_BIN_COUNT - AUDIO_ANALYZER_BAND_COUNT + i) {
+      bins[i] = AUDIO_ANALYZER_BIN_COUNT - AUDIO_ANALYZER_BAND_COUNT + i;
+    }
+    if (bins[i - 1] >= bins[i]) {
+      bins[i - 1] = bins[i] - 1;
+    }
+  }
+}
+
+int audio_analyzer_init(audio_analyzer *analyzer, int sample_rate,
+                        color_kernel kernel) {
+  if (!analyzer) {
+    fprintf(stderr, "analyzer is null\n");
+    return -1;
+  }
+
+  if (sample_rate <= 0) {
+    fprintf(stderr, "Invalid sample rate %d\n", sample_rate);
+    return -1;
+  }
+
+  memset(analyzer, 0, sizeof(audio_analyzer));
+  analyzer->kernel = kernel == COLOR_KERNEL_AUTO ? color_kernel_best() : kernel;
+  analyzer->sample_rate = sample_rate;
+
+  stage_function stage = NULL;
+  spectrum_function spectrum = NULL;
+  if (find_kernel(analyzer->kernel, &stage, &spectrum)) {
+    return -1;
+  }
+
+  int bits = 0;
+  while ((1 << bits) < AUDIO_ANALYZER_WINDOW_SIZE) {
+    bits++;
+  }
+
+  for (int i = 0; i < AUDIO_ANALYZER_WINDOW_SIZE; i++) {
+    analyzer->window[i] =
+        0.5f - 0.5f * cosf(2.0f * PI * i / AUDIO_ANALYZER_WINDOW_SIZE);
+
+    int reversed = 0;
+    for (int bit = 0; bit < bits; bit++) {
+      reversed |= ((i >> bit) & 1) << (bits - 1 - bit);
+    }
+    analyzer->bit_reversed[i] = reversed;
+  }
+
+  for (int half = 1; half < AUDIO_ANALYZER_WINDOW_SIZE; half *= 2) {
+    for (int j = 0; j < half; j++) {
+      analyzer->twiddles_real[half + j] = cosf(-PI * j / half);
+      analyzer->twiddles_imaginary[half + j] = sinf(-PI * j / half);
+    }
+  }
+
+  init_bands(analyzer);
+  for (int i = 0; i < AUDIO_ANALYZER_BAND_COUNT; i++) {
+    analyzer->band_peaks[i] = SILENCE_DB;
+  }
+  analyzer->windows_since_onset = ONSET_MIN_WINDOWS;
+  return 0;
+}
+
+static float clamp_unit(float value) {
+  return value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+}
+
+// Turn each band's power into a level against its own recent peak.
+static void update_bands(audio_analyzer *analyzer) {
+  for (int i = 0; i < AUDIO_ANALYZER_BAND_COUNT; i++) {
+    float power = 0.0f;
+    for (int bin = analyzer->band_bins[i]; bin < analyzer->band_bins[i + 1];
+         bin++) {
+      power += analyzer->magnitudes[bin] * analyzer->magnitudes[bin];
+    }
+    power /= analyzer->band_bins[i + 1] - analyzer->band_bins[i];
+
+    const float db = 10.0f * log10f(power + 1e-12f);
+    float *peak = &analyzer->band_peaks[i];
+    *peak = db > *peak - PEAK_DECAY_DB ? db : *peak - PEAK_DECAY_DB;
+    if (*peak < SILENCE_DB) {
+      *peak = SILENCE_DB;
+    }
+
+    const float level = clamp_unit((db - (*peak - RANGE_DB)) / RANGE_DB);
+    const float released = analyzer->bands[i] * BAND_RELEASE;
+    analyzer->bands[i] = level > released ? level : released;
+  }
+}
+
+static void update_onset(audio_analyzer *analyzer) {
+  analyzer->onset = analyzer->flux > ONSET_MIN_FLUX &&
+                    analyzer->flux > ONSET_RATIO * analyzer->average_flux &&
+                    analyzer->windows_since_onset >= ONSET_MIN_WINDOWS;
+  analyzer->windows_since_onset =
+      analyzer->onset ? 0 : analyzer->windows_since_onset + 1;
+  analyzer->average_flux +=
+      (analyzer->flux - analyzer->average_flux) * FLUX_AVERAGE_RATE;
+}
+
+int audio_analyzer_process(audio_analyzer *analyzer, const float *samples,
+                           int count) {
+  if (!analyzer || !samples) {
+    fprintf(stderr, "analyzer or samples is null\n");
+    return -1;
+  }
+
+  if (count < 0 || count > AUDIO_ANALYZER_WINDOW_SIZE) {
+    fprintf(stderr, "Invalid sample count %d\n", count);
+    return -1;
+  }
+
+  stage_function stage = NULL;
+  spectrum_function spectrum = NULL;
+  if (find_kernel(analyzer->kernel, &stage, &spectrum)) {
+    return -1;
+  }
+
+  const int kept = AUDIO_ANALYZER_WINDOW_SIZE - count;
+  memmove(analyzer->samples, analyzer->samples + count,
+          kept * sizeof(float));
+  memcpy(analyzer->samples + kept, samples, count * sizeof(float));
+
+  // Window the samples into bit-reversed order, so the stages run in place.
+  for (int i = 0; i < AUDIO_ANALYZER_WINDOW_SIZE; i++) {
+    analyzer->real[analyzer->bit_reversed[i]] =
+        analyzer->samples[i] * analyzer->window[i];
+  }
+  memset(analyzer->imaginary, 0, sizeof(analyzer->imaginary));
+
+  for (int half = 1; half < AUDIO_ANALYZER_WINDOW_SIZE; half *= 2) {
+    stage(analyzer->real, analyzer->imaginary, analyzer->twiddles_real,
+          analyzer->twiddles_imaginary, half);
+  }
+
+  // A full-scale sine has a magnitude of 1 through the Hann window.
+  memcpy(analyzer->previous_magnitudes, analyzer->magnitudes,
+         sizeof(analyzer->magnitudes));
+  analyzer->flux =
+      spectrum(analyzer->real, analyzer->imaginary,
+               4.0f / AUDIO_ANALYZER_WINDOW_SIZE, analyzer->magnitudes,
+               analyzer->previous_magnitudes);
+
+  update_bands(analyzer);
+  update_onset(analyzer);
+  return 0;
+}
+
+// One component of a fully saturated color of a hue, with n picking the
+// component: 5 for red, 3 for green and 1 for blue.
+static float hue_component(float hue, float n) {
+  const float k = fmodf(n + hue / 60.0f, 6.0f);
+  return 1.0f - fmaxf(fminf(fminf(k, 4.0f - k), 1.0f), 0.0f);
+}
+
+int audio_analyzer_render(const audio_analyzer *analyzer,
+                          hue_stream_message_data *frame, int channel_count,
+                          float *flash) {
+  if (!analyzer || !frame || !flash) {
+    fprintf(stderr, "analyzer, frame or flash is null\n");
+    return -1;
+  }
+
+  if (channel_count < 0 || channel_count > FRAME_SLOT_MAX_CHANNELS) {
+    fprintf(stderr, "Invalid channel count %d\n", channel_count);
+    return -1;
+  }
+
+  *flash = analyzer->onset ? 1.0f : *flash * FLASH_DECAY;
+
+  float rgb[3 * FRAME_SLOT_MAX_CHANNELS];
+  for (int i = 0; i < channel_count; i++) {
+    // Each channel shows the band at its middle.
+    const int band =
+        (2 * i + 1) * AUDIO_ANALYZER_BAND_COUNT / (2 * channel_count);
+    const float hue = BASS_HUE + (TREBLE_HUE - BASS_HUE) * band /
+                                     (AUDIO_ANALYZER_BAND_COUNT - 1);
+    float *color = rgb + 3 * i;
+    color[0] = hue_component(hue, 5.0f) * analyzer->bands[band];
+    color[1] = hue_component(hue, 3.0f) * analyzer->bands[band];
+    color[2] = hue_component(hue, 1.0f) * analyzer->bands[band];
+    for (int j = 0; j < 3; j++) {
+      color[j] = color_srgb_to_linear(color[j] + (1.0f - color[j]) * *flash);
+    }
+  }
+
+  return color_linear_to_xy_brightness(analyzer->kernel, rgb, channel_count,
+                                       frame);
+}
@@ -0,0 +1,317 @@
+#include "color.h"
+
+#include <math.h> // powf
+#include <pthread.h>
+#include <stdio.h> // fprintf
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define COLOR_X86 1
+#include <immintrin.h>
+#else
+#define COLOR_X86 0
+#endif
+
+// sRGB (D65) to CIE XYZ.
+#define M00 0.4124564f
+#define M01 0.3575761f
+#define M02 0.1804375f
+#define M10 0.2126729f
+#define M11 0.7151522f
+#define M12 0.0721750f
+#define M20 0.0193339f
+#define M21 0.1191920f
+#define M22 0.9503041f
+
+// sRGB colors are decoded this many at a time, on the stack.
+#define SRGB8_BLOCK_SIZE 64
+
+color_kernel color_kernel_best(void) {
+#if COLOR_X86
+  if (__builtin_cpu_supports("avx2")) {
+    return COLOR_KERNEL_AVX2;
+  }
+  return COLOR_KERNEL_SSE2;
+#else
+  return COLOR_KERNEL_SCALAR;
+#endif
+}
+
+const char *color_kernel_name(color_kernel kernel) {
+  switch (kernel) {
+  case COLOR_KERNEL_AUTO:
+    return "auto";
+  case COLOR_KERNEL_SCALAR:
+    return "scalar";
+  case COLOR_KERNEL_SSE2:
+    return "sse2";
+  case COLOR_KERNEL_AVX2:
+    return "avx2";
+  }
+  return "unknown";
+}
+
+float color_srgb_to_linear(float value) {
+  if (value <= 0.04045f) {
+    return value / 12.92f;
+  }
+  return powf((value + 0.055f) / 1.055f, 2.4f);
+}
+
+// Clamp to 0 to 1. NaN becomes 0, like _mm_max_ps() makes it.
+static float clamp_unit(float value) {
+  return value > 0.0f ? (value < 1.0f ? value : 1.0f) : 0.0f;
+}
+
+static uint16_t to_uint16(float value) {
+  const float scaled = value * 65535.0f + 0.5f;
+  return scaled < 65535.0f ? (uint16_t)scaled : 65535;
+}
+
+static void convert_scalar(const float *rgb, int count,
+                           hue_stream_message_data *data) {
+  for (int i = 0; i < count; i++) {
+    const float r = clamp_unit(rgb[3 * i]);
+    const float g = clamp_unit(rgb[3 * i + 1]);
+    const float b = clamp_unit(rgb[3 * i + 2]);
+
+    const float x = r * M00 + g * M01 + b * M02;
+    const float y = r * M10 + g * M11 + b * M12;
+    const float z = r * M20 + g * M21 + b * M22;
+    const float sum = x + y + z;
+
+    data[i].color_value[0] = to_uint16(sum > 0.0f ? x / sum
+                                                  : COLOR_WHITE_POINT_X);
+    data[i].color_value[1] = to_uint16(sum > 0.0f ? y / sum
+                                                  : COLOR_WHITE_POINT_Y);
+    data[i].color_value[2] = to_uint16(y);
+  }
+}
+
+#if COLOR_X86
+
+static __m128 clamp_unit_sse2(__m128 value) {
+  return _mm_min_ps(_mm_max_ps(value, _mm_setzero_ps()), _mm_set1_ps(1.0f));
+}
+
+static __m128i to_uint16_sse2(__m128 value) {
+  const __m128 scaled =
+      _mm_add_ps(_mm_mul_ps(value, _mm_set1_ps(65535.0f)), _mm_set1_ps(0.5f));
+  return _mm_cvttps_epi32(_mm_min_ps(scaled, _mm_set1_ps(65535.0f)));
+}
+
+static void store_sse2(hue_stream_message_data *data, __m128i x, __m128i y,
+                       __m128i brightness) {
+  int32_t values[3][4];
+  _mm_storeu_si128((__m128i *)values[0], x);
+  _mm_storeu_si128((__m128i *)values[1], y);
+  _mm_storeu_si128((__m128i *)values[2], brightness);
+  for (int i = 0; i < 4; i++) {
+    data[i].color_value[0] = values[0][i];
+    data[i].color_value[1] = values[1][i];
+    data[i].color_value[2] = values[2][i];
+  }
+}
+
+// Four colors at a time. The components are gathered with scalar loads, which
+// costs less than shuffling them out of the interleaved layout.
+static void convert_sse2(const float *rgb, int count,
+                         hue_stream_message_data *data) {
+  int i = 0;
+  for (; i + 4 <= count; i += 4) {
+    const float *p = rgb + 3 * i;
+    const __m128 r = clamp_unit_sse2(_mm_setr_ps(p[0], p[3], p[6], p[9]));
+    const __m128 g = clamp_unit_sse2(_mm_setr_ps(p[1], p[4], p[7], p[10]));
+    const __m128 b = clamp_unit_sse2(_mm_setr_ps(p[2], p[5], p[8], p[11]));
+
+    const __m128 x =
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(r, _mm_set1_ps(M00)),
+                              _mm_mul_ps(g, _mm_set1_ps(M01))),
+                   _mm_mul_ps(b, _mm_set1_ps(M02)));
+    const __m128 y =
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(r, _mm_set1_ps(M10)),
+                              _mm_mul_ps(g, _mm_set1_ps(M11))),
+                   _mm_mul_ps(b, _mm_set1_ps(M12)));
+    const __m128 z =
+        _mm_add_ps(_mm_add_ps(_mm_mul_ps(r, _mm_set1_ps(M20)),
+                              _mm_mul_ps(g, _mm_set1_ps(M21))),
+                   _mm_mul_ps(b, _mm_set1_ps(M22)));
+    const __m128 sum = _mm_add_ps(_mm_add_ps(x, y), z);
+
+    // Divide black by one instead of zero, then give it the white point.
+    const __m128 lit = _mm_cmpgt_ps(sum, _mm_setzero_ps());
+    const __m128 divisor = _mm_or_ps(_mm_and_ps(lit, sum),
+                                     _mm_andnot_ps(lit, _mm_set1_ps(1.0f)));
+    const __m128 cx =
+        _mm_or_ps(_mm_and_ps(lit, _mm_div_ps(x, divisor)),
+                  _mm_andnot_ps(lit, _mm_set1_ps(COLOR_WHITE_POINT_X)));
+    const __m128 cy =
+        _mm_or_ps(_mm_and_ps(lit, _mm_div_ps(y, divisor)),
+                  _mm_andnot_ps(lit, _mm_set1_ps(COLOR_WHITE_POINT_Y)));
+
+    store_sse2(data + i, to_uint16_sse2(cx), to_uint16_sse2(cy),
+               to_uint16_sse2(y));
+  }
+
+  convert_scalar(rgb + 3 * i, count - i, data + i);
+}
+
+__attribute__((target("avx2"))) static __m256 clamp_unit_avx2(__m256 value) {
+  return _mm256_min_ps(_mm256_max_ps(value, _mm256_setzero_ps()),
+                       _mm256_set1_ps(1.0f));
+}
+
+__attribute__((target("avx2"))) static __m256i to_uint16_avx2(__m256 value) {
+  const __m256 scaled = _mm256_add_ps(
+      _mm256_mul_ps(value, _mm256_set1_ps(65535.0f)), _mm256_set1_ps(0.5f));
+  return _mm256_cvttps_epi32(_mm256_min_ps(scaled, _mm256_set1_ps(65535.0f)));
+}
+
+__attribute__((target("avx2"))) static void
+store_avx2(hue_stream_message_data *data, __m256i x, __m256i y,
+           __m256i brightness) {
+  int32_t values[3][8];
+  _mm256_storeu_si256((__m256i *)values[0], x);
+  _mm256_storeu_si256((__m256i *)values[1], y);
+  _mm256_storeu_si256((__m256i *)values[2], brightness);
+  for (int i = 0; i < 8; i++) {
+    data[i].color_value[0] = values[0][i];
+    data[i].color_value[1] = values[1][i];
+    data[i].color_value[2] = values[2][i];
+  }
+}
+
+// Eight colors at a time, gathering each component with one instruction.
+__attribute__((target("avx2"))) static void
+convert_avx2(const float *rgb, int count, hue_stream_message_data *data) {
+  const __m256i stride = _mm256_setr_epi32(0, 3, 6, 9, 12, 15, 18, 21);
+
+  int i = 0;
+  for (; i + 8 <= count; i += 8) {
+    const float *p = rgb + 3 * i;
+    const __m256 r = clamp_unit_avx2(_mm256_i32gather_ps(p, stride, 4));
+    const __m256 g = clamp_unit_avx2(_mm256_i32gather_ps(p + 1, stride, 4));
+    const __m256 b = clamp_unit_avx2(_mm256_i32gather_ps(p + 2, stride, 4));
+
+    const __m256 x =
+        _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r, _mm256_set1_ps(M00)),
+                                    _mm256_mul_ps(g, _mm256_set1_ps(M01))),
+                      _mm256_mul_ps(b, _mm256_set1_ps(M02)));
+    const __m256 y =
+        _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r, _mm256_set1_ps(M10)),
+                                    _mm256_mul_ps(g, _mm256_set1_ps(M11))),
+                      _mm256_mul_ps(b, _mm256_set1_ps(M12)));
+    const __m256 z =
+        _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(r, _mm256_set1_ps(M20)),
+                                    _mm256_mul_ps(g, _mm256_set1_ps(M21))),
+                      _mm256_mul_ps(b, _mm256_set1_ps(M22)));
+    const __m256 sum = _mm256_add_ps(_mm256_add_ps(x, y), z);
+
+    // Divide black by one instead of zero, then give it the white point.
+    const __m256 lit = _mm256_cmp_ps(sum, _mm256_setzero_ps(), _CMP_GT_OQ);
+    const __m256 divisor = _mm256_blendv_ps(_mm256_set1_ps(1.0f), sum, lit);
+    const __m256 cx =
+        _mm256_blendv_ps(_mm256_set1_ps(COLOR_WHITE_POINT_X),
+                         _mm256_div_ps(x, divisor), lit);
+    const __m256 cy =
+        _mm256_blendv_ps(_mm256_set1_ps(COLOR_WHITE_POINT_Y),
+                         _mm256_div_ps(y, divisor), lit);
+
+    store_avx2(data + i, to_uint16_avx2(cx), to_uint16_avx2(cy),
+               to_uint16_avx2(y));
+  }
+
+  convert_sse2(rgb + 3 * i, count - i, data + i);
+}
+
+#endif
+
+typedef void (*convert_function)(const float *rgb, int count,
+                                 hue_stream_message_data *data);
+
+static convert_function find_kernel(color_kernel kernel) {
+  if (kernel == COLOR_KERNEL_AUTO) {
+    kernel = color_kernel_best();
+  }
+
+  switch (kernel) {
+  case COLOR_KERNEL_SCALAR:
+    return convert_scalar;
+#if COLOR_X86
+  case COLOR_KERNEL_SSE2:
+    return convert_sse2;
+  case COLOR_KERNEL_AVX2:
+    if (__builtin_cpu_supports("avx2")) {
+      return convert_avx2;
+    }
+    break;
+#endif
+  default:
+    break;
+  }
+
+  fprintf(stderr, "The %s color kernel isn't supported on this CPU\n",
+          color_kernel_name(kernel));
+  return NULL;
+}
+
+int color_linear_to_xy_brightness(color_kernel kernel, const float *rgb,
+                                  int count, hue_stream_message_data *data) {
+  if (!rgb || !data) {
+    fprintf(stderr, "rgb or data is null\n");
+    return -1;
+  }
+
+  if (count < 0) {
+    fprintf(stderr, "Invalid color count %d\n", count);
+    return -1;
+  }
+
+  const convert_function convert = find_kernel(kernel);
+  if (!convert) {
+    return -1;
+  }
+
+  convert(rgb, count, data);
+  return 0;
+}
+
+static float srgb8_table[256];
+static pthread_once_t srgb8_table_once = PTHREAD_ONCE_INIT;
+
+static void init_srgb8_table(void) {
+  for (int i = 0; i < 256; i++) {
+    srgb8_table[i] = color_srgb_to_linear(i / 255.0f);
+  }
+}
+
+int color_srgb8_to_xy_brightness(color_kernel kernel, const uint8_t *rgb,
+                                 int count, hue_stream_message_data *data) {
+  if (!rgb || !data) {
+    fprintf(stderr, "rgb or data is null\n");
+    return -1;
+  }
+
+  if (count < 0) {
+    fprintf(stderr, "Invalid color count %d\n", count);
+    return -1;
+  }
+
+  const convert_function convert = find_kernel(kernel);
+  if (!convert) {
+    return -1;
+  }
+
+  pthread_once(&srgb8_table_once, init_srgb8_table);
+
+  float linear[3 * SRGB8_BLOCK_SIZE];
+  for (int i = 0; i < count; i += SRGB8_BLOCK_SIZE) {
+    const int block = count - i < SRGB8_BLOCK_SIZE ? count - i
+                                                   : SRGB8_BLOCK_SIZE;
+    for (int j = 0; j < 3 * block; j++) {
+      linear[j] = srgb8_table[rgb[3 * i + j]];
+    }
+    convert(linear, block, data + i);
+  }
+
+  return 0;
+}
@@ -0,0 +1,552 @@
+#include "cue_sheet.h"
+
+#include <ctype.h>    // isdigit, isspace
+#include <fcntl.h>    // open
+#include <limits.h>   // INT_MAX
+#include <math.h>     // isfinite
+#include <stdbool.h>  // bool
+#include <stdint.h>   // uint32_t
+#include <stdio.h>    // fprintf, perror, fopen, fwrite
+#include <stdlib.h>   // malloc, free, strtod
+#include <string.h>   // memcmp, memcpy, memset, strchr, strlen, strrchr
+#include <sys/mman.h> // mmap, munmap
+#include <sys/stat.h> // fstat
+#include <unistd.h>   // close
+
+#define CUE_SHEET_BINARY_MAGIC "RCUE"
+#define CUE_SHEET_BINARY_MAGIC_SIZE 4
+#define CUE_SHEET_BINARY_VERSION 2
+#define CUE_SHEET_EFFECT_NAME_SIZE 32
+#define CUE_SHEET_MAX_LINE_LENGTH 256
+// More than there are effects, so every cue sheet that can be saved fits.
+#define CUE_SHEET_MAX_EFFECTS 64
+
+// The binary format is a header, followed by effect_count effect names of
+// CUE_SHEET_EFFECT_NAME_SIZE bytes, followed by cue_count cues. Values are
+// stored in host byte order.
+typedef struct cue_sheet_binary_header cue_sheet_binary_header;
+struct cue_sheet_binary_header {
+  char magic[CUE_SHEET_BINARY_MAGIC_SIZE];
+  uint32_t version;
+  uint32_t cue_count;
+  uint32_t effect_count;
+  char title[CUE_SHEET_TITLE_SIZE];
+};
+
+typedef struct cue_sheet_binary_cue cue_sheet_binary_cue;
+struct cue_sheet_binary_cue {
+  double start_time;
+  uint32_t effect;
+  uint32_t param_count;
+  double params[ANIMATION_EFFECT_MAX_PARAMS];
+  uint32_t easing;
+};
+
+static cue_sheet *cue_sheet_alloc(int cue_count) {
+  cue_sheet *sheet = malloc(sizeof(cue_sheet));
+  if (!sheet) {
+    perror("malloc");
+    return NULL;
+  }
+
+  memset(sheet, 0, sizeof(cue_sheet));
+
+  cue *cues = malloc(cue_count * sizeof(cue));
+  if (!cues) {
+    perror("malloc");
+    free(sheet);
+    return NULL;
+  }
+
+  memset(cues, 0, cue_count * sizeof(cue));
+  sheet->cues = cues;
+  return sheet;
+}
+
+// Check that a cue is valid and comes after the previous cue.
+static int validate_cue(const cue *cues, int index) {
+  const cue *c = &cues[index];
+  if (!isfinite(c->start_time) || c->start_time < 0 ||
+      (index > 0 && c->start_time < cues[index - 1].start_time)) {
+    fprintf(stderr, "cue %d starts at %.3f, before the previous cue\n", index,
+            c->start_time);
+    return -1;
+  }
+
+  if (c->param_count < 0 || c->param_count > c->effect->param_count) {
+    fprintf(stderr, "cue %d has %d parameters, but %s takes %d\n", index,
+            c->param_count, c->effect->name, c->effect->param_count);
+    return -1;
+  }
+
+  for (int i = 0; i < c->param_count; i++) {
+    if (!isfinite(c->params[i]) || c->params[i] < c->effect->param_min ||
+        c->params[i] > c->effect->param_max) {
+      fprintf(stderr, "cue %d parameter %d is not between %g and %g\n", index,
+              i, c->effect->param_min, c->effect->param_max);
+      return -1;
+    }
+  }
+
+  return 0;
+}
+
+// Parse a decimal number. strtod() alone also takes hex floats, inf and nan,
+// none of which belong in a cue sheet.
+static int parse_number(const char *text, double *value, char **end) {
+  *end = (char *)text;
+  const char *digits = text + (*text == '+' || *text == '-');
+  if (!isdigit((unsigned char)*digits) && *digits != '.') {
+    return -1;
+  }
+
+  if (digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X')) {
+    return -1;
+  }
+
+  *value = strtod(text, end);
+  return *end == text || !isfinite(*value) ? -1 : 0;
+}
+
+// Parse a time in seconds or [hh:]mm:ss.sss.
+static int parse_time(const char *token, double *time) {
+  char *end = NULL;
+  double value = 0;
+  if (parse_number(token, &value, &end)) {
+    return -1;
+  }
+
+  while (*end == ':') {
+    double part = 0;
+    if (parse_number(end + 1, &part, &end)) {
+      return -1;
+    }
+    value = value * 60 + part;
+  }
+
+  if (*end != '\0' || !isfinite(value)) {
+    return -1;
+  }
+
+  *time = value;
+  return 0;
+}
+
+// Split off the next whitespace-separated token. Returns NULL if there are no
+// tokens left.
+static char *next_token(char **line) {
+  char *token = *line;
+  while (isspace((unsigned char)*token)) {
+    token++;
+  }
+
+  if (*token == '\0') {
+    return NULL;
+  }
+
+  char *end = token;
+  while (*end != '\0' && !isspace((unsigned char)*end)) {
+    end++;
+  }
+
+  if (*end != '\0') {
+    *end++ = '\0';
+  }
+
+  *line = end;
+  return token;
+}
+
+static int parse_line(cue_sheet *sheet, cue *cues, char *line,
+                      int line_number) {
+  // Strip comments.
+  char *comment = strchr(line, '#');
+  if (comment) {
+    *comment = '\0';
+  }
+
+  char *token = next_token(&line);
+  if (!token) {
+    return 0;
+  }
+
+  if (strcmp(token, "title") == 0) {
+    while (isspace((unsigned char)*line)) {
+      line++;
+    }
+
+    size_t len = strlen(line);
+    while (len > 0 && isspace((unsigned char)line[len - 1])) {
+      len--;
+    }
+
+    if (len >= CUE_SHEET_TITLE_SIZE) {
+      len = CUE_SHEET_TITLE_SIZE - 1;
+    }
+
+    memcpy(sheet->title, line, len);
+    sheet->title[len] = '\0';
+    return 0;
+  }
+
+  cue *c = &cues[sheet->cue_count];
+  if (parse_time(token, &c->start_time)) {
+    fprintf(stderr, "line %d: invalid time '%s'\n", line_number, token);
+    return -1;
+  }
+
+  token = next_token(&line);
+  if (!token) {
+    fprintf(stderr, "line %d: missing effect\n", line_number);
+    return -1;
+  }
+
+  // The effect can be followed by the curve that eases it.
+  char *easing = strchr(token, ':');
+  if (easing) {
+    *easing++ = '\0';
+    if (easing_parse(easing, &c->easing)) {
+      fprintf(stderr, "line %d: unknown easing '%s'\n", line_number, easing);
+      return -1;
+    }
+  }
+
+  c->effect = animation_effect_find(token);
+  if (!c->effect) {
+    fprintf(stderr, "line %d: unknown effect '%s'\n", line_number, token);
+    return -1;
+  }
+
+  while ((token = next_token(&line))) {
+    if (c->param_count == ANIMATION_EFFECT_MAX_PARAMS) {
+      fprintf(stderr, "line %d: too many parameters\n", line_number);
+      return -1;
+    }
+
+    char *end = NULL;
+    if (parse_number(token, &c->params[c->param_count++], &end) ||
+        *end != '\0') {
+      fprintf(stderr, "line %d: invalid parameter '%s'\n", line_number, token);
+      return -1;
+    }
+  }
+
+  if (validate_cue(cues, sheet->cue_count)) {
+    fprintf(stderr, "line %d: invalid cue\n", line_number);
+    return -1;
+  }
+
+  sheet->cue_count++;
+  return 0;
+}
+
+cue_sheet *cue_sheet_parse(const char *text, size_t size) {
+  if (!text) {
+    fprintf(stderr, "text is null\n");
+    return NULL;
+  }
+
+  // There can't be more cues than lines.
+  int line_count = 1;
+  for (size_t i = 0; i < size; i++) {
+    line_count += text[i] == '\n';
+  }
+
+  cue_sheet *sheet = cue_sheet_alloc(line_count);
+  if (!sheet) {
+    fprintf(stderr, "cue_sheet_alloc() failed\n");
+    return NULL;
+  }
+
+  cue *cues = (cue *)sheet->cues;
+  const char *ptr = text;
+  const char *end = text + size;
+  for (int line_number = 1; ptr < end; line_number++) {
+    const char *newline = memchr(ptr, '\n', end - ptr);
+    const size_t len = (newline ? newline : end) - ptr;
+    if (len >= CUE_SHEET_MAX_LINE_LENGTH) {
+      fprintf(stderr, "line %d is too long\n", line_number);
+      cue_sheet_free(sheet);
+      return NULL;
+    }
+
+    char line[CUE_SHEET_MAX_LINE_LENGTH] = {0};
+    memcpy(line, ptr, len);
+    if (parse_line(sheet, cues, line, line_number)) {
+      cue_sheet_free(sheet);
+      return NULL;
+    }
+
+    ptr += len + 1;
+  }
+
+  if (sheet->cue_count == 0) {
+    fprintf(stderr, "cue sheet has no cues\n");
+    cue_sheet_free(sheet);
+    return NULL;
+  }
+
+  return sheet;
+}
+
+static cue_sheet *load_binary(const uint8_t *data, size_t size) {
+  cue_sheet_binary_header header = {0};
+  if (size < sizeof(header)) {
+    fprintf(stderr, "binary cue sheet is truncated\n");
+    return NULL;
+  }
+
+  memcpy(&header, data, sizeof(header));
+  if (header.version != CUE_SHEET_BINARY_VERSION) {
+    fprintf(stderr, "binary cue sheet version (%u) is not supported\n",
+            header.version);
+    return NULL;
+  }
+
+  const size_t names_size =
+      (size_t)header.effect_count * CUE_SHEET_EFFECT_NAME_SIZE;
+  const size_t cues_size =
+      (size_t)header.cue_count * sizeof(cue_sheet_binary_cue);
+  if (header.cue_count == 0 || header.cue_count > INT_MAX ||
+      header.effect_count == 0 ||
+      header.effect_count > CUE_SHEET_MAX_EFFECTS ||
+      size != sizeof(header) + names_size + cues_size) {
+    fprintf(stderr, "binary cue sheet size (%zu) is invalid\n", size);
+    return NULL;
+  }
+
+  // Resolve the effect names once rather than once per cue.
+  const animation_effect *effects[CUE_SHEET_MAX_EFFECTS] = {0};
+  const char *names = (const char *)data + sizeof(header);
+  for (uint32_t i = 0; i < header.effect_count; i++) {
+    char name[CUE_SHEET_EFFECT_NAME_SIZE] = {0};
+    memcpy(name, names + i * CUE_SHEET_EFFECT_NAME_SIZE, sizeof(name) - 1);
+    effects[i] = animation_effect_find(name);
+    if (!effects[i]) {
+      fprintf(stderr, "unknown effect '%s'\n", name);
+      return NULL;
+    }
+  }
+
+  cue_sheet *sheet = cue_sheet_alloc(header.cue_count);
+  if (!sheet) {
+    fprintf(stderr, "cue_sheet_alloc() failed\n");
+    return NULL;
+  }
+
+  memcpy(sheet->title, header.title, sizeof(sheet->title) - 1);
+
+  cue *cues = (cue *)sheet->cues;
+  const uint8_t *records = data + sizeof(header) + names_size;
+  for (uint32_t i = 0; i < header.cue_count; i++) {
+    cue_sheet_binary_cue record = {0};
+    memcpy(&record, records + i * sizeof(record), sizeof(record));
+    if (record.effect >= header.effect_count ||
+        record.param_count > ANIMATION_EFFECT_MAX_PARAMS ||
+        record.easing >= EASING_CURVE_COUNT) {
+      fprintf(stderr, "cue %u is invalid\n", i);
+      cue_sheet_free(sheet);
+      return NULL;
+    }
+
+    cues[i].start_time = record.start_time;
+    cues[i].effect = effects[record.effect];
+    cues[i].param_count = record.param_count;
+    memcpy(cues[i].params, record.params, sizeof(cues[i].params));
+    cues[i].easing = record.easing;
+
+    if (validate_cue(cues, i)) {
+      cue_sheet_free(sheet);
+      return NULL;
+    }
+  }
+
+  sheet->cue_count = header.cue_count;
+  return sheet;
+}
+
+cue_sheet *cue_sheet_load(const char *path) {
+  if (!path) {
+    fprintf(stderr, "path is null\n");
+    return NULL;
+  }
+
+  const int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    perror("open");
+    return NULL;
+  }
+
+  struct stat st = {0};
+  if (fstat(fd, &st)) {
+    perror("fstat");
+    close(fd);
+    return NULL;
+  }
+
+  if (st.st_size == 0) {
+    fprintf(stderr, "%s is empty\n", path);
+    close(fd);
+    return NULL;
+  }
+
+  const size_t size = st.st_size;
+  void *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    perror("mmap");
+    return NULL;
+  }
+
+  cue_sheet *sheet = NULL;
+  if (size >= CUE_SHEET_BINARY_MAGIC_SIZE &&
+      memcmp(data, CUE_SHEET_BINARY_MAGIC, CUE_SHEET_BINARY_MAGIC_SIZE) == 0) {
+    sheet = load_binary(data, size);
+  } else {
+    sheet = cue_sheet_parse(data, size);
+  }
+
+  munmap(data, size);
+
+  if (!sheet) {
+    fprintf(stderr, "failed to load %s\n", path);
+    return NULL;
+  }
+
+  // Default to the file name if the cue sheet has no title.
+  if (sheet->title[0] == '\0') {
+    const char *name = strrchr(path, '/');
+    name = name ? name + 1 : path;
+    snprintf(sheet->title, sizeof(sheet->title), "%s", name);
+  }
+
+  return sheet;
+}
+
+// Find an effect among the first count effects. Returns count if it isn't one
+// of them.
+static uint32_t find_effect(const animation_effect *const *effects,
+                            uint32_t count, const animation_effect *effect) {
+  uint32_t i = 0;
+  while (i < count && effects[i] != effect) {
+    i++;
+  }
+  return i;
+}
+
+int cue_sheet_save_binary(const cue_sheet *sheet, const char *path) {
+  if (!sheet || !path) {
+    fprintf(stderr, "sheet or path is null\n");
+    return -1;
+  }
+
+  if (sheet->cue_count <= 0) {
+    fprintf(stderr, "cue sheet has no cues\n");
+    return -1;
+  }
+
+  // Collect the distinct effects the cues use.
+  const animation_effect *effects[CUE_SHEET_MAX_EFFECTS] = {0};
+  uint32_t effect_count = 0;
+  for (int i = 0; i < sheet->cue_count; i++) {
+    const uint32_t j =
+        find_effect(effects, effect_count, sheet->cues[i].effect);
+    if (j < effect_count) {
+      continue;
+    }
+
+    if (effect_count == CUE_SHEET_MAX_EFFECTS) {
+      fprintf(stderr, "cue sheet uses more than %d effects\n",
+              CUE_SHEET_MAX_EFFECTS);
+      return -1;
+    }
+    effects[effect_count++] = sheet->cues[i].effect;
+  }
+
+  FILE *file = fopen(path, "wb");
+  if (!file) {
+    perror("fopen");
+    return -1;
+  }
+
+  cue_sheet_binary_header header = {0};
+  memcpy(header.magic, CUE_SHEET_BINARY_MAGIC, CUE_SHEET_BINARY_MAGIC_SIZE);
+  header.version = CUE_SHEET_BINARY_VERSION;
+  header.cue_count = sheet->cue_count;
+  header.effect_count = effect_count;
+  memcpy(header.title, sheet->title, sizeof(header.title));
+
+  int ret = fwrite(&header, sizeof(header), 1, file) == 1 ? 0 : -1;
+
+  for (uint32_t i = 0; !ret && i < effect_count; i++) {
+    char name[CUE_SHEET_EFFECT_NAME_SIZE] = {0};
+    snprintf(name, sizeof(name), "%s", effects[i]->name);
+    ret = fwrite(name, sizeof(name), 1, file) == 1 ? 0 : -1;
+  }
+
+  for (int i = 0; !ret && i < sheet->cue_count; i++) {
+    cue_sheet_binary_cue record = {0};
+    record.start_time = sheet->cues[i].start_time;
+    record.effect = find_effect(effects, effect_count, sheet->cues[i].effect);
+    record.param_count = sheet->cues[i].param_count;
+    memcpy(record.params, sheet->cues[i].params, sizeof(record.params));
+    record.easing = sheet->cues[i].easing;
+    ret = fwrite(&record, sizeof(record), 1, file) == 1 ? 0 : -1;
+  }
+
+  if (ret) {
+    perror("fwrite");
+  }
+
+  if (fclose(file)) {
+    perror("fclose");
+    ret = -1;
+  }
+
+  return ret;
+}
+
+// Whether cue index is active at time. The last cue only marks the end.
+static bool cue_active(const cue_sheet *sheet, int index, double time) {
+  return index >= 0 && index < sheet->cue_count - 1 &&
+         sheet->cues[index].start_time <= time &&
+         time < sheet->cues[index + 1].start_time;
+}
+
+int cue_sheet_find(const cue_sheet *sheet, double time, int *cursor) {
+  // Normal playback stays in the current cue or moves to the next one.
+  if (cue_active(sheet, *cursor, time)) {
+    return *cursor;
+  }
+
+  if (cue_active(sheet, *cursor + 1, time)) {
+    return ++*cursor;
+  }
+
+  // Find the last cue that starts at or before the time.
+  int low = 0;
+  int high = sheet->cue_count;
+  while (low < high) {
+    const int mid = low + (high - low) / 2;
+    if (sheet->cues[mid].start_time <= time) {
+      low = mid + 1;
+    } else {
+      high = mid;
+    }
+  }
+
+  const int index = low - 1;
+  if (!cue_active(sheet, index, time)) {
+    return -1;
+  }
+
+  *cursor = index;
+  return index;
+}
+
+void cue_sheet_free(cue_sheet *sheet) {
+  if (sheet) {
+    free((void *)sheet->cues);
+    free(sheet);
+  }
+}
@@ -0,0 +1,137 @@
+#include "easing.h"
+
+#include <math.h> // cos, exp2
+#include <pthread.h>
+#include <stddef.h> // size_t
+#include <string.h> // strcmp
+
+// The sine and exponential are sampled at TABLE_SIZE + 1 evenly spaced points,
+// and a point is found from the top TABLE_BITS bits of the progress. They bend
+// most around the middle of the exponential, where the interpolation is off by
+// less than 0.2 of the smallest step of a 16-bit value.
+#define TABLE_BITS 11
+#define TABLE_SIZE (1 << TABLE_BITS)
+#define FRACTION_SHIFT (EASING_FRACTION_BITS - TABLE_BITS)
+#define FRACTION_MASK ((1U << FRACTION_SHIFT) - 1)
+
+#define PI 3.14159265358979323846
+
+// The exponential rises from 2^-EXPONENTIAL_RANGE to 1 over each half.
+#define EXPONENTIAL_RANGE 10
+
+static const char *const curve_names[EASING_CURVE_COUNT] = {
+    [EASING_QUADRATIC] = "quadratic",
+    [EASING_CUBIC] = "cubic",
+    [EASING_SINE] = "sine",
+    [EASING_EXPONENTIAL] = "exponential",
+    [EASING_STEP] = "step",
+};
+
+// Only the sine and exponential are filled in.
+static uint32_t tables[EASING_CURVE_COUNT][TABLE_SIZE + 1];
+static pthread_once_t tables_once = PTHREAD_ONCE_INIT;
+
+int easing_parse(const char *name, easing_curve *curve) {
+  for (int i = 0; name && i < EASING_CURVE_COUNT; i++) {
+    if (!strcmp(name, curve_names[i])) {
+      *curve = i;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+const char *easing_name(easing_curve curve) {
+  return curve >= 0 && curve < EASING_CURVE_COUNT ? curve_names[curve]
+                                                  : "quadratic";
+}
+
+// The first half of the exponential, scaled so it starts at 0 and meets the
+// second half at 0.5 without a jump.
+static double exponential_half(double progress) {
+  const double lowest = exp2(-EXPONENTIAL_RANGE);
+  return (exp2(EXPONENTIAL_RANGE * (2 * progress - 1)) - lowest) /
+         (2 * (1 - lowest));
+}
+
+double easing_reference(easing_curve curve, double progress) {
+  switch (curve) {
+  case EASING_CUBIC:
+    return progress < 0.5 ? 4 * progress * progress * progress
+                          : 1 - 4 * (1 - progress) * (1 - progress) *
+                                    (1 - progress);
+  case EASING_SINE:
+    return (1 - cos(PI * progress)) / 2;
+  case EASING_EXPONENTIAL:
+    return progress < 0.5 ? exponential_half(progress)
+                          : 1 - exponential_half(1 - progress);
+  case EASING_STEP:
+    return progress < 0.5 ? 0 : 1;
+  case EASING_QUADRATIC:
+  default:
+    if (progress < 0.5) {
+      return 2 * progress * progress;
+    } else {
+      return -1 + 2 * progress * (2 - progress);
+    }
+  }
+}
+
+static void init_tables(void) {
+  static const easing_curve tabled[] = {EASING_SINE, EASING_EXPONENTIAL};
+  for (size_t j = 0; j < sizeof(tabled) / sizeof(tabled[0]); j++) {
+    const easing_curve curve = tabled[j];
+    for (int i = 0; i <= TABLE_SIZE; i++) {
+      const double eased = easing_reference(curve, (double)i / TABLE_SIZE);
+      tables[curve][i] = (uint32_t)(eased * EASING_ONE + 0.5);
+    }
+  }
+}
+
+uint32_t easing_progress(double progress) {
+  if (!(progress > 0)) {
+    return 0;
+  }
+  return progress < 1 ? (uint32_t)(progress * EASING_ONE) : EASING_ONE;
+}
+
+// Multiply two fixed-point values.
+static uint64_t multiply(uint64_t a, uint64_t b) {
+  return (a * b) >> EASING_FRACTION_BITS;
+}
+
+// The first half of the quadratic, 2p^2, and of the cubic, 4p^3, for p below
+// one half. The second half mirrors the first.
+static uint32_t polynomial_half(easing_curve curve, uint32_t progress) {
+  const uint64_t square = multiply(progress, progress);
+  return curve == EASING_CUBIC ? (uint32_t)(4 * multiply(square, progress))
+                               : (uint32_t)(2 * square);
+}
+
+uint32_t easing_apply(easing_curve curve, uint32_t progress) {
+  if (curve < 0 || curve >= EASING_CURVE_COUNT) {
+    curve = EASING_QUADRATIC;
+  }
+
+  // The step has nothing to interpolate.
+  if (curve == EASING_STEP) {
+    return progress < EASING_ONE / 2 ? 0 : EASING_ONE;
+  }
+
+  if (progress >= EASING_ONE) {
+    return EASING_ONE;
+  }
+
+  if (curve == EASING_QUADRATIC || curve == EASING_CUBIC) {
+    return progress < EASING_ONE / 2
+               ? polynomial_half(curve, progress)
+               : EASING_ONE - polynomial_half(curve, EASING_ONE - progress);
+  }
+
+  pthread_once(&tables_once, init_tables);
+
+  const uint32_t *table = tables[curve];
+  const uint32_t index = progress >> FRACTION_SHIFT;
+  const int64_t rise = (int64_t)table[index + 1] - table[index];
+  return table[index] + ((rise * (progress & FRACTION_MASK)) >> FRACTION_SHIFT);
+}
@@ -0,0 +1,299 @@
+#include "entertainment_cache.h"
+
+#include <errno.h>    // errno, EEXIST
+#include <stdio.h>    // fprintf, perror, fopen, fgets, rename, snprintf
+#include <stdlib.h>   // getenv
+#include <string.h>   // memset, strcspn, strlen, strncmp
+#include <sys/stat.h> // mkdir, stat
+#include <time.h>     // time
+
+#define CACHE_DIRECTORY "resonate"
+#define MAX_LINE_SIZE 256
+
+// Create a directory unless it already exists.
+static int make_directory(const char *path) {
+  if (mkdir(path, 0755) && errno != EEXIST) {
+    perror("mkdir");
+    return -1;
+  }
+  return 0;
+}
+
+// Get the cache directory, creating it on the way if create is set.
+static int cache_directory(char *path, size_t size, bool create) {
+  const char *xdg_cache_home = getenv("XDG_CACHE_HOME");
+  const char *home = getenv("HOME");
+  int length = 0;
+  if (xdg_cache_home && *xdg_cache_home) {
+    length = snprintf(path, size, "%s", xdg_cache_home);
+  } else if (home && *home) {
+    length = snprintf(path, size, "%s/.cache", home);
+  } else {
+    fprintf(stderr, "Neither XDG_CACHE_HOME nor HOME is set\n");
+    return -1;
+  }
+
+  if (length < 0 || (size_t)length >= size) {
+    fprintf(stderr, "cache directory path is too long\n");
+    return -1;
+  }
+
+  if (create && make_directory(path)) {
+    return -1;
+  }
+
+  length += snprintf(path + length, size - length, "/" CACHE_DIRECTORY);
+  if ((size_t)length >= size) {
+    fprintf(stderr, "cache directory path is too long\n");
+    return -1;
+  }
+
+  return create ? make_directory(path) : 0;
+}
+
+static int cache_file(const char *bridge_ip, char *path, size_t size,
+                      bool create) {
+  if (!bridge_ip || !path) {
+    fprintf(stderr, "bridge_ip or path is null\n");
+    return -1;
+  }
+
+  if (cache_directory(path, size, create)) {
+    return -1;
+  }
+
+  const size_t directory_length = strlen(path);
+  const int length =
+      snprintf(path + directory_length, size - directory_length,
+               "/entertainment-%s.txt", bridge_ip);
+  if (length < 0 || (size_t)length >= size - directory_length) {
+    fprintf(stderr, "cache file path is too long\n");
+    return -1;
+  }
+
+  // Keep the bridge address from escaping the cache directory.
+  for (char *c = path + directory_length + 1; *c; c++) {
+    if (*c == '/') {
+      *c = '_';
+    }
+  }
+
+  return 0;
+}
+
+int entertainment_cache_path(const char *bridge_ip, char *path, size_t size) {
+  return cache_file(bridge_ip, path, size, false);
+}
+
+// Parse one line of a cache file into the areas read so far. An area line
+// records how many channel lines should follow it in expected_channels.
+static int parse_line(const char *line, hue_entertainment_config *configs,
+                      int *config_count, int max_configs,
+                      int *expected_channels) {
+  int length = 0;
+  if (line[0] == '#' || line[0] == '\0') {
+    return 0;
+  }
+
+  if (!strncmp(line, "area ", 5)) {
+    if (*config_count >= max_configs ||
+        *config_count >= HUE_REST_MAX_ENTERTAINMENT_CONFIGS) {
+      return -1;
+    }
+
+    hue_entertainment_config *config = &configs[(*config_count)++];
+    memset(config, 0, sizeof(hue_entertainment_config));
+    int channel_count = 0;
+    if (sscanf(line, "area %36s %d %n", config->id, &channel_count,
+               &length) != 2 ||
+        strlen(config->id) !=
+            HUE_STREAM_MESSAGE_ENTERTAINMENT_CONFIG_ID_SIZE ||
+        !hue_stream_message_valid_channel_count(channel_count)) {
+      return -1;
+    }
+
+    snprintf(config->name, sizeof(config->name), "%s", line + length);
+    expected_channels[*config_count - 1] = channel_count;
+    return 0;
+  }
+
+  if (!strncmp(line, "channel ", 8)) {
+    if (*config_count == 0) {
+      return -1;
+    }
+
+    hue_entertainment_config *config = &configs[*config_count - 1];
+    if (config->channel_count >= HUE_STREAM_MESSAGE_MAX_CHANNELS) {
+      return -1;
+    }
+
+    // Caches written before gamuts were looked up end at the position.
+    hue_entertainment_channel channel = {0};
+    unsigned int channel_id = 0;
+    char gamut[8] = {0};
+    int gamut_length = 0;
+    if (sscanf(line, "channel %u %lf %lf %lf %n", &channel_id, &channel.x,
+               &channel.y, &channel.z, &length) != 4 ||
+        channel_id > UINT8_MAX) {
+      return -1;
+    }
+
+    channel.gamut = GAMUT_DEFAULT;
+    if (line[length] != '\0' &&
+        (sscanf(line + length, "%7s %n", gamut, &gamut_length) != 1 ||
+         line[length + gamut_length] != '\0' ||
+         gamut_parse(gamut, &channel.gamut))) {
+      return -1;
+    }
+
+    channel.channel_id = channel_id;
+    config->channels[config->channel_count++] = channel;
+    return 0;
+  }
+
+  return -1;
+}
+
+int entertainment_cache_load(const char *bridge_ip, int max_age_seconds,
+                             hue_entertainment_config *configs,
+                             int max_configs) {
+  if (!bridge_ip || !configs) {
+    fprintf(stderr, "bridge_ip or configs is null\n");
+    return -1;
+  }
+
+  char path[512] = {0};
+  if (entertainment_cache_path(bridge_ip, path, sizeof(path))) {
+    return -1;
+  }
+
+  struct stat status = {0};
+  if (stat(path, &status)) {
+    return 0;
+  }
+
+  if (time(NULL) - status.st_mtime > max_age_seconds) {
+    return 0;
+  }
+
+  FILE *file = fopen(path, "r");
+  if (!file) {
+    return 0;
+  }
+
+  int config_count = 0;
+  int expected_channels[HUE_REST_MAX_ENTERTAINMENT_CONFIGS] = {0};
+  char line[MAX_LINE_SIZE] = {0};
+  for (int line_number = 1; fgets(line, sizeof(line), file); line_number++) {
+    line[strcspn(line, "\r\n")] = '\0';
+
+    if (parse_line(line, configs, &config_count, max_configs,
+                   expected_channels)) {
+      fprintf(stderr, "%s: line %d is invalid, ignoring the cache\n", path,
+              line_number);
+      config_count = 0;
+      break;
+    }
+  }
+  fclose(file);
+
+  for (int i = 0; i < config_count; i++) {
+    if (configs[i].channel_count != expected_channels[i]) {
+      fprintf(stderr, "%s is incomplete, ignoring the cache\n", path);
+      return 0;
+    }
+  }
+
+  return config_count;
+}
+
+int entertainment_cache_save(const char *bridge_ip,
+                             const hue_entertainment_config *configs,
+                             int config_count) {
+  if (!bridge_ip || !configs) {
+    fprintf(stderr, "bridge_ip or configs is null\n");
+    return -1;
+  }
+
+  char path[512] = {0};
+  if (cache_file(bridge_ip, path, sizeof(path), true)) {
+    return -1;
+  }
+
+  char temporary_path[520] = {0};
+  snprintf(temporary_path, sizeof(temporary_path), "%s.tmp", path);
+
+  FILE *file = fopen(temporary_path, "w");
+  if (!file) {
+    perror("fopen");
+    return -1;
+  }
+
+  fprintf(file, "# Entertainment areas of %s, cached by resonate.\n",
+          bridge_ip);
+  for (int i = 0; i < config_count; i++) {
+    const hue_entertainment_config *config = &configs[i];
+    // Names are free text, but a line break would end the line.
+    char name[HUE_REST_ENTERTAINMENT_CONFIG_NAME_SIZE] = {0};
+    snprintf(name, sizeof(name), "%s", config->name);
+    for (char *c = name; *c; c++) {
+      if (*c == '\n' || *c == '\r') {
+        *c = ' ';
+      }
+    }
+
+    fprintf(file, "area %s %d %s\n", config->id, config->channel_count, name);
+    for (int j = 0; j < config->channel_count; j++) {
+      const hue_entertainment_channel *channel = &config->channels[j];
+      fprintf(file, "channel %u %.9g %.9g %.9g %s\n", channel->channel_id,
+              channel->x, channel->y, channel->z, gamut_name(channel->gamut));
+    }
+  }
+
+  if (fclose(file)) {
+    perror("fclose");
+    remove(temporary_path);
+    return -1;
+  }
+
+  if (rename(temporary_path, path)) {
+    perror("rename");
+    remove(temporary_path);
+    return -1;
+  }
+
+  return 0;
+}
+
+int entertainment_cache_discover(hue_rest_client *client,
+                                 const char *bridge_ip, bool refresh,
+                                 hue_entertainment_config *configs,
+                                 int max_configs) {
+  if (!client || !bridge_ip || !configs) {
+    fprintf(stderr, "client, bridge_ip or configs is null\n");
+    return -1;
+  }
+
+  if (!refresh) {
+    const int config_count = entertainment_cache_load(
+        bridge_ip, ENTERTAINMENT_CACHE_MAX_AGE_SECONDS, configs, max_configs);
+    if (config_count != 0) {
+      return config_count;
+    }
+  }
+
+  const int config_count = hue_rest_client_get_entertainment_configurations(
+      client, bridge_ip, configs, max_configs);
+  if (config_count < 0) {
+    fprintf(stderr,
+            "hue_rest_client_get_entertainment_configurations() failed\n");
+    return -1;
+  }
+
+  // A stale cache only costs a round trip on the next start.
+  if (entertainment_cache_save(bridge_ip, configs, config_count)) {
+    fprintf(stderr, "entertainment_cache_save() failed\n");
+  }
+
+  return config_count;
+}
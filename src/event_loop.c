@@ -0,0 +1,219 @@
+#include "event_loop.h"
+
+#include <stdio.h>  // fprintf, perror, printf
+#include <string.h> // memset
+#include <time.h>   // clock_gettime
+
+#ifdef __linux__
+#include <errno.h>        // EINTR
+#include <pthread.h>      // pthread_sigmask
+#include <sys/epoll.h>    // epoll_create1, epoll_ctl, epoll_wait
+#include <sys/signalfd.h> // signalfd
+#include <sys/timerfd.h>  // timerfd_create, timerfd_settime
+#include <unistd.h>       // close, read
+#endif
+
+#define NANOSECONDS_PER_SECOND 1000000000L
+
+// At most the timer, the signals and the input are ready at once.
+#define MAX_EVENTS 3
+
+static uint64_t now_ns(void) {
+  struct timespec now = {0};
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * NANOSECONDS_PER_SECOND + now.tv_nsec;
+}
+
+#ifdef __linux__
+
+bool event_loop_supported(void) { return true; }
+
+static int watch(int epoll, int fd) {
+  struct epoll_event event = {.events = EPOLLIN, .data.fd = fd};
+  if (epoll_ctl(epoll, EPOLL_CTL_ADD, fd, &event)) {
+    perror("epoll_ctl");
+    return -1;
+  }
+  return 0;
+}
+
+int event_loop_init(event_loop *loop, int frames_per_second, int input,
+                    const sigset_t *signals) {
+  if (!loop || !signals) {
+    fprintf(stderr, "loop or signals is null\n");
+    return -1;
+  }
+
+  if (frames_per_second <= 0) {
+    fprintf(stderr, "frames_per_second (%d) must be positive\n",
+            frames_per_second);
+    return -1;
+  }
+
+  memset(loop, 0, sizeof(event_loop));
+  loop->epoll = -1;
+  loop->timer = -1;
+  loop->signals = -1;
+  loop->input = input;
+  loop->period_ns = NANOSECONDS_PER_SECOND / frames_per_second;
+
+  // Signals have to be blocked to be read from a signalfd.
+  if (pthread_sigmask(SIG_BLOCK, signals, &loop->previous_mask)) {
+    fprintf(stderr, "pthread_sigmask() failed\n");
+    return -1;
+  }
+
+  loop->epoll = epoll_create1(EPOLL_CLOEXEC);
+  if (loop->epoll < 0) {
+    perror("epoll_create1");
+    goto error;
+  }
+
+  loop->signals = signalfd(-1, signals, SFD_NONBLOCK | SFD_CLOEXEC);
+  if (loop->signals < 0) {
+    perror("signalfd");
+    goto error;
+  }
+
+  loop->timer = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+  if (loop->timer < 0) {
+    perror("timerfd_create");
+    goto error;
+  }
+
+  if (watch(loop->epoll, loop->timer) || watch(loop->epoll, loop->signals) ||
+      (input >= 0 && watch(loop->epoll, input))) {
+    goto error;
+  }
+
+  const struct timespec period = {
+      .tv_sec = loop->period_ns / NANOSECONDS_PER_SECOND,
+      .tv_nsec = loop->period_ns % NANOSECONDS_PER_SECOND};
+  const struct itimerspec timer = {.it_interval = period, .it_value = period};
+  loop->start_ns = now_ns();
+  if (timerfd_settime(loop->timer, 0, &timer, NULL)) {
+    perror("timerfd_settime");
+    goto error;
+  }
+
+  return 0;
+
+error:
+  event_loop_close(loop);
+  return -1;
+}
+
+// Count the frames that came due since the last one.
+static int read_timer(event_loop *loop) {
+  uint64_t expirations = 0;
+  if (read(loop->timer, &expirations, sizeof(expirations)) !=
+      sizeof(expirations)) {
+    perror("read");
+    return -1;
+  }
+
+  loop->expirations += expirations;
+  loop->deadline_ns = loop->start_ns + loop->expirations * loop->period_ns;
+  loop->frames++;
+  if (expirations > 1) {
+    loop->deadline_misses++;
+    loop->frames_skipped += expirations - 1;
+  }
+  return 0;
+}
+
+event_loop_event event_loop_wait(event_loop *loop, int *signal) {
+  if (!loop || !signal) {
+    fprintf(stderr, "loop or signal is null\n");
+    return EVENT_LOOP_ERROR;
+  }
+
+  struct epoll_event events[MAX_EVENTS];
+  int count = 0;
+  do {
+    count = epoll_wait(loop->epoll, events, MAX_EVENTS, -1);
+  } while (count < 0 && errno == EINTR);
+
+  if (count < 0) {
+    perror("epoll_wait");
+    return EVENT_LOOP_ERROR;
+  }
+
+  // Everything is level-triggered, so whatever isn't handled now is reported
+  // again by the next wait.
+  for (int i = 0; i < count; i++) {
+    if (events[i].data.fd == loop->timer) {
+      return read_timer(loop) ? EVENT_LOOP_ERROR : EVENT_LOOP_FRAME;
+    }
+  }
+
+  if (events[0].data.fd == loop->signals) {
+    struct signalfd_siginfo info = {0};
+    if (read(loop->signals, &info, sizeof(info)) != sizeof(info)) {
+      perror("read");
+      return EVENT_LOOP_ERROR;
+    }
+    *signal = info.ssi_signo;
+    return EVENT_LOOP_SIGNAL;
+  }
+
+  return EVENT_LOOP_INPUT;
+}
+
+void event_loop_close(event_loop *loop) {
+  if (!loop) {
+    return;
+  }
+
+  if (loop->timer >= 0) {
+    close(loop->timer);
+  }
+  if (loop->signals >= 0) {
+    close(loop->signals);
+  }
+  if (loop->epoll >= 0) {
+    close(loop->epoll);
+  }
+  loop->timer = loop->signals = loop->epoll = -1;
+  pthread_sigmask(SIG_SETMASK, &loop->previous_mask, NULL);
+}
+
+#else
+
+bool event_loop_supported(void) { return false; }
+
+int event_loop_init(event_loop *loop, int frames_per_second, int input,
+                    const sigset_t *signals) {
+  (void)loop;
+  (void)frames_per_second;
+  (void)input;
+  (void)signals;
+  fprintf(stderr, "The event loop needs timerfd and epoll\n");
+  return -1;
+}
+
+event_loop_event event_loop_wait(event_loop *loop, int *signal) {
+  (void)loop;
+  (void)signal;
+  return EVENT_LOOP_ERROR;
+}
+
+void event_loop_close(event_loop *loop) { (void)loop; }
+
+#endif
+
+void event_loop_print_stats(const event_loop *loop, const char *name) {
+  if (!loop) {
+    fprintf(stderr, "loop is null\n");
+    return;
+  }
+
+  const double elapsed_seconds = (now_ns() - loop->start_ns) / 1e9;
+  printf("%s: %llu frames in %.3f s (%.2f fps), %llu deadline misses, %llu "
+         "frames skipped\n",
+         name ? name : "event loop", (unsigned long long)loop->frames,
+         elapsed_seconds,
+         elapsed_seconds > 0 ? loop->frames / elapsed_seconds : 0.0,
+         (unsigned long long)loop->deadline_misses,
+         (unsigned long long)loop->frames_skipped);
+}
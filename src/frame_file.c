@@ -0,0 +1,212 @@
+#include "frame_file.h"
+
+#include "offline_renderer.h"
+#include <fcntl.h>    // open
+#include <limits.h>   // INT_MAX
+#include <stdio.h>    // fprintf, perror, fopen, fwrite, fseek, snprintf
+#include <stdlib.h>   // malloc, free
+#include <string.h>   // memcmp, memcpy, memset
+#include <sys/mman.h> // mmap, munmap, madvise
+#include <sys/stat.h> // fstat
+#include <unistd.h>   // close
+
+#define FRAME_FILE_MAGIC "RFRM"
+#define FRAME_FILE_MAGIC_SIZE 4
+#define FRAME_FILE_VERSION 1
+#define NANOSECONDS_PER_SECOND 1000000000L
+
+// A frame file is a header followed by frame_count frames of channel_count
+// serialized channels. Values are stored in host byte order.
+typedef struct frame_file_header frame_file_header;
+struct frame_file_header {
+  char magic[FRAME_FILE_MAGIC_SIZE];
+  uint32_t version;
+  uint32_t frames_per_second;
+  uint32_t channel_count;
+  uint32_t frame_count;
+  char title[FRAME_FILE_TITLE_SIZE];
+};
+
+static int write_frame(int frame_index, const hue_stream_message_data *frame,
+                       int channel_count, void *user_data) {
+  (void)frame_index;
+  FILE *file = user_data;
+
+  uint8_t channels[HUE_STREAM_MESSAGE_MAX_CHANNELS *
+                   HUE_STREAM_MESSAGE_CHANNEL_SIZE];
+  if (hue_stream_message_serialize_channels(frame, channel_count, channels)) {
+    fprintf(stderr, "hue_stream_message_serialize_channels() failed\n");
+    return -1;
+  }
+
+  if (fwrite(channels, HUE_STREAM_MESSAGE_CHANNEL_SIZE, channel_count, file) !=
+      (size_t)channel_count) {
+    perror("fwrite");
+    return -1;
+  }
+  return 0;
+}
+
+int frame_file_render(const cue_sheet *sheet, int channel_count,
+                      int frames_per_second, const char *path) {
+  if (!sheet || !path) {
+    fprintf(stderr, "sheet or path is null\n");
+    return -1;
+  }
+
+  FILE *file = fopen(path, "wb");
+  if (!file) {
+    perror("fopen");
+    return -1;
+  }
+
+  // The frame count is only known once the frames have been rendered, so the
+  // header is written again at the end.
+  frame_file_header header = {0};
+  memcpy(header.magic, FRAME_FILE_MAGIC, FRAME_FILE_MAGIC_SIZE);
+  header.version = FRAME_FILE_VERSION;
+  header.frames_per_second = frames_per_second;
+  header.channel_count = channel_count;
+  snprintf(header.title, sizeof(header.title), "%s", sheet->title);
+
+  int frames = -1;
+  if (fwrite(&header, sizeof(header), 1, file) != 1) {
+    perror("fwrite");
+    goto exit;
+  }
+
+  frames = offline_renderer_run(sheet, channel_count, frames_per_second,
+                                write_frame, file);
+  if (frames < 0) {
+    fprintf(stderr, "offline_renderer_run() failed\n");
+    goto exit;
+  }
+
+  header.frame_count = frames;
+  if (fseek(file, 0, SEEK_SET) ||
+      fwrite(&header, sizeof(header), 1, file) != 1) {
+    perror("fwrite");
+    frames = -1;
+  }
+
+exit:
+  if (fclose(file)) {
+    perror("fclose");
+    frames = -1;
+  }
+
+  return frames;
+}
+
+frame_file *frame_file_open(const char *path) {
+  if (!path) {
+    fprintf(stderr, "path is null\n");
+    return NULL;
+  }
+
+  const int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    perror("open");
+    return NULL;
+  }
+
+  struct stat st = {0};
+  if (fstat(fd, &st)) {
+    perror("fstat");
+    close(fd);
+    return NULL;
+  }
+
+  frame_file_header header = {0};
+  const size_t size = st.st_size;
+  if (size < sizeof(header)) {
+    fprintf(stderr, "%s is not a frame file\n", path);
+    close(fd);
+    return NULL;
+  }
+
+  void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    perror("mmap");
+    return NULL;
+  }
+
+  memcpy(&header, map, sizeof(header));
+  if (memcmp(header.magic, FRAME_FILE_MAGIC, FRAME_FILE_MAGIC_SIZE)) {
+    fprintf(stderr, "%s is not a frame file\n", path);
+    munmap(map, size);
+    return NULL;
+  }
+
+  if (header.version != FRAME_FILE_VERSION) {
+    fprintf(stderr, "frame file version (%u) is not supported\n",
+            header.version);
+    munmap(map, size);
+    return NULL;
+  }
+
+  const size_t frame_size =
+      (size_t)header.channel_count * HUE_STREAM_MESSAGE_CHANNEL_SIZE;
+  if (header.frames_per_second == 0 || header.frames_per_second > INT_MAX ||
+      header.channel_count == 0 ||
+      header.channel_count > HUE_STREAM_MESSAGE_MAX_CHANNELS ||
+      header.frame_count > INT_MAX ||
+      size != sizeof(header) + header.frame_count * frame_size) {
+    fprintf(stderr, "frame file size (%zu) is invalid\n", size);
+    munmap(map, size);
+    return NULL;
+  }
+
+  // Playback reads the file front to back.
+  if (madvise(map, size, MADV_SEQUENTIAL)) {
+    perror("madvise");
+  }
+
+  frame_file *file = malloc(sizeof(frame_file));
+  if (!file) {
+    perror("malloc");
+    munmap(map, size);
+    return NULL;
+  }
+
+  memset(file, 0, sizeof(frame_file));
+  memcpy(file->title, header.title, sizeof(file->title) - 1);
+  file->frames_per_second = header.frames_per_second;
+  file->channel_count = header.channel_count;
+  file->frame_count = header.frame_count;
+  file->frame_size = frame_size;
+  file->frames = (const uint8_t *)map + sizeof(header);
+  file->map = map;
+  file->map_size = size;
+  return file;
+}
+
+const uint8_t *frame_file_frame_at(const frame_file *file,
+                                   int64_t elapsed_ns) {
+  if (!file) {
+    return NULL;
+  }
+
+  // Before the start, as with a negative lookahead, the first frame holds.
+  if (elapsed_ns < 0) {
+    elapsed_ns = 0;
+  }
+
+  const int64_t index =
+      elapsed_ns * file->frames_per_second / NANOSECONDS_PER_SECOND;
+  if (index >= file->frame_count) {
+    return NULL;
+  }
+
+  return file->frames + index * file->frame_size;
+}
+
+void frame_file_close(frame_file *file) {
+  if (!file) {
+    return;
+  }
+
+  munmap(file->map, file->map_size);
+  free(file);
+}
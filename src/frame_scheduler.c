@@ -0,0 +1,185 @@
+#include "frame_scheduler.h"
+
+#include <errno.h>   // EINTR
+#include <stdbool.h> // true
+#include <stdio.h>   // fprintf, printf
+#include <string.h>  // memset
+
+#define NANOSECONDS_PER_SECOND 1000000000L
+
+static void timespec_add_ns(struct timespec *ts, long ns) {
+  ts->tv_sec += ns / NANOSECONDS_PER_SECOND;
+  ts->tv_nsec += ns % NANOSECONDS_PER_SECOND;
+  if (ts->tv_nsec >= NANOSECONDS_PER_SECOND) {
+    ts->tv_sec++;
+    ts->tv_nsec -= NANOSECONDS_PER_SECOND;
+  }
+}
+
+static int64_t timespec_diff_ns(const struct timespec *end,
+                                const struct timespec *start) {
+  return (int64_t)(end->tv_sec - start->tv_sec) * NANOSECONDS_PER_SECOND +
+         (end->tv_nsec - start->tv_nsec);
+}
+
+// Sleep until an absolute time on CLOCK_MONOTONIC.
+static int sleep_until(const struct timespec *deadline) {
+#ifdef TIMER_ABSTIME
+  int ret = 0;
+  do {
+    ret = clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, deadline, NULL);
+  } while (ret == EINTR);
+
+  if (ret) {
+    fprintf(stderr, "clock_nanosleep() failed: %d\n", ret);
+    return -1;
+  }
+#else
+  // clock_nanosleep() isn't available on macOS. Sleep for the time remaining
+  // until the deadline instead.
+  while (true) {
+    struct timespec now = {0};
+    if (clock_gettime(CLOCK_MONOTONIC, &now)) {
+      fprintf(stderr, "clock_gettime() failed\n");
+      return -1;
+    }
+
+    const int64_t remaining_ns = timespec_diff_ns(deadline, &now);
+    if (remaining_ns <= 0) {
+      break;
+    }
+
+    struct timespec ts = {.tv_sec = remaining_ns / NANOSECONDS_PER_SECOND,
+                          .tv_nsec = remaining_ns % NANOSECONDS_PER_SECOND};
+    if (!nanosleep(&ts, NULL)) {
+      break;
+    }
+
+    if (errno != EINTR) {
+      perror("nanosleep");
+      return -1;
+    }
+  }
+#endif
+
+  return 0;
+}
+
+int frame_scheduler_init(frame_scheduler *scheduler, int frames_per_second,
+                         frame_scheduler_overrun_policy overrun_policy) {
+  if (!scheduler) {
+    fprintf(stderr, "scheduler is null\n");
+    return -1;
+  }
+
+  if (frames_per_second <= 0) {
+    fprintf(stderr, "frames_per_second (%d) must be positive\n",
+            frames_per_second);
+    return -1;
+  }
+
+  return frame_scheduler_init_period(
+      scheduler, NANOSECONDS_PER_SECOND / frames_per_second, overrun_policy);
+}
+
+int frame_scheduler_init_period(frame_scheduler *scheduler, long period_ns,
+                                frame_scheduler_overrun_policy overrun_policy) {
+  if (!scheduler) {
+    fprintf(stderr, "scheduler is null\n");
+    return -1;
+  }
+
+  if (period_ns <= 0) {
+    fprintf(stderr, "period_ns (%ld) must be positive\n", period_ns);
+    return -1;
+  }
+
+  memset(scheduler, 0, sizeof(frame_scheduler));
+  scheduler->period_ns = period_ns;
+  scheduler->overrun_policy = overrun_policy;
+
+  if (clock_gettime(CLOCK_MONOTONIC, &scheduler->start_time)) {
+    fprintf(stderr, "clock_gettime() failed\n");
+    return -1;
+  }
+
+  scheduler->deadline = scheduler->start_time;
+  timespec_add_ns(&scheduler->deadline, scheduler->period_ns);
+  return 0;
+}
+
+int frame_scheduler_wait(frame_scheduler *scheduler) {
+  if (!scheduler) {
+    fprintf(stderr, "scheduler is null\n");
+    return -1;
+  }
+
+  struct timespec now = {0};
+  if (clock_gettime(CLOCK_MONOTONIC, &now)) {
+    fprintf(stderr, "clock_gettime() failed\n");
+    return -1;
+  }
+
+  scheduler->frames++;
+
+  const int64_t late_ns = timespec_diff_ns(&now, &scheduler->deadline);
+  if (late_ns > 0) {
+    scheduler->deadline_misses++;
+
+    if (scheduler->overrun_policy == FRAME_SCHEDULER_OVERRUN_CATCH_UP) {
+      // Start the next frame immediately.
+      timespec_add_ns(&scheduler->deadline, scheduler->period_ns);
+      return 0;
+    }
+
+    // Skip every frame whose deadline has already passed.
+    const int64_t skipped = late_ns / scheduler->period_ns;
+    scheduler->frames_skipped += skipped;
+    timespec_add_ns(&scheduler->deadline, skipped * scheduler->period_ns);
+  }
+
+  if (sleep_until(&scheduler->deadline)) {
+    return -1;
+  }
+
+  timespec_add_ns(&scheduler->deadline, scheduler->period_ns);
+  return 0;
+}
+
+void frame_scheduler_get_stats(const frame_scheduler *scheduler,
+                               frame_scheduler_stats *stats) {
+  if (!scheduler || !stats) {
+    fprintf(stderr, "scheduler or stats is null\n");
+    return;
+  }
+
+  memset(stats, 0, sizeof(frame_scheduler_stats));
+
+  struct timespec now = {0};
+  if (clock_gettime(CLOCK_MONOTONIC, &now)) {
+    fprintf(stderr, "clock_gettime() failed\n");
+    return;
+  }
+
+  stats->frames = scheduler->frames;
+  stats->deadline_misses = scheduler->deadline_misses;
+  stats->frames_skipped = scheduler->frames_skipped;
+  stats->elapsed_seconds =
+      timespec_diff_ns(&now, &scheduler->start_time) / 1e9;
+  if (stats->elapsed_seconds > 0) {
+    stats->achieved_rate = stats->frames / stats->elapsed_seconds;
+  }
+}
+
+void frame_scheduler_print_stats(const frame_scheduler *scheduler,
+                                 const char *name) {
+  frame_scheduler_stats stats = {0};
+  frame_scheduler_get_stats(scheduler, &stats);
+
+  printf("%s: %llu frames in %.3f s (%.2f fps), %llu deadline misses, %llu "
+         "frames skipped\n",
+         name ? name : "frame scheduler", (unsigned long long)stats.frames,
+         stats.elapsed_seconds, stats.achieved_rate,
+         (unsigned long long)stats.deadline_misses,
+         (unsigned long long)stats.frames_skipped);
+}
@@ -0,0 +1,71 @@
+#include "frame_slot.h"
+
+#include <stdio.h>  // fprintf
+#include <string.h> // memcpy, memset
+
+#define FRAME_SLOT_INDEX_MASK 0x3u
+#define FRAME_SLOT_UPDATED 0x4u
+
+int frame_slot_init(frame_slot *slot, const hue_stream_message_data *frame,
+                    int channel_count) {
+  if (!slot || !frame) {
+    fprintf(stderr, "slot or frame is null\n");
+    return -1;
+  }
+
+  if (channel_count < 1 || channel_count > FRAME_SLOT_MAX_CHANNELS) {
+    fprintf(stderr, "channel_count is out of range\n");
+    return -1;
+  }
+
+  memset(slot->buffers, 0, sizeof(slot->buffers));
+  memset(slot->published_ns, 0, sizeof(slot->published_ns));
+  for (int i = 0; i < FRAME_SLOT_BUFFER_COUNT; i++) {
+    memcpy(slot->buffers[i], frame,
+           channel_count * sizeof(hue_stream_message_data));
+  }
+
+  slot->channel_count = channel_count;
+  slot->back = 0;
+  atomic_init(&slot->shared, 1);
+  slot->front = 2;
+  return 0;
+}
+
+void frame_slot_publish(frame_slot *slot, const hue_stream_message_data *frame,
+                        uint64_t published_ns) {
+  memcpy(slot->buffers[slot->back], frame,
+         slot->channel_count * sizeof(hue_stream_message_data));
+  slot->published_ns[slot->back] = published_ns;
+
+  // Swap the finished buffer with the shared one. The release ordering makes
+  // the frame visible to the consumer before the index is.
+  const unsigned int previous = atomic_exchange_explicit(
+      &slot->shared, slot->back | FRAME_SLOT_UPDATED, memory_order_acq_rel);
+  slot->back = previous & FRAME_SLOT_INDEX_MASK;
+}
+
+const hue_stream_message_data *frame_slot_acquire(frame_slot *slot,
+                                                  bool *updated) {
+  const bool has_update =
+      atomic_load_explicit(&slot->shared, memory_order_relaxed) &
+      FRAME_SLOT_UPDATED;
+
+  if (has_update) {
+    // Swap the consumed buffer with the shared one. The acquire ordering makes
+    // the frame visible before it is read.
+    const unsigned int previous = atomic_exchange_explicit(
+        &slot->shared, slot->front, memory_order_acq_rel);
+    slot->front = previous & FRAME_SLOT_INDEX_MASK;
+  }
+
+  if (updated) {
+    *updated = has_update;
+  }
+
+  return slot->buffers[slot->front];
+}
+
+uint64_t frame_slot_published_ns(const frame_slot *slot) {
+  return slot->published_ns[slot->front];
+}
@@ -0,0 +1,238 @@
+#include "gamut.h"
+
+#include <math.h> // INFINITY
+#include <pthread.h>
+#include <stdbool.h>
+#include <string.h> // strcmp
+
+// Each gamut's grid has TABLE_SIZE x TABLE_SIZE cells over the xy plane, and
+// a cell is found from the top TABLE_BITS bits of each 16-bit coordinate.
+#define TABLE_BITS 6
+#define TABLE_SIZE (1 << TABLE_BITS)
+#define CELL_SHIFT (16 - TABLE_BITS)
+
+// Where the colors of a cell go. The closest point of a triangle is inside it,
+// on one of its edges or at one of its corners, and each of those regions of
+// the plane is convex. A cell whose four corners are in the same region is in
+// it entirely, and any other cell is mixed.
+enum {
+  REGION_INSIDE,
+  REGION_EDGE,
+  REGION_CORNER = REGION_EDGE + 3,
+  REGION_MIXED = REGION_CORNER + 3,
+};
+
+typedef struct gamut gamut;
+struct gamut {
+  // Red, green and blue, counterclockwise.
+  float corners[3][2];
+  // From each corner to the next.
+  float edges[3][2];
+  float inverse_squared_lengths[3];
+  uint16_t scaled_corners[3][2];
+  uint8_t regions[TABLE_SIZE][TABLE_SIZE];
+};
+
+// The gamut triangles documented for Hue lights.
+static const float gamut_corners[GAMUT_TYPE_COUNT][3][2] = {
+    [GAMUT_A] = {{0.704f, 0.296f}, {0.2151f, 0.7106f}, {0.138f, 0.08f}},
+    [GAMUT_B] = {{0.675f, 0.322f}, {0.409f, 0.518f}, {0.167f, 0.04f}},
+    [GAMUT_C] = {{0.6915f, 0.3083f}, {0.17f, 0.7f}, {0.1532f, 0.0475f}},
+};
+
+static const char *const gamut_names[GAMUT_TYPE_COUNT] = {
+    [GAMUT_OTHER] = "other",
+    [GAMUT_A] = "A",
+    [GAMUT_B] = "B",
+    [GAMUT_C] = "C",
+};
+
+static gamut gamuts[GAMUT_TYPE_COUNT];
+static pthread_once_t gamuts_once = PTHREAD_ONCE_INIT;
+
+int gamut_parse(const char *name, gamut_type *type) {
+  for (int i = 0; name && i < GAMUT_TYPE_COUNT; i++) {
+    if (!strcmp(name, gamut_names[i])) {
+      *type = i;
+      return 0;
+    }
+  }
+  return -1;
+}
+
+const char *gamut_name(gamut_type type) {
+  return type >= 0 && type < GAMUT_TYPE_COUNT ? gamut_names[type] : "other";
+}
+
+static float unscale(uint16_t value) { return value / 65535.0f; }
+
+static uint16_t scale(float value) {
+  const float scaled = value * 65535.0f + 0.5f;
+  return scaled > 0.0f ? (scaled < 65535.0f ? (uint16_t)scaled : 65535) : 0;
+}
+
+// Find the closest point of an edge, and whether it is the edge or one of its
+// corners.
+static int project(const gamut *g, int edge, float x, float y, float *px,
+                   float *py) {
+  const float *corner = g->corners[edge];
+  const float t = ((x - corner[0]) * g->edges[edge][0] +
+                   (y - corner[1]) * g->edges[edge][1]) *
+                  g->inverse_squared_lengths[edge];
+
+  if (t <= 0.0f) {
+    *px = corner[0];
+    *py = corner[1];
+    return REGION_CORNER + edge;
+  }
+
+  if (t >= 1.0f) {
+    const int next = (edge + 1) % 3;
+    *px = g->corners[next][0];
+    *py = g->corners[next][1];
+    return REGION_CORNER + next;
+  }
+
+  *px = corner[0] + t * g->edges[edge][0];
+  *py = corner[1] + t * g->edges[edge][1];
+  return REGION_EDGE + edge;
+}
+
+// Find the closest point of the triangle, and the region it is in.
+static int closest_point(const gamut *g, float x, float y, float *px,
+                         float *py) {
+  // Inside is on the left of every edge, since the corners are
+  // counterclockwise.
+  bool inside = true;
+  for (int i = 0; i < 3; i++) {
+    const float cross = g->edges[i][0] * (y - g->corners[i][1]) -
+                        g->edges[i][1] * (x - g->corners[i][0]);
+    inside = inside && cross >= 0.0f;
+  }
+
+  if (inside) {
+    *px = x;
+    *py = y;
+    return REGION_INSIDE;
+  }
+
+  int region = REGION_MIXED;
+  float closest = INFINITY;
+  for (int i = 0; i < 3; i++) {
+    float ex = 0;
+    float ey = 0;
+    const int edge_region = project(g, i, x, y, &ex, &ey);
+    const float distance = (x - ex) * (x - ex) + (y - ey) * (y - ey);
+    if (distance < closest) {
+      closest = distance;
+      *px = ex;
+      *py = ey;
+      region = edge_region;
+    }
+  }
+  return region;
+}
+
+static int region_at(const gamut *g, uint16_t x, uint16_t y) {
+  float px = 0;
+  float py = 0;
+  return closest_point(g, unscale(x), unscale(y), &px, &py);
+}
+
+static void init_gamut(gamut *g, const float corners[3][2]) {
+  for (int i = 0; i < 3; i++) {
+    const float *next = corners[(i + 1) % 3];
+    g->corners[i][0] = corners[i][0];
+    g->corners[i][1] = corners[i][1];
+    g->edges[i][0] = next[0] - corners[i][0];
+    g->edges[i][1] = next[1] - corners[i][1];
+    g->inverse_squared_lengths[i] =
+        1.0f / (g->edges[i][0] * g->edges[i][0] +
+                g->edges[i][1] * g->edges[i][1]);
+  }
+
+  for (int i = 0; i < 3; i++) {
+    g->scaled_corners[i][0] = scale(corners[i][0]);
+    g->scaled_corners[i][1] = scale(corners[i][1]);
+  }
+
+  for (int row = 0; row < TABLE_SIZE; row++) {
+    for (int column = 0; column < TABLE_SIZE; column++) {
+      const uint16_t x0 = column << CELL_SHIFT;
+      const uint16_t y0 = row << CELL_SHIFT;
+      const uint16_t x1 = x0 + (1 << CELL_SHIFT) - 1;
+      const uint16_t y1 = y0 + (1 << CELL_SHIFT) - 1;
+
+      const int region = region_at(g, x0, y0);
+      const bool uniform = region_at(g, x1, y0) == region &&
+                           region_at(g, x0, y1) == region &&
+                           region_at(g, x1, y1) == region;
+      g->regions[row][column] = uniform ? region : REGION_MIXED;
+    }
+  }
+}
+
+static void init_gamuts(void) {
+  for (int i = GAMUT_A; i < GAMUT_TYPE_COUNT; i++) {
+    init_gamut(&gamuts[i], gamut_corners[i]);
+  }
+}
+
+static bool has_gamut(gamut_type type) {
+  return type > GAMUT_OTHER && type < GAMUT_TYPE_COUNT;
+}
+
+static void clamp(const gamut *g, uint16_t *x, uint16_t *y) {
+  float px = 0;
+  float py = 0;
+  closest_point(g, unscale(*x), unscale(*y), &px, &py);
+  *x = scale(px);
+  *y = scale(py);
+}
+
+void gamut_clamp(gamut_type type, uint16_t *x, uint16_t *y) {
+  if (!has_gamut(type) || !x || !y) {
+    return;
+  }
+
+  pthread_once(&gamuts_once, init_gamuts);
+  clamp(&gamuts[type], x, y);
+}
+
+void gamut_map_frame(const gamut_type *gamuts_by_channel,
+                     const hue_stream_message_data *frame,
+                     hue_stream_message_data *mapped, int channel_count) {
+  if (!gamuts_by_channel || !frame || !mapped) {
+    return;
+  }
+
+  pthread_once(&gamuts_once, init_gamuts);
+
+  for (int i = 0; i < channel_count; i++) {
+    mapped[i] = frame[i];
+    if (!has_gamut(gamuts_by_channel[i])) {
+      continue;
+    }
+
+    const gamut *g = &gamuts[gamuts_by_channel[i]];
+    uint16_t *x = &mapped[i].color_value[0];
+    uint16_t *y = &mapped[i].color_value[1];
+    const int region = g->regions[*y >> CELL_SHIFT][*x >> CELL_SHIFT];
+    if (region == REGION_INSIDE) {
+      continue;
+    }
+
+    if (region >= REGION_CORNER && region < REGION_MIXED) {
+      *x = g->scaled_corners[region - REGION_CORNER][0];
+      *y = g->scaled_corners[region - REGION_CORNER][1];
+    } else if (region >= REGION_EDGE && region < REGION_CORNER) {
+      float px = 0;
+      float py = 0;
+      project(g, region - REGION_EDGE, unscale(*x), unscale(*y), &px, &py);
+      *x = scale(px);
+      *y = scale(py);
+    } else {
+      clamp(g, x, y);
+    }
+  }
+}
@@ -10,12 +10,14 @@
 #include <stdlib.h> // getenv, malloc, free
 #include <string.h> // strlen
 
-#define HUE_BRIDGE_DTLS_CIPHER MBEDTLS_TLS_PSK_WITH_AES_128_GCM_SHA256
-#define HUE_BRIDGE_DTLS_PORT "2100"
-
 #define PSK_HEX_EXPECTED_LEN 32
 
-static int set_psk(mbedtls_ssl_config *conf) {
+int hue_dtls_conf_psk(mbedtls_ssl_config *conf) {
+  if (!conf) {
+    fprintf(stderr, "conf is null\n");
+    return -1;
+  }
+
   const char *psk_identity = getenv("HUE_APPLICATION_ID");
   const char *psk_hex = getenv("HUE_CLIENTKEY");
 
@@ -90,8 +92,8 @@ hue_dtls_context *hue_dtls_context_create(void) {
   mbedtls_ssl_conf_ciphersuites(&context->conf, context->ciphersuites);
 
   // Set the pre-shared key (PSK).
-  if (set_psk(&context->conf)) {
-    fprintf(stderr, "set_psk() failed\n");
+  if (hue_dtls_conf_psk(&context->conf)) {
+    fprintf(stderr, "hue_dtls_conf_psk() failed\n");
     goto exit;
   }
 
@@ -169,6 +171,29 @@ int hue_dtls_connect(hue_dtls_context *context, const char *bridge_ip) {
   return 0;
 }
 
+static int send_all(hue_dtls_context *context, const uint8_t *buffer,
+                    size_t buffer_size) {
+  size_t written = 0;
+  while (written < buffer_size) {
+    const int ret = mbedtls_ssl_write(&context->ssl, buffer + written,
+                                      buffer_size - written);
+
+    if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
+      continue;
+    }
+
+    if (ret < 0) {
+      fprintf(stderr, "mbedtls_ssl_write() failed: -0x%x\n",
+              (unsigned int)-ret);
+      return -1;
+    }
+
+    written += ret;
+  }
+
+  return 0;
+}
+
 int hue_dtls_send_message(hue_dtls_context *context,
                           const hue_stream_message *message,
                           int channel_count) {
@@ -190,25 +215,17 @@ int hue_dtls_send_message(hue_dtls_context *context,
     return -1;
   }
 
-  size_t written = 0;
-  while (written < buffer_size) {
-    const int ret = mbedtls_ssl_write(&context->ssl, buffer + written,
-                                      buffer_size - written);
-
-    if (ret == MBEDTLS_ERR_SSL_WANT_READ || ret == MBEDTLS_ERR_SSL_WANT_WRITE) {
-      continue;
-    }
-
-    if (ret < 0) {
-      fprintf(stderr, "mbedtls_ssl_write() failed: -0x%x\n",
-              (unsigned int)-ret);
-      free(buffer);
-      return -1;
-    }
+  const int ret = send_all(context, buffer, buffer_size);
+  free(buffer);
+  return ret;
+}
 
-    written += ret;
+int hue_dtls_send_buffer(hue_dtls_context *context,
+                         const hue_stream_message_buffer *buffer) {
+  if (!context || !buffer) {
+    fprintf(stderr, "context or buffer is null\n");
+    return -1;
   }
 
-  free(buffer);
-  return 0;
+  return send_all(context, buffer->data, buffer->size);
 }
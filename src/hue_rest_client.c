@@ -1,96 +1,684 @@
 #include "hue_rest_client.h"
 
+#include "json.h"
 #include <curl/curl.h>
 
-#include <stdlib.h> // getenv
+#include <stdio.h>  // fprintf, perror, snprintf
+#include <stdlib.h> // calloc, free, getenv, malloc, realloc
+#include <string.h> // memcpy, memset, strlen
 
-static size_t write_callback(void *ptr, size_t size, size_t nmemb,
-                             void *stream) {
+#define ENTERTAINMENT_CONFIGURATION_PATH                                       \
+  "/clip/v2/resource/entertainment_configuration"
+#define ENTERTAINMENT_PATH "/clip/v2/resource/entertainment"
+#define LIGHT_PATH "/clip/v2/resource/light"
+
+// Responses larger than this are rejected. A bridge with every entertainment
+// area it allows fits well within it.
+#define MAX_RESPONSE_SIZE (4 * 1024 * 1024)
+
+// How long to wait for activity on the connections before checking them again.
+#define WAIT_TIMEOUT_MS 1000
+
+typedef struct response response;
+struct response {
+  char *data;
+  size_t size;
+};
+
+static size_t discard_callback(void *ptr, size_t size, size_t nmemb,
+                               void *stream) {
   (void)ptr;
   (void)stream;
   return size * nmemb;
 }
 
-int hue_rest_start_entertainment_area_streaming(
-    const char *bridge_ip, const char *entertainment_config_id) {
-  // Validate input parameters.
-  if (!bridge_ip || !entertainment_config_id) {
-    fprintf(stderr, "bridge_ip or entertainment_config_id is null\n");
+static size_t write_callback(void *ptr, size_t size, size_t nmemb,
+                             void *stream) {
+  response *res = stream;
+  const size_t length = size * nmemb;
+  if (res->size + length > MAX_RESPONSE_SIZE) {
+    fprintf(stderr, "response is too large\n");
+    return 0;
+  }
+
+  // Keep the response null-terminated.
+  char *data = realloc(res->data, res->size + length + 1);
+  if (!data) {
+    perror("realloc");
+    return 0;
+  }
+
+  memcpy(data + res->size, ptr, length);
+  res->data = data;
+  res->size += length;
+  res->data[res->size] = '\0';
+  return length;
+}
+
+int hue_rest_global_init(void) {
+  const CURLcode code = curl_global_init(CURL_GLOBAL_DEFAULT);
+  if (code != CURLE_OK) {
+    fprintf(stderr, "curl_global_init() failed: %s\n",
+            curl_easy_strerror(code));
     return -1;
   }
+  return 0;
+}
+
+void hue_rest_global_cleanup(void) { curl_global_cleanup(); }
 
+struct hue_rest_client {
+  // Holds the connection cache, so connections outlive the requests.
+  CURLM *multi;
+  // Reused for every call, so each keeps its TLS session cache.
+  CURL *handles[HUE_REST_CLIENT_MAX_REQUESTS];
+  struct curl_slist *headers;
+  const char *port;
+};
+
+// A REST API request with the application key. The response body is
+// discarded if res is NULL.
+typedef struct request request;
+struct request {
+  const char *bridge_ip;
+  const char *method;
+  char path[128];
+  const char *body;
+  response *res;
+  // 0 once the request succeeds.
+  int ret;
+};
+
+hue_rest_client *hue_rest_client_create(void) {
   const char *hue_username = getenv("HUE_USERNAME");
   if (!hue_username) {
     fprintf(stderr, "HUE_USERNAME not set\n");
-    return -1;
+    return NULL;
   }
 
-  // Initialize curl.
-  curl_global_init(CURL_GLOBAL_DEFAULT);
-  CURL *curl = curl_easy_init();
-  if (!curl) {
-    fprintf(stderr, "curl_easy_init() failed\n");
-    curl_global_cleanup();
-    return -1;
+  hue_rest_client *client = calloc(1, sizeof(hue_rest_client));
+  if (!client) {
+    perror("calloc");
+    return NULL;
+  }
+
+  // HUE_REST_PORT overrides the HTTPS port, which lets the bridge emulator run
+  // without binding port 443.
+  client->port = getenv("HUE_REST_PORT");
+
+  client->multi = curl_multi_init();
+  if (!client->multi) {
+    fprintf(stderr, "curl_multi_init() failed\n");
+    goto error;
   }
 
+  // One connection per bridge. Requests to a bridge that is busy wait for its
+  // connection instead of opening another one.
+  curl_multi_setopt(client->multi, CURLMOPT_MAX_HOST_CONNECTIONS, 1L);
+
+  for (int i = 0; i < HUE_REST_CLIENT_MAX_REQUESTS; i++) {
+    client->handles[i] = curl_easy_init();
+    if (!client->handles[i]) {
+      fprintf(stderr, "curl_easy_init() failed\n");
+      goto error;
+    }
+  }
+
+  // The request body is JSON.
+  client->headers = curl_slist_append(NULL, "Content-Type: application/json");
+  if (!client->headers) {
+    fprintf(stderr, "curl_slist_append() failed\n");
+    goto error;
+  }
+
+  // Set the Hue application key.
+  char hue_application_key[256] = {0};
+  snprintf(hue_application_key, sizeof(hue_application_key),
+           "hue-application-key: %s", hue_username);
+  struct curl_slist *headers =
+      curl_slist_append(client->headers, hue_application_key);
+  if (!headers) {
+    fprintf(stderr, "curl_slist_append() failed\n");
+    goto error;
+  }
+  client->headers = headers;
+
+  return client;
+
+error:
+  hue_rest_client_free(client);
+  return NULL;
+}
+
+void hue_rest_client_free(hue_rest_client *client) {
+  if (!client) {
+    return;
+  }
+
+  for (int i = 0; i < HUE_REST_CLIENT_MAX_REQUESTS; i++) {
+    if (client->handles[i]) {
+      curl_easy_cleanup(client->handles[i]);
+    }
+  }
+  if (client->multi) {
+    curl_multi_cleanup(client->multi);
+  }
+  curl_slist_free_all(client->headers);
+  free(client);
+}
+
+static void set_request(hue_rest_client *client, CURL *curl,
+                        request *req) {
+  // Forget the previous request's options. Connections and TLS sessions stay.
+  curl_easy_reset(curl);
+
   // Set the REST API URL.
   char url[256] = {0};
-  snprintf(url, sizeof(url),
-           "https://%s/clip/v2/resource/entertainment_configuration/%s",
-           bridge_ip, entertainment_config_id);
+  snprintf(url, sizeof(url), "https://%s%s%s%s", req->bridge_ip,
+           client->port ? ":" : "", client->port ? client->port : "",
+           req->path);
   curl_easy_setopt(curl, CURLOPT_URL, url);
 
   // Ignore SSL certificate verification.
   curl_easy_setopt(curl, CURLOPT_SSL_VERIFYPEER, 0L);
   curl_easy_setopt(curl, CURLOPT_SSL_VERIFYHOST, 0L);
 
+  // Keep the connection alive between titles.
+  curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+
   // Set the request method.
-  curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, "PUT");
+  curl_easy_setopt(curl, CURLOPT_CUSTOMREQUEST, req->method);
 
   // Set the request body.
-  curl_easy_setopt(curl, CURLOPT_POSTFIELDS, "{\"action\":\"start\"}");
+  if (req->body) {
+    curl_easy_setopt(curl, CURLOPT_POSTFIELDS, req->body);
+  }
 
-  // The request body is JSON.
-  struct curl_slist *headers =
-      curl_slist_append(NULL, "Content-Type: application/json");
-  if (!headers) {
-    fprintf(stderr, "curl_slist_append() failed\n");
-    curl_easy_cleanup(curl);
-    curl_global_cleanup();
+  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, client->headers);
+
+  // Collect the response, or don't write it to stdout.
+  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION,
+                   req->res ? write_callback : discard_callback);
+  curl_easy_setopt(curl, CURLOPT_WRITEDATA, req->res);
+  curl_easy_setopt(curl, CURLOPT_PRIVATE, req);
+}
+
+// Check the outcome of a finished request.
+static int check_request(CURL *curl, CURLcode code) {
+  request *req = NULL;
+  curl_easy_getinfo(curl, CURLINFO_PRIVATE, (char **)&req);
+
+  if (code != CURLE_OK) {
+    fprintf(stderr, "%s %s on %s failed: %s\n", req->method, req->path,
+            req->bridge_ip, curl_easy_strerror(code));
     return -1;
   }
 
-  // Set the Hue application key.
-  char hue_application_key[256] = {0};
-  snprintf(hue_application_key, sizeof(hue_application_key),
-           "hue-application-key: %s", hue_username);
-  headers = curl_slist_append(headers, hue_application_key);
-  if (!headers) {
-    fprintf(stderr, "curl_slist_append() failed\n");
-    curl_easy_cleanup(curl);
-    curl_global_cleanup();
+  long status = 0;
+  curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &status);
+  if (status != 200) {
+    fprintf(stderr, "%s %s on %s returned HTTP %ld\n", req->method,
+            req->path, req->bridge_ip, status);
     return -1;
   }
 
-  curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+  req->ret = 0;
+  return 0;
+}
 
-  // Don't write the response to stdout.
-  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
-  curl_easy_setopt(curl, CURLOPT_WRITEDATA, NULL);
+// Perform requests at the same time, through the client's connections.
+static int perform_requests(hue_rest_client *client, request *requests,
+                            int request_count) {
+  if (request_count > HUE_REST_CLIENT_MAX_REQUESTS) {
+    fprintf(stderr, "Too many requests\n");
+    return -1;
+  }
 
   int ret = 0;
+  int added = 0;
+  for (; added < request_count; added++) {
+    requests[added].ret = -1;
+    CURL *curl = client->handles[added];
+    set_request(client, curl, &requests[added]);
+
+    const CURLMcode code = curl_multi_add_handle(client->multi, curl);
+    if (code != CURLM_OK) {
+      fprintf(stderr, "curl_multi_add_handle() failed: %s\n",
+              curl_multi_strerror(code));
+      ret = -1;
+      goto exit;
+    }
+  }
+
+  int running = added;
+  while (running) {
+    CURLMcode code = curl_multi_perform(client->multi, &running);
+    if (code == CURLM_OK && running) {
+      code = curl_multi_wait(client->multi, NULL, 0, WAIT_TIMEOUT_MS, NULL);
+    }
+
+    if (code != CURLM_OK) {
+      fprintf(stderr, "curl_multi_perform() failed: %s\n",
+              curl_multi_strerror(code));
+      ret = -1;
+      goto exit;
+    }
+  }
+
+  int pending = 0;
+  int finished = 0;
+  CURLMsg *message = NULL;
+  while ((message = curl_multi_info_read(client->multi, &pending))) {
+    if (message->msg != CURLMSG_DONE) {
+      continue;
+    }
 
-  // Perform the REST API request.
-  CURLcode res = curl_easy_perform(curl);
-  if (res != CURLE_OK) {
-    fprintf(stderr, "curl_easy_perform() failed: %s\n",
-            curl_easy_strerror(res));
+    finished++;
+    if (check_request(message->easy_handle, message->data.result)) {
+      ret = -1;
+    }
+  }
+
+  if (finished != added) {
+    fprintf(stderr, "%d of %d requests didn't finish\n", added - finished,
+            added);
     ret = -1;
   }
 
-  curl_slist_free_all(headers);
-  curl_easy_cleanup(curl);
-  curl_global_cleanup();
+exit:
+  for (int i = 0; i < added; i++) {
+    curl_multi_remove_handle(client->multi, client->handles[i]);
+  }
+  return ret;
+}
+
+// Start or stop streaming to every area at once.
+static int set_streaming(hue_rest_client *client, const hue_rest_area *areas,
+                         int area_count, const char *body) {
+  if (!client || !areas) {
+    fprintf(stderr, "client or areas is null\n");
+    return -1;
+  }
+
+  if (area_count < 0 || area_count > HUE_REST_CLIENT_MAX_REQUESTS) {
+    fprintf(stderr, "Invalid area count %d\n", area_count);
+    return -1;
+  }
+
+  request requests[HUE_REST_CLIENT_MAX_REQUESTS] = {0};
+  for (int i = 0; i < area_count; i++) {
+    if (!areas[i].bridge_ip || !areas[i].entertainment_config_id) {
+      fprintf(stderr, "bridge_ip or entertainment_config_id is null\n");
+      return -1;
+    }
+
+    requests[i] = (request){areas[i].bridge_ip, "PUT", "", body, NULL, -1};
+    snprintf(requests[i].path, sizeof(requests[i].path), "%s/%s",
+             ENTERTAINMENT_CONFIGURATION_PATH,
+             areas[i].entertainment_config_id);
+  }
+
+  return perform_requests(client, requests, area_count);
+}
+
+int hue_rest_client_start(hue_rest_client *client, const hue_rest_area *areas,
+                          int area_count) {
+  return set_streaming(client, areas, area_count, "{\"action\":\"start\"}");
+}
+
+int hue_rest_client_stop(hue_rest_client *client, const hue_rest_area *areas,
+                         int area_count) {
+  return set_streaming(client, areas, area_count, "{\"action\":\"stop\"}");
+}
+
+// A parsed response body.
+typedef struct document document;
+struct document {
+  const char *json;
+  json_token *tokens;
+  // The response's data array.
+  int data;
+};
+
+static int document_parse(document *doc, const char *json, size_t length) {
+  memset(doc, 0, sizeof(document));
+
+  const int token_count = json_parse(json, length, NULL, 0);
+  if (token_count < 0) {
+    fprintf(stderr, "json_parse() failed\n");
+    return -1;
+  }
+
+  doc->tokens = malloc(token_count * sizeof(json_token));
+  if (!doc->tokens) {
+    perror("malloc");
+    return -1;
+  }
+
+  doc->json = json;
+  json_parse(json, length, doc->tokens, token_count);
+
+  doc->data = json_object_get(json, doc->tokens, 0, "data");
+  if (doc->data < 0 || doc->tokens[doc->data].type != JSON_ARRAY) {
+    fprintf(stderr, "response has no data\n");
+    free(doc->tokens);
+    doc->tokens = NULL;
+    return -1;
+  }
+
+  return 0;
+}
+
+static void document_free(document *doc) {
+  free(doc->tokens);
+  doc->tokens = NULL;
+}
+
+// Read a number member of an object.
+static int get_number(const char *json, const json_token *tokens, int object,
+                      const char *key, double *number) {
+  const int value = json_object_get(json, tokens, object, key);
+  return value < 0 ? -1 : json_number(json, &tokens[value], number);
+}
+
+// Copy the rid of a resource reference member, like {"rid":"...",
+// "rtype":"..."}.
+static int get_reference(const document *doc, int object, const char *key,
+                         char *id, size_t size) {
+  const int rid = json_object_get(
+      doc->json, doc->tokens,
+      json_object_get(doc->json, doc->tokens, object, key), "rid");
+  return rid < 0 ? -1
+                 : json_string_copy(doc->json, &doc->tokens[rid], id, size);
+}
+
+// Find the resource with an id in a response's data array.
+static int find_resource(const document *doc, const char *id) {
+  for (int i = doc->data + 1; i < doc->tokens[doc->data].next;
+       i = doc->tokens[i].next) {
+    const int value = json_object_get(doc->json, doc->tokens, i, "id");
+    if (value >= 0 && json_string_equals(doc->json, &doc->tokens[value], id)) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+// The documents a channel's gamut is looked up in: the entertainment services,
+// which point to the lights that render them, and the lights.
+typedef struct gamut_lookup gamut_lookup;
+struct gamut_lookup {
+  document entertainment;
+  document lights;
+};
+
+// Find the gamut of the light behind a channel's first member. Lights without
+// color have the other gamut, since their xy is ignored.
+static gamut_type find_gamut(const document *configs, int channel,
+                             const gamut_lookup *lookup) {
+  if (!lookup) {
+    return GAMUT_DEFAULT;
+  }
+
+  const int members =
+      json_object_get(configs->json, configs->tokens, channel, "members");
+  char service_id[64] = {0};
+  if (members < 0 || configs->tokens[members].type != JSON_ARRAY ||
+      configs->tokens[members].next == members + 1 ||
+      get_reference(configs, members + 1, "service", service_id,
+                    sizeof(service_id))) {
+    return GAMUT_DEFAULT;
+  }
+
+  const document *entertainment = &lookup->entertainment;
+  char light_id[64] = {0};
+  const int service = find_resource(entertainment, service_id);
+  if (service < 0 || get_reference(entertainment, service,
+                                   "renderer_reference", light_id,
+                                   sizeof(light_id))) {
+    return GAMUT_DEFAULT;
+  }
+
+  const document *lights = &lookup->lights;
+  const int light = find_resource(lights, light_id);
+  if (light < 0) {
+    return GAMUT_DEFAULT;
+  }
+
+  const int gamut_type_token = json_object_get(
+      lights->json, lights->tokens,
+      json_object_get(lights->json, lights->tokens, light, "color"),
+      "gamut_type");
+  char name[8] = {0};
+  gamut_type type = GAMUT_OTHER;
+  if (gamut_type_token >= 0 &&
+      (json_string_copy(lights->json, &lights->tokens[gamut_type_token], name,
+                        sizeof(name)) ||
+       gamut_parse(name, &type))) {
+    return GAMUT_DEFAULT;
+  }
+  return type;
+}
+
+static int parse_channel(const document *doc, int object,
+                         const gamut_lookup *lookup,
+                         hue_entertainment_channel *channel) {
+  const char *json = doc->json;
+  const json_token *tokens = doc->tokens;
+  double channel_id = 0;
+  const int position = json_object_get(json, tokens, object, "position");
+  if (get_number(json, tokens, object, "channel_id", &channel_id) ||
+      channel_id < 0 || channel_id > UINT8_MAX || position < 0 ||
+      get_number(json, tokens, position, "x", &channel->x) ||
+      get_number(json, tokens, position, "y", &channel->y) ||
+      get_number(json, tokens, position, "z", &channel->z)) {
+    return -1;
+  }
+
+  channel->channel_id = (uint8_t)channel_id;
+  channel->gamut = find_gamut(doc, object, lookup);
+  return 0;
+}
+
+static int parse_config(const document *doc, int object,
+                        const gamut_lookup *lookup,
+                        hue_entertainment_config *config) {
+  const char *json = doc->json;
+  const json_token *tokens = doc->tokens;
+  memset(config, 0, sizeof(hue_entertainment_config));
+
+  const int id = json_object_get(json, tokens, object, "id");
+  if (id < 0 || json_string_copy(json, &tokens[id], config->id,
+                                 sizeof(config->id)) ||
+      strlen(config->id) != HUE_STREAM_MESSAGE_ENTERTAINMENT_CONFIG_ID_SIZE) {
+    fprintf(stderr, "entertainment configuration has no valid id\n");
+    return -1;
+  }
+
+  // Older firmware only has the name in the metadata.
+  int name = json_object_get(json, tokens, object, "name");
+  if (name < 0) {
+    name = json_object_get(
+        json, tokens, json_object_get(json, tokens, object, "metadata"),
+        "name");
+  }
+  if (name < 0 || json_string_copy(json, &tokens[name], config->name,
+                                   sizeof(config->name))) {
+    snprintf(config->name, sizeof(config->name), "%s", config->id);
+  }
+
+  const int channels = json_object_get(json, tokens, object, "channels");
+  if (channels < 0 || tokens[channels].type != JSON_ARRAY) {
+    fprintf(stderr, "entertainment configuration %s has no channels\n",
+            config->id);
+    return -1;
+  }
+
+  for (int i = channels + 1; i < tokens[channels].next; i = tokens[i].next) {
+    if (config->channel_count >= HUE_STREAM_MESSAGE_MAX_CHANNELS) {
+      fprintf(stderr, "entertainment configuration %s has too many channels\n",
+              config->id);
+      return -1;
+    }
+
+    if (parse_channel(doc, i, lookup,
+                      &config->channels[config->channel_count++])) {
+      fprintf(stderr, "entertainment configuration %s has an invalid channel\n",
+              config->id);
+      return -1;
+    }
+  }
+
+  if (config->channel_count == 0) {
+    fprintf(stderr, "entertainment configuration %s has no channels\n",
+            config->id);
+    return -1;
+  }
+
+  return 0;
+}
+
+static int parse_configs(const char *json, size_t length,
+                         const gamut_lookup *lookup,
+                         hue_entertainment_config *configs, int max_configs) {
+  document doc = {0};
+  if (document_parse(&doc, json, length)) {
+    return -1;
+  }
+
+  int config_count = 0;
+  for (int i = doc.data + 1; i < doc.tokens[doc.data].next;
+       i = doc.tokens[i].next) {
+    if (config_count >= max_configs) {
+      fprintf(stderr, "Ignoring entertainment configurations past %d\n",
+              max_configs);
+      break;
+    }
+
+    if (parse_config(&doc, i, lookup, &configs[config_count])) {
+      config_count = -1;
+      break;
+    }
+    config_count++;
+  }
+
+  document_free(&doc);
+  return config_count;
+}
+
+int hue_rest_parse_entertainment_configurations(
+    const char *json, size_t length, hue_entertainment_config *configs,
+    int max_configs) {
+  if (!json || !configs) {
+    fprintf(stderr, "json or configs is null\n");
+    return -1;
+  }
+
+  return parse_configs(json, length, NULL, configs, max_configs);
+}
+
+int hue_rest_client_get_entertainment_configurations(
+    hue_rest_client *client, const char *bridge_ip,
+    hue_entertainment_config *configs, int max_configs) {
+  if (!client || !bridge_ip || !configs) {
+    fprintf(stderr, "client, bridge_ip or configs is null\n");
+    return -1;
+  }
+
+  // The lights' gamuts are looked up at the same time. Without them, the
+  // channels get the default gamut.
+  response responses[3] = {0};
+  request requests[3] = {
+      {bridge_ip, "GET", ENTERTAINMENT_CONFIGURATION_PATH, NULL, &responses[0],
+       -1},
+      {bridge_ip, "GET", ENTERTAINMENT_PATH, NULL, &responses[1], -1},
+      {bridge_ip, "GET", LIGHT_PATH, NULL, &responses[2], -1},
+  };
+  perform_requests(client, requests, 3);
+
+  int config_count = -1;
+  if (requests[0].ret || !responses[0].data) {
+    goto exit;
+  }
+
+  gamut_lookup lookup = {0};
+  const bool has_lookup =
+      !requests[1].ret && !requests[2].ret && responses[1].data &&
+      responses[2].data &&
+      !document_parse(&lookup.entertainment, responses[1].data,
+                      responses[1].size) &&
+      !document_parse(&lookup.lights, responses[2].data, responses[2].size);
+  if (!has_lookup) {
+    fprintf(stderr, "Couldn't look up the lights of %s, assuming gamut %s\n",
+            bridge_ip, gamut_name(GAMUT_DEFAULT));
+  }
+
+  config_count = parse_configs(responses[0].data, responses[0].size,
+                               has_lookup ? &lookup : NULL, configs,
+                               max_configs);
+  document_free(&lookup.entertainment);
+  document_free(&lookup.lights);
+
+exit:
+  if (config_count < 0) {
+    fprintf(stderr, "Invalid entertainment configurations from %s\n",
+            bridge_ip);
+  }
+  for (int i = 0; i < 3; i++) {
+    free(responses[i].data);
+  }
+  return config_count;
+}
+
+int hue_rest_parse_entertainment_status(const char *json, size_t length,
+                                        bool *active) {
+  if (!json || !active) {
+    fprintf(stderr, "json or active is null\n");
+    return -1;
+  }
+
+  document doc = {0};
+  if (document_parse(&doc, json, length)) {
+    return -1;
+  }
+
+  // The data array holds the one area asked for.
+  int ret = -1;
+  const int status =
+      doc.tokens[doc.data].next == doc.data + 1
+          ? -1
+          : json_object_get(json, doc.tokens, doc.data + 1, "status");
+  if (status < 0 || doc.tokens[status].type != JSON_STRING) {
+    fprintf(stderr, "entertainment configuration has no status\n");
+  } else {
+    *active = json_string_equals(json, &doc.tokens[status], "active");
+    ret = 0;
+  }
+
+  document_free(&doc);
+  return ret;
+}
+
+int hue_rest_client_status(hue_rest_client *client, const hue_rest_area *area,
+                           bool *active) {
+  if (!client || !area || !area->bridge_ip ||
+      !area->entertainment_config_id || !active) {
+    fprintf(stderr, "client, area or active is null\n");
+    return -1;
+  }
+
+  response res = {0};
+  request req = {area->bridge_ip, "GET", "", NULL, &res, -1};
+  snprintf(req.path, sizeof(req.path), "%s/%s",
+           ENTERTAINMENT_CONFIGURATION_PATH, area->entertainment_config_id);
+  if (perform_requests(client, &req, 1)) {
+    free(res.data);
+    return -1;
+  }
+
+  const int ret =
+      res.data ? hue_rest_parse_entertainment_status(res.data, res.size, active)
+               : -1;
+  free(res.data);
   return ret;
 }
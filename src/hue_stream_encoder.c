@@ -0,0 +1,137 @@
+#include "hue_stream_encoder.h"
+
+#include <stdio.h>  // fprintf, printf
+#include <string.h> // memcmp, memcpy, memset
+
+int hue_stream_encoder_init(hue_stream_encoder *encoder,
+                            const char *entertainment_config_id,
+                            uint8_t color_space, int keepalive_frames) {
+  if (!encoder) {
+    fprintf(stderr, "encoder is null\n");
+    return -1;
+  }
+
+  if (keepalive_frames <= 0) {
+    fprintf(stderr, "keepalive_frames (%d) must be positive\n",
+            keepalive_frames);
+    return -1;
+  }
+
+  memset(encoder, 0, sizeof(hue_stream_encoder));
+
+  if (hue_stream_message_buffer_init(&encoder->buffer, entertainment_config_id,
+                                     color_space)) {
+    fprintf(stderr, "hue_stream_message_buffer_init() failed\n");
+    return -1;
+  }
+
+  encoder->keepalive_frames = keepalive_frames;
+  return 0;
+}
+
+int hue_stream_encoder_encode(hue_stream_encoder *encoder,
+                              const hue_stream_message_data *frame,
+                              int channel_count) {
+  if (!encoder || !frame) {
+    fprintf(stderr, "encoder or frame is null\n");
+    return -1;
+  }
+
+  uint8_t channels[HUE_STREAM_MESSAGE_MAX_CHANNELS *
+                   HUE_STREAM_MESSAGE_CHANNEL_SIZE];
+  if (hue_stream_message_serialize_channels(frame, channel_count, channels)) {
+    fprintf(stderr, "hue_stream_message_serialize_channels() failed\n");
+    return -1;
+  }
+
+  return hue_stream_encoder_encode_serialized(encoder, channels,
+                                              channel_count);
+}
+
+int hue_stream_encoder_encode_serialized(hue_stream_encoder *encoder,
+                                         const uint8_t *channels,
+                                         int channel_count) {
+  if (!encoder || !channels) {
+    fprintf(stderr, "encoder or channels is null\n");
+    return -1;
+  }
+
+  if (!hue_stream_message_valid_channel_count(channel_count)) {
+    fprintf(stderr, "channel_count is out of range\n");
+    return -1;
+  }
+
+  hue_stream_encoder_stats *stats = &encoder->stats;
+  stats->frames++;
+
+  const size_t channels_size = channel_count * HUE_STREAM_MESSAGE_CHANNEL_SIZE;
+  const size_t full_size = HUE_STREAM_MESSAGE_HEADER_SIZE + channels_size;
+
+  const bool send_full = !encoder->has_last_sent ||
+                         ++encoder->frames_since_full >=
+                             encoder->keepalive_frames;
+
+  // Collect the channels that changed since they were last sent. The
+  // serialized channel includes its ID, so one comparison covers both.
+  uint8_t changed[HUE_STREAM_MESSAGE_MAX_CHANNELS *
+                  HUE_STREAM_MESSAGE_CHANNEL_SIZE];
+  int changed_count = 0;
+  if (!send_full) {
+    for (int i = 0; i < channel_count; i++) {
+      const size_t offset = i * HUE_STREAM_MESSAGE_CHANNEL_SIZE;
+      if (memcmp(channels + offset, encoder->last_sent + offset,
+                 HUE_STREAM_MESSAGE_CHANNEL_SIZE)) {
+        memcpy(changed + changed_count * HUE_STREAM_MESSAGE_CHANNEL_SIZE,
+               channels + offset, HUE_STREAM_MESSAGE_CHANNEL_SIZE);
+        changed_count++;
+      }
+    }
+
+    if (changed_count == 0) {
+      stats->packets_suppressed++;
+      stats->channels_suppressed += channel_count;
+      stats->bytes_saved += full_size;
+      return 0;
+    }
+  }
+
+  const uint8_t *data = send_full ? channels : changed;
+  const int data_count = send_full ? channel_count : changed_count;
+  if (hue_stream_message_buffer_write_serialized(
+          &encoder->buffer, encoder->sequence_id++, data, data_count)) {
+    fprintf(stderr, "hue_stream_message_buffer_write_serialized() failed\n");
+    return -1;
+  }
+
+  memcpy(encoder->last_sent, channels, channels_size);
+  encoder->has_last_sent = true;
+  if (send_full) {
+    encoder->frames_since_full = 0;
+  }
+
+  stats->packets_sent++;
+  stats->channels_sent += data_count;
+  stats->channels_suppressed += channel_count - data_count;
+  stats->bytes_sent += encoder->buffer.size;
+  stats->bytes_saved += full_size - encoder->buffer.size;
+  return 1;
+}
+
+void hue_stream_encoder_print_stats(const hue_stream_encoder *encoder) {
+  if (!encoder) {
+    fprintf(stderr, "encoder is null\n");
+    return;
+  }
+
+  const hue_stream_encoder_stats *stats = &encoder->stats;
+  printf("encoder: %llu frames, %llu packets sent, %llu packets suppressed, "
+         "%llu/%llu channels sent, %llu bytes sent, %llu bytes saved\n",
+         (unsigned long long)stats->frames,
+         (unsigned long long)stats->packets_sent,
+         (unsigned long long)stats->packets_suppressed,
+         (unsigned long long)stats->channels_sent,
+         (unsigned long long)(stats->channels_sent +
+                              stats->channels_suppressed),
+         (unsigned long long)stats->bytes_sent,
+         (unsigned long long)stats->bytes_saved);
+}
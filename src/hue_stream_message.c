@@ -1,9 +1,9 @@
 #include "hue_stream_message.h"
 
-#include <arpa/inet.h> // htons
-#include <stdio.h>     // fprintf, perror
-#include <stdlib.h>    // malloc
-#include <string.h>    // memcpy, memset
+#include <ctype.h>  // isxdigit
+#include <stdio.h>  // fprintf, perror
+#include <stdlib.h> // malloc, free
+#include <string.h> // memcmp, memcpy, memset
 
 hue_stream_message *
 hue_stream_message_create(const hue_stream_message_data *data,
@@ -55,6 +55,46 @@ hue_stream_message_create(const hue_stream_message_data *data,
   return message;
 }
 
+// Write the message header, which is identical for every frame apart from the
+// sequence ID.
+static void write_header(uint8_t *ptr, const hue_stream_message *message) {
+  memcpy(ptr, message->protocol_name, sizeof(message->protocol_name));
+  ptr += sizeof(message->protocol_name);
+
+  memcpy(ptr, message->version, sizeof(message->version));
+  ptr += sizeof(message->version);
+
+  memcpy(ptr, &message->sequence_id, sizeof(message->sequence_id));
+  ptr += sizeof(message->sequence_id);
+
+  memcpy(ptr, message->reserved1, sizeof(message->reserved1));
+  ptr += sizeof(message->reserved1);
+
+  memcpy(ptr, &message->color_space, sizeof(message->color_space));
+  ptr += sizeof(message->color_space);
+
+  memcpy(ptr, &message->reserved2, sizeof(message->reserved2));
+  ptr += sizeof(message->reserved2);
+
+  memcpy(ptr, message->entertainment_config_id,
+         sizeof(message->entertainment_config_id));
+}
+
+// Write the channel data. The color values are stored big-endian. Writing the
+// bytes directly converts every value in one pass instead of an htons() and
+// memcpy() per value.
+static void write_channels(uint8_t *ptr, const hue_stream_message_data *data,
+                           int channel_count) {
+  for (int i = 0; i < channel_count; i++) {
+    ptr[0] = data[i].channel_id;
+    for (int j = 0; j < HUE_STREAM_MESSAGE_COLOR_VALUE_ELEMENTS; j++) {
+      ptr[1 + 2 * j] = data[i].color_value[j] >> 8;
+      ptr[2 + 2 * j] = data[i].color_value[j] & 0xff;
+    }
+    ptr += HUE_STREAM_MESSAGE_CHANNEL_SIZE;
+  }
+}
+
 void hue_stream_message_serialize(const hue_stream_message *message,
                                   int channel_count, uint8_t **buffer,
                                   size_t *buffer_size) {
@@ -68,12 +108,8 @@ void hue_stream_message_serialize(const hue_stream_message *message,
     return;
   }
 
-  *buffer_size = sizeof(message->protocol_name) + sizeof(message->version) +
-                 sizeof(message->sequence_id) + sizeof(message->reserved1) +
-                 sizeof(message->color_space) + sizeof(message->reserved2) +
-                 sizeof(message->entertainment_config_id) +
-                 channel_count * (sizeof(message->data[0].channel_id) +
-                                  sizeof(message->data[0].color_value));
+  *buffer_size = HUE_STREAM_MESSAGE_HEADER_SIZE +
+                 channel_count * HUE_STREAM_MESSAGE_CHANNEL_SIZE;
 
   *buffer = malloc(*buffer_size);
   if (!*buffer) {
@@ -81,41 +117,205 @@ void hue_stream_message_serialize(const hue_stream_message *message,
     return;
   }
 
-  uint8_t *ptr = *buffer;
+  write_header(*buffer, message);
+  write_channels(*buffer + HUE_STREAM_MESSAGE_HEADER_SIZE, message->data,
+                 channel_count);
+}
 
-  memcpy(ptr, message->protocol_name, sizeof(message->protocol_name));
+// Whether an entertainment configuration ID is a UUID such as
+// 2d4cb563-4244-4bfc-9bb2-f5a08068df84.
+static bool valid_entertainment_config_id(const uint8_t *id) {
+  for (int i = 0; i < HUE_STREAM_MESSAGE_ENTERTAINMENT_CONFIG_ID_SIZE; i++) {
+    const bool dash = i == 8 || i == 13 || i == 18 || i == 23;
+    if (dash ? id[i] != '-' : !isxdigit(id[i])) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int hue_stream_message_parse(const uint8_t *buffer, size_t buffer_size,
+                             hue_stream_message *message, int *channel_count) {
+  if (!buffer || !message || !channel_count) {
+    fprintf(stderr, "buffer, message, or channel_count is null\n");
+    return -1;
+  }
+
+  if (buffer_size < HUE_STREAM_MESSAGE_HEADER_SIZE) {
+    fprintf(stderr, "message size (%zu) is shorter than the header\n",
+            buffer_size);
+    return -1;
+  }
+
+  const size_t channels_size = buffer_size - HUE_STREAM_MESSAGE_HEADER_SIZE;
+  const size_t count = channels_size / HUE_STREAM_MESSAGE_CHANNEL_SIZE;
+  if (channels_size % HUE_STREAM_MESSAGE_CHANNEL_SIZE ||
+      count > HUE_STREAM_MESSAGE_MAX_CHANNELS) {
+    fprintf(stderr, "message channel data size (%zu) is invalid\n",
+            channels_size);
+    return -1;
+  }
+
+  memset(message, 0, sizeof(hue_stream_message));
+
+  const uint8_t *ptr = buffer;
+  memcpy(message->protocol_name, ptr, sizeof(message->protocol_name));
   ptr += sizeof(message->protocol_name);
 
-  memcpy(ptr, message->version, sizeof(message->version));
+  memcpy(message->version, ptr, sizeof(message->version));
   ptr += sizeof(message->version);
 
-  memcpy(ptr, &message->sequence_id, sizeof(message->sequence_id));
+  message->sequence_id = *ptr;
   ptr += sizeof(message->sequence_id);
 
-  memcpy(ptr, message->reserved1, sizeof(message->reserved1));
+  memcpy(message->reserved1, ptr, sizeof(message->reserved1));
   ptr += sizeof(message->reserved1);
 
-  memcpy(ptr, &message->color_space, sizeof(message->color_space));
+  message->color_space = *ptr;
   ptr += sizeof(message->color_space);
 
-  memcpy(ptr, &message->reserved2, sizeof(message->reserved2));
+  message->reserved2 = *ptr;
   ptr += sizeof(message->reserved2);
 
-  memcpy(ptr, message->entertainment_config_id,
+  memcpy(message->entertainment_config_id, ptr,
          sizeof(message->entertainment_config_id));
   ptr += sizeof(message->entertainment_config_id);
 
-  for (int i = 0; i < channel_count; i++) {
-    memcpy(ptr, &message->data[i].channel_id,
-           sizeof(message->data[i].channel_id));
-    ptr += sizeof(message->data[i].channel_id);
+  if (memcmp(message->protocol_name, "HueStream",
+             sizeof(message->protocol_name))) {
+    fprintf(stderr, "message protocol name is invalid\n");
+    return -1;
+  }
+
+  if (message->version[0] != 0x02 || message->version[1] != 0x00) {
+    fprintf(stderr, "message version (%d.%d) is not supported\n",
+            message->version[0], message->version[1]);
+    return -1;
+  }
+
+  if (message->color_space != HUE_STREAM_MESSAGE_COLOR_SPACE_RGB &&
+      message->color_space != HUE_STREAM_MESSAGE_COLOR_SPACE_XY_BRIGHTNESS) {
+    fprintf(stderr, "message color space (%d) is invalid\n",
+            message->color_space);
+    return -1;
+  }
+
+  if (!valid_entertainment_config_id(message->entertainment_config_id)) {
+    fprintf(stderr, "message entertainment_config_id is invalid\n");
+    return -1;
+  }
 
+  bool seen[UINT8_MAX + 1] = {0};
+  for (size_t i = 0; i < count; i++) {
+    hue_stream_message_data *data = &message->data[i];
+    data->channel_id = ptr[0];
     for (int j = 0; j < HUE_STREAM_MESSAGE_COLOR_VALUE_ELEMENTS; j++) {
-      uint16_t color_value_net = htons(message->data[i].color_value[j]);
-      memcpy(ptr, &color_value_net, sizeof(color_value_net));
-      ptr += sizeof(color_value_net);
+      data->color_value[j] = ptr[1 + 2 * j] << 8 | ptr[2 + 2 * j];
     }
+    ptr += HUE_STREAM_MESSAGE_CHANNEL_SIZE;
+
+    if (seen[data->channel_id]) {
+      fprintf(stderr, "message channel %d is duplicated\n", data->channel_id);
+      return -1;
+    }
+    seen[data->channel_id] = true;
+  }
+
+  *channel_count = count;
+  return 0;
+}
+
+int hue_stream_message_buffer_init(hue_stream_message_buffer *buffer,
+                                   const char *entertainment_config_id,
+                                   uint8_t color_space) {
+  if (!buffer) {
+    fprintf(stderr, "buffer is null\n");
+    return -1;
+  }
+
+  if (color_space != HUE_STREAM_MESSAGE_COLOR_SPACE_RGB &&
+      color_space != HUE_STREAM_MESSAGE_COLOR_SPACE_XY_BRIGHTNESS) {
+    fprintf(stderr, "color_space (%d) is invalid\n", color_space);
+    return -1;
+  }
+
+  // Reuse the message validation and layout to build the header.
+  const hue_stream_message_data data = {0};
+  hue_stream_message *message =
+      hue_stream_message_create(&data, 0, entertainment_config_id);
+  if (!message) {
+    fprintf(stderr, "hue_stream_message_create() failed\n");
+    return -1;
   }
+
+  message->color_space = color_space;
+
+  memset(buffer, 0, sizeof(hue_stream_message_buffer));
+  write_header(buffer->data, message);
+  buffer->size = HUE_STREAM_MESSAGE_HEADER_SIZE;
+
+  free(message);
+  return 0;
+}
+
+int hue_stream_message_buffer_write(hue_stream_message_buffer *buffer,
+                                    uint8_t sequence_id,
+                                    const hue_stream_message_data *data,
+                                    int channel_count) {
+  if (!buffer || !data) {
+    fprintf(stderr, "buffer or data is null\n");
+    return -1;
+  }
+
+  if (!hue_stream_message_valid_channel_count(channel_count)) {
+    fprintf(stderr, "channel_count is out of range\n");
+    return -1;
+  }
+
+  buffer->data[HUE_STREAM_MESSAGE_SEQUENCE_ID_OFFSET] = sequence_id;
+  write_channels(buffer->data + HUE_STREAM_MESSAGE_HEADER_SIZE, data,
+                 channel_count);
+  buffer->size = HUE_STREAM_MESSAGE_HEADER_SIZE +
+                 channel_count * HUE_STREAM_MESSAGE_CHANNEL_SIZE;
+  return 0;
+}
+
+int hue_stream_message_buffer_write_serialized(
+    hue_stream_message_buffer *buffer, uint8_t sequence_id,
+    const uint8_t *channels, int channel_count) {
+  if (!buffer || !channels) {
+    fprintf(stderr, "buffer or channels is null\n");
+    return -1;
+  }
+
+  if (!hue_stream_message_valid_channel_count(channel_count)) {
+    fprintf(stderr, "channel_count is out of range\n");
+    return -1;
+  }
+
+  const size_t channels_size = channel_count * HUE_STREAM_MESSAGE_CHANNEL_SIZE;
+  buffer->data[HUE_STREAM_MESSAGE_SEQUENCE_ID_OFFSET] = sequence_id;
+  memcpy(buffer->data + HUE_STREAM_MESSAGE_HEADER_SIZE, channels,
+         channels_size);
+  buffer->size = HUE_STREAM_MESSAGE_HEADER_SIZE + channels_size;
+  return 0;
+}
+
+int hue_stream_message_serialize_channels(const hue_stream_message_data *data,
+                                          int channel_count,
+                                          uint8_t *channels) {
+  if (!data || !channels) {
+    fprintf(stderr, "data or channels is null\n");
+    return -1;
+  }
+
+  if (!hue_stream_message_valid_channel_count(channel_count)) {
+    fprintf(stderr, "channel_count is out of range\n");
+    return -1;
+  }
+
+  write_channels(channels, data, channel_count);
+  return 0;
 }
 
 bool hue_stream_message_valid_channel_count(int channel_count) {
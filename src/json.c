@@ -0,0 +1,270 @@
+#include "json.h"
+
+#include <stdio.h>  // fprintf
+#include <stdlib.h> // strtod, strtol
+#include <string.h> // strchr, strlen, strncmp
+
+#define JSON_MAX_DEPTH 64
+
+typedef struct json_parser json_parser;
+struct json_parser {
+  const char *json;
+  size_t length;
+  size_t position;
+  json_token *tokens;
+  int max_tokens;
+  int count;
+};
+
+static bool is_whitespace(char c) {
+  return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static void skip_whitespace(json_parser *parser) {
+  while (parser->position < parser->length &&
+         is_whitespace(parser->json[parser->position])) {
+    parser->position++;
+  }
+}
+
+// Take the next character if it is c.
+static bool accept(json_parser *parser, char c) {
+  skip_whitespace(parser);
+  if (parser->position < parser->length &&
+      parser->json[parser->position] == c) {
+    parser->position++;
+    return true;
+  }
+  return false;
+}
+
+// Add a token, or only count it when there is nowhere to store it.
+static int add_token(json_parser *parser, json_type type, size_t start) {
+  if (parser->tokens) {
+    if (parser->count >= parser->max_tokens) {
+      return -1;
+    }
+    parser->tokens[parser->count].type = type;
+    parser->tokens[parser->count].start = start;
+  }
+  return parser->count++;
+}
+
+// Set a token's end once its children have been parsed.
+static void end_token(json_parser *parser, int index, size_t end) {
+  if (parser->tokens) {
+    parser->tokens[index].end = end;
+    parser->tokens[index].next = parser->count;
+  }
+}
+
+static int parse_string(json_parser *parser) {
+  const int index = add_token(parser, JSON_STRING, ++parser->position);
+  if (index < 0) {
+    return -1;
+  }
+
+  while (parser->position < parser->length) {
+    const unsigned char c = parser->json[parser->position];
+    if (c == '"') {
+      end_token(parser, index, parser->position++);
+      return 0;
+    }
+    if (c < 0x20) {
+      return -1;
+    }
+    parser->position += c == '\\' ? 2 : 1;
+  }
+
+  return -1;
+}
+
+static int parse_primitive(json_parser *parser) {
+  const size_t start = parser->position;
+  while (parser->position < parser->length &&
+         !is_whitespace(parser->json[parser->position]) &&
+         !strchr(",:]}", parser->json[parser->position])) {
+    parser->position++;
+  }
+
+  if (parser->position == start ||
+      !strchr("-0123456789tfn", parser->json[start])) {
+    return -1;
+  }
+
+  const int index = add_token(parser, JSON_PRIMITIVE, start);
+  if (index < 0) {
+    return -1;
+  }
+  end_token(parser, index, parser->position);
+  return 0;
+}
+
+static int parse_value(json_parser *parser, int depth);
+
+// Parse the members of an object or the elements of an array.
+static int parse_container(json_parser *parser, int depth, bool object) {
+  const char close = object ? '}' : ']';
+  const int index =
+      add_token(parser, object ? JSON_OBJECT : JSON_ARRAY, parser->position++);
+  if (index < 0) {
+    return -1;
+  }
+
+  if (!accept(parser, close)) {
+    do {
+      if (object) {
+        skip_whitespace(parser);
+        if (parser->position >= parser->length ||
+            parser->json[parser->position] != '"' || parse_string(parser) ||
+            !accept(parser, ':')) {
+          return -1;
+        }
+      }
+
+      if (parse_value(parser, depth + 1)) {
+        return -1;
+      }
+    } while (accept(parser, ','));
+
+    if (!accept(parser, close)) {
+      return -1;
+    }
+  }
+
+  end_token(parser, index, parser->position);
+  return 0;
+}
+
+static int parse_value(json_parser *parser, int depth) {
+  if (depth > JSON_MAX_DEPTH) {
+    return -1;
+  }
+
+  skip_whitespace(parser);
+  if (parser->position >= parser->length) {
+    return -1;
+  }
+
+  switch (parser->json[parser->position]) {
+  case '{':
+    return parse_container(parser, depth, true);
+  case '[':
+    return parse_container(parser, depth, false);
+  case '"':
+    return parse_string(parser);
+  default:
+    return parse_primitive(parser);
+  }
+}
+
+int json_parse(const char *json, size_t length, json_token *tokens,
+               int max_tokens) {
+  if (!json) {
+    fprintf(stderr, "json is null\n");
+    return -1;
+  }
+
+  json_parser parser = {json, length, 0, tokens, max_tokens, 0};
+  if (parse_value(&parser, 0)) {
+    return -1;
+  }
+
+  skip_whitespace(&parser);
+  if (parser.position != length) {
+    return -1;
+  }
+
+  return parser.count;
+}
+
+int json_object_get(const char *json, const json_token *tokens, int object,
+                    const char *key) {
+  if (!json || !tokens || !key) {
+    fprintf(stderr, "json, tokens or key is null\n");
+    return -1;
+  }
+
+  if (object < 0 || tokens[object].type != JSON_OBJECT) {
+    return -1;
+  }
+
+  for (int i = object + 1; i < tokens[object].next; i = tokens[i + 1].next) {
+    if (json_string_equals(json, &tokens[i], key)) {
+      return i + 1;
+    }
+  }
+
+  return -1;
+}
+
+bool json_string_equals(const char *json, const json_token *token,
+                        const char *string) {
+  const size_t length = strlen(string);
+  return token->type == JSON_STRING && token->end - token->start == length &&
+         !strncmp(json + token->start, string, length);
+}
+
+int json_string_copy(const char *json, const json_token *token, char *string,
+                     size_t size) {
+  if (token->type != JSON_STRING || size == 0) {
+    return -1;
+  }
+
+  size_t length = 0;
+  for (size_t i = token->start; i < token->end; i++) {
+    if (length + 1 >= size) {
+      return -1;
+    }
+
+    char c = json[i];
+    if (c == '\\') {
+      switch (json[++i]) {
+      case 'b':
+        c = '\b';
+        break;
+      case 'f':
+        c = '\f';
+        break;
+      case 'n':
+        c = '\n';
+        break;
+      case 'r':
+        c = '\r';
+        break;
+      case 't':
+        c = '\t';
+        break;
+      case 'u': {
+        if (i + 4 >= token->end) {
+          return -1;
+        }
+        char hex[5] = {json[i + 1], json[i + 2], json[i + 3], json[i + 4]};
+        const long code = strtol(hex, NULL, 16);
+        c = code < 0x80 ? (char)code : '?';
+        i += 4;
+        break;
+      }
+      default:
+        c = json[i];
+        break;
+      }
+    }
+    string[length++] = c;
+  }
+
+  string[length] = '\0';
+  return 0;
+}
+
+int json_number(const char *json, const json_token *token, double *number) {
+  if (token->type != JSON_PRIMITIVE ||
+      !strchr("-0123456789", json[token->start])) {
+    return -1;
+  }
+
+  // The number is followed by a delimiter, which stops strtod().
+  char *end = NULL;
+  *number = strtod(json + token->start, &end);
+  return end == json + token->end ? 0 : -1;
+}
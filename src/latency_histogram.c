@@ -0,0 +1,110 @@
+#include "latency_histogram.h"
+
+#include <stdio.h>  // fprintf
+#include <string.h> // memset
+#include <time.h>   // clock_gettime
+
+#define SUB_BUCKETS (1 << LATENCY_HISTOGRAM_SUB_BUCKET_BITS)
+
+// Values below SUB_BUCKETS get a bucket each. Above that, the bucket is the
+// position of the most significant bit followed by the next
+// LATENCY_HISTOGRAM_SUB_BUCKET_BITS bits.
+static int bucket_index(uint64_t ns) {
+  if (ns < SUB_BUCKETS) {
+    return ns;
+  }
+
+  const int msb = 63 - __builtin_clzll(ns);
+  const int sub_bucket =
+      (ns >> (msb - LATENCY_HISTOGRAM_SUB_BUCKET_BITS)) & (SUB_BUCKETS - 1);
+  return ((msb - LATENCY_HISTOGRAM_SUB_BUCKET_BITS + 1)
+          << LATENCY_HISTOGRAM_SUB_BUCKET_BITS) +
+         sub_bucket;
+}
+
+// The largest value that falls in a bucket.
+static uint64_t bucket_upper_bound(int index) {
+  if (index < SUB_BUCKETS) {
+    return index;
+  }
+
+  const int msb =
+      (index >> LATENCY_HISTOGRAM_SUB_BUCKET_BITS) +
+      LATENCY_HISTOGRAM_SUB_BUCKET_BITS - 1;
+  const int shift = msb - LATENCY_HISTOGRAM_SUB_BUCKET_BITS;
+  const uint64_t lower = (uint64_t)(SUB_BUCKETS | (index & (SUB_BUCKETS - 1)))
+                         << shift;
+  return lower + ((uint64_t)1 << shift) - 1;
+}
+
+void latency_histogram_init(latency_histogram *histogram) {
+  if (!histogram) {
+    fprintf(stderr, "histogram is null\n");
+    return;
+  }
+
+  memset(histogram, 0, sizeof(latency_histogram));
+}
+
+// With a single writer, a relaxed load and store is enough and avoids a
+// locked read-modify-write.
+void latency_histogram_add(atomic_uint_least64_t *counter, uint64_t value) {
+  atomic_store_explicit(
+      counter, atomic_load_explicit(counter, memory_order_relaxed) + value,
+      memory_order_relaxed);
+}
+
+void latency_histogram_record(latency_histogram *histogram, uint64_t ns) {
+  latency_histogram_add(&histogram->buckets[bucket_index(ns)], 1);
+  latency_histogram_add(&histogram->count, 1);
+  latency_histogram_add(&histogram->total_ns, ns);
+  if (ns > atomic_load_explicit(&histogram->max_ns, memory_order_relaxed)) {
+    atomic_store_explicit(&histogram->max_ns, ns, memory_order_relaxed);
+  }
+}
+
+uint64_t latency_histogram_percentile(const latency_histogram *histogram,
+                                      double percentile) {
+  if (!histogram) {
+    fprintf(stderr, "histogram is null\n");
+    return 0;
+  }
+
+  // Sum the buckets instead of reading count, which the writer might have
+  // updated separately.
+  uint64_t buckets[LATENCY_HISTOGRAM_BUCKETS] = {0};
+  uint64_t count = 0;
+  for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+    buckets[i] =
+        atomic_load_explicit(&histogram->buckets[i], memory_order_relaxed);
+    count += buckets[i];
+  }
+
+  if (count == 0) {
+    return 0;
+  }
+
+  // Bucket bounds can overshoot the largest latency recorded.
+  const uint64_t max_ns =
+      atomic_load_explicit(&histogram->max_ns, memory_order_relaxed);
+
+  const double rank = percentile / 100 * count;
+  uint64_t seen = 0;
+  int index = LATENCY_HISTOGRAM_BUCKETS - 1;
+  for (int i = 0; i < LATENCY_HISTOGRAM_BUCKETS; i++) {
+    seen += buckets[i];
+    if (seen > 0 && seen >= rank) {
+      index = i;
+      break;
+    }
+  }
+
+  const uint64_t upper_bound = bucket_upper_bound(index);
+  return upper_bound < max_ns ? upper_bound : max_ns;
+}
+
+uint64_t latency_histogram_now_ns(void) {
+  struct timespec now = {0};
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint64_t)now.tv_sec * 1000000000ULL + now.tv_nsec;
+}
@@ -1,252 +1,1962 @@
+#include "ambilight.h"
 #include "animation.h"
+#include "audio_analyzer.h"
+#include "cue_sheet.h"
+#include "event_loop.h"
+#include "frame_file.h"
+#include "frame_scheduler.h"
+#include "frame_slot.h"
+#include "gamut.h"
 #include "hue_dtls_client.h"
-#include "hue_rest_client.h"
+#include "hue_stream_encoder.h"
+#include "media_sync.h"
+#include "offline_renderer.h"
+#include "realtime.h"
+#include "show_log.h"
+#include "stream_metrics.h"
+#include "stream_session.h"
+#include "wav_reader.h"
+#include "y4m_reader.h"
+#include <getopt.h>   // getopt_long
+#include <inttypes.h> // PRIu64
+#include <limits.h>   // INT_MAX
 #include <pthread.h>
+#include <sched.h> // SCHED_FIFO, sched_get_priority_max
 #include <signal.h>
+#include <stdatomic.h> // atomic_bool
 #include <stdbool.h>
-#include <stdio.h>  // fprintf, printf, getchar
-#include <stdlib.h> // free, srand
-#include <string.h> // memcpy
-#include <time.h>   // nanosleep
+#include <stdio.h>  // fprintf, printf, fgets, getchar
+#include <stdlib.h> // atoi, strtod, strtol, strtoull
+#include <string.h> // memcpy, memmove, memset, strchr, strcmp
+#include <time.h>   // time
+#include <unistd.h> // STDIN_FILENO, read
 
+// The number of channels rendered offline, where there is no bridge to
+// discover them from.
 #define CHANNEL_COUNT 10
-#define ENTERTAINMENT_CONFIG_ID "2d4cb563-4244-4bfc-9bb2-f5a08068df84"
 
 #define FRAMES_PER_SECOND 60
-#define NANOSECONDS_PER_FRAME (1000000000L / FRAMES_PER_SECOND)
 
-pthread_mutex_t current_frame_mutex = {0};
-hue_stream_message_data current_frame[CHANNEL_COUNT] = {0};
+// Audio is analyzed once per frame, so sample rates above this would need
+// more samples per frame than the buffer holds.
+#define MAX_SAMPLE_RATE 192000
+#define MAX_HOP_SIZE (MAX_SAMPLE_RATE / FRAMES_PER_SECOND)
+
+// The bridge ends the entertainment session after 10 seconds without a
+// message. Sending the whole frame every second keeps it alive and repairs
+// lost updates quickly.
+#define KEEPALIVE_FRAMES FRAMES_PER_SECOND
+
+// Written by the render loop, read by the stream thread.
+frame_slot current_frame = {0};
 
 bool streaming = true;
 
-typedef struct stream_thread_args stream_thread_args;
-struct stream_thread_args {
-  hue_dtls_context *context;
-};
+// Hot path timings, printed on exit or on SIGUSR1.
+stream_metrics metrics = {0};
+
+// The entertainment areas streamed to. Each one takes the next slice of the
+// global channel map, which the render loop animates as a single frame.
+stream_session sessions[STREAM_SESSION_MAX_SESSIONS] = {0};
+int session_count = 0;
+int channel_map_size = 0;
+
+// Starts and stops the areas, keeping a connection to each bridge.
+hue_rest_client *rest_client = NULL;
+
+// When main() started, to time startup against.
+uint64_t launch_ns = 0;
+
+// Whether a frame has been sent yet. Only written by the thread that streams.
+bool first_frame_sent = false;
+
+// How far ahead of the clock frames are rendered, to make up for the time they
+// take to reach the lights, and how much further ahead each channel of the
+// channel map is rendered, for lights that react more slowly.
+long lookahead_ns = 0;
+long channel_lookahead_ns[STREAM_SESSION_MAX_CHANNELS] = {0};
+
+// How the threads that stream and render are scheduled, and whether memory is
+// locked so the hot path never waits for a page to be read back in.
+realtime_thread stream_realtime = {.priority = 0, .cpu = -1};
+realtime_thread render_realtime = {.priority = 0, .cpu = -1};
+bool lock_memory = false;
+
+// Channels with the same lookahead are rendered together, so each distinct
+// lookahead costs a render of the frame.
+#define MAX_LOOKAHEAD_GROUPS 8
+
+// Wait for the next frame, counting the deadlines missed on the way and
+// recording how late the thread woke up.
+static int wait_for_next_frame(frame_scheduler *scheduler,
+                               atomic_uint_least64_t *deadline_misses,
+                               stream_stage jitter) {
+  const uint64_t misses = scheduler->deadline_misses;
+  if (frame_scheduler_wait(scheduler)) {
+    fprintf(stderr, "frame_scheduler_wait() failed\n");
+    return -1;
+  }
+
+  stream_metrics_count(deadline_misses, scheduler->deadline_misses - misses);
+
+  // The deadline waited for is a period before the next one.
+  const uint64_t now_ns = latency_histogram_now_ns();
+  const uint64_t deadline_ns =
+      (uint64_t)scheduler->deadline.tv_sec * 1000000000ULL +
+      scheduler->deadline.tv_nsec - scheduler->period_ns;
+  latency_histogram_record(&metrics.stages[jitter],
+                           now_ns > deadline_ns ? now_ns - deadline_ns : 0);
+  return 0;
+}
+
+// Send the encoded message, timing the send and counting the outcome.
+static int send_encoded(hue_dtls_context *context,
+                        const hue_stream_encoder *encoder) {
+  const uint64_t start_ns = latency_histogram_now_ns();
+  const int ret = hue_dtls_send_buffer(context, &encoder->buffer);
+  stream_metrics_record(&metrics, STREAM_STAGE_SEND, start_ns);
+
+  if (ret) {
+    stream_metrics_count(&metrics.send_failures, 1);
+    fprintf(stderr, "hue_dtls_send_buffer() failed\n");
+    return -1;
+  }
+
+  stream_metrics_count(&metrics.frames_sent, 1);
+  if (!first_frame_sent) {
+    first_frame_sent = true;
+    printf("First frame sent %.1f ms after launch\n",
+           (latency_histogram_now_ns() - launch_ns) / 1e6);
+  }
+  return 0;
+}
+
+// Send every area its slice of the frame back to back, so they all receive it
+// at nearly the same time, and record how far apart they did.
+static int send_sessions(const hue_stream_encoder *encoders,
+                         const bool *encoded) {
+  uint64_t first_sent_ns = 0;
+  uint64_t last_sent_ns = 0;
+  int sent = 0;
+  for (int i = 0; i < session_count; i++) {
+    if (!encoded[i]) {
+      continue;
+    }
+
+    if (send_encoded(sessions[i].context, &encoders[i])) {
+      return -1;
+    }
+
+    last_sent_ns = latency_histogram_now_ns();
+    if (sent++ == 0) {
+      first_sent_ns = last_sent_ns;
+    }
+  }
+
+  if (sent > 1) {
+    latency_histogram_record(&metrics.stages[STREAM_STAGE_SKEW],
+                             last_sent_ns - first_sent_ns);
+  }
+  return 0;
+}
+
+// Set up an encoder for every area. Only the channels that changed are sent.
+// The encoders build the message headers once and reuse their buffers, so
+// streaming doesn't allocate.
+static int init_encoders(hue_stream_encoder *encoders) {
+  for (int i = 0; i < session_count; i++) {
+    if (hue_stream_encoder_init(&encoders[i],
+                                sessions[i].entertainment_config_id,
+                                HUE_STREAM_MESSAGE_COLOR_SPACE_XY_BRIGHTNESS,
+                                KEEPALIVE_FRAMES)) {
+      fprintf(stderr, "hue_stream_encoder_init() failed\n");
+      return -1;
+    }
+  }
+  return 0;
+}
+
+// Send every area its slice of the frame.
+static int stream_frame(hue_stream_encoder *encoders,
+                        const hue_stream_message_data *frame) {
+  // Encode every slice before sending any, to keep encoding out of the skew.
+  const uint64_t start_ns = latency_histogram_now_ns();
+  bool encoded[STREAM_SESSION_MAX_SESSIONS] = {0};
+  for (int i = 0; i < session_count; i++) {
+    const int ret = hue_stream_encoder_encode(
+        &encoders[i], frame + sessions[i].first_channel,
+        sessions[i].channel_count);
+    if (ret < 0) {
+      fprintf(stderr, "hue_stream_encoder_encode() failed\n");
+      return -1;
+    }
+    encoded[i] = ret;
+  }
+  stream_metrics_record(&metrics, STREAM_STAGE_ENCODE, start_ns);
+
+  return send_sessions(encoders, encoded);
+}
+
+static void print_encoder_stats(const hue_stream_encoder *encoders) {
+  for (int i = 0; i < session_count; i++) {
+    printf("%s %s\n", sessions[i].bridge_ip,
+           sessions[i].entertainment_config_id);
+    hue_stream_encoder_print_stats(&encoders[i]);
+  }
+}
 
 void *stream(void *arg) {
-  const stream_thread_args *args = (stream_thread_args *)arg;
+  (void)arg;
+  realtime_thread_apply(&stream_realtime, "stream");
+
+  // Stream at the specified frame rate. A late frame is stale by the time it
+  // would be sent, so skip it instead of sending a burst.
+  frame_scheduler scheduler = {0};
+  if (frame_scheduler_init(&scheduler, FRAMES_PER_SECOND,
+                           FRAME_SCHEDULER_OVERRUN_SKIP)) {
+    fprintf(stderr, "frame_scheduler_init() failed\n");
+    return NULL;
+  }
+
+  hue_stream_encoder encoders[STREAM_SESSION_MAX_SESSIONS] = {0};
+  if (init_encoders(encoders)) {
+    return NULL;
+  }
 
   while (streaming) {
-    // Copy the current frame to minimize the time the mutex is locked.
-    hue_stream_message_data frame_copy[CHANNEL_COUNT] = {0};
-    pthread_mutex_lock(&current_frame_mutex);
-    memcpy(frame_copy, current_frame, sizeof(current_frame));
-    pthread_mutex_unlock(&current_frame_mutex);
-
-    hue_stream_message *message = hue_stream_message_create(
-        frame_copy, CHANNEL_COUNT, ENTERTAINMENT_CONFIG_ID);
-    if (!message) {
-      fprintf(stderr, "hue_stream_message_create() failed\n");
-      return NULL;
+    const uint64_t start_ns = latency_histogram_now_ns();
+    bool updated = false;
+    const hue_stream_message_data *frame =
+        frame_slot_acquire(&current_frame, &updated);
+    const uint64_t acquired_ns =
+        stream_metrics_record(&metrics, STREAM_STAGE_ACQUIRE, start_ns);
+
+    // How long a new frame sat in the slot, waiting for this thread.
+    const uint64_t published_ns = frame_slot_published_ns(&current_frame);
+    if (updated && published_ns) {
+      latency_histogram_record(&metrics.stages[STREAM_STAGE_WAIT],
+                               acquired_ns - published_ns);
     }
 
-    if (hue_dtls_send_message(args->context, message, CHANNEL_COUNT)) {
-      fprintf(stderr, "hue_dtls_send_message() failed\n");
+    if (stream_frame(encoders, frame)) {
       return NULL;
     }
 
-    free(message);
-
-    // Stream at the specified frame rate.
-    struct timespec ts = {.tv_sec = 0, .tv_nsec = NANOSECONDS_PER_FRAME};
-    nanosleep(&ts, NULL);
+    if (wait_for_next_frame(&scheduler, &metrics.stream_deadline_misses,
+                            STREAM_STAGE_STREAM_JITTER)) {
+      return NULL;
+    }
   }
 
+  frame_scheduler_print_stats(&scheduler, "stream");
+  print_encoder_stats(encoders);
   return NULL;
 }
 
-static hue_dtls_context *connect_to_bridge(const char *bridge_ip) {
-  if (!bridge_ip) {
-    fprintf(stderr, "bridge_ip is null\n");
-    return NULL;
+volatile sig_atomic_t animating = true;
+
+static void handle_signal(int signal) {
+  if (signal == SIGINT) {
+    animating = false;
   }
+}
+
+// Play a pre-rendered animation straight from the memory-mapped frame file.
+// Each frame is a pointer lookup by elapsed time, so nothing is computed here.
+void *play(void *arg) {
+  const frame_file *file = (const frame_file *)arg;
+  const stream_session *session = &sessions[0];
+  realtime_thread_apply(&stream_realtime, "play");
 
-  // Start entertainment area streaming.
-  if (hue_rest_start_entertainment_area_streaming(bridge_ip,
-                                                  ENTERTAINMENT_CONFIG_ID)) {
-    fprintf(stderr, "hue_rest_start_entertainment_area_streaming() failed\n");
+  frame_scheduler scheduler = {0};
+  if (frame_scheduler_init(&scheduler, file->frames_per_second,
+                           FRAME_SCHEDULER_OVERRUN_SKIP)) {
+    fprintf(stderr, "frame_scheduler_init() failed\n");
     return NULL;
   }
 
-  // Perform the DTLS handshake.
-  hue_dtls_context *context = hue_dtls_context_create();
-  if (!context) {
-    fprintf(stderr, "hue_dtls_context_create() failed\n");
+  hue_stream_encoder encoder = {0};
+  if (hue_stream_encoder_init(&encoder, session->entertainment_config_id,
+                              HUE_STREAM_MESSAGE_COLOR_SPACE_XY_BRIGHTNESS,
+                              KEEPALIVE_FRAMES)) {
+    fprintf(stderr, "hue_stream_encoder_init() failed\n");
     return NULL;
   }
 
-  if (hue_dtls_connect(context, bridge_ip)) {
-    fprintf(stderr, "hue_dtls_connect() failed\n");
-    hue_dtls_context_free(context);
-    return NULL;
+  while (animating) {
+    const struct timespec *start = &scheduler.start_time;
+    struct timespec now = {0};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    const int64_t elapsed_ns = (int64_t)(now.tv_sec - start->tv_sec) *
+                                   1000000000L +
+                               (now.tv_nsec - start->tv_nsec);
+
+    const uint8_t *channels =
+        frame_file_frame_at(file, elapsed_ns + lookahead_ns);
+    if (!channels) {
+      break;
+    }
+
+    const uint64_t start_ns = latency_histogram_now_ns();
+    const int encoded = hue_stream_encoder_encode_serialized(
+        &encoder, channels, file->channel_count);
+    stream_metrics_record(&metrics, STREAM_STAGE_ENCODE, start_ns);
+    if (encoded < 0) {
+      fprintf(stderr, "hue_stream_encoder_encode_serialized() failed\n");
+      return NULL;
+    }
+
+    if (encoded && send_encoded(session->context, &encoder)) {
+      return NULL;
+    }
+
+    if (wait_for_next_frame(&scheduler, &metrics.stream_deadline_misses,
+                            STREAM_STAGE_STREAM_JITTER)) {
+      return NULL;
+    }
   }
 
-  return context;
+  frame_scheduler_print_stats(&scheduler, "play");
+  hue_stream_encoder_print_stats(&encoder);
+
+  // Turn lights off after the animation ends or is interrupted.
+  hue_stream_message_data frame[HUE_STREAM_MESSAGE_MAX_CHANNELS] = {0};
+  stream_session_initialize_frame(session, 1, frame);
+  if (hue_stream_encoder_encode(&encoder, frame, file->channel_count) > 0 &&
+      hue_dtls_send_buffer(session->context, &encoder.buffer)) {
+    fprintf(stderr, "hue_dtls_send_buffer() failed\n");
+  }
+  return NULL;
 }
 
-static void initialize_frame(hue_stream_message_data *frame,
-                             int channel_count) {
+// Group the channels by their lookahead. Returns the number of groups, or -1
+// if there are more than MAX_LOOKAHEAD_GROUPS.
+static int group_channels(int channel_count, long *group_lookaheads,
+                          int *channel_groups) {
+  int group_count = 0;
   for (int i = 0; i < channel_count; i++) {
-    frame[i].channel_id = i;
-    frame[i].color_value[0] = 0;
-    frame[i].color_value[1] = 0;
-    frame[i].color_value[2] = 0;
+    int group = 0;
+    while (group < group_count &&
+           group_lookaheads[group] != channel_lookahead_ns[i]) {
+      group++;
+    }
+
+    if (group == group_count) {
+      if (group_count == MAX_LOOKAHEAD_GROUPS) {
+        return -1;
+      }
+      group_lookaheads[group_count++] = channel_lookahead_ns[i];
+    }
+    channel_groups[i] = group;
   }
+  return group_count;
 }
 
-volatile sig_atomic_t animating = true;
+// A cue sheet playing across the channel map. Each lookahead group renders a
+// frame of its own with its own cue cursor and random numbers, since effects
+// like hold leave the previous frame as it was.
+typedef struct show show;
+struct show {
+  const cue_sheet *sheet;
+  int channel_count;
+  // Set once per frame, so every group renders the same moment and a replay
+  // can render the same moments again.
+  animation_clock clock;
+  int group_count;
+  int channel_groups[STREAM_SESSION_MAX_CHANNELS];
+  animation_context contexts[MAX_LOOKAHEAD_GROUPS];
+  hue_stream_message_data frames[MAX_LOOKAHEAD_GROUPS]
+                                [STREAM_SESSION_MAX_CHANNELS];
+  hue_stream_message_data initial_frame[STREAM_SESSION_MAX_CHANNELS];
+};
 
-static void handle_signal(int signal) {
-  if (signal == SIGINT) {
-    animating = false;
+// The seed of every show's random numbers.
+static uint64_t show_seed = 0;
+
+// Where to log shows for replay, if anywhere.
+static const char *show_log_path = NULL;
+
+// Start a show at a time on its clock, from a frame with every light off.
+static int show_init(show *show, const cue_sheet *sheet, int channel_count,
+                     const struct timespec *start_time, uint64_t seed,
+                     const hue_stream_message_data *initial_frame) {
+  long group_lookaheads[MAX_LOOKAHEAD_GROUPS] = {0};
+  show->group_count =
+      group_channels(channel_count, group_lookaheads, show->channel_groups);
+  if (show->group_count < 0) {
+    fprintf(stderr, "Too many channel lookaheads\n");
+    return -1;
+  }
+
+  show->sheet = sheet;
+  show->channel_count = channel_count;
+  animation_clock_init_manual(&show->clock, start_time);
+  memcpy(show->initial_frame, initial_frame,
+         channel_count * sizeof(hue_stream_message_data));
+
+  for (int i = 0; i < show->group_count; i++) {
+    animation_context *context = &show->contexts[i];
+    if (animation_context_init(context, &show->clock)) {
+      fprintf(stderr, "animation_context_init() failed\n");
+      return -1;
+    }
+    animation_context_seed(context, seed);
+    context->lookahead_ns = lookahead_ns + group_lookaheads[i];
+    memcpy(show->frames[i], initial_frame,
+           channel_count * sizeof(hue_stream_message_data));
+  }
+  return 0;
+}
+
+// Render the frame at a time. The show runs until every group has ended.
+static animation_status show_render(show *show, const struct timespec *time,
+                                    hue_stream_message_data *frame) {
+  animation_clock_set(&show->clock, time);
+
+  animation_status status = ANIMATION_STATUS_END;
+  for (int i = 0; i < show->group_count && status != ANIMATION_STATUS_ERROR;
+       i++) {
+    const animation_status group_status = animation_cue_sheet(
+        show->frames[i], show->channel_count, &show->contexts[i], show->sheet);
+    if (group_status != ANIMATION_STATUS_END) {
+      status = group_status;
+    }
+  }
+
+  for (int i = 0; i < show->channel_count; i++) {
+    frame[i] = show->frames[show->channel_groups[i]][i];
+  }
+  return status;
+}
+
+// Turn every light off, in the groups' frames too.
+static void show_reset(show *show, hue_stream_message_data *frame) {
+  const size_t size = show->channel_count * sizeof(hue_stream_message_data);
+  memcpy(frame, show->initial_frame, size);
+  for (int i = 0; i < show->group_count; i++) {
+    memcpy(show->frames[i], show->initial_frame, size);
+  }
+}
+
+// Open the show log and write what the show needs to be replayed.
+static FILE *open_show_log(const show *show, int menu_number, uint64_t seed) {
+  FILE *file = fopen(show_log_path, "w");
+  if (!file) {
+    perror("fopen");
+    return NULL;
+  }
+
+  static show_log_header header;
+  memset(&header, 0, sizeof(header));
+  header.sheet = menu_number;
+  snprintf(header.title, sizeof(header.title), "%s", show->sheet->title);
+  header.seed = seed;
+  header.channel_count = show->channel_count;
+  header.start_time = show->contexts[0].start_time;
+  header.lookahead_ns = lookahead_ns;
+  memcpy(header.channel_lookahead_ns, channel_lookahead_ns,
+         sizeof(header.channel_lookahead_ns));
+  if (show_log_write_header(file, &header)) {
+    fclose(file);
+    return NULL;
   }
+  return file;
 }
 
-static void animate(int animation) {
+// The media player that animations follow, if any.
+static media_sync *player_sync = NULL;
+
+// A show playing live, on the clock of the media player it follows or on
+// CLOCK_MONOTONIC.
+typedef struct playback playback;
+struct playback {
+  animation_clock monotonic;
+  animation_clock *clock;
+  show show;
+  FILE *log;
+  // Colors are rendered as they are, then moved into the gamut of each
+  // channel's light.
+  gamut_type gamuts[STREAM_SESSION_MAX_CHANNELS];
+  hue_stream_message_data frame[STREAM_SESSION_MAX_CHANNELS];
+};
+
+static int playback_start(playback *playback, const cue_sheet *sheet,
+                          int menu_number) {
+  animation_clock_init_monotonic(&playback->monotonic);
+  playback->clock = player_sync ? &player_sync->clock : &playback->monotonic;
+  playback->log = NULL;
+
+  // Following a player, cue times are positions in the media.
   struct timespec start_time = {0};
-  if (clock_gettime(CLOCK_MONOTONIC, &start_time)) {
-    fprintf(stderr, "clock_gettime() failed\n");
+  if (!player_sync && animation_clock_now(playback->clock, &start_time)) {
+    fprintf(stderr, "animation_clock_now() failed\n");
+    return -1;
+  }
+
+  stream_session_initialize_frame(sessions, session_count, playback->frame);
+  if (show_init(&playback->show, sheet, channel_map_size, &start_time,
+                show_seed, playback->frame)) {
+    return -1;
+  }
+
+  if (show_log_path) {
+    playback->log = open_show_log(&playback->show, menu_number, show_seed);
+    if (!playback->log) {
+      return -1;
+    }
+  }
+
+  stream_session_gamuts(sessions, session_count, playback->gamuts);
+  return 0;
+}
+
+// Render the frame for now into mapped. Returns false once the show is over.
+static bool playback_render(playback *playback,
+                            hue_stream_message_data *mapped) {
+  const uint64_t start_ns = latency_histogram_now_ns();
+  struct timespec now = {0};
+  if (animation_clock_now(playback->clock, &now)) {
+    fprintf(stderr, "animation_clock_now() failed\n");
+    return false;
+  }
+
+  const animation_status status =
+      show_render(&playback->show, &now, playback->frame);
+  if (status == ANIMATION_STATUS_ERROR) {
+    fprintf(stderr, "Animation failed\n");
+    return false;
+  }
+
+  if (status == ANIMATION_STATUS_END && !player_sync) {
+    return false;
+  }
+
+  // The player can seek back into the cue sheet, so the lights only go
+  // dark outside of it.
+  if (status == ANIMATION_STATUS_END) {
+    show_reset(&playback->show, playback->frame);
+  }
+
+  if (player_sync && !media_sync_connected(player_sync)) {
+    printf("The media player disconnected\n");
+    return false;
+  }
+
+  if (playback->log &&
+      show_log_write_frame(playback->log, &now,
+                           show_log_hash(playback->frame, channel_map_size))) {
+    return false;
+  }
+
+  gamut_map_frame(playback->gamuts, playback->frame, mapped,
+                  channel_map_size);
+  stream_metrics_record(&metrics, STREAM_STAGE_RENDER, start_ns);
+  return true;
+}
+
+static void playback_stop(playback *playback) {
+  if (player_sync) {
+    media_sync_print_stats(player_sync);
+  }
+
+  if (playback->log && fclose(playback->log)) {
+    perror("fclose");
+  }
+  playback->log = NULL;
+}
+
+static void animate(const cue_sheet *sheet, int menu_number) {
+  static playback playback;
+  if (playback_start(&playback, sheet, menu_number)) {
     return;
   }
 
-  hue_stream_message_data frame[CHANNEL_COUNT] = {0};
-  initialize_frame(frame, CHANNEL_COUNT);
+  // Animate at the specified frame rate.
+  frame_scheduler scheduler = {0};
+  if (frame_scheduler_init(&scheduler, FRAMES_PER_SECOND,
+                           FRAME_SCHEDULER_OVERRUN_SKIP)) {
+    fprintf(stderr, "frame_scheduler_init() failed\n");
+    playback_stop(&playback);
+    return;
+  }
 
+  hue_stream_message_data mapped[STREAM_SESSION_MAX_CHANNELS] = {0};
   animating = true;
   while (animating) {
-    animation_status status = 0;
-    switch (animation) {
-    case ANIMATION_THX_DEEP_NOTE:
-      status = animation_thx_deep_note(frame, CHANNEL_COUNT, &start_time);
-      break;
-    case ANIMATION_SPIDER_MAN_INTO_THE_SPIDER_VERSE:
-      status = animation_spider_man_into_the_spider_verse(frame, CHANNEL_COUNT,
-                                                          &start_time);
-      break;
-    case ANIMATION_SPIDER_MAN_ACROSS_THE_SPIDER_VERSE:
-      status = animation_spider_man_across_the_spider_verse(
-          frame, CHANNEL_COUNT, &start_time);
+    if (!playback_render(&playback, mapped)) {
+      animating = false;
       break;
-    default:
-      fprintf(stderr, "Invalid animation\n");
+    }
+
+    // Update the current frame.
+    const uint64_t start_ns = latency_histogram_now_ns();
+    frame_slot_publish(&current_frame, mapped, start_ns);
+    stream_metrics_record(&metrics, STREAM_STAGE_PUBLISH, start_ns);
+
+    if (wait_for_next_frame(&scheduler, &metrics.render_deadline_misses,
+                            STREAM_STAGE_RENDER_JITTER)) {
       animating = false;
       break;
     }
+  }
+
+  frame_scheduler_print_stats(&scheduler, "animation");
+  playback_stop(&playback);
+
+  // Turn lights off after the animation ends or is interrupted.
+  hue_stream_message_data frame[STREAM_SESSION_MAX_CHANNELS] = {0};
+  stream_session_initialize_frame(sessions, session_count, frame);
+  frame_slot_publish(&current_frame, frame, 0);
+}
+
+// Replay a logged show offline and check every frame against its hash.
+static int replay_show(const char *path, const cue_sheet *const *sheets,
+                       int sheet_count) {
+  FILE *file = fopen(path, "r");
+  if (!file) {
+    perror("fopen");
+    return -1;
+  }
+
+  int ret = -1;
+  static show_log_header header;
+  if (show_log_read_header(file, &header)) {
+    fprintf(stderr, "show_log_read_header() failed\n");
+    goto exit;
+  }
+
+  if (header.sheet < 1 || header.sheet > sheet_count ||
+      strcmp(sheets[header.sheet - 1]->title, header.title)) {
+    fprintf(stderr, "The show played %s, which isn't menu number %d\n",
+            header.title, header.sheet);
+    goto exit;
+  }
+
+  lookahead_ns = header.lookahead_ns;
+  memcpy(channel_lookahead_ns, header.channel_lookahead_ns,
+         sizeof(channel_lookahead_ns));
+
+  hue_stream_message_data frame[STREAM_SESSION_MAX_CHANNELS] = {0};
+  for (int i = 0; i < header.channel_count; i++) {
+    frame[i].channel_id = i;
+  }
+
+  static show show;
+  if (show_init(&show, sheets[header.sheet - 1], header.channel_count,
+                &header.start_time, header.seed, frame)) {
+    goto exit;
+  }
 
+  int frames = 0;
+  int mismatches = 0;
+  struct timespec time = {0};
+  uint64_t hash = 0;
+  int read = 0;
+  while ((read = show_log_read_frame(file, &time, &hash)) == 1) {
+    const animation_status status = show_render(&show, &time, frame);
     if (status == ANIMATION_STATUS_ERROR) {
       fprintf(stderr, "Animation failed\n");
-      animating = false;
-      break;
+      goto exit;
     }
 
     if (status == ANIMATION_STATUS_END) {
-      animating = false;
-      break;
+      show_reset(&show, frame);
     }
 
-    // Update the current frame.
-    pthread_mutex_lock(&current_frame_mutex);
-    memcpy(current_frame, frame, sizeof(frame));
-    pthread_mutex_unlock(&current_frame_mutex);
+    if (show_log_hash(frame, header.channel_count) != hash) {
+      if (!mismatches) {
+        printf("Frame %d differs from the log\n", frames);
+      }
+      mismatches++;
+    }
+    frames++;
+  }
 
-    // Animate at the specified frame rate.
-    struct timespec ts = {.tv_sec = 0, .tv_nsec = NANOSECONDS_PER_FRAME};
-    nanosleep(&ts, NULL);
+  if (read < 0) {
+    goto exit;
   }
 
-  // Turn lights off after the animation ends or is interrupted.
-  initialize_frame(current_frame, CHANNEL_COUNT);
+  printf("Replayed %d frames of %s with seed %" PRIu64 ": %d differ\n",
+         frames, header.title, header.seed, mismatches);
+  ret = mismatches ? -1 : 0;
+
+exit:
+  fclose(file);
+  return ret;
+}
+
+static void print_menu(const cue_sheet *const *sheets, int sheet_count) {
+  printf("\n--------------------------------\n");
+  for (int i = 0; i < sheet_count; i++) {
+    printf("%d. %s\n", i + 1, sheets[i]->title);
+  }
+  printf("%d. Quit\n", sheet_count + 1);
+  printf("--------------------------------\n");
+
+  printf("Enter your choice: ");
+  fflush(stdout);
 }
 
-static void display_menu() {
+static void display_menu(const cue_sheet *const *sheets, int sheet_count) {
   while (true) {
-    printf("\n--------------------------------\n");
-    printf("1. THX Deep Note\n");
-    printf("2. Spider-Man: Into the Spider-Verse\n");
-    printf("3. Spider-Man: Across the Spider-Verse\n");
-    printf("4. Quit\n");
-    printf("--------------------------------\n");
-
-    printf("Enter your choice: ");
-    int choice = getchar();
-    int c = 0;
-    while ((c = getchar()) != '\n' && c != EOF)
-      ;
-
-    switch (choice) {
-    case '1':
-      animate(ANIMATION_THX_DEEP_NOTE);
-      break;
-    case '2':
-      animate(ANIMATION_SPIDER_MAN_INTO_THE_SPIDER_VERSE);
-      break;
-    case '3':
-      animate(ANIMATION_SPIDER_MAN_ACROSS_THE_SPIDER_VERSE);
-      break;
-    case '4':
+    print_menu(sheets, sheet_count);
+    char line[16] = {0};
+    if (!fgets(line, sizeof(line), stdin)) {
       return;
-    default:
+    }
+
+    // Discard the rest of a long line.
+    if (!strchr(line, '\n')) {
+      int c = 0;
+      while ((c = getchar()) != '\n' && c != EOF)
+        ;
+    }
+
+    const int choice = atoi(line);
+    if (choice >= 1 && choice <= sheet_count) {
+      animate(sheets[choice - 1], choice);
+    } else if (choice == sheet_count + 1) {
+      return;
+    } else {
       printf("Invalid choice. Please try again.\n");
-      break;
     }
   }
 }
 
-int main(int argc, char *argv[]) {
-  if (argc != 2) {
-    fprintf(stderr, "Usage: %s <Hue bridge IP address>\n", argv[0]);
-    return 1;
+// The longest menu choice the event loop reads. Longer lines are skipped.
+#define MAX_CHOICE_SIZE 16
+
+// The state of the menu and the show playing when the event loop runs it.
+typedef struct live_menu live_menu;
+struct live_menu {
+  const cue_sheet *const *sheets;
+  int sheet_count;
+  bool playing;
+  playback playback;
+  char line[MAX_CHOICE_SIZE];
+  size_t line_size;
+  bool skipping;
+};
+
+static void stop_playing(live_menu *menu) {
+  if (menu->playing) {
+    menu->playing = false;
+    playback_stop(&menu->playback);
+    print_menu(menu->sheets, menu->sheet_count);
   }
+}
 
-  const char *bridge_ip = argv[1];
+// Act on a menu choice. A show that is playing stops, and a new choice starts
+// at once. Returns false to quit.
+static bool choose(live_menu *menu, const char *line) {
+  const int choice = atoi(line);
+  if (choice >= 1 && choice <= menu->sheet_count) {
+    stop_playing(menu);
+    menu->playing = !playback_start(&menu->playback,
+                                    menu->sheets[choice - 1], choice);
+    if (!menu->playing) {
+      print_menu(menu->sheets, menu->sheet_count);
+    }
+  } else if (choice == menu->sheet_count + 1) {
+    return false;
+  } else {
+    printf("Invalid choice. Please try again.\n");
+    if (!menu->playing) {
+      print_menu(menu->sheets, menu->sheet_count);
+    }
+  }
+  return true;
+}
 
-  // Connect to the Hue bridge.
-  printf("Connecting to Hue bridge\n");
-  hue_dtls_context *context = connect_to_bridge(bridge_ip);
-  if (!context) {
-    fprintf(stderr, "Failed to connect to Hue bridge\n");
-    return 1;
+// Read the choices typed so far. Returns false at the end of the input, or
+// to quit.
+static bool read_choices(live_menu *menu) {
+  const ssize_t received = read(STDIN_FILENO, menu->line + menu->line_size,
+                                sizeof(menu->line) - menu->line_size - 1);
+  if (received <= 0) {
+    return false;
   }
-  printf("Connected to Hue bridge\n");
+  menu->line_size += received;
+  menu->line[menu->line_size] = '\0';
 
-  // Initialize the current frame.
-  initialize_frame(current_frame, CHANNEL_COUNT);
+  char *start = menu->line;
+  char *end = NULL;
+  while ((end = strchr(start, '\n'))) {
+    *end = '\0';
+    if (!menu->skipping && !choose(menu, start)) {
+      return false;
+    }
+    menu->skipping = false;
+    start = end + 1;
+  }
 
-  // Initialize the current frame mutex.
-  if (pthread_mutex_init(&current_frame_mutex, NULL)) {
-    fprintf(stderr, "pthread_mutext_init() failed\n");
-    hue_dtls_context_free(context);
-    return 1;
+  menu->line_size -= start - menu->line;
+  memmove(menu->line, start, menu->line_size);
+  if (menu->line_size == sizeof(menu->line) - 1) {
+    menu->skipping = true;
+    menu->line_size = 0;
   }
+  return true;
+}
 
-  // Stream frames to the Hue bridge.
-  pthread_t stream_thread = 0;
-  stream_thread_args args = {context};
-  if (pthread_create(&stream_thread, NULL, stream, &args)) {
-    fprintf(stderr, "pthread_create() failed\n");
-    pthread_mutex_destroy(&current_frame_mutex);
-    hue_dtls_context_free(context);
-    return 1;
+// The signals the event loop handles: SIGINT stops the show that is playing,
+// SIGTERM quits and SIGUSR1 prints the metrics.
+static void event_loop_signals(sigset_t *signals) {
+  sigemptyset(signals);
+  sigaddset(signals, SIGINT);
+  sigaddset(signals, SIGTERM);
+  sigaddset(signals, SIGUSR1);
+}
+
+// Run the menu, render and stream from this thread alone. Each frame is
+// rendered right when it is due and sent at once, so it never waits for
+// another thread, and menu choices and signals are handled between frames.
+static int run_event_loop(const cue_sheet *const *sheets, int sheet_count) {
+  sigset_t signals;
+  event_loop_signals(&signals);
+  event_loop loop = {0};
+  if (event_loop_init(&loop, FRAMES_PER_SECOND, STDIN_FILENO, &signals)) {
+    fprintf(stderr, "event_loop_init() failed\n");
+    return -1;
   }
 
-  // Handle Ctrl+C to stop animating.
-  signal(SIGINT, handle_signal);
+  // This thread streams, so it is scheduled like the stream thread.
+  realtime_thread_apply(&stream_realtime, "event loop");
 
-  // Seed the random number generator.
-  const time_t seed = time(NULL);
-  printf("seed: %ld\n", seed);
-  srand(seed);
+  hue_stream_encoder encoders[STREAM_SESSION_MAX_SESSIONS] = {0};
+  if (init_encoders(encoders)) {
+    event_loop_close(&loop);
+    return -1;
+  }
 
-  // Display animation menu.
-  display_menu();
+  // Between shows, the lights are off.
+  hue_stream_message_data off[STREAM_SESSION_MAX_CHANNELS] = {0};
+  stream_session_initialize_frame(sessions, session_count, off);
+  hue_stream_message_data mapped[STREAM_SESSION_MAX_CHANNELS] = {0};
 
-  // Stop streaming.
-  streaming = false;
-  pthread_join(stream_thread, NULL);
+  static live_menu menu;
+  memset(&menu, 0, sizeof(menu));
+  menu.sheets = sheets;
+  menu.sheet_count = sheet_count;
+  print_menu(sheets, sheet_count);
 
-  pthread_mutex_destroy(&current_frame_mutex);
-  hue_dtls_context_free(context);
-  return 0;
+  int ret = 0;
+  bool running = true;
+  while (running) {
+    int signal = 0;
+    switch (event_loop_wait(&loop, &signal)) {
+    case EVENT_LOOP_FRAME:
+      latency_histogram_record(&metrics.stages[STREAM_STAGE_STREAM_JITTER],
+                               latency_histogram_now_ns() - loop.deadline_ns);
+      if (menu.playing && !playback_render(&menu.playback, mapped)) {
+        stop_playing(&menu);
+      }
+
+      if (stream_frame(encoders, menu.playing ? mapped : off)) {
+        ret = -1;
+        running = false;
+      }
+      break;
+    case EVENT_LOOP_INPUT:
+      running = read_choices(&menu);
+      break;
+    case EVENT_LOOP_SIGNAL:
+      if (signal == SIGUSR1) {
+        stream_metrics_print(&metrics, stdout);
+      } else if (signal == SIGINT) {
+        stop_playing(&menu);
+      } else {
+        running = false;
+      }
+      break;
+    default:
+      ret = -1;
+      running = false;
+      break;
+    }
+  }
+
+  if (menu.playing) {
+    playback_stop(&menu.playback);
+  }
+
+  // Turn lights off on the way out.
+  if (stream_frame(encoders, off)) {
+    ret = -1;
+  }
+
+  event_loop_print_stats(&loop, "event loop");
+  print_encoder_stats(encoders);
+  event_loop_close(&loop);
+  return ret;
+}
+
+static double milliseconds_since(const struct timespec *start) {
+  struct timespec now = {0};
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start->tv_sec) * 1e3 +
+         (now.tv_nsec - start->tv_nsec) / 1e6;
+}
+
+static cue_sheet *load_cue_sheet(const char *path) {
+  struct timespec start = {0};
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  cue_sheet *sheet = cue_sheet_load(path);
+  if (!sheet) {
+    fprintf(stderr, "cue_sheet_load() failed\n");
+    return NULL;
+  }
+
+  printf("Loaded %s (%d cues) in %.3f ms\n", sheet->title, sheet->cue_count,
+         milliseconds_since(&start));
+  return sheet;
+}
+
+// Convert a cue sheet to the binary format.
+static int compile_cue_sheet(const char *input, const char *output) {
+  cue_sheet *sheet = load_cue_sheet(input);
+  if (!sheet) {
+    return -1;
+  }
+
+  const int ret = cue_sheet_save_binary(sheet, output);
+  if (ret) {
+    fprintf(stderr, "cue_sheet_save_binary() failed\n");
+  }
+
+  cue_sheet_free(sheet);
+  return ret;
+}
+
+// Render a cue sheet without a bridge, as fast as possible.
+static int render_cue_sheet(const cue_sheet *sheet, const char *output) {
+  struct timespec start = {0};
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  const int frames = offline_renderer_render_csv(sheet, CHANNEL_COUNT,
+                                                 FRAMES_PER_SECOND, output);
+  if (frames < 0) {
+    fprintf(stderr, "offline_renderer_render_csv() failed\n");
+    return -1;
+  }
+
+  printf("Rendered %s (%d frames) in %.3f ms\n", sheet->title, frames,
+         milliseconds_since(&start));
+  return 0;
+}
+
+// Pre-render a cue sheet into a frame file.
+static int export_cue_sheet(const cue_sheet *sheet, const char *output) {
+  struct timespec start = {0};
+  clock_gettime(CLOCK_MONOTONIC, &start);
+
+  const int frames =
+      frame_file_render(sheet, CHANNEL_COUNT, FRAMES_PER_SECOND, output);
+  if (frames < 0) {
+    fprintf(stderr, "frame_file_render() failed\n");
+    return -1;
+  }
+
+  printf("Exported %s (%d frames) in %.3f ms\n", sheet->title, frames,
+         milliseconds_since(&start));
+  return 0;
+}
+
+static pthread_t metrics_thread = 0;
+static atomic_bool reporting_metrics = false;
+
+static void *report_metrics(void *arg) {
+  (void)arg;
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGUSR1);
+
+  while (atomic_load(&reporting_metrics)) {
+    int signal = 0;
+    if (sigwait(&signals, &signal)) {
+      fprintf(stderr, "sigwait() failed\n");
+      break;
+    }
+
+    if (atomic_load(&reporting_metrics)) {
+      stream_metrics_print(&metrics, stdout);
+    }
+  }
+
+  return NULL;
+}
+
+// Print the metrics from a thread of their own whenever SIGUSR1 arrives.
+// SIGUSR1 is blocked before the render and stream threads start, so they are
+// never interrupted. Must be called before starting them. The media player's
+// thread, which may start earlier, blocks every signal.
+static int start_metrics_reporter(void) {
+  stream_metrics_init(&metrics);
+
+  sigset_t signals;
+  sigemptyset(&signals);
+  sigaddset(&signals, SIGUSR1);
+  if (pthread_sigmask(SIG_BLOCK, &signals, NULL)) {
+    fprintf(stderr, "pthread_sigmask() failed\n");
+    return -1;
+  }
+
+  atomic_store(&reporting_metrics, true);
+  if (pthread_create(&metrics_thread, NULL, report_metrics, NULL)) {
+    fprintf(stderr, "pthread_create() failed\n");
+    atomic_store(&reporting_metrics, false);
+    return -1;
+  }
+
+  return 0;
+}
+
+// Stop the reporter and print the metrics one last time.
+static void stop_metrics_reporter(void) {
+  if (atomic_exchange(&reporting_metrics, false)) {
+    pthread_kill(metrics_thread, SIGUSR1);
+    pthread_join(metrics_thread, NULL);
+  }
+
+  stream_metrics_print(&metrics, stdout);
+}
+
+static double milliseconds(uint64_t ns) { return ns / 1e6; }
+
+// Print how long connecting took, in total and step by step. Bridges are
+// connected in parallel, and the steps on one bridge overlap, so the total is
+// less than the sum of the steps.
+static void print_startup_timings(uint64_t connect_start_ns) {
+  const uint64_t now_ns = latency_histogram_now_ns();
+  printf("Connected in %.1f ms, %.1f ms after launch\n",
+         milliseconds(now_ns - connect_start_ns),
+         milliseconds(now_ns - launch_ns));
+
+  for (int i = 0; i < session_count; i++) {
+    const stream_session *session = &sessions[i];
+    printf("  %s %s: discover %.1f ms, REST start %.1f ms", session->bridge_ip,
+           session->entertainment_config_id,
+           milliseconds(session->discover_ns),
+           milliseconds(session->rest_start_ns));
+    if (session->owns_context) {
+      printf(", DTLS setup %.1f ms, handshake %.1f ms",
+             milliseconds(session->dtls_setup_ns),
+             milliseconds(session->handshake_ns));
+    }
+    printf("\n");
+  }
+}
+
+// Stream to the first entertainment area of the bridge unless areas were
+// given with --area, connect to every area, then lay them out on the global
+// channel map.
+static int connect_to_bridges(const char *bridge_ip, bool refresh) {
+  if (session_count == 0) {
+    if (stream_session_init(&sessions[0], bridge_ip, NULL, 0)) {
+      fprintf(stderr, "stream_session_init() failed\n");
+      return -1;
+    }
+    session_count = 1;
+  }
+
+  printf("Connecting to %d entertainment area(s)\n", session_count);
+  const uint64_t start_ns = latency_histogram_now_ns();
+  if (stream_session_connect(rest_client, sessions, session_count, refresh)) {
+    fprintf(stderr, "Failed to connect to Hue bridge\n");
+    return -1;
+  }
+  print_startup_timings(start_ns);
+
+  channel_map_size = stream_session_map(sessions, session_count);
+  if (channel_map_size < 0) {
+    fprintf(stderr, "stream_session_map() failed\n");
+    stream_session_disconnect(rest_client, sessions, session_count);
+    return -1;
+  }
+
+  return 0;
+}
+
+// Stream a frame file to one entertainment area.
+static int play_frame_file(const char *path, const char *bridge_ip,
+                           bool refresh) {
+  frame_file *file = frame_file_open(path);
+  if (!file) {
+    fprintf(stderr, "frame_file_open() failed\n");
+    return -1;
+  }
+
+  printf("Loaded %s (%d frames)\n", file->title, file->frame_count);
+
+  if (connect_to_bridges(bridge_ip, refresh)) {
+    frame_file_close(file);
+    return -1;
+  }
+
+  // A frame file holds the channels of a single area.
+  if (channel_map_size != file->channel_count) {
+    fprintf(stderr, "%s needs one area of %d channels\n", path,
+            file->channel_count);
+    stream_session_disconnect(rest_client, sessions, session_count);
+    frame_file_close(file);
+    return -1;
+  }
+
+  // Handle Ctrl+C to stop playing.
+  signal(SIGINT, handle_signal);
+
+  int ret = 0;
+  pthread_t play_thread = 0;
+  if (start_metrics_reporter()) {
+    fprintf(stderr, "start_metrics_reporter() failed\n");
+    ret = -1;
+  } else if (pthread_create(&play_thread, NULL, play, file)) {
+    fprintf(stderr, "pthread_create() failed\n");
+    ret = -1;
+  } else {
+    pthread_join(play_thread, NULL);
+  }
+  stop_metrics_reporter();
+
+  stream_session_disconnect(rest_client, sessions, session_count);
+  frame_file_close(file);
+  return ret;
+}
+
+// Initialize the current frame, print hot path metrics on SIGUSR1, and stream
+// frames to the Hue bridges from a thread of their own. The calling thread is
+// the one that renders, and is scheduled as such once the other threads have
+// started, so they don't inherit its settings.
+static int start_streaming(pthread_t *stream_thread) {
+  hue_stream_message_data frame[STREAM_SESSION_MAX_CHANNELS] = {0};
+  stream_session_initialize_frame(sessions, session_count, frame);
+  if (frame_slot_init(&current_frame, frame, channel_map_size)) {
+    fprintf(stderr, "frame_slot_init() failed\n");
+    return -1;
+  }
+
+  if (start_metrics_reporter()) {
+    fprintf(stderr, "start_metrics_reporter() failed\n");
+    return -1;
+  }
+
+  streaming = true;
+  if (pthread_create(stream_thread, NULL, stream, NULL)) {
+    fprintf(stderr, "pthread_create() failed\n");
+    stop_metrics_reporter();
+    return -1;
+  }
+
+  realtime_thread_apply(&render_realtime, "render");
+  return 0;
+}
+
+static void stop_streaming(pthread_t stream_thread) {
+  streaming = false;
+  pthread_join(stream_thread, NULL);
+  stop_metrics_reporter();
+}
+
+// Render each video frame into the channel map as it comes due. A frame whose
+// time has already passed is read but not rendered, so a decoder that can't
+// keep up drops frames instead of falling behind.
+static void render_video(y4m_reader *reader, const ambilight *light) {
+  hue_stream_message_data frame[STREAM_SESSION_MAX_CHANNELS] = {0};
+  stream_session_initialize_frame(sessions, session_count, frame);
+
+  hue_stream_message_data mapped[STREAM_SESSION_MAX_CHANNELS] = {0};
+  gamut_type gamuts[STREAM_SESSION_MAX_CHANNELS] = {0};
+  stream_session_gamuts(sessions, session_count, gamuts);
+
+  frame_scheduler scheduler = {0};
+  uint64_t frames_dropped = 0;
+  animating = true;
+  while (animating) {
+    const int read = y4m_reader_read(reader);
+    if (read <= 0) {
+      if (read < 0) {
+        fprintf(stderr, "y4m_reader_read() failed\n");
+      }
+      break;
+    }
+
+    // The video starts when its first frame arrives, which may take a while
+    // from a decoder that is still starting up.
+    if (reader->frame_count == 1 &&
+        frame_scheduler_init_period(&scheduler,
+                                    y4m_reader_frame_period_ns(reader),
+                                    FRAME_SCHEDULER_OVERRUN_CATCH_UP)) {
+      fprintf(stderr, "frame_scheduler_init_period() failed\n");
+      break;
+    }
+
+    struct timespec now = {0};
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    const struct timespec *deadline = &scheduler.deadline;
+    if (now.tv_sec > deadline->tv_sec ||
+        (now.tv_sec == deadline->tv_sec && now.tv_nsec > deadline->tv_nsec)) {
+      frames_dropped++;
+    } else {
+      uint64_t start_ns = latency_histogram_now_ns();
+      if (ambilight_render(light, &reader->frame, frame)) {
+        fprintf(stderr, "ambilight_render() failed\n");
+        break;
+      }
+      gamut_map_frame(gamuts, frame, mapped, channel_map_size);
+      start_ns = stream_metrics_record(&metrics, STREAM_STAGE_RENDER, start_ns);
+
+      frame_slot_publish(&current_frame, mapped, start_ns);
+      stream_metrics_record(&metrics, STREAM_STAGE_PUBLISH, start_ns);
+    }
+
+    if (wait_for_next_frame(&scheduler, &metrics.render_deadline_misses,
+                            STREAM_STAGE_RENDER_JITTER)) {
+      break;
+    }
+  }
+
+  frame_scheduler_print_stats(&scheduler, "video");
+  printf("video: %llu frames read, %llu dropped\n",
+         (unsigned long long)reader->frame_count,
+         (unsigned long long)frames_dropped);
+
+  // Turn lights off after the video ends or is interrupted.
+  stream_session_initialize_frame(sessions, session_count, frame);
+  frame_slot_publish(&current_frame, frame, 0);
+}
+
+// Light the entertainment areas from a Y4M video, as an ambilight.
+static int play_video(const char *path, const char *bridge_ip, bool refresh) {
+  y4m_reader *reader = y4m_reader_open(path);
+  if (!reader) {
+    fprintf(stderr, "y4m_reader_open() failed\n");
+    return -1;
+  }
+
+  printf("Opened %s (%dx%d at %d/%d fps)\n", path, reader->frame.width,
+         reader->frame.height, reader->frame_rate_numerator,
+         reader->frame_rate_denominator);
+
+  if (connect_to_bridges(bridge_ip, refresh)) {
+    y4m_reader_close(reader);
+    return -1;
+  }
+
+  int ret = -1;
+  hue_entertainment_channel channels[STREAM_SESSION_MAX_CHANNELS] = {0};
+  stream_session_channels(sessions, session_count, channels);
+  ambilight light = {0};
+  if (ambilight_init(&light, &reader->frame, channels, channel_map_size,
+                     COLOR_KERNEL_AUTO)) {
+    fprintf(stderr, "ambilight_init() failed\n");
+    goto exit;
+  }
+
+  pthread_t stream_thread = 0;
+  if (start_streaming(&stream_thread)) {
+    goto exit;
+  }
+
+  // Handle Ctrl+C to stop playing.
+  signal(SIGINT, handle_signal);
+
+  printf("Summing %d zones with the %s kernel\n", light.zone_count,
+         color_kernel_name(light.kernel));
+  render_video(reader, &light);
+
+  stop_streaming(stream_thread);
+  ret = 0;
+
+exit:
+  stream_session_disconnect(rest_client, sessions, session_count);
+  y4m_reader_close(reader);
+  return ret;
+}
+
+// Analyze one frame's worth of audio at a time and light the channel map from
+// it. A file is paced at its sample rate. Live audio is paced by its own clock
+// alone, by blocking on the read, since sleeping to the monotonic clock would
+// let audio from a slightly faster device pile up. Whenever more than a hop
+// has piled up anyway, the older hops are skipped.
+static void render_audio(wav_reader *reader, audio_analyzer *analyzer) {
+  hue_stream_message_data frame[STREAM_SESSION_MAX_CHANNELS] = {0};
+  stream_session_initialize_frame(sessions, session_count, frame);
+
+  hue_stream_message_data mapped[STREAM_SESSION_MAX_CHANNELS] = {0};
+  gamut_type gamuts[STREAM_SESSION_MAX_CHANNELS] = {0};
+  stream_session_gamuts(sessions, session_count, gamuts);
+
+  // Only the newest window of a long hop is analyzed.
+  const int hop = reader->sample_rate / FRAMES_PER_SECOND;
+  const int analyzed =
+      hop < AUDIO_ANALYZER_WINDOW_SIZE ? hop : AUDIO_ANALYZER_WINDOW_SIZE;
+  float samples[MAX_HOP_SIZE] = {0};
+  float flash = 0.0f;
+
+  frame_scheduler scheduler = {0};
+  uint64_t hops_skipped = 0;
+  animating = true;
+  while (animating) {
+    int read = wav_reader_read(reader, samples, hop);
+    while (read == hop && wav_reader_available(reader) >= hop) {
+      read = wav_reader_read(reader, samples, hop);
+      hops_skipped++;
+    }
+
+    if (read < hop) {
+      if (read < 0) {
+        fprintf(stderr, "wav_reader_read() failed\n");
+      }
+      break;
+    }
+
+    if (!reader->live && reader->frame_count == (uint64_t)hop &&
+        frame_scheduler_init_period(
+            &scheduler, (long)(1000000000LL * hop / reader->sample_rate),
+            FRAME_SCHEDULER_OVERRUN_CATCH_UP)) {
+      fprintf(stderr, "frame_scheduler_init_period() failed\n");
+      break;
+    }
+
+    uint64_t start_ns = latency_histogram_now_ns();
+    if (audio_analyzer_process(analyzer, samples + hop - analyzed,
+                               analyzed) ||
+        audio_analyzer_render(analyzer, frame, channel_map_size, &flash)) {
+      fprintf(stderr, "Audio analysis failed\n");
+      break;
+    }
+    gamut_map_frame(gamuts, frame, mapped, channel_map_size);
+    start_ns = stream_metrics_record(&metrics, STREAM_STAGE_RENDER, start_ns);
+
+    frame_slot_publish(&current_frame, mapped, start_ns);
+    stream_metrics_record(&metrics, STREAM_STAGE_PUBLISH, start_ns);
+
+    if (!reader->live &&
+        wait_for_next_frame(&scheduler, &metrics.render_deadline_misses,
+                            STREAM_STAGE_RENDER_JITTER)) {
+      break;
+    }
+  }
+
+  if (reader->live) {
+    printf("audio: %" PRIu64 " hops read, %" PRIu64 " skipped to keep up\n",
+           reader->frame_count / hop, hops_skipped);
+  } else {
+    frame_scheduler_print_stats(&scheduler, "audio");
+  }
+
+  // Turn lights off after the audio ends or is interrupted.
+  stream_session_initialize_frame(sessions, session_count, frame);
+  frame_slot_publish(&current_frame, frame, 0);
+}
+
+// Light the entertainment areas from WAV audio, live or from a file.
+static int play_audio(const char *path, const char *bridge_ip, bool refresh) {
+  wav_reader *reader = wav_reader_open(path);
+  if (!reader) {
+    fprintf(stderr, "wav_reader_open() failed\n");
+    return -1;
+  }
+
+  if (reader->sample_rate < FRAMES_PER_SECOND ||
+      reader->sample_rate > MAX_SAMPLE_RATE) {
+    fprintf(stderr, "Sample rate %d is not supported\n", reader->sample_rate);
+    wav_reader_close(reader);
+    return -1;
+  }
+
+  printf("Opened %s (%d Hz, %d channels)\n", path, reader->sample_rate,
+         reader->channel_count);
+
+  // The analyzer holds every buffer it uses, too much for the stack.
+  static audio_analyzer analyzer;
+  if (audio_analyzer_init(&analyzer, reader->sample_rate, COLOR_KERNEL_AUTO)) {
+    fprintf(stderr, "audio_analyzer_init() failed\n");
+    wav_reader_close(reader);
+    return -1;
+  }
+
+  if (connect_to_bridges(bridge_ip, refresh)) {
+    wav_reader_close(reader);
+    return -1;
+  }
+
+  int ret = -1;
+  pthread_t stream_thread = 0;
+  if (start_streaming(&stream_thread)) {
+    goto exit;
+  }
+
+  // Handle Ctrl+C to stop playing.
+  signal(SIGINT, handle_signal);
+
+  printf("Analyzing %d-sample windows with the %s kernel\n",
+         AUDIO_ANALYZER_WINDOW_SIZE, color_kernel_name(analyzer.kernel));
+  render_audio(reader, &analyzer);
+
+  stop_streaming(stream_thread);
+  ret = 0;
+
+exit:
+  stream_session_disconnect(rest_client, sessions, session_count);
+  wav_reader_close(reader);
+  return ret;
+}
+
+// Each flash lasts this long, from the start of a second.
+#define CALIBRATION_FLASH_NS 200000000LL
+
+// Flash every channel white at the start of each second of CLOCK_REALTIME,
+// rendered ahead by the lookahead like an animation. The lookahead is right
+// when the lights come on exactly at each second.
+static void render_calibration(int flash_count) {
+  hue_stream_message_data off[STREAM_SESSION_MAX_CHANNELS] = {0};
+  stream_session_initialize_frame(sessions, session_count, off);
+
+  hue_stream_message_data white = {0};
+  static const float white_rgb[3] = {1.0f, 1.0f, 1.0f};
+  if (color_linear_to_xy_brightness(COLOR_KERNEL_SCALAR, white_rgb, 1,
+                                    &white)) {
+    fprintf(stderr, "color_linear_to_xy_brightness() failed\n");
+    return;
+  }
+
+  hue_stream_message_data frame[STREAM_SESSION_MAX_CHANNELS] = {0};
+  hue_stream_message_data mapped[STREAM_SESSION_MAX_CHANNELS] = {0};
+  gamut_type gamuts[STREAM_SESSION_MAX_CHANNELS] = {0};
+  stream_session_gamuts(sessions, session_count, gamuts);
+
+  frame_scheduler scheduler = {0};
+  if (frame_scheduler_init(&scheduler, FRAMES_PER_SECOND,
+                           FRAME_SCHEDULER_OVERRUN_SKIP)) {
+    fprintf(stderr, "frame_scheduler_init() failed\n");
+    return;
+  }
+
+  // The flashes start at the next whole second.
+  struct timespec now = {0};
+  clock_gettime(CLOCK_REALTIME, &now);
+  const int64_t first_ns = (int64_t)(now.tv_sec + 1) * 1000000000LL;
+  const int64_t end_ns = first_ns + (int64_t)flash_count * 1000000000LL;
+
+  animating = true;
+  while (animating) {
+    clock_gettime(CLOCK_REALTIME, &now);
+    const int64_t now_ns = (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec;
+    if (now_ns >= end_ns) {
+      break;
+    }
+
+    for (int i = 0; i < channel_map_size; i++) {
+      const int64_t time_ns = now_ns + lookahead_ns + channel_lookahead_ns[i];
+      const bool on = time_ns >= first_ns && time_ns < end_ns &&
+                      (time_ns - first_ns) % 1000000000LL <
+                          CALIBRATION_FLASH_NS;
+      frame[i] = off[i];
+      if (on) {
+        memcpy(frame[i].color_value, white.color_value,
+               sizeof(white.color_value));
+      }
+    }
+
+    gamut_map_frame(gamuts, frame, mapped, channel_map_size);
+    frame_slot_publish(&current_frame, mapped, latency_histogram_now_ns());
+
+    if (wait_for_next_frame(&scheduler, &metrics.render_deadline_misses,
+                            STREAM_STAGE_RENDER_JITTER)) {
+      break;
+    }
+  }
+
+  frame_slot_publish(&current_frame, off, 0);
+}
+
+// Flash the lights on a known schedule, so the time they take to react can be
+// measured and used as the lookahead.
+static int calibrate(int flash_count, const char *bridge_ip, bool refresh) {
+  if (connect_to_bridges(bridge_ip, refresh)) {
+    return -1;
+  }
+
+  int ret = -1;
+  pthread_t stream_thread = 0;
+  if (start_streaming(&stream_thread)) {
+    goto exit;
+  }
+
+  // Handle Ctrl+C to stop flashing.
+  signal(SIGINT, handle_signal);
+
+  printf("Flashing %d times, at the start of each second of the system "
+         "clock, %.1f ms ahead\n",
+         flash_count, lookahead_ns / 1e6);
+  render_calibration(flash_count);
+
+  stop_streaming(stream_thread);
+  ret = 0;
+
+exit:
+  stream_session_disconnect(rest_client, sessions, session_count);
+  return ret;
+}
+
+// Parse a whole number from min to max.
+static int parse_integer(const char *text, long min, long max, int *value) {
+  char *end = NULL;
+  const long number = strtol(text, &end, 10);
+  if (end == text || *end || number < min || number > max) {
+    return -1;
+  }
+
+  *value = (int)number;
+  return 0;
+}
+
+// Parse a time in milliseconds, like 120 or 37.5, into nanoseconds.
+static int parse_milliseconds(const char *text, long *ns) {
+  char *end = NULL;
+  const double milliseconds = strtod(text, &end);
+  if (end == text || *end || milliseconds < -10000.0 ||
+      milliseconds > 10000.0) {
+    fprintf(stderr, "Invalid time %s\n", text);
+    return -1;
+  }
+
+  *ns = (long)(milliseconds * 1e6);
+  return 0;
+}
+
+// Parse <channel>:<milliseconds>, where the channel is its index in the
+// channel map.
+static int parse_channel_lookahead(const char *text) {
+  char *end = NULL;
+  const long channel = strtol(text, &end, 10);
+  if (end == text || *end != ':' || channel < 0 ||
+      channel >= STREAM_SESSION_MAX_CHANNELS) {
+    fprintf(stderr, "Invalid channel lookahead %s\n", text);
+    return -1;
+  }
+
+  return parse_milliseconds(end + 1, &channel_lookahead_ns[channel]);
+}
+
+static void usage(const char *program) {
+  fprintf(stderr,
+          "Usage: %s [--cue-sheet <file>]... <Hue bridge IP address>\n"
+          "       %s [--cue-sheet <file>]... --area <area>...\n"
+          "       %s [--cue-sheet <file>]... --sync <mpv IPC socket> "
+          "<Hue bridge IP address>\n"
+          "       %s [--cue-sheet <file>]... --render <menu number> "
+          "--output <file>\n"
+          "       %s [--cue-sheet <file>]... --export <menu number> "
+          "--output <file>\n"
+          "       %s --play <frame file> <Hue bridge IP address>\n"
+          "       %s --video <Y4M file or -> <Hue bridge IP address>\n"
+          "       %s --audio <WAV file or -> <Hue bridge IP address>\n"
+          "       %s --calibrate <flash count> <Hue bridge IP address>\n"
+          "       %s [--cue-sheet <file>]... --replay <show log>\n"
+          "       %s --compile <cue sheet> --output <file>\n"
+          "\n"
+          "An area is <bridge IP>[,<entertainment config ID>[,<channel "
+          "count>]].\n"
+          "Areas take consecutive slices of one animated channel map. Areas\n"
+          "and channels left out are discovered from the bridge and cached;\n"
+          "--refresh-areas ignores the cache. --play, --video and --audio\n"
+          "take --area too.\n"
+          "\n"
+          "--lookahead <ms> renders ahead of time to make up for the delay of\n"
+          "the lights, and --channel-lookahead <channel>:<ms> further ahead\n"
+          "for the channel at that index of the channel map. --calibrate\n"
+          "flashes every second so the delay can be measured.\n"
+          "\n"
+          "--seed <seed> seeds the random numbers of every animation, and\n"
+          "--log <file> logs each frame of a show so --replay can check that\n"
+          "it renders the same again.\n"
+          "\n"
+          "--event-loop renders each frame of a show right before it is sent,\n"
+          "from one thread that also reads the menu and handles signals.\n"
+          "It needs Linux.\n"
+          "\n"
+          "--realtime <priority> schedules the stream and render threads with\n"
+          "SCHED_FIFO at that priority, --stream-cpu <cpu> and --render-cpu\n"
+          "<cpu> pin them to a CPU, and --lock-memory keeps every page in\n"
+          "memory. Settings that aren't permitted are reported and skipped.\n",
+          program, program, program, program, program, program, program,
+          program, program, program, program);
+}
+
+#define MAX_CUE_SHEETS 32
+
+int main(int argc, char *argv[]) {
+  launch_ns = latency_histogram_now_ns();
+
+  static const struct option options[] = {
+      {"cue-sheet", required_argument, NULL, 'c'},
+      {"area", required_argument, NULL, 'a'},
+      {"refresh-areas", no_argument, NULL, 'R'},
+      {"compile", required_argument, NULL, 'C'},
+      {"render", required_argument, NULL, 'r'},
+      {"export", required_argument, NULL, 'e'},
+      {"play", required_argument, NULL, 'p'},
+      {"video", required_argument, NULL, 'v'},
+      {"audio", required_argument, NULL, 'A'},
+      {"sync", required_argument, NULL, 's'},
+      {"lookahead", required_argument, NULL, 'l'},
+      {"channel-lookahead", required_argument, NULL, 'L'},
+      {"calibrate", required_argument, NULL, 'k'},
+      {"seed", required_argument, NULL, 'S'},
+      {"log", required_argument, NULL, 'g'},
+      {"replay", required_argument, NULL, 'y'},
+      {"event-loop", no_argument, NULL, 'E'},
+      {"realtime", required_argument, NULL, 'P'},
+      {"stream-cpu", required_argument, NULL, 't'},
+      {"render-cpu", required_argument, NULL, 'n'},
+      {"lock-memory", no_argument, NULL, 'M'},
+      {"output", required_argument, NULL, 'o'},
+      {"help", no_argument, NULL, 'h'},
+      {NULL, 0, NULL, 0}};
+
+  const char *cue_sheet_paths[MAX_CUE_SHEETS] = {0};
+  int cue_sheet_path_count = 0;
+  const char *compile_input = NULL;
+  int render_choice = 0;
+  int export_choice = 0;
+  const char *play_path = NULL;
+  const char *video_path = NULL;
+  const char *audio_path = NULL;
+  const char *sync_path = NULL;
+  int flash_count = 0;
+  const char *seed_text = NULL;
+  const char *replay_path = NULL;
+  bool use_event_loop = false;
+  bool refresh_areas = false;
+  const char *output = NULL;
+
+  int option = 0;
+  while ((option = getopt_long(argc, argv,
+                               "c:a:RC:r:e:p:v:A:s:l:L:k:S:g:y:EP:t:n:Mo:h",
+                               options, NULL)) != -1) {
+    switch (option) {
+    case 'c':
+      if (cue_sheet_path_count + ANIMATION_COUNT >= MAX_CUE_SHEETS) {
+        fprintf(stderr, "Too many cue sheets\n");
+        return 1;
+      }
+      cue_sheet_paths[cue_sheet_path_count++] = optarg;
+      break;
+    case 'a':
+      if (session_count >= STREAM_SESSION_MAX_SESSIONS) {
+        fprintf(stderr, "Too many areas\n");
+        return 1;
+      }
+      if (stream_session_parse(&sessions[session_count], optarg)) {
+        return 1;
+      }
+      session_count++;
+      break;
+    case 'R':
+      refresh_areas = true;
+      break;
+    case 'C':
+      compile_input = optarg;
+      break;
+    case 'r':
+      if (parse_integer(optarg, 1, INT_MAX, &render_choice)) {
+        fprintf(stderr, "Invalid menu number %s\n", optarg);
+        return 1;
+      }
+      break;
+    case 'e':
+      if (parse_integer(optarg, 1, INT_MAX, &export_choice)) {
+        fprintf(stderr, "Invalid menu number %s\n", optarg);
+        return 1;
+      }
+      break;
+    case 'p':
+      play_path = optarg;
+      break;
+    case 'v':
+      video_path = optarg;
+      break;
+    case 'A':
+      audio_path = optarg;
+      break;
+    case 's':
+      sync_path = optarg;
+      break;
+    case 'l':
+      if (parse_milliseconds(optarg, &lookahead_ns)) {
+        return 1;
+      }
+      break;
+    case 'L':
+      if (parse_channel_lookahead(optarg)) {
+        return 1;
+      }
+      break;
+    case 'S':
+      seed_text = optarg;
+      break;
+    case 'g':
+      show_log_path = optarg;
+      break;
+    case 'y':
+      replay_path = optarg;
+      break;
+    case 'E':
+      use_event_loop = true;
+      break;
+    case 'P': {
+      const int min = sched_get_priority_min(SCHED_FIFO);
+      const int max = sched_get_priority_max(SCHED_FIFO);
+      if (parse_integer(optarg, min, max, &stream_realtime.priority)) {
+        fprintf(stderr, "--realtime needs a priority from %d to %d\n", min,
+                max);
+        return 1;
+      }
+      render_realtime.priority = stream_realtime.priority;
+      break;
+    }
+    case 't':
+    case 'n': {
+      // A CPU that is offline, or otherwise can't be used, is reported and
+      // skipped when the thread is pinned.
+      realtime_thread *thread =
+          option == 't' ? &stream_realtime : &render_realtime;
+      if (parse_integer(optarg, 0, REALTIME_MAX_CPUS - 1, &thread->cpu)) {
+        fprintf(stderr, "Invalid CPU %s\n", optarg);
+        return 1;
+      }
+      break;
+    }
+    case 'M':
+      lock_memory = true;
+      break;
+    case 'k':
+      if (parse_integer(optarg, 1, INT_MAX, &flash_count)) {
+        fprintf(stderr, "Invalid flash count %s\n", optarg);
+        return 1;
+      }
+      break;
+    case 'o':
+      output = optarg;
+      break;
+    case 'h':
+      usage(argv[0]);
+      return 0;
+    default:
+      usage(argv[0]);
+      return 1;
+    }
+  }
+
+  long group_lookaheads[MAX_LOOKAHEAD_GROUPS] = {0};
+  int channel_groups[STREAM_SESSION_MAX_CHANNELS] = {0};
+  if (group_channels(STREAM_SESSION_MAX_CHANNELS, group_lookaheads,
+                     channel_groups) < 0) {
+    fprintf(stderr, "At most %d different channel lookaheads are supported\n",
+            MAX_LOOKAHEAD_GROUPS);
+    return 1;
+  }
+
+  if (compile_input) {
+    if (!output) {
+      usage(argv[0]);
+      return 1;
+    }
+    return compile_cue_sheet(compile_input, output) ? 1 : 0;
+  }
+
+  // Rendering, exporting and replaying run offline. Everything else needs a
+  // bridge IP address, unless the areas to stream to are given with --area.
+  const int offline_choice = render_choice ? render_choice : export_choice;
+  const bool offline = offline_choice || replay_path;
+  const int bridge_argument_count = session_count ? 0 : 1;
+  if (offline ? (offline_choice && !output) || optind != argc
+              : optind != argc - bridge_argument_count) {
+    usage(argv[0]);
+    return 1;
+  }
+  const char *bridge_ip = session_count ? NULL : argv[optind];
+
+  // Shows are seeded from the time unless a seed is given. The seed is
+  // printed, and logged with --log, so the show can be replayed.
+  if (seed_text) {
+    char *end = NULL;
+    show_seed = strtoull(seed_text, &end, 10);
+    if (end == seed_text || *end) {
+      fprintf(stderr, "Invalid seed %s\n", seed_text);
+      return 1;
+    }
+  } else {
+    show_seed = (uint64_t)time(NULL);
+  }
+
+  // Lock memory before the hot path allocates anything, so all of it stays
+  // resident. Threads started from now on prefault their stacks.
+  if (!offline && lock_memory) {
+    realtime_lock_memory();
+  }
+
+  // Connecting to the bridges sets up DTLS from several threads.
+  if (!offline) {
+    if (hue_rest_global_init()) {
+      fprintf(stderr, "hue_rest_global_init() failed\n");
+      return 1;
+    }
+
+    rest_client = hue_rest_client_create();
+    if (!rest_client) {
+      fprintf(stderr, "hue_rest_client_create() failed\n");
+      hue_rest_global_cleanup();
+      return 1;
+    }
+  }
+
+  if (play_path) {
+    const int play_ret = play_frame_file(play_path, bridge_ip, refresh_areas);
+    hue_rest_client_free(rest_client);
+    hue_rest_global_cleanup();
+    return play_ret ? 1 : 0;
+  }
+
+  if (video_path) {
+    const int video_ret = play_video(video_path, bridge_ip, refresh_areas);
+    hue_rest_client_free(rest_client);
+    hue_rest_global_cleanup();
+    return video_ret ? 1 : 0;
+  }
+
+  if (audio_path) {
+    const int audio_ret = play_audio(audio_path, bridge_ip, refresh_areas);
+    hue_rest_client_free(rest_client);
+    hue_rest_global_cleanup();
+    return audio_ret ? 1 : 0;
+  }
+
+  if (flash_count) {
+    const int calibrate_ret = calibrate(flash_count, bridge_ip, refresh_areas);
+    hue_rest_client_free(rest_client);
+    hue_rest_global_cleanup();
+    return calibrate_ret ? 1 : 0;
+  }
+
+  int ret = 1;
+
+  // The menu lists the built-in animations, then the loaded cue sheets.
+  const cue_sheet *sheets[MAX_CUE_SHEETS] = {0};
+  int sheet_count = 0;
+  cue_sheet *loaded_sheets[MAX_CUE_SHEETS] = {0};
+  int loaded_sheet_count = 0;
+  for (int i = 0; i < ANIMATION_COUNT; i++) {
+    sheets[sheet_count] = animation_builtin_cue_sheet(i);
+    if (!sheets[sheet_count++]) {
+      fprintf(stderr, "animation_builtin_cue_sheet() failed\n");
+      goto exit;
+    }
+  }
+
+  for (int i = 0; i < cue_sheet_path_count; i++) {
+    cue_sheet *sheet = load_cue_sheet(cue_sheet_paths[i]);
+    if (!sheet) {
+      goto exit;
+    }
+    loaded_sheets[loaded_sheet_count++] = sheet;
+    sheets[sheet_count++] = sheet;
+  }
+
+  if (offline_choice) {
+    if (offline_choice < 1 || offline_choice > sheet_count) {
+      fprintf(stderr, "Invalid menu choice %d\n", offline_choice);
+      goto exit;
+    }
+
+    const cue_sheet *sheet = sheets[offline_choice - 1];
+    if (!(render_choice ? render_cue_sheet(sheet, output)
+                        : export_cue_sheet(sheet, output))) {
+      ret = 0;
+    }
+    goto exit;
+  }
+
+  if (replay_path) {
+    ret = replay_show(replay_path, sheets, sheet_count) ? 1 : 0;
+    goto exit;
+  }
+
+  if (use_event_loop && !event_loop_supported()) {
+    printf("The event loop isn't supported on this platform. Rendering and "
+           "streaming from separate threads\n");
+    use_event_loop = false;
+  }
+
+  // The event loop reads its signals from a signalfd, so every thread has to
+  // block them. Threads inherit the mask, so block them before any starts.
+  if (use_event_loop) {
+    sigset_t signals;
+    event_loop_signals(&signals);
+    if (pthread_sigmask(SIG_BLOCK, &signals, NULL)) {
+      fprintf(stderr, "pthread_sigmask() failed\n");
+      goto exit;
+    }
+  }
+
+  // Follow the media player from the start, so its position is known before
+  // an animation is chosen.
+  if (sync_path) {
+    player_sync = media_sync_connect(sync_path);
+    if (!player_sync) {
+      fprintf(stderr, "media_sync_connect() failed\n");
+      goto exit;
+    }
+    printf("Following the media player at %s\n", sync_path);
+  }
+
+  // Connect to every entertainment area.
+  if (connect_to_bridges(bridge_ip, refresh_areas)) {
+    goto exit;
+  }
+
+  if (use_event_loop) {
+    stream_metrics_init(&metrics);
+    printf("seed: %" PRIu64 "\n", show_seed);
+    const int loop_ret = run_event_loop(sheets, sheet_count);
+    stream_metrics_print(&metrics, stdout);
+    stream_session_disconnect(rest_client, sessions, session_count);
+    ret = loop_ret ? 1 : 0;
+    goto exit;
+  }
+
+  // Stream frames to the Hue bridges.
+  pthread_t stream_thread = 0;
+  if (start_streaming(&stream_thread)) {
+    stream_session_disconnect(rest_client, sessions, session_count);
+    goto exit;
+  }
+
+  // Handle Ctrl+C to stop animating.
+  signal(SIGINT, handle_signal);
+
+  printf("seed: %" PRIu64 "\n", show_seed);
+
+  // Display animation menu.
+  display_menu(sheets, sheet_count);
+
+  // Stop streaming.
+  stop_streaming(stream_thread);
+
+  stream_session_disconnect(rest_client, sessions, session_count);
+  ret = 0;
+
+exit:
+  media_sync_close(player_sync);
+  for (int i = 0; i < loaded_sheet_count; i++) {
+    cue_sheet_free(loaded_sheets[i]);
+  }
+  if (!offline) {
+    hue_rest_client_free(rest_client);
+    hue_rest_global_cleanup();
+  }
+  return ret;
 }
@@ -0,0 +1,311 @@
+#include "media_sync.h"
+
+#include "json.h"
+#include <signal.h>     // pthread_sigmask, sigfillset
+#include <stdio.h>      // fprintf, perror, printf
+#include <stdlib.h>     // calloc, free
+#include <string.h>     // memchr, memmove, strlen, strncpy
+#include <sys/socket.h> // connect, shutdown, socket
+#include <sys/un.h>     // struct sockaddr_un
+#include <unistd.h>     // close, read, write
+
+#define NANOSECONDS_PER_SECOND 1000000000LL
+
+// The longest message from the player. Longer ones are skipped.
+#define MAX_LINE_SIZE 4096
+#define MAX_TOKENS 64
+
+// Ask the player to report the position, pause state and speed whenever they
+// change.
+static const char observe_commands[] =
+    "{\"command\":[\"observe_property\",1,\"time-pos\"]}\n"
+    "{\"command\":[\"observe_property\",2,\"pause\"]}\n"
+    "{\"command\":[\"observe_property\",3,\"speed\"]}\n";
+
+static int64_t now_ns(void) {
+  struct timespec now = {0};
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (int64_t)now.tv_sec * NANOSECONDS_PER_SECOND + now.tv_nsec;
+}
+
+// The position at a time. The mutex must be held.
+static int64_t position_at(const media_sync *sync, int64_t time_ns) {
+  if (sync->paused) {
+    return sync->position_ns;
+  }
+  return sync->position_ns +
+         (int64_t)((time_ns - sync->anchor_ns) * sync->rate);
+}
+
+// Move the anchor to a time without moving the clock. The mutex must be held.
+static void reanchor(media_sync *sync, int64_t time_ns) {
+  sync->position_ns = position_at(sync, time_ns);
+  sync->anchor_ns = time_ns;
+}
+
+static int synced_now(animation_clock *clock, struct timespec *time) {
+  media_sync *sync = (media_sync *)clock;
+  const int64_t time_ns = now_ns();
+
+  pthread_mutex_lock(&sync->mutex);
+  int64_t position_ns = position_at(sync, time_ns);
+  pthread_mutex_unlock(&sync->mutex);
+
+  if (position_ns < 0) {
+    position_ns = 0;
+  }
+  time->tv_sec = position_ns / NANOSECONDS_PER_SECOND;
+  time->tv_nsec = position_ns % NANOSECONDS_PER_SECOND;
+  return 0;
+}
+
+static void update_position(media_sync *sync, double seconds,
+                            int64_t time_ns) {
+  const int64_t position_ns = (int64_t)(seconds * NANOSECONDS_PER_SECOND);
+
+  pthread_mutex_lock(&sync->mutex);
+  reanchor(sync, time_ns);
+  const int64_t error_ns = position_ns - sync->position_ns;
+  const int64_t magnitude_ns = error_ns < 0 ? -error_ns : error_ns;
+  sync->updates++;
+
+  if (!sync->has_position || sync->paused ||
+      magnitude_ns > MEDIA_SYNC_STEP_THRESHOLD_NS) {
+    // A seek, or the first position: jump straight to it.
+    sync->position_ns = position_ns;
+    sync->rate = sync->speed;
+    sync->has_position = true;
+    sync->steps++;
+  } else {
+    // Run fast or slow until the error is gone, instead of jumping.
+    double slew = error_ns / MEDIA_SYNC_SLEW_TIME_NS;
+    if (slew > MEDIA_SYNC_MAX_SLEW) {
+      slew = MEDIA_SYNC_MAX_SLEW;
+    } else if (slew < -MEDIA_SYNC_MAX_SLEW) {
+      slew = -MEDIA_SYNC_MAX_SLEW;
+    }
+    sync->rate = sync->speed * (1.0 + slew);
+
+    sync->slewed_updates++;
+    sync->error_sum_ns += magnitude_ns;
+    if (magnitude_ns > sync->max_error_ns) {
+      sync->max_error_ns = magnitude_ns;
+    }
+  }
+  pthread_mutex_unlock(&sync->mutex);
+}
+
+static void update_pause(media_sync *sync, bool paused, int64_t time_ns) {
+  pthread_mutex_lock(&sync->mutex);
+  reanchor(sync, time_ns);
+  sync->paused = paused;
+  sync->rate = sync->speed;
+  pthread_mutex_unlock(&sync->mutex);
+}
+
+static void update_speed(media_sync *sync, double speed, int64_t time_ns) {
+  pthread_mutex_lock(&sync->mutex);
+  reanchor(sync, time_ns);
+  sync->speed = speed;
+  sync->rate = speed;
+  pthread_mutex_unlock(&sync->mutex);
+}
+
+// Handle one message from the player. Replies to commands and events other
+// than property changes are ignored.
+static void handle_line(media_sync *sync, const char *line, size_t length,
+                        int64_t time_ns) {
+  json_token tokens[MAX_TOKENS];
+  if (json_parse(line, length, tokens, MAX_TOKENS) < 1) {
+    return;
+  }
+
+  const int event = json_object_get(line, tokens, 0, "event");
+  if (event < 0 ||
+      !json_string_equals(line, &tokens[event], "property-change")) {
+    return;
+  }
+
+  const int name = json_object_get(line, tokens, 0, "name");
+  const int data = json_object_get(line, tokens, 0, "data");
+  if (name < 0 || data < 0 || tokens[data].type != JSON_PRIMITIVE) {
+    return;
+  }
+
+  // The position is null while no file is playing.
+  double number = 0.0;
+  if (json_string_equals(line, &tokens[name], "time-pos")) {
+    if (!json_number(line, &tokens[data], &number)) {
+      update_position(sync, number, time_ns);
+    }
+  } else if (json_string_equals(line, &tokens[name], "pause")) {
+    update_pause(sync, line[tokens[data].start] == 't', time_ns);
+  } else if (json_string_equals(line, &tokens[name], "speed")) {
+    if (!json_number(line, &tokens[data], &number) && number > 0.0) {
+      update_speed(sync, number, time_ns);
+    }
+  }
+}
+
+static void *receive(void *arg) {
+  media_sync *sync = (media_sync *)arg;
+  char buffer[MAX_LINE_SIZE];
+  size_t size = 0;
+  bool skipping = false;
+
+  while (true) {
+    const ssize_t received =
+        read(sync->socket, buffer + size, sizeof(buffer) - size);
+    if (received <= 0) {
+      break;
+    }
+
+    // Every message in a read arrived at the same time.
+    const int64_t time_ns = now_ns();
+    size += received;
+
+    char *start = buffer;
+    char *end = NULL;
+    while ((end = memchr(start, '\n', buffer + size - start))) {
+      if (!skipping) {
+        handle_line(sync, start, end - start, time_ns);
+      }
+      skipping = false;
+      start = end + 1;
+    }
+
+    size -= start - buffer;
+    memmove(buffer, start, size);
+    if (size == sizeof(buffer)) {
+      skipping = true;
+      size = 0;
+    }
+  }
+
+  pthread_mutex_lock(&sync->mutex);
+  sync->connected = false;
+  pthread_mutex_unlock(&sync->mutex);
+  return NULL;
+}
+
+media_sync *media_sync_connect(const char *path) {
+  if (!path) {
+    fprintf(stderr, "path is null\n");
+    return NULL;
+  }
+
+  struct sockaddr_un address = {0};
+  if (strlen(path) >= sizeof(address.sun_path)) {
+    fprintf(stderr, "Socket path %s is too long\n", path);
+    return NULL;
+  }
+  address.sun_family = AF_UNIX;
+  strncpy(address.sun_path, path, sizeof(address.sun_path) - 1);
+
+  media_sync *sync = calloc(1, sizeof(media_sync));
+  if (!sync) {
+    perror("calloc");
+    return NULL;
+  }
+
+  sync->clock.now = synced_now;
+  sync->speed = 1.0;
+  sync->rate = 1.0;
+  sync->paused = true;
+  sync->anchor_ns = now_ns();
+
+  sync->socket = socket(AF_UNIX, SOCK_STREAM, 0);
+  if (sync->socket < 0) {
+    perror("socket");
+    free(sync);
+    return NULL;
+  }
+
+  if (connect(sync->socket, (const struct sockaddr *)&address,
+              sizeof(address))) {
+    perror("connect");
+    goto error;
+  }
+
+  const size_t length = sizeof(observe_commands) - 1;
+  if (write(sync->socket, observe_commands, length) != (ssize_t)length) {
+    perror("write");
+    goto error;
+  }
+
+  if (pthread_mutex_init(&sync->mutex, NULL)) {
+    fprintf(stderr, "pthread_mutex_init() failed\n");
+    goto error;
+  }
+
+  // The receive thread is started with every signal blocked, so a signal
+  // meant for another thread, like SIGUSR1 for the metrics, can't be
+  // delivered to it and take its default action.
+  sigset_t signals;
+  sigset_t previous_mask;
+  sigfillset(&signals);
+  if (pthread_sigmask(SIG_SETMASK, &signals, &previous_mask)) {
+    fprintf(stderr, "pthread_sigmask() failed\n");
+    pthread_mutex_destroy(&sync->mutex);
+    goto error;
+  }
+
+  sync->connected = true;
+  const int created = pthread_create(&sync->thread, NULL, receive, sync);
+  pthread_sigmask(SIG_SETMASK, &previous_mask, NULL);
+  if (created) {
+    fprintf(stderr, "pthread_create() failed\n");
+    pthread_mutex_destroy(&sync->mutex);
+    goto error;
+  }
+
+  return sync;
+
+error:
+  close(sync->socket);
+  free(sync);
+  return NULL;
+}
+
+bool media_sync_connected(media_sync *sync) {
+  if (!sync) {
+    fprintf(stderr, "sync is null\n");
+    return false;
+  }
+
+  pthread_mutex_lock(&sync->mutex);
+  const bool connected = sync->connected;
+  pthread_mutex_unlock(&sync->mutex);
+  return connected;
+}
+
+void media_sync_print_stats(media_sync *sync) {
+  if (!sync) {
+    fprintf(stderr, "sync is null\n");
+    return;
+  }
+
+  pthread_mutex_lock(&sync->mutex);
+  const double mean_error_ms =
+      sync->slewed_updates
+          ? sync->error_sum_ns / sync->slewed_updates / 1000000.0
+          : 0.0;
+  printf("sync: %llu updates, %llu steps, mean error %.2f ms, "
+         "max error %.2f ms\n",
+         (unsigned long long)sync->updates, (unsigned long long)sync->steps,
+         mean_error_ms, sync->max_error_ns / 1000000.0);
+  pthread_mutex_unlock(&sync->mutex);
+}
+
+void media_sync_close(media_sync *sync) {
+  if (!sync) {
+    return;
+  }
+
+  // Wake the receiving thread up from its read.
+  shutdown(sync->socket, SHUT_RDWR);
+  pthread_join(sync->thread, NULL);
+  close(sync->socket);
+  pthread_mutex_destroy(&sync->mutex);
+  free(sync);
+}
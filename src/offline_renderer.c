@@ -0,0 +1,120 @@
+#include "offline_renderer.h"
+
+#include <stdbool.h> // true
+#include <stdint.h>  // int64_t
+#include <stdio.h>   // fprintf, fopen, perror
+
+#define NANOSECONDS_PER_SECOND 1000000000L
+
+int offline_renderer_run(const cue_sheet *sheet, int channel_count,
+                         int frames_per_second,
+                         offline_renderer_callback callback, void *user_data) {
+  if (!sheet || !callback) {
+    fprintf(stderr, "sheet or callback is null\n");
+    return -1;
+  }
+
+  if (!hue_stream_message_valid_channel_count(channel_count)) {
+    fprintf(stderr, "channel_count is out of range\n");
+    return -1;
+  }
+
+  if (frames_per_second <= 0) {
+    fprintf(stderr, "frames_per_second (%d) must be positive\n",
+            frames_per_second);
+    return -1;
+  }
+
+  const struct timespec start_time = {0};
+  animation_clock clock = {0};
+  animation_clock_init_manual(&clock, &start_time);
+
+  animation_context context = {0};
+  if (animation_context_init(&context, &clock)) {
+    fprintf(stderr, "animation_context_init() failed\n");
+    return -1;
+  }
+
+  hue_stream_message_data frame[HUE_STREAM_MESSAGE_MAX_CHANNELS] = {0};
+  for (int i = 0; i < channel_count; i++) {
+    frame[i].channel_id = i;
+  }
+
+  int frame_index = 0;
+  while (true) {
+    const animation_status status =
+        animation_cue_sheet(frame, channel_count, &context, sheet);
+    if (status == ANIMATION_STATUS_ERROR) {
+      fprintf(stderr, "animation_cue_sheet() failed\n");
+      return -1;
+    }
+
+    if (status == ANIMATION_STATUS_END) {
+      break;
+    }
+
+    if (callback(frame_index, frame, channel_count, user_data)) {
+      return -1;
+    }
+
+    // Advance to the start of the next frame. Computing each frame's time
+    // from its index keeps rounding errors from accumulating.
+    const int64_t frame_ns =
+        (int64_t)frame_index * NANOSECONDS_PER_SECOND / frames_per_second;
+    frame_index++;
+    const int64_t next_frame_ns =
+        (int64_t)frame_index * NANOSECONDS_PER_SECOND / frames_per_second;
+    animation_clock_advance(&clock, next_frame_ns - frame_ns);
+  }
+
+  return frame_index;
+}
+
+typedef struct csv_writer csv_writer;
+struct csv_writer {
+  FILE *file;
+  int frames_per_second;
+};
+
+static int write_csv_frame(int frame_index,
+                           const hue_stream_message_data *frame,
+                           int channel_count, void *user_data) {
+  const csv_writer *writer = user_data;
+  const double time = (double)frame_index / writer->frames_per_second;
+  for (int i = 0; i < channel_count; i++) {
+    if (fprintf(writer->file, "%d,%.6f,%u,%u,%u,%u\n", frame_index, time,
+                frame[i].channel_id, frame[i].color_value[0],
+                frame[i].color_value[1], frame[i].color_value[2]) < 0) {
+      perror("fprintf");
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int offline_renderer_render_csv(const cue_sheet *sheet, int channel_count,
+                                int frames_per_second, const char *path) {
+  if (!path) {
+    fprintf(stderr, "path is null\n");
+    return -1;
+  }
+
+  FILE *file = fopen(path, "w");
+  if (!file) {
+    perror("fopen");
+    return -1;
+  }
+
+  fprintf(file, "frame,time,channel,x,y,brightness\n");
+
+  csv_writer writer = {file, frames_per_second};
+  int frames = offline_renderer_run(sheet, channel_count, frames_per_second,
+                                    write_csv_frame, &writer);
+
+  if (fclose(file)) {
+    perror("fclose");
+    frames = -1;
+  }
+
+  return frames;
+}
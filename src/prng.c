@@ -0,0 +1,55 @@
+#include "prng.h"
+
+#include <stdio.h> // fprintf
+
+static uint64_t rotate_left(uint64_t value, int bits) {
+  return (value << bits) | (value >> (64 - bits));
+}
+
+static uint64_t splitmix64(uint64_t *state) {
+  uint64_t z = (*state += 0x9e3779b97f4a7c15ULL);
+  z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+  z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+  return z ^ (z >> 31);
+}
+
+void prng_seed(prng *generator, uint64_t seed) {
+  if (!generator) {
+    fprintf(stderr, "generator is null\n");
+    return;
+  }
+
+  for (int i = 0; i < 4; i++) {
+    generator->state[i] = splitmix64(&seed);
+  }
+}
+
+uint64_t prng_next(prng *generator) {
+  uint64_t *s = generator->state;
+  const uint64_t result = rotate_left(s[1] * 5, 7) * 9;
+  const uint64_t t = s[1] << 17;
+
+  s[2] ^= s[0];
+  s[3] ^= s[1];
+  s[1] ^= s[2];
+  s[0] ^= s[3];
+  s[2] ^= t;
+  s[3] = rotate_left(s[3], 45);
+
+  return result;
+}
+
+// Lemire's multiply-shift: the high half of a 32x32-bit product is below the
+// bound, and the rare low halves that would favor some results are redrawn.
+uint32_t prng_below(prng *generator, uint32_t bound) {
+  uint64_t product = (prng_next(generator) >> 32) * bound;
+  uint32_t low = (uint32_t)product;
+  if (low < bound) {
+    const uint32_t threshold = -bound % bound;
+    while (low < threshold) {
+      product = (prng_next(generator) >> 32) * bound;
+      low = (uint32_t)product;
+    }
+  }
+  return product >> 32;
+}
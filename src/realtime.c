@@ -0,0 +1,122 @@
+#ifdef __linux__
+// For cpu_set_t and pthread_setaffinity_np().
+#define _GNU_SOURCE
+#endif
+
+#include "realtime.h"
+
+#include <errno.h>    // EPERM
+#include <pthread.h>  // pthread_self, pthread_setschedparam
+#include <sched.h>    // SCHED_FIFO, sched_get_priority_max
+#include <stdbool.h>  // bool
+#include <stdio.h>    // fprintf, printf
+#include <string.h>   // strerror
+#include <sys/mman.h> // mlockall
+#include <unistd.h>   // sysconf
+
+// Whether memory was locked, so new threads prefault their stacks.
+static bool memory_locked = false;
+
+int realtime_lock_memory(void) {
+  if (mlockall(MCL_CURRENT | MCL_FUTURE)) {
+    printf("Memory can't be locked (%s), so it can be paged out\n",
+           strerror(errno));
+    return -1;
+  }
+
+  memory_locked = true;
+  realtime_prefault_stack();
+  printf("Memory locked\n");
+  return 0;
+}
+
+void realtime_prefault_stack(void) {
+  volatile unsigned char stack[REALTIME_PREFAULT_STACK_SIZE];
+  const long page_size = sysconf(_SC_PAGESIZE);
+  const size_t step = page_size > 0 ? (size_t)page_size : 4096;
+  for (size_t i = 0; i < sizeof(stack); i += step) {
+    stack[i] = 0;
+  }
+}
+
+static int set_priority(int priority, const char *name) {
+  const int min = sched_get_priority_min(SCHED_FIFO);
+  const int max = sched_get_priority_max(SCHED_FIFO);
+  if (priority < min || priority > max) {
+    printf("%s: SCHED_FIFO priority %d is outside %d to %d, so it keeps the "
+           "default scheduling\n",
+           name, priority, min, max);
+    return -1;
+  }
+
+  const struct sched_param param = {.sched_priority = priority};
+  const int ret = pthread_setschedparam(pthread_self(), SCHED_FIFO, &param);
+  if (ret == EPERM) {
+    printf("%s: not permitted to use SCHED_FIFO (run with CAP_SYS_NICE or "
+           "raise RLIMIT_RTPRIO), so it keeps the default scheduling\n",
+           name);
+    return -1;
+  }
+
+  if (ret) {
+    printf("%s: SCHED_FIFO failed (%s), so it keeps the default scheduling\n",
+           name, strerror(ret));
+    return -1;
+  }
+
+  printf("%s: SCHED_FIFO priority %d\n", name, priority);
+  return 0;
+}
+
+#ifdef __linux__
+_Static_assert(REALTIME_MAX_CPUS <= CPU_SETSIZE,
+               "REALTIME_MAX_CPUS doesn't fit in a cpu_set_t");
+#endif
+
+static int set_cpu(int cpu, const char *name) {
+#ifdef __linux__
+  if (cpu < 0 || cpu >= REALTIME_MAX_CPUS) {
+    printf("%s: CPU %d doesn't exist, so it runs on any CPU\n", name, cpu);
+    return -1;
+  }
+
+  cpu_set_t cpus;
+  CPU_ZERO(&cpus);
+  CPU_SET(cpu, &cpus);
+  const int ret = pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus);
+  if (ret) {
+    printf("%s: can't be pinned to CPU %d (%s), so it runs on any CPU\n", name,
+           cpu, strerror(ret));
+    return -1;
+  }
+
+  printf("%s: pinned to CPU %d\n", name, cpu);
+  return 0;
+#else
+  printf("%s: threads can't be pinned to CPU %d on this platform, so it runs "
+         "on any CPU\n",
+         name, cpu);
+  return -1;
+#endif
+}
+
+int realtime_thread_apply(const realtime_thread *thread, const char *name) {
+  if (!thread || !name) {
+    fprintf(stderr, "thread or name is null\n");
+    return -1;
+  }
+
+  int ret = 0;
+  if (thread->priority && set_priority(thread->priority, name)) {
+    ret = -1;
+  }
+
+  if (thread->cpu >= 0 && set_cpu(thread->cpu, name)) {
+    ret = -1;
+  }
+
+  if (memory_locked) {
+    realtime_prefault_stack();
+  }
+  return ret;
+}
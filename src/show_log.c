@@ -0,0 +1,174 @@
+#include "show_log.h"
+
+#include <inttypes.h> // PRIu64, PRIx64, SCNu64, SCNx64
+#include <stdio.h>    // fgets, fprintf, perror, snprintf, sscanf
+#include <string.h>   // memset, strcmp, strcspn
+
+#define MAX_LINE_SIZE 256
+
+#define FNV_OFFSET_BASIS 0xcbf29ce484222325ULL
+#define FNV_PRIME 0x100000001b3ULL
+
+int show_log_write_header(FILE *file, const show_log_header *header) {
+  if (!file || !header) {
+    fprintf(stderr, "file or header is null\n");
+    return -1;
+  }
+
+  fprintf(file, "# Show logged by resonate.\n");
+  fprintf(file, "sheet %d %s\n", header->sheet, header->title);
+  fprintf(file, "seed %" PRIu64 "\n", header->seed);
+  fprintf(file, "channels %d\n", header->channel_count);
+  fprintf(file, "start %lld %ld\n", (long long)header->start_time.tv_sec,
+          header->start_time.tv_nsec);
+  fprintf(file, "lookahead %ld\n", header->lookahead_ns);
+  for (int i = 0; i < header->channel_count; i++) {
+    if (header->channel_lookahead_ns[i]) {
+      fprintf(file, "channel_lookahead %d %ld\n", i,
+              header->channel_lookahead_ns[i]);
+    }
+  }
+
+  if (fprintf(file, "frames\n") < 0) {
+    perror("fprintf");
+    return -1;
+  }
+  return 0;
+}
+
+int show_log_write_frame(FILE *file, const struct timespec *time,
+                         uint64_t hash) {
+  if (!file || !time) {
+    fprintf(stderr, "file or time is null\n");
+    return -1;
+  }
+
+  if (fprintf(file, "%lld %ld %016" PRIx64 "\n", (long long)time->tv_sec,
+              time->tv_nsec, hash) < 0) {
+    perror("fprintf");
+    return -1;
+  }
+  return 0;
+}
+
+// Parse one header line. Returns 1 at the end of the header, 0 to read on, or
+// -1 if the line is invalid.
+static int parse_line(const char *line, show_log_header *header) {
+  int length = 0;
+  long long seconds = 0;
+  int channel = 0;
+  long ns = 0;
+
+  if (line[0] == '#' || line[0] == '\0') {
+    return 0;
+  }
+
+  if (!strcmp(line, "frames")) {
+    return 1;
+  }
+
+  if (sscanf(line, "sheet %d %n", &header->sheet, &length) == 1) {
+    snprintf(header->title, sizeof(header->title), "%s", line + length);
+    return 0;
+  }
+
+  if (sscanf(line, "seed %" SCNu64, &header->seed) == 1) {
+    return 0;
+  }
+
+  if (sscanf(line, "channels %d", &header->channel_count) == 1) {
+    return header->channel_count > 0 &&
+                   header->channel_count <= STREAM_SESSION_MAX_CHANNELS
+               ? 0
+               : -1;
+  }
+
+  if (sscanf(line, "start %lld %ld", &seconds, &ns) == 2) {
+    header->start_time.tv_sec = seconds;
+    header->start_time.tv_nsec = ns;
+    return ns >= 0 && ns < 1000000000L ? 0 : -1;
+  }
+
+  if (sscanf(line, "lookahead %ld", &header->lookahead_ns) == 1) {
+    return 0;
+  }
+
+  if (sscanf(line, "channel_lookahead %d %ld", &channel, &ns) == 2) {
+    if (channel < 0 || channel >= STREAM_SESSION_MAX_CHANNELS) {
+      return -1;
+    }
+    header->channel_lookahead_ns[channel] = ns;
+    return 0;
+  }
+
+  return -1;
+}
+
+int show_log_read_header(FILE *file, show_log_header *header) {
+  if (!file || !header) {
+    fprintf(stderr, "file or header is null\n");
+    return -1;
+  }
+
+  memset(header, 0, sizeof(show_log_header));
+  char line[MAX_LINE_SIZE];
+  int line_number = 0;
+  while (fgets(line, sizeof(line), file)) {
+    line_number++;
+    line[strcspn(line, "\r\n")] = '\0';
+
+    const int ret = parse_line(line, header);
+    if (ret < 0) {
+      fprintf(stderr, "show log line %d is invalid\n", line_number);
+      return -1;
+    }
+
+    if (ret == 1) {
+      if (!header->sheet || !header->channel_count) {
+        fprintf(stderr, "show log header is incomplete\n");
+        return -1;
+      }
+      return 0;
+    }
+  }
+
+  fprintf(stderr, "show log has no frames\n");
+  return -1;
+}
+
+int show_log_read_frame(FILE *file, struct timespec *time, uint64_t *hash) {
+  if (!file || !time || !hash) {
+    fprintf(stderr, "file, time or hash is null\n");
+    return -1;
+  }
+
+  char line[MAX_LINE_SIZE];
+  if (!fgets(line, sizeof(line), file)) {
+    return 0;
+  }
+
+  long long seconds = 0;
+  long ns = 0;
+  if (sscanf(line, "%lld %ld %" SCNx64, &seconds, &ns, hash) != 3 || ns < 0 ||
+      ns >= 1000000000L) {
+    fprintf(stderr, "show log frame is invalid: %s", line);
+    return -1;
+  }
+
+  time->tv_sec = seconds;
+  time->tv_nsec = ns;
+  return 1;
+}
+
+uint64_t show_log_hash(const hue_stream_message_data *frame,
+                       int channel_count) {
+  uint64_t hash = FNV_OFFSET_BASIS;
+  for (int i = 0; i < channel_count; i++) {
+    for (int j = 0; j < HUE_STREAM_MESSAGE_COLOR_VALUE_ELEMENTS; j++) {
+      const uint16_t value = frame[i].color_value[j];
+      hash = (hash ^ (value & 0xff)) * FNV_PRIME;
+      hash = (hash ^ (value >> 8)) * FNV_PRIME;
+    }
+  }
+  return hash;
+}
@@ -0,0 +1,70 @@
+#include "stream_metrics.h"
+
+#include <string.h> // memset
+
+static const char *const stage_names[STREAM_STAGE_COUNT] = {
+    [STREAM_STAGE_RENDER] = "render",
+    [STREAM_STAGE_PUBLISH] = "publish",
+    [STREAM_STAGE_WAIT] = "wait",
+    [STREAM_STAGE_ACQUIRE] = "acquire",
+    [STREAM_STAGE_ENCODE] = "encode",
+    [STREAM_STAGE_SEND] = "send",
+    [STREAM_STAGE_SKEW] = "skew",
+    [STREAM_STAGE_RENDER_JITTER] = "r-jitter",
+    [STREAM_STAGE_STREAM_JITTER] = "s-jitter",
+};
+
+void stream_metrics_init(stream_metrics *metrics) {
+  if (!metrics) {
+    fprintf(stderr, "metrics is null\n");
+    return;
+  }
+
+  memset(metrics, 0, sizeof(stream_metrics));
+}
+
+uint64_t stream_metrics_record(stream_metrics *metrics, stream_stage stage,
+                               uint64_t start_ns) {
+  const uint64_t now_ns = latency_histogram_now_ns();
+  latency_histogram_record(&metrics->stages[stage], now_ns - start_ns);
+  return now_ns;
+}
+
+void stream_metrics_count(atomic_uint_least64_t *counter, uint64_t value) {
+  latency_histogram_add(counter, value);
+}
+
+static unsigned long long load(const atomic_uint_least64_t *counter) {
+  return atomic_load_explicit(counter, memory_order_relaxed);
+}
+
+void stream_metrics_print(const stream_metrics *metrics, FILE *file) {
+  if (!metrics || !file) {
+    fprintf(stderr, "metrics or file is null\n");
+    return;
+  }
+
+  fprintf(file, "%-8s %10s %9s %9s %9s %9s %9s %9s\n", "stage", "count",
+          "mean us", "p50 us", "p90 us", "p99 us", "p99.9 us", "max us");
+
+  for (int i = 0; i < STREAM_STAGE_COUNT; i++) {
+    const latency_histogram *histogram = &metrics->stages[i];
+    const unsigned long long count = load(&histogram->count);
+    fprintf(file, "%-8s %10llu %9.1f %9.1f %9.1f %9.1f %9.1f %9.1f\n",
+            stage_names[i], count,
+            count ? load(&histogram->total_ns) / 1e3 / count : 0.0,
+            latency_histogram_percentile(histogram, 50) / 1e3,
+            latency_histogram_percentile(histogram, 90) / 1e3,
+            latency_histogram_percentile(histogram, 99) / 1e3,
+            latency_histogram_percentile(histogram, 99.9) / 1e3,
+            load(&histogram->max_ns) / 1e3);
+  }
+
+  fprintf(file,
+          "frames sent: %llu, send failures: %llu, deadline misses: %llu "
+          "render, %llu stream\n",
+          load(&metrics->frames_sent), load(&metrics->send_failures),
+          load(&metrics->render_deadline_misses),
+          load(&metrics->stream_deadline_misses));
+  fflush(file);
+}
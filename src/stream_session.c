@@ -0,0 +1,417 @@
+#include "stream_session.h"
+
+#include "entertainment_cache.h"
+#include "frame_slot.h"
+#include "latency_histogram.h"
+#include <pthread.h>
+#include <stdio.h>  // fprintf, printf, snprintf
+#include <stdlib.h> // strtol
+#include <string.h> // memcpy, memset, strchr, strcmp, strcpy, strlen
+
+_Static_assert(STREAM_SESSION_MAX_CHANNELS <= FRAME_SLOT_MAX_CHANNELS,
+               "a frame slot must hold the whole channel map");
+_Static_assert(STREAM_SESSION_MAX_SESSIONS <= HUE_REST_CLIENT_MAX_REQUESTS,
+               "every area must start in one batch");
+
+int stream_session_init(stream_session *session, const char *bridge_ip,
+                        const char *entertainment_config_id,
+                        int channel_count) {
+  if (!session || !bridge_ip) {
+    fprintf(stderr, "session or bridge_ip is null\n");
+    return -1;
+  }
+
+  if (strlen(bridge_ip) == 0 ||
+      strlen(bridge_ip) >= STREAM_SESSION_BRIDGE_IP_SIZE) {
+    fprintf(stderr, "bridge_ip is empty or too long\n");
+    return -1;
+  }
+
+  if (entertainment_config_id &&
+      strlen(entertainment_config_id) !=
+          HUE_STREAM_MESSAGE_ENTERTAINMENT_CONFIG_ID_SIZE) {
+    fprintf(stderr, "entertainment_config_id has an invalid length\n");
+    return -1;
+  }
+
+  // Channels can only be discovered along with their area.
+  if (channel_count != 0 &&
+      (!entertainment_config_id ||
+       !hue_stream_message_valid_channel_count(channel_count))) {
+    fprintf(stderr, "channel_count is out of range\n");
+    return -1;
+  }
+
+  memset(session, 0, sizeof(stream_session));
+  strcpy(session->bridge_ip, bridge_ip);
+  if (entertainment_config_id) {
+    strcpy(session->entertainment_config_id, entertainment_config_id);
+  }
+  session->channel_count = channel_count;
+  for (int i = 0; i < channel_count; i++) {
+    session->channels[i].channel_id = i;
+    session->channels[i].gamut = GAMUT_DEFAULT;
+  }
+  return 0;
+}
+
+int stream_session_parse(stream_session *session, const char *spec) {
+  if (!session || !spec) {
+    fprintf(stderr, "session or spec is null\n");
+    return -1;
+  }
+
+  // Split the specification into up to three fields.
+  char fields[STREAM_SESSION_BRIDGE_IP_SIZE * 2] = {0};
+  if ((size_t)snprintf(fields, sizeof(fields), "%s", spec) >= sizeof(fields)) {
+    fprintf(stderr, "Area %s is too long\n", spec);
+    return -1;
+  }
+
+  const char *bridge_ip = fields;
+  char *entertainment_config_id = strchr(fields, ',');
+  char *channels = NULL;
+  if (entertainment_config_id) {
+    *entertainment_config_id++ = '\0';
+    channels = strchr(entertainment_config_id, ',');
+    if (channels) {
+      *channels++ = '\0';
+    }
+  }
+
+  int channel_count = 0;
+  if (channels) {
+    char *end = NULL;
+    channel_count = strtol(channels, &end, 10);
+    if (end == channels || *end != '\0' || channel_count == 0) {
+      fprintf(stderr, "Invalid channel count in area %s\n", spec);
+      return -1;
+    }
+  }
+
+  if (stream_session_init(session, bridge_ip, entertainment_config_id,
+                          channel_count)) {
+    fprintf(stderr,
+            "Invalid area %s, expected <bridge IP>[,<entertainment config "
+            "ID>[,<channel count>]]\n",
+            spec);
+    return -1;
+  }
+
+  return 0;
+}
+
+// Find the session's area among the bridge's, or take the first one if the
+// session doesn't name one.
+static const hue_entertainment_config *
+find_config(const stream_session *session,
+            const hue_entertainment_config *configs, int config_count) {
+  for (int i = 0; i < config_count; i++) {
+    if (!session->entertainment_config_id[0] ||
+        !strcmp(configs[i].id, session->entertainment_config_id)) {
+      return &configs[i];
+    }
+  }
+
+  return NULL;
+}
+
+// Find the session's area and channels, unless it already has them.
+static int discover(hue_rest_client *client, stream_session *session,
+                    bool refresh) {
+  if (session->channel_count) {
+    return 0;
+  }
+
+  hue_entertainment_config configs[HUE_REST_MAX_ENTERTAINMENT_CONFIGS] = {0};
+  int config_count =
+      entertainment_cache_discover(client, session->bridge_ip, refresh,
+                                   configs, HUE_REST_MAX_ENTERTAINMENT_CONFIGS);
+  if (config_count < 0) {
+    fprintf(stderr, "entertainment_cache_discover() failed\n");
+    return -1;
+  }
+
+  const hue_entertainment_config *config =
+      find_config(session, configs, config_count);
+
+  // The area may have been added since the bridge was cached.
+  if (!config && !refresh) {
+    config_count =
+        entertainment_cache_discover(client, session->bridge_ip, true, configs,
+                                     HUE_REST_MAX_ENTERTAINMENT_CONFIGS);
+    config = find_config(session, configs, config_count);
+  }
+
+  if (!config) {
+    fprintf(stderr, "%s has no entertainment area %s\n", session->bridge_ip,
+            session->entertainment_config_id[0]
+                ? session->entertainment_config_id
+                : "at all");
+    return -1;
+  }
+
+  strcpy(session->entertainment_config_id, config->id);
+  session->channel_count = config->channel_count;
+  memcpy(session->channels, config->channels,
+         config->channel_count * sizeof(hue_entertainment_channel));
+  printf("Found %s (%s, %d channels) on %s\n", config->name, config->id,
+         config->channel_count, session->bridge_ip);
+  return 0;
+}
+
+int stream_session_map(stream_session *sessions, int session_count) {
+  if (!sessions) {
+    fprintf(stderr, "sessions is null\n");
+    return -1;
+  }
+
+  int channel_count = 0;
+  for (int i = 0; i < session_count; i++) {
+    sessions[i].first_channel = channel_count;
+    channel_count += sessions[i].channel_count;
+  }
+
+  if (channel_count > STREAM_SESSION_MAX_CHANNELS) {
+    fprintf(stderr, "The areas have %d channels, more than the %d supported\n",
+            channel_count, STREAM_SESSION_MAX_CHANNELS);
+    return -1;
+  }
+
+  return channel_count;
+}
+
+void stream_session_initialize_frame(const stream_session *sessions,
+                                     int session_count,
+                                     hue_stream_message_data *frame) {
+  if (!sessions || !frame) {
+    fprintf(stderr, "sessions or frame is null\n");
+    return;
+  }
+
+  for (int i = 0; i < session_count; i++) {
+    hue_stream_message_data *slice = frame + sessions[i].first_channel;
+    for (int j = 0; j < sessions[i].channel_count; j++) {
+      memset(&slice[j], 0, sizeof(hue_stream_message_data));
+      slice[j].channel_id = sessions[i].channels[j].channel_id;
+    }
+  }
+}
+
+void stream_session_channels(const stream_session *sessions,
+                             int session_count,
+                             hue_entertainment_channel *channels) {
+  if (!sessions || !channels) {
+    fprintf(stderr, "sessions or channels is null\n");
+    return;
+  }
+
+  for (int i = 0; i < session_count; i++) {
+    memcpy(channels + sessions[i].first_channel, sessions[i].channels,
+           sessions[i].channel_count * sizeof(hue_entertainment_channel));
+  }
+}
+
+void stream_session_gamuts(const stream_session *sessions, int session_count,
+                           gamut_type *gamuts) {
+  if (!sessions || !gamuts) {
+    fprintf(stderr, "sessions or gamuts is null\n");
+    return;
+  }
+
+  for (int i = 0; i < session_count; i++) {
+    gamut_type *slice = gamuts + sessions[i].first_channel;
+    for (int j = 0; j < sessions[i].channel_count; j++) {
+      slice[j] = sessions[i].channels[j].gamut;
+    }
+  }
+}
+
+// The connection to one bridge, shared by every session on it.
+typedef struct bridge_connection bridge_connection;
+struct bridge_connection {
+  // The first session on the bridge, which owns the connection.
+  stream_session *owner;
+  pthread_t thread;
+  bool threaded;
+  int ret;
+};
+
+static bool same_bridge(const stream_session *a, const stream_session *b) {
+  return !strcmp(a->bridge_ip, b->bridge_ip);
+}
+
+// Set up DTLS for the bridge. Creating the context is dominated by seeding the
+// random generator, and doesn't depend on the areas having started, so it runs
+// while they start.
+static void *create_context(void *arg) {
+  bridge_connection *connection = arg;
+  stream_session *owner = connection->owner;
+
+  const uint64_t start_ns = latency_histogram_now_ns();
+  owner->context = hue_dtls_context_create();
+  owner->dtls_setup_ns = latency_histogram_now_ns() - start_ns;
+  if (!owner->context) {
+    fprintf(stderr, "hue_dtls_context_create() failed\n");
+    return NULL;
+  }
+
+  owner->owns_context = true;
+  connection->ret = 0;
+  return NULL;
+}
+
+// Perform the DTLS handshake, which the bridge only accepts once streaming has
+// started.
+static void *handshake(void *arg) {
+  bridge_connection *connection = arg;
+  stream_session *owner = connection->owner;
+
+  const uint64_t start_ns = latency_histogram_now_ns();
+  if (hue_dtls_connect(owner->context, owner->bridge_ip)) {
+    fprintf(stderr, "hue_dtls_connect() failed\n");
+    return NULL;
+  }
+  owner->handshake_ns = latency_histogram_now_ns() - start_ns;
+
+  connection->ret = 0;
+  return NULL;
+}
+
+// Run a step for every bridge at once, one thread each, or in the calling
+// thread if a thread can't be created.
+static void start_bridges(bridge_connection *connections, int connection_count,
+                          void *(*step)(void *)) {
+  for (int i = 0; i < connection_count; i++) {
+    bridge_connection *connection = &connections[i];
+    connection->ret = -1;
+    connection->threaded =
+        !pthread_create(&connection->thread, NULL, step, connection);
+    if (!connection->threaded) {
+      step(connection);
+    }
+  }
+}
+
+// Wait for the step started by start_bridges() to finish on every bridge.
+static int join_bridges(bridge_connection *connections, int connection_count) {
+  int ret = 0;
+  for (int i = 0; i < connection_count; i++) {
+    if (connections[i].threaded) {
+      pthread_join(connections[i].thread, NULL);
+    }
+    if (connections[i].ret) {
+      ret = -1;
+    }
+  }
+  return ret;
+}
+
+// Discover every area, then start them all at once.
+static int start_areas(hue_rest_client *client, stream_session *sessions,
+                       int session_count, bool refresh) {
+  hue_rest_area areas[STREAM_SESSION_MAX_SESSIONS] = {0};
+  for (int i = 0; i < session_count; i++) {
+    stream_session *session = &sessions[i];
+    const uint64_t start_ns = latency_histogram_now_ns();
+    if (discover(client, session, refresh)) {
+      return -1;
+    }
+    session->discover_ns = latency_histogram_now_ns() - start_ns;
+    areas[i] = (hue_rest_area){session->bridge_ip,
+                               session->entertainment_config_id};
+  }
+
+  const uint64_t start_ns = latency_histogram_now_ns();
+  const int ret = hue_rest_client_start(client, areas, session_count);
+  const uint64_t rest_start_ns = latency_histogram_now_ns() - start_ns;
+
+  // Stop every area on disconnect, even if only some of them started.
+  for (int i = 0; i < session_count; i++) {
+    sessions[i].started = true;
+    sessions[i].rest_start_ns = rest_start_ns;
+  }
+
+  if (ret) {
+    fprintf(stderr, "hue_rest_client_start() failed\n");
+    return -1;
+  }
+  return 0;
+}
+
+int stream_session_connect(hue_rest_client *client, stream_session *sessions,
+                           int session_count, bool refresh) {
+  if (!client || !sessions) {
+    fprintf(stderr, "client or sessions is null\n");
+    return -1;
+  }
+
+  // One connection per bridge, owned by the bridge's first session.
+  bridge_connection connections[STREAM_SESSION_MAX_SESSIONS] = {0};
+  int connection_count = 0;
+  for (int i = 0; i < session_count; i++) {
+    bool owner = true;
+    for (int j = 0; j < i && owner; j++) {
+      owner = !same_bridge(&sessions[i], &sessions[j]);
+    }
+
+    if (owner) {
+      connections[connection_count++].owner = &sessions[i];
+    }
+  }
+
+  // Set up DTLS for every bridge while the areas are discovered and started.
+  start_bridges(connections, connection_count, create_context);
+  const int started = start_areas(client, sessions, session_count, refresh);
+  if (join_bridges(connections, connection_count) || started) {
+    stream_session_disconnect(client, sessions, session_count);
+    return -1;
+  }
+
+  start_bridges(connections, connection_count, handshake);
+  if (join_bridges(connections, connection_count)) {
+    stream_session_disconnect(client, sessions, session_count);
+    return -1;
+  }
+
+  // Share each bridge's connection with its other sessions.
+  for (int i = 0; i < connection_count; i++) {
+    for (int j = 0; j < session_count; j++) {
+      if (same_bridge(&sessions[j], connections[i].owner)) {
+        sessions[j].context = connections[i].owner->context;
+      }
+    }
+  }
+
+  return 0;
+}
+
+void stream_session_disconnect(hue_rest_client *client,
+                               stream_session *sessions, int session_count) {
+  if (!client || !sessions) {
+    fprintf(stderr, "client or sessions is null\n");
+    return;
+  }
+
+  hue_rest_area areas[STREAM_SESSION_MAX_SESSIONS] = {0};
+  int area_count = 0;
+  for (int i = 0; i < session_count; i++) {
+    stream_session *session = &sessions[i];
+    if (session->owns_context) {
+      hue_dtls_context_free(session->context);
+    }
+    session->context = NULL;
+    session->owns_context = false;
+
+    if (session->started) {
+      areas[area_count++] = (hue_rest_area){session->bridge_ip,
+                                            session->entertainment_config_id};
+      session->started = false;
+    }
+  }
+
+  // End the entertainment sessions, so the bridges hand the lights back.
+  if (area_count && hue_rest_client_stop(client, areas, area_count)) {
+    fprintf(stderr, "hue_rest_client_stop() failed\n");
+  }
+}
@@ -0,0 +1,247 @@
+#include "wav_reader.h"
+
+#include <stdio.h>     // fileno, fprintf, perror, fopen, fread, setvbuf
+#include <stdlib.h>    // calloc, free, malloc
+#include <string.h>    // memcmp, memcpy, strcmp
+#include <sys/ioctl.h> // ioctl, FIONREAD
+#include <sys/stat.h>  // fstat
+
+#define FORMAT_PCM 1
+#define FORMAT_FLOAT 3
+#define FORMAT_EXTENSIBLE 0xfffe
+
+// The most sample frames one read converts at a time.
+#define BUFFER_FRAMES 1024
+#define MAX_CHANNELS 16
+
+static uint16_t read_u16(const uint8_t *bytes) {
+  return bytes[0] | (uint16_t)bytes[1] << 8;
+}
+
+static uint32_t read_u32(const uint8_t *bytes) {
+  return bytes[0] | (uint32_t)bytes[1] << 8 | (uint32_t)bytes[2] << 16 |
+         (uint32_t)bytes[3] << 24;
+}
+
+// Skip a chunk. Streams can't seek, so it is read and thrown away.
+static int skip(FILE *file, uint32_t size) {
+  uint8_t scratch[256];
+  while (size > 0) {
+    const size_t chunk = size < sizeof(scratch) ? size : sizeof(scratch);
+    if (fread(scratch, 1, chunk, file) != chunk) {
+      return -1;
+    }
+    size -= chunk;
+  }
+  return 0;
+}
+
+static int parse_format(wav_reader *reader, const uint8_t *format,
+                        uint32_t size) {
+  if (size < 16) {
+    return -1;
+  }
+
+  uint16_t tag = read_u16(format);
+  reader->channel_count = read_u16(format + 2);
+  reader->sample_rate = read_u32(format + 4);
+  reader->block_size = read_u16(format + 12);
+  reader->bits_per_sample = read_u16(format + 14);
+
+  // The extensible format keeps the real tag at the start of its subformat.
+  if (tag == FORMAT_EXTENSIBLE) {
+    if (size < 26) {
+      return -1;
+    }
+    tag = read_u16(format + 24);
+  }
+
+  reader->floating_point = tag == FORMAT_FLOAT;
+  const bool supported =
+      tag == FORMAT_FLOAT ? reader->bits_per_sample == 32
+                          : tag == FORMAT_PCM &&
+                                (reader->bits_per_sample == 16 ||
+                                 reader->bits_per_sample == 24 ||
+                                 reader->bits_per_sample == 32);
+  if (!supported) {
+    fprintf(stderr, "WAV format %u with %d-bit samples is not supported\n",
+            tag, reader->bits_per_sample);
+    return -1;
+  }
+
+  if (reader->channel_count < 1 || reader->channel_count > MAX_CHANNELS ||
+      reader->sample_rate <= 0 ||
+      reader->block_size !=
+          reader->channel_count * reader->bits_per_sample / 8) {
+    fprintf(stderr, "WAV format is invalid\n");
+    return -1;
+  }
+
+  return 0;
+}
+
+// Read chunks up to the start of the samples.
+static int parse_header(wav_reader *reader) {
+  uint8_t riff[12] = {0};
+  if (fread(riff, 1, sizeof(riff), reader->file) != sizeof(riff) ||
+      memcmp(riff, "RIFF", 4) || memcmp(riff + 8, "WAVE", 4)) {
+    return -1;
+  }
+
+  bool has_format = false;
+  while (true) {
+    uint8_t header[8] = {0};
+    if (fread(header, 1, sizeof(header), reader->file) != sizeof(header)) {
+      return -1;
+    }
+
+    const uint32_t size = read_u32(header + 4);
+    if (!memcmp(header, "data", 4)) {
+      return has_format ? 0 : -1;
+    }
+
+    if (!memcmp(header, "fmt ", 4) && size <= 64) {
+      uint8_t format[64] = {0};
+      if (fread(format, 1, size, reader->file) != size ||
+          parse_format(reader, format, size)) {
+        return -1;
+      }
+      has_format = true;
+    } else if (skip(reader->file, size)) {
+      return -1;
+    }
+
+    // Chunks are padded to an even size.
+    if (size % 2 && skip(reader->file, 1)) {
+      return -1;
+    }
+  }
+}
+
+wav_reader *wav_reader_open(const char *path) {
+  if (!path) {
+    fprintf(stderr, "path is null\n");
+    return NULL;
+  }
+
+  wav_reader *reader = calloc(1, sizeof(wav_reader));
+  if (!reader) {
+    perror("calloc");
+    return NULL;
+  }
+
+  reader->file = strcmp(path, "-") ? fopen(path, "rb") : stdin;
+  if (!reader->file) {
+    perror("fopen");
+    free(reader);
+    return NULL;
+  }
+
+  // Live samples left in a stdio buffer would be invisible to FIONREAD.
+  struct stat st = {0};
+  reader->live = fstat(fileno(reader->file), &st) || !S_ISREG(st.st_mode);
+  if (reader->live && setvbuf(reader->file, NULL, _IONBF, 0)) {
+    perror("setvbuf");
+    goto error;
+  }
+
+  if (parse_header(reader)) {
+    fprintf(stderr, "%s is not a supported WAV stream\n", path);
+    goto error;
+  }
+
+  reader->buffer = malloc((size_t)BUFFER_FRAMES * reader->block_size);
+  if (!reader->buffer) {
+    perror("malloc");
+    goto error;
+  }
+
+  return reader;
+
+error:
+  wav_reader_close(reader);
+  return NULL;
+}
+
+static float decode(const wav_reader *reader, const uint8_t *sample) {
+  switch (reader->bits_per_sample) {
+  case 16:
+    return (int16_t)read_u16(sample) / 32768.0f;
+  case 24: {
+    // Shift the sign bit into place before scaling back down.
+    const int32_t value =
+        (int32_t)((uint32_t)sample[0] << 8 | (uint32_t)sample[1] << 16 |
+                  (uint32_t)sample[2] << 24);
+    return value / 2147483648.0f;
+  }
+  default:
+    if (reader->floating_point) {
+      const uint32_t bits = read_u32(sample);
+      float value = 0.0f;
+      memcpy(&value, &bits, sizeof(value));
+      return value;
+    }
+    return (int32_t)read_u32(sample) / 2147483648.0f;
+  }
+}
+
+int wav_reader_read(wav_reader *reader, float *samples, int count) {
+  if (!reader || !samples) {
+    fprintf(stderr, "reader or samples is null\n");
+    return -1;
+  }
+
+  const int bytes_per_sample = reader->bits_per_sample / 8;
+  const float scale = 1.0f / reader->channel_count;
+  int read = 0;
+  while (read < count) {
+    const int wanted =
+        count - read < BUFFER_FRAMES ? count - read : BUFFER_FRAMES;
+    const size_t frames =
+        fread(reader->buffer, reader->block_size, wanted, reader->file);
+    for (size_t i = 0; i < frames; i++) {
+      const uint8_t *frame = reader->buffer + i * reader->block_size;
+      float sum = 0.0f;
+      for (int j = 0; j < reader->channel_count; j++) {
+        sum += decode(reader, frame + j * bytes_per_sample);
+      }
+      samples[read++] = sum * scale;
+    }
+
+    if ((int)frames < wanted) {
+      if (ferror(reader->file)) {
+        fprintf(stderr, "fread() failed\n");
+        return -1;
+      }
+      break;
+    }
+  }
+
+  reader->frame_count += read;
+  return read;
+}
+
+int wav_reader_available(const wav_reader *reader) {
+  if (!reader) {
+    fprintf(stderr, "reader is null\n");
+    return 0;
+  }
+
+  int bytes = 0;
+  if (!reader->live || ioctl(fileno(reader->file), FIONREAD, &bytes)) {
+    return 0;
+  }
+  return bytes / reader->block_size;
+}
+
+void wav_reader_close(wav_reader *reader) {
+  if (!reader) {
+    return;
+  }
+
+  if (reader->file && reader->file != stdin) {
+    fclose(reader->file);
+  }
+  free(reader->buffer);
+  free(reader);
+}
@@ -0,0 +1,231 @@
+#include "y4m_reader.h"
+
+#include <stdio.h>  // fprintf, perror, fopen, fgets, fread, sscanf
+#include <stdlib.h> // calloc, free, malloc
+#include <string.h> // strchr, strcmp, strcspn, strlen, strncmp, strtok_r
+
+#define Y4M_MAGIC "YUV4MPEG2 "
+#define FRAME_MAGIC "FRAME"
+#define MAX_HEADER_SIZE 1024
+
+// Larger frames than 8K are rejected, to bound the buffer.
+#define MAX_DIMENSION 8192
+
+#define NANOSECONDS_PER_SECOND 1000000000L
+
+typedef struct chroma_format chroma_format;
+struct chroma_format {
+  const char *tag;
+  int shift_x;
+  int shift_y;
+  bool has_chroma;
+};
+
+// The 8-bit formats. The 4:2:0 variants only differ in where the chroma
+// samples sit, which doesn't matter for averaging.
+static const chroma_format chroma_formats[] = {
+    {"420jpeg", 1, 1, true}, {"420paldv", 1, 1, true},
+    {"420mpeg2", 1, 1, true}, {"420", 1, 1, true},
+    {"422", 1, 0, true},      {"444", 0, 0, true},
+    {"mono", 0, 0, false},
+};
+
+static int parse_header(y4m_reader *reader, char *header) {
+  y4m_frame *frame = &reader->frame;
+  const char *chroma = "420jpeg";
+  char *save = NULL;
+  for (char *field = strtok_r(header, " ", &save); field;
+       field = strtok_r(NULL, " ", &save)) {
+    int consumed = 0;
+    switch (field[0]) {
+    case 'W':
+      if (sscanf(field, "W%d%n", &frame->width, &consumed) != 1 ||
+          field[consumed] != '\0') {
+        return -1;
+      }
+      break;
+    case 'H':
+      if (sscanf(field, "H%d%n", &frame->height, &consumed) != 1 ||
+          field[consumed] != '\0') {
+        return -1;
+      }
+      break;
+    case 'F':
+      if (sscanf(field, "F%d:%d%n", &reader->frame_rate_numerator,
+                 &reader->frame_rate_denominator, &consumed) != 2 ||
+          field[consumed] != '\0') {
+        return -1;
+      }
+      break;
+    case 'C':
+      chroma = field + 1;
+      break;
+    case 'X':
+      if (!strcmp(field, "XCOLORRANGE=FULL")) {
+        frame->full_range = true;
+      }
+      break;
+    default:
+      // Interlacing and the pixel aspect ratio don't change the samples.
+      break;
+    }
+  }
+
+  if (frame->width <= 0 || frame->width > MAX_DIMENSION ||
+      frame->height <= 0 || frame->height > MAX_DIMENSION) {
+    fprintf(stderr, "Y4M frame size %dx%d is not supported\n", frame->width,
+            frame->height);
+    return -1;
+  }
+
+  if (reader->frame_rate_numerator <= 0 ||
+      reader->frame_rate_denominator <= 0) {
+    fprintf(stderr, "Y4M stream has no frame rate\n");
+    return -1;
+  }
+
+  const chroma_format *format = NULL;
+  for (size_t i = 0; i < sizeof(chroma_formats) / sizeof(chroma_formats[0]);
+       i++) {
+    if (!strcmp(chroma, chroma_formats[i].tag)) {
+      format = &chroma_formats[i];
+      break;
+    }
+  }
+  if (!format) {
+    fprintf(stderr, "Y4M color space %s is not supported\n", chroma);
+    return -1;
+  }
+
+  frame->chroma_shift_x = format->shift_x;
+  frame->chroma_shift_y = format->shift_y;
+  frame->has_chroma = format->has_chroma;
+  return 0;
+}
+
+// Lay the planes out in the buffer, one after another as the stream has them.
+static int allocate_frame(y4m_reader *reader) {
+  y4m_frame *frame = &reader->frame;
+  const size_t luma_size = (size_t)frame->width * frame->height;
+  const int chroma_width =
+      (frame->width + (1 << frame->chroma_shift_x) - 1) >>
+      frame->chroma_shift_x;
+  const int chroma_height =
+      (frame->height + (1 << frame->chroma_shift_y) - 1) >>
+      frame->chroma_shift_y;
+  const size_t chroma_size =
+      frame->has_chroma ? (size_t)chroma_width * chroma_height : 0;
+
+  reader->frame_size = luma_size + 2 * chroma_size;
+  reader->buffer = malloc(reader->frame_size);
+  if (!reader->buffer) {
+    perror("malloc");
+    return -1;
+  }
+
+  frame->planes[0] = reader->buffer;
+  frame->strides[0] = frame->width;
+  if (frame->has_chroma) {
+    frame->planes[1] = reader->buffer + luma_size;
+    frame->planes[2] = reader->buffer + luma_size + chroma_size;
+    frame->strides[1] = chroma_width;
+    frame->strides[2] = chroma_width;
+  }
+  return 0;
+}
+
+y4m_reader *y4m_reader_open(const char *path) {
+  if (!path) {
+    fprintf(stderr, "path is null\n");
+    return NULL;
+  }
+
+  y4m_reader *reader = calloc(1, sizeof(y4m_reader));
+  if (!reader) {
+    perror("calloc");
+    return NULL;
+  }
+
+  reader->file = strcmp(path, "-") ? fopen(path, "rb") : stdin;
+  if (!reader->file) {
+    perror("fopen");
+    free(reader);
+    return NULL;
+  }
+
+  char header[MAX_HEADER_SIZE] = {0};
+  if (!fgets(header, sizeof(header), reader->file) ||
+      strncmp(header, Y4M_MAGIC, strlen(Y4M_MAGIC)) ||
+      !strchr(header, '\n')) {
+    fprintf(stderr, "%s is not a Y4M stream\n", path);
+    goto error;
+  }
+
+  header[strcspn(header, "\n")] = '\0';
+  if (parse_header(reader, header + strlen(Y4M_MAGIC))) {
+    fprintf(stderr, "%s has an invalid Y4M header\n", path);
+    goto error;
+  }
+
+  if (allocate_frame(reader)) {
+    goto error;
+  }
+
+  return reader;
+
+error:
+  y4m_reader_close(reader);
+  return NULL;
+}
+
+int y4m_reader_read(y4m_reader *reader) {
+  if (!reader) {
+    fprintf(stderr, "reader is null\n");
+    return -1;
+  }
+
+  // Each frame starts with FRAME and optional parameters on a line of its own.
+  char header[MAX_HEADER_SIZE] = {0};
+  if (!fgets(header, sizeof(header), reader->file)) {
+    return ferror(reader->file) ? -1 : 0;
+  }
+
+  if (strncmp(header, FRAME_MAGIC, strlen(FRAME_MAGIC)) ||
+      !strchr(header, '\n')) {
+    fprintf(stderr, "Y4M frame %llu has an invalid header\n",
+            (unsigned long long)reader->frame_count);
+    return -1;
+  }
+
+  const size_t read = fread(reader->buffer, 1, reader->frame_size,
+                            reader->file);
+  if (read != reader->frame_size) {
+    // A stream cut off mid-frame ends there.
+    return ferror(reader->file) ? -1 : 0;
+  }
+
+  reader->frame_count++;
+  return 1;
+}
+
+long y4m_reader_frame_period_ns(const y4m_reader *reader) {
+  if (!reader) {
+    fprintf(stderr, "reader is null\n");
+    return 0;
+  }
+
+  return (long)((long long)NANOSECONDS_PER_SECOND *
+                reader->frame_rate_denominator / reader->frame_rate_numerator);
+}
+
+void y4m_reader_close(y4m_reader *reader) {
+  if (!reader) {
+    return;
+  }
+
+  if (reader->file && reader->file != stdin) {
+    fclose(reader->file);
+  }
+  free(reader->buffer);
+  free(reader);
+}